@@ -13,9 +13,15 @@
 
 typedef unsigned short BlockIndex;
 
-const unsigned char BITMASK_BLOCK_LIGHT = 0x0F;
-const unsigned char BITMASK_BLOCK_IS_SKY = 0x10;
-const unsigned char BITMASK_BLOCK_LIGHT_DIRTY = 0x20;
+const int LIGHT_DIRTY_BITS_PER_WORD_EXPONENT = 5;
+const BlockIndex LIGHT_DIRTY_BIT_MASK = (1 << LIGHT_DIRTY_BITS_PER_WORD_EXPONENT) - 1;
+
+//a light value holds light from light-emitting blocks in its low nibble and sky light in its high nibble
+//sky light is stored as if it were always full daylight; the current sky level is only applied when vertexes are colored
+const unsigned char MAX_LIGHT_LEVEL = 15;
+const int SKY_LIGHT_SHIFT = 4;
+const unsigned char BLOCK_LIGHT_MASK = 0x0F;
+const unsigned char FULL_SKY_LIGHT_VALUE = MAX_LIGHT_LEVEL << SKY_LIGHT_SHIFT;
 
 class Chunk;
 struct BlockLocation{
@@ -27,94 +33,61 @@ struct BlockLocation{
 };
 typedef std::vector<BlockLocation> BlockLocations;
 
+//thin view over one block's light value and its bit in the chunk's light-dirty bitset
+//block types are stored separately in each chunk's PalettedBlockStorage
 struct Block{
 public:
-	unsigned char m_type;
-	unsigned char m_lightingAndFlags;
+	unsigned char* m_lightValue;
+	unsigned int* m_lightDirtyWord;
+	unsigned int m_lightDirtyBit;
 
-	inline Block():m_type(BT_INVALID),m_lightingAndFlags(0){}
-	inline Block(unsigned char type):m_type(type),m_lightingAndFlags(0){}
+	inline Block(unsigned char* lightValue, unsigned int* lightDirtyBits, BlockIndex blockIndex)
+	:m_lightValue(lightValue),
+	m_lightDirtyWord(&lightDirtyBits[blockIndex >> LIGHT_DIRTY_BITS_PER_WORD_EXPONENT]),
+	m_lightDirtyBit(1u << (blockIndex & LIGHT_DIRTY_BIT_MASK)){}
 
 	unsigned char GetLightValue() const;
 	void SetLightValue(unsigned char lightValue);
-
-	inline SoundIDs GetBreakSounds() const{ return g_blockDefinitions[m_type].m_breakSounds;}
-	inline SoundIDs GetPlaceSounds() const{ return g_blockDefinitions[m_type].m_placeSounds;}
-	inline SoundIDs GetWalkSounds() const{ return g_blockDefinitions[m_type].m_walkSounds;}
 	
 	void DirtyLighting();
 	void UndirtyLighting();
 
-	void MarkAsSky();
-	void UnmarkAsSky();
-
-	bool IsVisible() const;
 	bool IsLightingDirty() const;
-	bool IsSky() const;
 };
 
 ///=====================================================
 /// 
 ///=====================================================
 inline unsigned char Block::GetLightValue() const{
-	return m_lightingAndFlags & BITMASK_BLOCK_LIGHT;
+	return *m_lightValue;
 }
 
 ///=====================================================
 /// 
 ///=====================================================
 inline void Block::SetLightValue(unsigned char lightValue){
-	m_lightingAndFlags &= ~BITMASK_BLOCK_LIGHT;
-	m_lightingAndFlags |= lightValue;
+	*m_lightValue = lightValue;
 }
 
 ///=====================================================
 /// 
 ///=====================================================
 inline void Block::DirtyLighting(){
-	m_lightingAndFlags |= BITMASK_BLOCK_LIGHT_DIRTY;
+	*m_lightDirtyWord |= m_lightDirtyBit;
 }
 
 ///=====================================================
 /// 
 ///=====================================================
 inline void Block::UndirtyLighting(){
-	m_lightingAndFlags &= ~BITMASK_BLOCK_LIGHT_DIRTY;
-}
-
-///=====================================================
-/// 
-///=====================================================
-inline bool Block::IsVisible() const{
-	return g_blockDefinitions[m_type].m_isVisible;
-}
-
-///=====================================================
-/// 
-///=====================================================
-inline void Block::MarkAsSky(){
-	m_lightingAndFlags |= BITMASK_BLOCK_IS_SKY;
-}
-
-///=====================================================
-/// 
-///=====================================================
-inline void Block::UnmarkAsSky(){
-	m_lightingAndFlags &= ~BITMASK_BLOCK_IS_SKY;
+	*m_lightDirtyWord &= ~m_lightDirtyBit;
 }
 
 ///=====================================================
 /// 
 ///=====================================================
 inline bool Block::IsLightingDirty() const{
-	return ((m_lightingAndFlags & BITMASK_BLOCK_LIGHT_DIRTY) == BITMASK_BLOCK_LIGHT_DIRTY);
-}
-
-///=====================================================
-/// 
-///=====================================================
-inline bool Block::IsSky() const{
-	return ((m_lightingAndFlags & BITMASK_BLOCK_IS_SKY) == BITMASK_BLOCK_IS_SKY);
+	return (*m_lightDirtyWord & m_lightDirtyBit) != 0;
 }
 
 #endif
\ No newline at end of file
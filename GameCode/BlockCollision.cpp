@@ -0,0 +1,168 @@
+//=====================================================
+// BlockCollision.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "BlockCollision.hpp"
+#include <math.h>
+
+///=====================================================
+/// 
+///=====================================================
+static inline float GetAxis(const Vec3& vec, int axis){
+	return (axis == 0) ? vec.x : ((axis == 1) ? vec.y : vec.z);
+}
+
+///=====================================================
+/// the blocks a box overlaps, ignoring ones it only touches
+///=====================================================
+static inline void GetOverlappedCells(const AABB3D& box, int* out_cellMins, int* out_cellMaxs){
+	for (int axis = 0; axis < 3; ++axis){
+		out_cellMins[axis] = RoundDownToInt(GetAxis(box.mins, axis) + COLLISION_SKIN);
+		out_cellMaxs[axis] = (int)ceil(GetAxis(box.maxs, axis) - COLLISION_SKIN) - 1;
+	}
+}
+
+///=====================================================
+/// false if the box only touches the block, such as a block placed right beside or beneath the player
+///=====================================================
+bool DoesBoxOverlapBlock(const AABB3D& box, int blockX, int blockY, int blockZ){
+	int cellMins[3], cellMaxs[3];
+	GetOverlappedCells(box, cellMins, cellMaxs);
+	return blockX >= cellMins[0] && blockX <= cellMaxs[0]
+		&& blockY >= cellMins[1] && blockY <= cellMaxs[1]
+		&& blockZ >= cellMins[2] && blockZ <= cellMaxs[2];
+}
+
+///=====================================================
+/// 
+///=====================================================
+BlockCollisionSolver::BlockCollisionSolver(const Chunks& chunks)
+:m_blockAccessor(chunks){
+}
+
+///=====================================================
+/// 
+///=====================================================
+bool BlockCollisionSolver::IsBlockSolid(int blockX, int blockY, int blockZ, unsigned char& out_blockType){
+	out_blockType = BT_AIR;
+	if (blockZ >= BLOCKS_PER_CHUNK_Z)
+		return false;
+	if (blockZ < 0)
+		return true;
+
+	const Chunk* chunk = m_blockAccessor.GetChunkAtBlockCoords(blockX, blockY);
+	if (chunk == NULL)
+		return true;
+
+	out_blockType = chunk->GetBlockType(Chunk::GetIndexAtLocalCoords(LocalCoords(blockX & CHUNK_X_MASK, blockY & CHUNK_Y_MASK, blockZ)));
+	return g_blockDefinitions[out_blockType].m_isSolid;
+}
+
+///=====================================================
+/// cell ranges are inclusive
+///=====================================================
+bool BlockCollisionSolver::FindSolidBlockInCells(const int* cellMins, const int* cellMaxs, unsigned char& out_blockType){
+	for (int blockZ = cellMins[2]; blockZ <= cellMaxs[2]; ++blockZ){
+		for (int blockY = cellMins[1]; blockY <= cellMaxs[1]; ++blockY){
+			for (int blockX = cellMins[0]; blockX <= cellMaxs[0]; ++blockX){
+				if (IsBlockSolid(blockX, blockY, blockZ, out_blockType))
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+///=====================================================
+/// Visits the layers of blocks ahead of the box's leading face, nearest first, and returns how far it can move before touching one
+///=====================================================
+float BlockCollisionSolver::SweepBoxAlongAxis(const AABB3D& box, int axis, float distance, unsigned char& out_blockingType){
+	int cellMins[3], cellMaxs[3];
+	GetOverlappedCells(box, cellMins, cellMaxs);
+
+	if (distance > 0.0f){
+		const float leadingFace = GetAxis(box.maxs, axis);
+		const int lastLayer = (int)ceil(leadingFace + distance) - 1;
+		for (int layer = (int)ceil(leadingFace - COLLISION_SKIN); layer <= lastLayer; ++layer){
+			cellMins[axis] = cellMaxs[axis] = layer;
+			if (FindSolidBlockInCells(cellMins, cellMaxs, out_blockingType))
+				return min(distance, (float)layer - leadingFace);
+		}
+	}
+	else{
+		const float leadingFace = GetAxis(box.mins, axis);
+		const int lastLayer = RoundDownToInt(leadingFace + distance);
+		for (int layer = RoundDownToInt(leadingFace + COLLISION_SKIN) - 1; layer >= lastLayer; --layer){
+			cellMins[axis] = cellMaxs[axis] = layer;
+			if (FindSolidBlockInCells(cellMins, cellMaxs, out_blockingType))
+				return max(distance, (float)(layer + 1) - leadingFace);
+		}
+	}
+	return distance;
+}
+
+///=====================================================
+/// 
+///=====================================================
+BoxMovementResult BlockCollisionSolver::MoveBox(AABB3D& box, const Vec3& translation){
+	static const int AXIS_ORDER[3] = { 2, 0, 1 }; //vertical first, so walking boxes settle onto the ground before sliding
+	BoxMovementResult result;
+
+	for (int axisIndex = 0; axisIndex < 3; ++axisIndex){
+		const int axis = AXIS_ORDER[axisIndex];
+		const float distance = GetAxis(translation, axis);
+		if (distance == 0.0f)
+			continue;
+
+		unsigned char blockingType = BT_AIR;
+		const float allowedDistance = SweepBoxAlongAxis(box, axis, distance, blockingType);
+		if (allowedDistance != distance){
+			result.m_didCollideOnAxis[axis] = true;
+			if (axis == 2 && distance < 0.0f)
+				result.m_blockTypeBelow = blockingType;
+		}
+
+		const Vec3 step((axis == 0) ? allowedDistance : 0.0f, (axis == 1) ? allowedDistance : 0.0f, (axis == 2) ? allowedDistance : 0.0f);
+		box.Translate(step);
+		result.m_appliedTranslation += step;
+	}
+
+	return result;
+}
+
+///=====================================================
+/// Lifts a box that is stuck inside solid blocks onto the highest one it overlaps, until it is free.
+/// Returns false, without moving the box, if it overlaps an inactive chunk.
+///=====================================================
+bool BlockCollisionSolver::PushBoxUpOutOfBlocks(AABB3D& box, float& out_liftDistance){
+	out_liftDistance = 0.0f;
+
+	int cellMins[3], cellMaxs[3];
+	GetOverlappedCells(box, cellMins, cellMaxs);
+	for (int blockY = cellMins[1]; blockY <= cellMaxs[1]; ++blockY){
+		for (int blockX = cellMins[0]; blockX <= cellMaxs[0]; ++blockX){
+			if (m_blockAccessor.GetChunkAtBlockCoords(blockX, blockY) == NULL)
+				return false;
+		}
+	}
+
+	for (;;){
+		bool isStuck = false;
+		for (int blockZ = cellMaxs[2]; blockZ >= cellMins[2] && !isStuck; --blockZ){ //highest layer first
+			const int layerMins[3] = { cellMins[0], cellMins[1], blockZ };
+			const int layerMaxs[3] = { cellMaxs[0], cellMaxs[1], blockZ };
+			unsigned char blockType;
+			if (FindSolidBlockInCells(layerMins, layerMaxs, blockType)){
+				const float liftDistance = (float)(blockZ + 1) - box.mins.z;
+				box.Translate(Vec3(0.0f, 0.0f, liftDistance));
+				out_liftDistance += liftDistance;
+				isStuck = true;
+			}
+		}
+		if (!isStuck)
+			return true;
+
+		GetOverlappedCells(box, cellMins, cellMaxs);
+	}
+}
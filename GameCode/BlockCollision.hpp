@@ -0,0 +1,58 @@
+//=====================================================
+// BlockCollision.hpp
+// by Andrew Socha
+//=====================================================
+
+#pragma once
+
+#ifndef __included_BlockCollision__
+#define __included_BlockCollision__
+
+#include "WorldBlockAccessor.hpp"
+#include "BlockDefinition.hpp"
+#include "Engine/Math/AABB3D.hpp"
+
+const float COLLISION_SKIN = 0.001f; //faces closer than this to a block boundary count as touching it, not overlapping it
+
+struct BoxMovementResult{
+public:
+	inline BoxMovementResult()
+	:m_appliedTranslation(0.0f, 0.0f, 0.0f),
+	m_blockTypeBelow(BT_AIR){
+		m_didCollideOnAxis[0] = m_didCollideOnAxis[1] = m_didCollideOnAxis[2] = false;
+	}
+
+	Vec3 m_appliedTranslation;
+	bool m_didCollideOnAxis[3]; //x, y, z
+	unsigned char m_blockTypeBelow; //the solid block that stopped a downward move, or BT_AIR
+};
+
+///=====================================================
+/// Moves axis-aligned boxes of any size through the solid blocks of the active chunks.
+/// Movement is resolved one axis at a time (z, then x, then y) against every block the box sweeps across, so boxes slide along walls and never tunnel.
+/// Blocks in inactive chunks and below the world are solid; above the world is open.
+/// Never allocates, and looks chunks up through a WorldBlockAccessor, so one solver can serve many queries in a frame.
+///=====================================================
+class BlockCollisionSolver{
+private:
+	WorldBlockAccessor m_blockAccessor;
+
+	bool FindSolidBlockInCells(const int* cellMins, const int* cellMaxs, unsigned char& out_blockType);
+	float SweepBoxAlongAxis(const AABB3D& box, int axis, float distance, unsigned char& out_blockingType);
+
+	BlockCollisionSolver& operator=(const BlockCollisionSolver&);
+
+public:
+	explicit BlockCollisionSolver(const Chunks& chunks);
+
+	bool IsBlockSolid(int blockX, int blockY, int blockZ, unsigned char& out_blockType);
+	BoxMovementResult MoveBox(AABB3D& box, const Vec3& translation);
+	bool PushBoxUpOutOfBlocks(AABB3D& box, float& out_liftDistance);
+};
+
+///=====================================================
+/// Whether the box is partly inside the block's cell, with the same skin the solver uses, so a box resting against a block doesn't overlap it
+///=====================================================
+bool DoesBoxOverlapBlock(const AABB3D& box, int blockX, int blockY, int blockZ);
+
+#endif
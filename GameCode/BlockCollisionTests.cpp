@@ -0,0 +1,378 @@
+//=====================================================
+// BlockCollisionTests.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "TestHarness.hpp"
+#include "TestWorld.hpp"
+#include "BlockCollision.hpp"
+#include <math.h>
+
+const float COLLISION_TEST_TOLERANCE = 0.0001f;
+const float PLAYER_TEST_WIDTH = 0.6f;
+const float PLAYER_TEST_HEIGHT = 1.8f;
+const int FLOOR_TEST_HEIGHT = 10; //every floor's top face is at z == 11
+
+///=====================================================
+/// 
+///=====================================================
+static bool IsNearly(float value, float expected){
+	return fabs(value - expected) <= COLLISION_TEST_TOLERANCE;
+}
+
+///=====================================================
+/// a box the size of the player, centered on x and y with its feet at z
+///=====================================================
+static const AABB3D MakePlayerBox(float centerX, float centerY, float feetZ){
+	const float halfWidth = PLAYER_TEST_WIDTH * 0.5f;
+	return AABB3D(Vec3(centerX - halfWidth, centerY - halfWidth, feetZ), Vec3(centerX + halfWidth, centerY + halfWidth, feetZ + PLAYER_TEST_HEIGHT));
+}
+
+///=====================================================
+/// the three chunks along each axis around the origin chunk, all active, with a stone floor under chunk 0, 0
+///=====================================================
+static void SetUpFlatTestWorld(TestWorld& world){
+	world.AddAirChunks(ChunkCoords(-1, -1), ChunkCoords(1, 1));
+	world.FillBlocks(0, 0, FLOOR_TEST_HEIGHT, BLOCKS_PER_CHUNK_X - 1, BLOCKS_PER_CHUNK_Y - 1, FLOOR_TEST_HEIGHT, BT_STONE);
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void TestBoxLandsOnFloor(){
+	TestWorld world;
+	SetUpFlatTestWorld(world);
+	BlockCollisionSolver solver(world.m_chunks);
+
+	AABB3D box = MakePlayerBox(5.5f, 5.5f, 13.25f);
+	const BoxMovementResult result = solver.MoveBox(box, Vec3(0.0f, 0.0f, -5.0f));
+	TEST_CHECK(IsNearly(box.mins.z, 11.0f));
+	TEST_CHECK(IsNearly(result.m_appliedTranslation.z, -2.25f));
+	TEST_CHECK(result.m_didCollideOnAxis[2]);
+	TEST_CHECK(!result.m_didCollideOnAxis[0] && !result.m_didCollideOnAxis[1]);
+	TEST_CHECK(result.m_blockTypeBelow == BT_STONE);
+
+	//resting on the floor, gravity keeps colliding without moving the box
+	const BoxMovementResult restingResult = solver.MoveBox(box, Vec3(0.0f, 0.0f, -0.1f));
+	TEST_CHECK(restingResult.m_appliedTranslation.z == 0.0f);
+	TEST_CHECK(restingResult.m_didCollideOnAxis[2]);
+	TEST_CHECK(restingResult.m_blockTypeBelow == BT_STONE);
+}
+
+///=====================================================
+/// the block type below is what the movement code uses to pick ice friction
+///=====================================================
+static void TestBoxLandsOnIce(){
+	TestWorld world;
+	SetUpFlatTestWorld(world);
+	world.SetBlockType(5, 5, FLOOR_TEST_HEIGHT, BT_ICE);
+	BlockCollisionSolver solver(world.m_chunks);
+
+	AABB3D box = MakePlayerBox(5.5f, 5.5f, 12.0f);
+	const BoxMovementResult result = solver.MoveBox(box, Vec3(0.0f, 0.0f, -3.0f));
+	TEST_CHECK(IsNearly(box.mins.z, 11.0f));
+	TEST_CHECK(result.m_blockTypeBelow == BT_ICE);
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void TestBoxFallsThroughWater(){
+	TestWorld world;
+	SetUpFlatTestWorld(world);
+	world.FillBlocks(4, 4, FLOOR_TEST_HEIGHT + 1, 6, 6, FLOOR_TEST_HEIGHT + 2, BT_WATER);
+	BlockCollisionSolver solver(world.m_chunks);
+
+	AABB3D box = MakePlayerBox(5.5f, 5.5f, 15.0f);
+	const BoxMovementResult result = solver.MoveBox(box, Vec3(0.0f, 0.0f, -10.0f));
+	TEST_CHECK(IsNearly(box.mins.z, 11.0f));
+	TEST_CHECK(result.m_blockTypeBelow == BT_STONE);
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void TestBoxStopsAtWallAndSlides(){
+	TestWorld world;
+	SetUpFlatTestWorld(world);
+	world.FillBlocks(8, 0, FLOOR_TEST_HEIGHT + 1, 8, BLOCKS_PER_CHUNK_Y - 1, FLOOR_TEST_HEIGHT + 3, BT_STONE);
+	BlockCollisionSolver solver(world.m_chunks);
+
+	AABB3D box = MakePlayerBox(6.5f, 5.5f, 11.0f);
+	BoxMovementResult result = solver.MoveBox(box, Vec3(5.0f, 0.0f, 0.0f));
+	TEST_CHECK(IsNearly(box.maxs.x, 8.0f));
+	TEST_CHECK(result.m_didCollideOnAxis[0]);
+
+	//pushing diagonally into the wall keeps the motion along it
+	box = MakePlayerBox(6.5f, 5.5f, 11.0f);
+	result = solver.MoveBox(box, Vec3(3.0f, 2.0f, 0.0f));
+	TEST_CHECK(IsNearly(box.maxs.x, 8.0f));
+	TEST_CHECK(IsNearly(result.m_appliedTranslation.y, 2.0f));
+	TEST_CHECK(result.m_didCollideOnAxis[0] && !result.m_didCollideOnAxis[1]);
+}
+
+///=====================================================
+/// a box exactly touching a face is blocked into it, but free to move along it or away from it
+///=====================================================
+static void TestTouchingBoxIsNotStuck(){
+	TestWorld world;
+	SetUpFlatTestWorld(world);
+	world.FillBlocks(8, 0, FLOOR_TEST_HEIGHT + 1, 8, BLOCKS_PER_CHUNK_Y - 1, FLOOR_TEST_HEIGHT + 3, BT_STONE);
+	BlockCollisionSolver solver(world.m_chunks);
+
+	AABB3D box(Vec3(7.4f, 5.0f, 11.0f), Vec3(8.0f, 5.6f, 12.8f));
+	BoxMovementResult result = solver.MoveBox(box, Vec3(1.0f, 0.0f, 0.0f));
+	TEST_CHECK(result.m_appliedTranslation.x == 0.0f);
+	TEST_CHECK(result.m_didCollideOnAxis[0]);
+
+	result = solver.MoveBox(box, Vec3(0.0f, 3.0f, 0.0f));
+	TEST_CHECK(IsNearly(result.m_appliedTranslation.y, 3.0f));
+	TEST_CHECK(!result.m_didCollideOnAxis[1]);
+
+	result = solver.MoveBox(box, Vec3(-1.0f, 0.0f, 0.0f));
+	TEST_CHECK(IsNearly(result.m_appliedTranslation.x, -1.0f));
+}
+
+///=====================================================
+/// a move much longer than a block still stops at a one block thick wall, even past a chunk border
+///=====================================================
+static void TestLargeMoveDoesNotTunnel(){
+	TestWorld world;
+	SetUpFlatTestWorld(world);
+	world.FillBlocks(20, 0, FLOOR_TEST_HEIGHT + 1, 20, BLOCKS_PER_CHUNK_Y - 1, FLOOR_TEST_HEIGHT + 3, BT_STONE);
+	BlockCollisionSolver solver(world.m_chunks);
+
+	AABB3D box = MakePlayerBox(5.5f, 5.5f, 11.0f);
+	const BoxMovementResult result = solver.MoveBox(box, Vec3(50.0f, 0.0f, 0.0f));
+	TEST_CHECK(IsNearly(box.maxs.x, 20.0f));
+	TEST_CHECK(result.m_didCollideOnAxis[0]);
+}
+
+///=====================================================
+/// many tiny steps into a wall end touching it, never inside it
+///=====================================================
+static void TestSmallStepsSettleAgainstWall(){
+	TestWorld world;
+	SetUpFlatTestWorld(world);
+	world.FillBlocks(8, 0, FLOOR_TEST_HEIGHT + 1, 8, BLOCKS_PER_CHUNK_Y - 1, FLOOR_TEST_HEIGHT + 3, BT_STONE);
+	BlockCollisionSolver solver(world.m_chunks);
+
+	AABB3D box = MakePlayerBox(6.5f, 5.5f, 11.0f);
+	bool didEverOverlapWall = false;
+	for (int step = 0; step < 1000; ++step){
+		solver.MoveBox(box, Vec3(0.01f, 0.0f, -0.01f));
+		if (box.maxs.x > 8.0f || box.mins.z < 11.0f)
+			didEverOverlapWall = true;
+	}
+	TEST_CHECK(!didEverOverlapWall);
+	TEST_CHECK(IsNearly(box.maxs.x, 8.0f));
+	TEST_CHECK(IsNearly(box.mins.z, 11.0f));
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void TestBoxHitsCeiling(){
+	TestWorld world;
+	SetUpFlatTestWorld(world);
+	world.FillBlocks(0, 0, FLOOR_TEST_HEIGHT + 3, BLOCKS_PER_CHUNK_X - 1, BLOCKS_PER_CHUNK_Y - 1, FLOOR_TEST_HEIGHT + 3, BT_STONE);
+	BlockCollisionSolver solver(world.m_chunks);
+
+	AABB3D box = MakePlayerBox(5.5f, 5.5f, 11.0f);
+	const BoxMovementResult result = solver.MoveBox(box, Vec3(0.0f, 0.0f, 2.0f));
+	TEST_CHECK(IsNearly(box.maxs.z, 13.0f));
+	TEST_CHECK(result.m_didCollideOnAxis[2]);
+	TEST_CHECK(result.m_blockTypeBelow == BT_AIR);
+}
+
+///=====================================================
+/// a box wider than a block lands on a single block under any part of it
+///=====================================================
+static void TestLargeBoxLandsOnSinglePillar(){
+	TestWorld world;
+	world.AddAirChunks(ChunkCoords(-1, -1), ChunkCoords(1, 1));
+	world.SetBlockType(7, 7, FLOOR_TEST_HEIGHT, BT_SAND);
+	BlockCollisionSolver solver(world.m_chunks);
+
+	AABB3D box(Vec3(5.25f, 5.25f, 15.0f), Vec3(7.75f, 7.75f, 17.5f));
+	const BoxMovementResult result = solver.MoveBox(box, Vec3(0.0f, 0.0f, -10.0f));
+	TEST_CHECK(IsNearly(box.mins.z, 11.0f));
+	TEST_CHECK(result.m_blockTypeBelow == BT_SAND);
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void TestOnlyNarrowBoxFitsThroughGap(){
+	TestWorld world;
+	SetUpFlatTestWorld(world);
+	world.FillBlocks(8, 0, FLOOR_TEST_HEIGHT + 1, 8, BLOCKS_PER_CHUNK_Y - 1, FLOOR_TEST_HEIGHT + 3, BT_STONE);
+	world.FillBlocks(8, 5, FLOOR_TEST_HEIGHT + 1, 8, 5, FLOOR_TEST_HEIGHT + 2, BT_AIR);
+	BlockCollisionSolver solver(world.m_chunks);
+
+	AABB3D narrowBox = MakePlayerBox(6.5f, 5.5f, 11.0f);
+	BoxMovementResult result = solver.MoveBox(narrowBox, Vec3(4.0f, 0.0f, 0.0f));
+	TEST_CHECK(IsNearly(result.m_appliedTranslation.x, 4.0f));
+	TEST_CHECK(!result.m_didCollideOnAxis[0]);
+
+	AABB3D wideBox(Vec3(5.9f, 4.9f, 11.0f), Vec3(7.1f, 6.1f, 12.8f));
+	result = solver.MoveBox(wideBox, Vec3(4.0f, 0.0f, 0.0f));
+	TEST_CHECK(IsNearly(wideBox.maxs.x, 8.0f));
+	TEST_CHECK(result.m_didCollideOnAxis[0]);
+
+	//the gap is two blocks high, so a three block tall box can't pass either
+	AABB3D tallBox(Vec3(6.2f, 5.2f, 11.0f), Vec3(6.8f, 5.8f, 13.5f));
+	result = solver.MoveBox(tallBox, Vec3(4.0f, 0.0f, 0.0f));
+	TEST_CHECK(IsNearly(tallBox.maxs.x, 8.0f));
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void TestStuckBoxIsPushedUp(){
+	TestWorld world;
+	SetUpFlatTestWorld(world);
+	world.FillBlocks(5, 5, FLOOR_TEST_HEIGHT + 1, 5, 5, FLOOR_TEST_HEIGHT + 2, BT_DIRT);
+	BlockCollisionSolver solver(world.m_chunks);
+
+	AABB3D box = MakePlayerBox(5.5f, 5.5f, 11.5f);
+	float liftDistance = 0.0f;
+	TEST_CHECK(solver.PushBoxUpOutOfBlocks(box, liftDistance));
+	TEST_CHECK(IsNearly(box.mins.z, 13.0f));
+	TEST_CHECK(IsNearly(liftDistance, 1.5f));
+
+	//a free box is left where it is
+	TEST_CHECK(solver.PushBoxUpOutOfBlocks(box, liftDistance));
+	TEST_CHECK(liftDistance == 0.0f);
+	TEST_CHECK(IsNearly(box.mins.z, 13.0f));
+}
+
+///=====================================================
+/// blocks in chunks that aren't active are solid, so nothing walks or falls out of the loaded world
+///=====================================================
+static void TestInactiveChunksAreSolid(){
+	TestWorld world;
+	SetUpFlatTestWorld(world);
+	BlockCollisionSolver solver(world.m_chunks);
+
+	const float activeMaxX = (float)(2 * BLOCKS_PER_CHUNK_X);
+	AABB3D box = MakePlayerBox(activeMaxX - 1.5f, 5.5f, 40.0f);
+	BoxMovementResult result = solver.MoveBox(box, Vec3(5.0f, 0.0f, 0.0f));
+	TEST_CHECK(IsNearly(box.maxs.x, activeMaxX));
+	TEST_CHECK(result.m_didCollideOnAxis[0]);
+
+	AABB3D straddlingBox(Vec3(activeMaxX - 0.5f, 5.2f, 40.0f), Vec3(activeMaxX + 0.1f, 5.8f, 41.8f));
+	const AABB3D boxBeforePush = straddlingBox;
+	float liftDistance = 0.0f;
+	TEST_CHECK(!solver.PushBoxUpOutOfBlocks(straddlingBox, liftDistance));
+	TEST_CHECK(straddlingBox.mins.z == boxBeforePush.mins.z && straddlingBox.maxs.z == boxBeforePush.maxs.z);
+	TEST_CHECK(liftDistance == 0.0f);
+}
+
+///=====================================================
+/// the world has a solid floor at z == 0 and no ceiling
+///=====================================================
+static void TestWorldVerticalBounds(){
+	TestWorld world;
+	world.AddAirChunks(ChunkCoords(-1, -1), ChunkCoords(1, 1));
+	BlockCollisionSolver solver(world.m_chunks);
+
+	AABB3D box = MakePlayerBox(5.5f, 5.5f, 2.0f);
+	BoxMovementResult result = solver.MoveBox(box, Vec3(0.0f, 0.0f, -10.0f));
+	TEST_CHECK(IsNearly(box.mins.z, 0.0f));
+	TEST_CHECK(result.m_didCollideOnAxis[2]);
+
+	box = MakePlayerBox(5.5f, 5.5f, (float)BLOCKS_PER_CHUNK_Z - 2.0f);
+	result = solver.MoveBox(box, Vec3(0.0f, 0.0f, 10.0f));
+	TEST_CHECK(IsNearly(result.m_appliedTranslation.z, 10.0f));
+	TEST_CHECK(!result.m_didCollideOnAxis[2]);
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void TestZeroTranslation(){
+	TestWorld world;
+	SetUpFlatTestWorld(world);
+	BlockCollisionSolver solver(world.m_chunks);
+
+	AABB3D box = MakePlayerBox(5.5f, 5.5f, 11.0f);
+	const BoxMovementResult result = solver.MoveBox(box, Vec3(0.0f, 0.0f, 0.0f));
+	TEST_CHECK(result.m_appliedTranslation.x == 0.0f && result.m_appliedTranslation.y == 0.0f && result.m_appliedTranslation.z == 0.0f);
+	TEST_CHECK(!result.m_didCollideOnAxis[0] && !result.m_didCollideOnAxis[1] && !result.m_didCollideOnAxis[2]);
+	TEST_CHECK(result.m_blockTypeBelow == BT_AIR);
+}
+
+///=====================================================
+/// negative block coords round down into the chunks west and south of the origin
+///=====================================================
+static void TestNegativeCoordsAcrossChunkBorders(){
+	TestWorld world;
+	world.AddAirChunks(ChunkCoords(-1, -1), ChunkCoords(1, 1));
+	world.FillBlocks(-BLOCKS_PER_CHUNK_X, -BLOCKS_PER_CHUNK_Y, FLOOR_TEST_HEIGHT, BLOCKS_PER_CHUNK_X - 1, BLOCKS_PER_CHUNK_Y - 1, FLOOR_TEST_HEIGHT, BT_STONE);
+	world.FillBlocks(-3, -BLOCKS_PER_CHUNK_Y, FLOOR_TEST_HEIGHT + 1, -3, BLOCKS_PER_CHUNK_Y - 1, FLOOR_TEST_HEIGHT + 3, BT_STONE);
+	BlockCollisionSolver solver(world.m_chunks);
+
+	AABB3D box = MakePlayerBox(1.5f, 0.0f, 11.0f);
+	BoxMovementResult result = solver.MoveBox(box, Vec3(-10.0f, 0.0f, 0.0f));
+	TEST_CHECK(IsNearly(box.mins.x, -2.0f));
+	TEST_CHECK(result.m_didCollideOnAxis[0]);
+
+	//the box straddles y == 0, so landing needs the floor in both chunks
+	box = MakePlayerBox(-1.0f, 0.0f, 14.0f);
+	world.SetBlockType(-1, 0, FLOOR_TEST_HEIGHT, BT_AIR);
+	world.SetBlockType(-2, 0, FLOOR_TEST_HEIGHT, BT_AIR);
+	world.SetBlockType(-1, -1, FLOOR_TEST_HEIGHT, BT_AIR);
+	result = solver.MoveBox(box, Vec3(0.0f, 0.0f, -5.0f));
+	TEST_CHECK(IsNearly(box.mins.z, 11.0f));
+	TEST_CHECK(result.m_blockTypeBelow == BT_STONE);
+
+	world.SetBlockType(-2, -1, FLOOR_TEST_HEIGHT, BT_AIR);
+	result = solver.MoveBox(box, Vec3(0.0f, 0.0f, -5.0f));
+	TEST_CHECK(!result.m_didCollideOnAxis[2]);
+	TEST_CHECK(IsNearly(box.mins.z, 6.0f));
+}
+
+///=====================================================
+/// A block can't be placed in any cell the player's box is in, but can be placed against any of its faces
+///=====================================================
+static void TestBoxOverlapsOnlyCellsItIsInside(){
+	const AABB3D box = MakePlayerBox(1.0f, 0.5f, (float)FLOOR_TEST_HEIGHT + 1.0f); //straddles x == 1, standing on the floor
+	TEST_CHECK(DoesBoxOverlapBlock(box, 0, 0, FLOOR_TEST_HEIGHT + 1));
+	TEST_CHECK(DoesBoxOverlapBlock(box, 1, 0, FLOOR_TEST_HEIGHT + 1));
+	TEST_CHECK(DoesBoxOverlapBlock(box, 1, 0, FLOOR_TEST_HEIGHT + 2)); //the head, which isn't at a corner or the waist
+	TEST_CHECK(!DoesBoxOverlapBlock(box, 1, 0, FLOOR_TEST_HEIGHT)); //the floor it stands on
+	TEST_CHECK(!DoesBoxOverlapBlock(box, 1, 0, FLOOR_TEST_HEIGHT + 3));
+	TEST_CHECK(!DoesBoxOverlapBlock(box, 2, 0, FLOOR_TEST_HEIGHT + 1));
+	TEST_CHECK(!DoesBoxOverlapBlock(box, 1, 1, FLOOR_TEST_HEIGHT + 1));
+
+	const AABB3D flushBox = MakePlayerBox(-0.3f, -1.0f, (float)FLOOR_TEST_HEIGHT + 1.0f); //east face at x == 0, across y == -1
+	TEST_CHECK(!DoesBoxOverlapBlock(flushBox, 0, -1, FLOOR_TEST_HEIGHT + 1));
+	TEST_CHECK(DoesBoxOverlapBlock(flushBox, -1, -1, FLOOR_TEST_HEIGHT + 1));
+	TEST_CHECK(DoesBoxOverlapBlock(flushBox, -1, -2, FLOOR_TEST_HEIGHT + 2));
+
+	const AABB3D largeBox(Vec3(0.2f, 0.2f, 20.0f), Vec3(3.8f, 3.8f, 24.0f));
+	TEST_CHECK(DoesBoxOverlapBlock(largeBox, 2, 2, 22)); //the middle of a box bigger than a block, which no corner lands in
+}
+
+///=====================================================
+/// 
+///=====================================================
+void RunBlockCollisionTests(){
+	TestBoxLandsOnFloor();
+	TestBoxLandsOnIce();
+	TestBoxFallsThroughWater();
+	TestBoxStopsAtWallAndSlides();
+	TestTouchingBoxIsNotStuck();
+	TestLargeMoveDoesNotTunnel();
+	TestSmallStepsSettleAgainstWall();
+	TestBoxHitsCeiling();
+	TestLargeBoxLandsOnSinglePillar();
+	TestOnlyNarrowBoxFitsThroughGap();
+	TestStuckBoxIsPushedUp();
+	TestInactiveChunksAreSolid();
+	TestWorldVerticalBounds();
+	TestZeroTranslation();
+	TestNegativeCoordsAcrossChunkBorders();
+	TestBoxOverlapsOnlyCellsItIsInside();
+}
@@ -0,0 +1,113 @@
+//=====================================================
+// BlockRaycast.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "BlockRaycast.hpp"
+#include "BlockDefinition.hpp"
+#include <float.h>
+
+//indexed by BlockFace; corners start where the target outline begins
+const float IMPACT_FACE_NORMALS[NUM_BLOCK_FACES][3] = {
+	{ 0.0f, 0.0f, 1.0f },
+	{ 0.0f, 0.0f, -1.0f },
+	{ 0.0f, 1.0f, 0.0f },
+	{ 0.0f, -1.0f, 0.0f },
+	{ 1.0f, 0.0f, 0.0f },
+	{ -1.0f, 0.0f, 0.0f }
+};
+const float IMPACT_FACE_CORNER_OFFSETS[NUM_BLOCK_FACES][4][3] = {
+	{ { 0.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f } },
+	{ { 1.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } },
+	{ { 1.0f, 1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f } },
+	{ { 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 1.0f } },
+	{ { 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 1.0f, 0.0f, 1.0f } },
+	{ { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 1.0f } }
+};
+
+///=====================================================
+/// Walks the grid with Amanatides-Woo traversal, visiting every block the ray crosses exactly once.
+/// The chunk is only looked up again when the ray crosses into a different one.
+///=====================================================
+const Raycast3DResult RaycastBlocks(const Chunks& chunks, const WorldCoords& start, const WorldCoords& end){
+	Raycast3DResult result;
+	result.m_didImpact = false;
+	result.m_impactWorldCoords = start;
+
+	WorldBlockAccessor blockAccessor(chunks);
+	const Chunk* chunk = blockAccessor.GetChunkAtWorldCoords(start);
+	if (!chunk)
+		return result;
+
+	int blockCoords[3] = { RoundDownToInt(start.x), RoundDownToInt(start.y), RoundDownToInt(start.z) };
+	if (blockCoords[2] < 0 || blockCoords[2] >= BLOCKS_PER_CHUNK_Z)
+		return result;
+	if (chunk->GetBlockDefinition(Chunk::GetIndexAtWorldCoords(start)).m_isVisible) //camera is inside a visible block
+		return result;
+
+	//per axis: which way the ray steps, the t at which it crosses the next block boundary, and the t between boundaries
+	const float startCoords[3] = { start.x, start.y, start.z };
+	const Vec3 rayDisplacement = end - start;
+	const float displacements[3] = { rayDisplacement.x, rayDisplacement.y, rayDisplacement.z };
+	int steps[3];
+	float tToNextBoundary[3];
+	float tPerBlock[3];
+	for (int axis = 0; axis < 3; ++axis){
+		if (displacements[axis] > 0.0f){
+			steps[axis] = 1;
+			tPerBlock[axis] = 1.0f / displacements[axis];
+			tToNextBoundary[axis] = ((float)(blockCoords[axis] + 1) - startCoords[axis]) * tPerBlock[axis];
+		}
+		else if (displacements[axis] < 0.0f){
+			steps[axis] = -1;
+			tPerBlock[axis] = -1.0f / displacements[axis];
+			tToNextBoundary[axis] = (startCoords[axis] - (float)blockCoords[axis]) * tPerBlock[axis];
+		}
+		else{
+			steps[axis] = 0;
+			tPerBlock[axis] = FLT_MAX;
+			tToNextBoundary[axis] = FLT_MAX;
+		}
+	}
+
+	for (;;){
+		int crossedAxis = 0;
+		if (tToNextBoundary[1] < tToNextBoundary[crossedAxis]) crossedAxis = 1;
+		if (tToNextBoundary[2] < tToNextBoundary[crossedAxis]) crossedAxis = 2;
+		if (tToNextBoundary[crossedAxis] >= 1.0f)
+			return result;
+
+		blockCoords[crossedAxis] += steps[crossedAxis];
+		tToNextBoundary[crossedAxis] += tPerBlock[crossedAxis];
+
+		if (blockCoords[2] < 0 || blockCoords[2] >= BLOCKS_PER_CHUNK_Z)
+			return result;
+		if (crossedAxis != 2){ //stepping into the next chunk follows its neighbor pointer rather than searching the registry
+			chunk = blockAccessor.GetChunkAtBlockCoords(blockCoords[0], blockCoords[1]);
+			if (!chunk)
+				return result;
+		}
+
+		const BlockIndex index = Chunk::GetIndexAtLocalCoords(LocalCoords(blockCoords[0] & CHUNK_X_MASK, blockCoords[1] & CHUNK_Y_MASK, blockCoords[2]));
+		if (chunk->GetBlockDefinition(index).m_isVisible){
+			//the face that was hit is the one facing back along the crossed axis
+			BlockFace impactFace;
+			if (crossedAxis == 0)
+				impactFace = (steps[0] > 0) ? FACE_WEST : FACE_EAST;
+			else if (crossedAxis == 1)
+				impactFace = (steps[1] > 0) ? FACE_SOUTH : FACE_NORTH;
+			else
+				impactFace = (steps[2] > 0) ? FACE_BOTTOM : FACE_TOP;
+
+			result.m_didImpact = true;
+			result.m_impactWorldCoordsMins = Vec3((float)blockCoords[0], (float)blockCoords[1], (float)blockCoords[2]);
+			result.m_impactSurfaceNormal = Vec3(IMPACT_FACE_NORMALS[impactFace][0], IMPACT_FACE_NORMALS[impactFace][1], IMPACT_FACE_NORMALS[impactFace][2]);
+			for (int corner = 0; corner < 4; ++corner){
+				const float* cornerOffset = IMPACT_FACE_CORNER_OFFSETS[impactFace][corner];
+				result.m_impactFaceCoords.push_back(result.m_impactWorldCoordsMins + Vec3(cornerOffset[0], cornerOffset[1], cornerOffset[2]));
+			}
+			result.m_impactWorldCoords = result.m_impactFaceCoords[0];
+			return result;
+		}
+	}
+}
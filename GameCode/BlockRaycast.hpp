@@ -0,0 +1,19 @@
+//=====================================================
+// BlockRaycast.hpp
+// by Andrew Socha
+//=====================================================
+
+#pragma once
+
+#ifndef __included_BlockRaycast__
+#define __included_BlockRaycast__
+
+#include "WorldBlockAccessor.hpp"
+
+///=====================================================
+/// Finds the first visible block along the segment from start to end, through the given active chunks.
+/// Misses if the segment starts inside a visible block, or leaves the active chunks or the world's height before hitting one.
+///=====================================================
+const Raycast3DResult RaycastBlocks(const Chunks& chunks, const WorldCoords& start, const WorldCoords& end);
+
+#endif
@@ -5,24 +5,51 @@
 
 #include "Chunk.hpp"
 #include "Engine/Math/Noise.hpp"
+#include "BatchedNoise.hpp"
 #include "BlockDefinition.hpp"
+#include "RadixSort.hpp"
 #include "Engine/Core/Utilities.hpp"
-#include <sstream>
 #include <algorithm>
 #include "Engine/Time/Time.hpp"
 #include "Engine/Renderer/AnimatedTexture.hpp"
 
-const float TEX_COORD_SIZE_PER_TILE = 1.0f / 32.0f;
+const float TEX_COORD_SIZE_PER_TILE = 1.0f / (float)TEX_TILES_PER_ATLAS_SIDE;
 
-unsigned char Chunk::s_tempRLEBuffer[MAX_RLE_BYTES];
 WorldCoords Chunk::s_lastKnownCameraPosition;
 const float Chunk::AVERAGE_GROUND_HEIGHT = 83.0f;
 const float Chunk::SEA_LEVEL = 80.0f;
+Vertex3D_PCT_Faces Chunk::s_unpackedVertexFaceArray;
+std::vector<unsigned int> Chunk::s_translucentSortKeys;
 Vertex3D_PCT_Faces Chunk::s_weatherVertexFaceArray;
 
 const float PERLIN_MINIMUM_PRECIPITATION = 0.6f;
 const float PERLIN_MINIMUM_SNOW_BIOME = 0.5f;
 
+///=====================================================
+/// Prepares a pooled chunk for reuse, keeping its VBOs and vertex array memory
+///=====================================================
+void Chunk::Reset(){
+	m_dirtySectionsMask = ALL_SECTIONS_MASK;
+	m_pendingMeshRevision = 0;
+	m_numQueuedLightUpdates = 0;
+	m_hasUnsavedEdits = false;
+	m_editedBlockIndexes.clear();
+	m_hasUntrackedEdits = false;
+	m_vboSkyLightLevel = PackedBlockVertex::GetSkyLightLevel();
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		m_numVertexesInSectionVBOs[section] = 0;
+		m_sectionOpaqueVertexFaceArrays[section].clear();
+		m_sectionTranslucentVertexFaceArrays[section].clear();
+	}
+	m_translucentBlocksVertexFaceArray.clear();
+	m_isTranslucentSortValid = false;
+	m_areColumnBiomesCached = false;
+	m_chunkToNorth = NULL;
+	m_chunkToSouth = NULL;
+	m_chunkToEast = NULL;
+	m_chunkToWest = NULL;
+}
+
 ///=====================================================
 /// 
 ///=====================================================
@@ -43,13 +70,15 @@ void Chunk::RenderWithGLBegin(const OpenGLRenderer* renderer, const AnimatedText
 ///=====================================================
 void Chunk::RenderWithVAs(const OpenGLRenderer* renderer, const AnimatedTexture& texture, bool useWeather, bool isSnow, const Vec2& camForwardNormal, const Vec3& playerPosition) {
 	if (useWeather){
+		CacheColumnBiomes();
 		s_weatherVertexFaceArray.clear();
-		PopulateVertexFaceArray(s_weatherVertexFaceArray, false, true, isSnow, camForwardNormal, playerPosition);
+		PopulateWeatherVertexFaceArray(s_weatherVertexFaceArray, isSnow, camForwardNormal, playerPosition);
 		if (s_weatherVertexFaceArray.empty()) return;
 	}
 	else{ //nonopaque blocks
 		if (m_translucentBlocksVertexFaceArray.empty()) return;
-		std::sort(m_translucentBlocksVertexFaceArray.begin(), m_translucentBlocksVertexFaceArray.end(), SortBlocksFurthestToNearest);
+		SortTranslucentFacesFurthestToNearest();
+		UnpackVertexFacesInOrder(m_translucentBlocksVertexFaceArray, m_translucentSortOrder, m_worldCoordsMins, s_unpackedVertexFaceArray);
 	}
 
 	renderer->PushMatrix();
@@ -59,7 +88,7 @@ void Chunk::RenderWithVAs(const OpenGLRenderer* renderer, const AnimatedTexture&
 		renderer->DrawVertexFaceArrayPCT(s_weatherVertexFaceArray);
 	}
 	else{
-		renderer->DrawVertexFaceArrayPCT(m_translucentBlocksVertexFaceArray);
+		renderer->DrawVertexFaceArrayPCT(s_unpackedVertexFaceArray);
 	}
 	renderer->PopMatrix();
 }
@@ -68,93 +97,188 @@ void Chunk::RenderWithVAs(const OpenGLRenderer* renderer, const AnimatedTexture&
 /// 
 ///=====================================================
 void Chunk::RenderWithVBOs(const OpenGLRenderer* renderer, const AnimatedTexture& textureAtlas){
-	if (m_isVboDirty)
-		GenerateVertexArrayAndVBO(renderer);
-
 	renderer->PushMatrix();
 	renderer->BindTexture2D(textureAtlas);
-	renderer->DrawVboPCT(m_vboID, m_numVertexesInVBO);
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		if (m_numVertexesInSectionVBOs[section] != 0) //skip sections that aren't meshed yet or have nothing opaque to draw
+			renderer->DrawVboPCT(m_sectionVboIDs[section], m_numVertexesInSectionVBOs[section]);
+	}
 	renderer->PopMatrix();
 }
 
 ///=====================================================
 /// 
 ///=====================================================
-void Chunk::PopulateVertexFaceArray(Vertex3D_PCT_Faces& out_vertexFaceArray, bool useOpaqueBlocks, bool useWeather, bool isSnow, const Vec2& camForwardNormal, const Vec3& playerPosition) const{
-	if (!useWeather){
-		if (useOpaqueBlocks)
-			out_vertexFaceArray.reserve(400);
+void Chunk::PopulateWeatherVertexFaceArray(Vertex3D_PCT_Faces& out_vertexFaceArray, bool isSnow, const Vec2& camForwardNormal, const Vec3& playerPosition) const{
+	//gather the nearby columns in a matching biome (cached at activation), then sample only the time-varying weather for them in one batch
+	const Vec2 player2dCoords(playerPosition);
+	const bool isPlayerSheltered = CalculateWeatherAtWorldCoords(playerPosition) < PERLIN_MINIMUM_PRECIPITATION;
+	int candidateColumns[BLOCKS_PER_CHUNK_LAYER];
+	Vec2 candidatePositions[BLOCKS_PER_CHUNK_LAYER];
+	int numCandidates = 0;
+	for (int column = 0; column < BLOCKS_PER_CHUNK_LAYER; ++column){
+		if ((m_columnBiomes[column] >= PERLIN_MINIMUM_SNOW_BIOME) != isSnow)
+			continue;
+
+		const Vec2 columnCoords(GetWorldCoordsAtIndex((BlockIndex)column));
+		float distanceToPlayerSquared = CalcDistanceSquared(player2dCoords, columnCoords);
+		if ((distanceToPlayerSquared <= 100.0f && distanceToPlayerSquared > 1.0f) || (distanceToPlayerSquared <= 400.0f && isPlayerSheltered)){
+			candidateColumns[numCandidates] = column;
+			candidatePositions[numCandidates] = columnCoords;
+			++numCandidates;
+		}
+	}
+	if (numCandidates == 0)
+		return;
 
-		for(BlockIndex blockIndex = 0; blockIndex < BLOCKS_PER_CHUNK; ++blockIndex){
-			const Block& block = m_blocks[blockIndex];
-			AddBlockVertexesToRenderingArray(block, blockIndex, out_vertexFaceArray, useOpaqueBlocks);
+	float weatherValues[BLOCKS_PER_CHUNK_LAYER];
+	CalculateWeatherAtPositions(candidatePositions, numCandidates, weatherValues);
+	for (int candidate = 0; candidate < numCandidates; ++candidate){
+		if (weatherValues[candidate] < PERLIN_MINIMUM_PRECIPITATION)
+			continue;
+
+		int column = candidateColumns[candidate];
+		for (int height = BLOCKS_PER_CHUNK_Z - 1; height >= m_skyHeights[column]; --height){
+			AddWeatherVertexesToRenderingArray((BlockIndex)(column + height * BLOCKS_PER_CHUNK_LAYER), out_vertexFaceArray, camForwardNormal, isSnow);
 		}
 	}
-	else{
-		int unused;
-		const Vec2 player2dCoords(playerPosition);
-		for (int column = 0; column < BLOCKS_PER_CHUNK_LAYER; ++column){
-			const WorldCoords worldCoords = GetWorldCoordsAtIndex((BlockIndex)column);
-			float distanceToPlayerSquared = CalcDistanceSquared(player2dCoords, Vec2(worldCoords));
-			if ((distanceToPlayerSquared <= 100.0f && distanceToPlayerSquared > 1.0f) || (distanceToPlayerSquared <= 400.0f && CalculateWeatherAtWorldCoords(playerPosition) < PERLIN_MINIMUM_PRECIPITATION)){
-				float biomeForColumn = CalculateBiomeAtWorldCoords(worldCoords, unused);
-				if (biomeForColumn >= PERLIN_MINIMUM_SNOW_BIOME && isSnow || biomeForColumn < PERLIN_MINIMUM_SNOW_BIOME && !isSnow){
-					float weatherForColumn = CalculateWeatherAtWorldCoords(worldCoords);
-					if (weatherForColumn >= PERLIN_MINIMUM_PRECIPITATION){
-						for (BlockIndex index = (BlockIndex)(BLOCKS_PER_CHUNK - BLOCKS_PER_CHUNK_LAYER + column); index < BLOCKS_PER_CHUNK; index -= BLOCKS_PER_CHUNK_LAYER){
-							const Block& block = m_blocks[index];
-							if (!block.IsSky()) break;
-
-							AddWeatherVertexesToRenderingArray(block, index, out_vertexFaceArray, camForwardNormal, isSnow);
-						}
-					}
-				}
+}
+
+///=====================================================
+/// Keys each face by its distance to the camera once, then radix sorts the keys.
+/// The order is kept until the faces change or the camera moves into another block.
+///=====================================================
+void Chunk::SortTranslucentFacesFurthestToNearest(){
+	const IntVec3 cameraBlock(RoundDownToInt(s_lastKnownCameraPosition.x), RoundDownToInt(s_lastKnownCameraPosition.y), RoundDownToInt(s_lastKnownCameraPosition.z));
+	if (m_isTranslucentSortValid && cameraBlock == m_translucentSortCameraBlock)
+		return;
+
+	//face centers sit on half blocks, so measure in doubled chunk-local coords to keep them whole
+	const Vec3 doubledCameraCoords = (s_lastKnownCameraPosition - m_worldCoordsMins) * 2.0f;
+	const int numFaces = (int)m_translucentBlocksVertexFaceArray.size();
+	s_translucentSortKeys.resize(numFaces);
+	for (int faceIndex = 0; faceIndex < numFaces; ++faceIndex){
+		const PackedBlockVertexFace& vertexFace = m_translucentBlocksVertexFaceArray[faceIndex];
+		const PackedBlockVertex& mins = vertexFace.vertexes[0];
+		const PackedBlockVertex& maxs = vertexFace.vertexes[2];
+		const Vec3 doubledCenter((float)(mins.m_localX + maxs.m_localX), (float)(mins.m_localY + maxs.m_localY), (float)(mins.m_localZ + maxs.m_localZ));
+		float distanceSquared = CalcDistanceSquared(doubledCenter, doubledCameraCoords);
+
+		unsigned int distanceBits;
+		memcpy(&distanceBits, &distanceSquared, sizeof(distanceBits));
+		s_translucentSortKeys[faceIndex] = ~distanceBits; //non-negative floats order like their bits; flipping them puts the furthest face first
+	}
+
+	RadixSortIndexesByKey(numFaces == 0 ? NULL : &s_translucentSortKeys[0], numFaces, m_translucentSortOrder);
+	m_translucentSortCameraBlock = cameraBlock;
+	m_isTranslucentSortValid = true;
+}
+
+///=====================================================
+/// Opaque faces are unpacked for the upload, since the renderer takes Vertex3D_PCT, and both face arrays are copied into the chunk's own.
+/// Copying rather than swapping keeps each chunk's kept faces within the capacity its own sections have needed, instead of inheriting a mesh job's largest buffer.
+///=====================================================
+void Chunk::UploadSectionMeshes(const OpenGLRenderer* renderer, unsigned char sectionsMask, const PackedBlockVertexFaces* opaqueVertexFaces, const PackedBlockVertexFaces* translucentVertexFaces){
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		if ((sectionsMask & (1 << section)) == 0) continue;
+
+		m_numVertexesInSectionVBOs[section] = (int)opaqueVertexFaces[section].size() * 4;
+		if (m_numVertexesInSectionVBOs[section] != 0){
+			if (m_sectionVboIDs[section] == 0){
+				renderer->GenerateBuffer(&m_sectionVboIDs[section]);
 			}
+
+			UnpackVertexFaces(opaqueVertexFaces[section], m_worldCoordsMins, s_unpackedVertexFaceArray);
+			size_t vertexArrayNumBytes = sizeof(Vertex3D_PCT) * m_numVertexesInSectionVBOs[section];
+			renderer->SendVertexDataToBuffer(s_unpackedVertexFaceArray, vertexArrayNumBytes, m_sectionVboIDs[section]);
 		}
+
+		m_sectionOpaqueVertexFaceArrays[section].assign(opaqueVertexFaces[section].begin(), opaqueVertexFaces[section].end());
+		m_sectionTranslucentVertexFaceArrays[section].assign(translucentVertexFaces[section].begin(), translucentVertexFaces[section].end());
+	}
+	if (sectionsMask == ALL_SECTIONS_MASK)
+		m_vboSkyLightLevel = PackedBlockVertex::GetSkyLightLevel();
+
+	m_translucentBlocksVertexFaceArray.clear();
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		m_translucentBlocksVertexFaceArray.insert(m_translucentBlocksVertexFaceArray.end(), m_sectionTranslucentVertexFaceArrays[section].begin(), m_sectionTranslucentVertexFaceArrays[section].end());
 	}
+	m_isTranslucentSortValid = false;
 }
 
 ///=====================================================
-/// 
+/// re-uploads every section VBO from the kept faces at the current sky light level, without remeshing or relighting
 ///=====================================================
-bool Chunk::SortBlocksFurthestToNearest(const Vertex3D_PCT_Face& vertexFace1, const Vertex3D_PCT_Face& vertexFace2){
-	const Vec3 face1MinsPlusMaxes = vertexFace1.vertexes[0].m_position + vertexFace1.vertexes[2].m_position;
-	const Vec3 face2MinsPlusMaxes = vertexFace2.vertexes[0].m_position + vertexFace2.vertexes[2].m_position;
-	const Vec3 center1(face1MinsPlusMaxes * 0.5f);
-	const Vec3 center2(face2MinsPlusMaxes * 0.5f);
-	float distanceSquared1 = CalcDistanceSquared(center1, s_lastKnownCameraPosition);
-	float distanceSquared2 = CalcDistanceSquared(center2, s_lastKnownCameraPosition);
-	return (distanceSquared1 > distanceSquared2);
+void Chunk::RefreshVboLighting(const OpenGLRenderer* renderer){
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		if (m_numVertexesInSectionVBOs[section] == 0) continue;
+
+		UnpackVertexFaces(m_sectionOpaqueVertexFaceArrays[section], m_worldCoordsMins, s_unpackedVertexFaceArray);
+		size_t vertexArrayNumBytes = sizeof(Vertex3D_PCT) * m_numVertexesInSectionVBOs[section];
+		renderer->SendVertexDataToBuffer(s_unpackedVertexFaceArray, vertexArrayNumBytes, m_sectionVboIDs[section]);
+	}
+	m_vboSkyLightLevel = PackedBlockVertex::GetSkyLightLevel();
 }
 
 ///=====================================================
-/// 
+/// the CPU copies of this chunk's faces, including spare capacity
 ///=====================================================
-void Chunk::GenerateVertexArrayAndVBO(const OpenGLRenderer* renderer){
-	Vertex3D_PCT_Faces vertexFaceArray;
-	PopulateVertexFaceArray(vertexFaceArray, true, false, false, Vec2(), Vec3());
-	if(m_vboID == 0){
-		renderer->GenerateBuffer(&m_vboID);
+size_t Chunk::GetNumKeptFaceBytes() const{
+	size_t numKeptFaces = m_translucentBlocksVertexFaceArray.capacity();
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		numKeptFaces += m_sectionOpaqueVertexFaceArrays[section].capacity() + m_sectionTranslucentVertexFaceArrays[section].capacity();
 	}
+	return numKeptFaces * sizeof(PackedBlockVertexFace);
+}
 
-	m_numVertexesInVBO = vertexFaceArray.size() * 4;
-	size_t vertexArrayNumBytes = sizeof(Vertex3D_PCT) * m_numVertexesInVBO;
-	renderer->SendVertexDataToBuffer(vertexFaceArray, vertexArrayNumBytes, m_vboID);
-
+///=====================================================
+/// 
+///=====================================================
+void Chunk::DeleteBuffers(const OpenGLRenderer* renderer){
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		if (m_sectionVboIDs[section] != 0)
+			renderer->DeleteBuffer(&m_sectionVboIDs[section]);
+	}
+}
 
-	m_translucentBlocksVertexFaceArray.clear();
-	PopulateVertexFaceArray(m_translucentBlocksVertexFaceArray, false, false, false, Vec2(), Vec3());
+///=====================================================
+/// A block on a section's top or bottom layer also shows up in the faces of the section next to it
+///=====================================================
+void Chunk::DirtyMeshAtIndex(BlockIndex blockIndex){
+	int section = blockIndex >> SECTION_INDEX_SHIFT;
+	m_dirtySectionsMask |= (unsigned char)(1 << section);
+
+	int localZ = (blockIndex >> (CHUNKS_WIDE_EXPONENT + CHUNKS_LONG_EXPONENT)) & (BLOCKS_PER_SECTION_Z - 1);
+	if (localZ == 0 && section > 0)
+		m_dirtySectionsMask |= (unsigned char)(1 << (section - 1));
+	else if (localZ == BLOCKS_PER_SECTION_Z - 1 && section < SECTIONS_PER_CHUNK - 1)
+		m_dirtySectionsMask |= (unsigned char)(1 << (section + 1));
+}
 
-	m_isVboDirty = false;
+///=====================================================
+/// For a block edit: a block on the chunk's border also shows up in the faces of the neighboring chunk's section beside it
+///=====================================================
+void Chunk::DirtyMeshesAroundIndex(BlockIndex blockIndex){
+	DirtyMeshAtIndex(blockIndex);
+
+	const unsigned char sectionBit = (unsigned char)(1 << (blockIndex >> SECTION_INDEX_SHIFT));
+	const int x = blockIndex & CHUNK_X_MASK;
+	const int y = (blockIndex & CHUNK_LAYER_MASK) >> CHUNKS_WIDE_EXPONENT;
+	if (x == CHUNK_X_MASK && m_chunkToEast)
+		m_chunkToEast->m_dirtySectionsMask |= sectionBit;
+	else if (x == 0 && m_chunkToWest)
+		m_chunkToWest->m_dirtySectionsMask |= sectionBit;
+	if (y == CHUNK_Y_MASK && m_chunkToNorth)
+		m_chunkToNorth->m_dirtySectionsMask |= sectionBit;
+	else if (y == 0 && m_chunkToSouth)
+		m_chunkToSouth->m_dirtySectionsMask |= sectionBit;
 }
 
 ///=====================================================
 /// 
 ///=====================================================
 void Chunk::DrawBlockAtIndex(const OpenGLRenderer* renderer, BlockIndex blockIndex) const{
-	const Block& block = m_blocks[blockIndex];
-	const BlockType& type = (BlockType)(block.m_type);
-	const BlockDefinition& blockDef = g_blockDefinitions[type];
+	const BlockDefinition& blockDef = GetBlockDefinition(blockIndex);
 
 	if (!blockDef.m_isVisible) return;
 
@@ -164,7 +288,7 @@ void Chunk::DrawBlockAtIndex(const OpenGLRenderer* renderer, BlockIndex blockInd
 	const static Vec2 TEX_COORD_SIZE_PER_TILE_VEC2(TEX_COORD_SIZE_PER_TILE, TEX_COORD_SIZE_PER_TILE);
 
 	BlockIndex aboveBlockIndex = blockIndex + BLOCKS_PER_CHUNK_LAYER;
-	if (aboveBlockIndex < BLOCKS_PER_CHUNK && !g_blockDefinitions[m_blocks[aboveBlockIndex].m_type].m_isOpaque){
+	if (aboveBlockIndex < BLOCKS_PER_CHUNK && !GetBlockDefinition(aboveBlockIndex).m_isOpaque){
 		const Vec2& topTexCoordsMins = blockDef.m_topTexCoordsMins;
 		const Vec2 topTexCoordsMaxs = topTexCoordsMins + TEX_COORD_SIZE_PER_TILE_VEC2;
 
@@ -179,7 +303,7 @@ void Chunk::DrawBlockAtIndex(const OpenGLRenderer* renderer, BlockIndex blockInd
 	}
 
 	BlockIndex belowBlockIndex = blockIndex - BLOCKS_PER_CHUNK_LAYER;
-	if (belowBlockIndex < BLOCKS_PER_CHUNK && !g_blockDefinitions[m_blocks[belowBlockIndex].m_type].m_isOpaque){
+	if (belowBlockIndex < BLOCKS_PER_CHUNK && !GetBlockDefinition(belowBlockIndex).m_isOpaque){
 		const Vec2& bottomTexCoordsMins = blockDef.m_bottomTexCoordsMins;
 		const Vec2 bottomTexCoordsMaxs = bottomTexCoordsMins + TEX_COORD_SIZE_PER_TILE_VEC2;
 
@@ -198,7 +322,7 @@ void Chunk::DrawBlockAtIndex(const OpenGLRenderer* renderer, BlockIndex blockInd
 
 	if (((blockIndex & CHUNK_LAYER_MASK) >> CHUNKS_WIDE_EXPONENT) != (CHUNK_LAYER_MASK >> CHUNKS_WIDE_EXPONENT)){ //we are not on the northern edge of the chunk
 		BlockIndex northBlockIndex = blockIndex + BLOCKS_PER_CHUNK_X;
-		if (!g_blockDefinitions[m_blocks[northBlockIndex].m_type].m_isOpaque){
+		if (!GetBlockDefinition(northBlockIndex).m_isOpaque){
 			renderer->TexCoord2f(sideTexCoordsMins.x, sideTexCoordsMaxs.y);
 			renderer->Vertex3i(blockCoordsMaxs.x, blockCoordsMaxs.y, blockCoordsMins.z);
 			renderer->TexCoord2f(sideTexCoordsMaxs.x, sideTexCoordsMaxs.y);
@@ -212,7 +336,7 @@ void Chunk::DrawBlockAtIndex(const OpenGLRenderer* renderer, BlockIndex blockInd
 
 	if (((blockIndex & CHUNK_LAYER_MASK) >> CHUNKS_WIDE_EXPONENT) != 0){ //we are not on the southern edge of the chunk
 		BlockIndex southBlockIndex = blockIndex - BLOCKS_PER_CHUNK_X;
-		if (!g_blockDefinitions[m_blocks[southBlockIndex].m_type].m_isOpaque){
+		if (!GetBlockDefinition(southBlockIndex).m_isOpaque){
 			renderer->TexCoord2f(sideTexCoordsMins.x, sideTexCoordsMaxs.y);
 			renderer->Vertex3i(blockCoordsMins.x, blockCoordsMins.y, blockCoordsMins.z);
 			renderer->TexCoord2f(sideTexCoordsMaxs.x, sideTexCoordsMaxs.y);
@@ -226,7 +350,7 @@ void Chunk::DrawBlockAtIndex(const OpenGLRenderer* renderer, BlockIndex blockInd
 
 	if ((blockIndex & CHUNK_X_MASK) != CHUNK_X_MASK){ //we are not on the eastern edge of the chunk
 		BlockIndex eastBlockIndex = blockIndex + 1;
-		if (!g_blockDefinitions[m_blocks[eastBlockIndex].m_type].m_isOpaque){
+		if (!GetBlockDefinition(eastBlockIndex).m_isOpaque){
 			renderer->TexCoord2f(sideTexCoordsMins.x, sideTexCoordsMaxs.y);
 			renderer->Vertex3i(blockCoordsMaxs.x, blockCoordsMins.y, blockCoordsMins.z);
 			renderer->TexCoord2f(sideTexCoordsMaxs.x, sideTexCoordsMaxs.y);
@@ -240,7 +364,7 @@ void Chunk::DrawBlockAtIndex(const OpenGLRenderer* renderer, BlockIndex blockInd
 
 	if ((blockIndex & CHUNK_X_MASK) != 0){ //we are not on the western edge of the chunk
 		BlockIndex westBlockIndex = blockIndex - 1;
-		if (!g_blockDefinitions[m_blocks[westBlockIndex].m_type].m_isOpaque){
+		if (!GetBlockDefinition(westBlockIndex).m_isOpaque){
 			renderer->TexCoord2f(sideTexCoordsMins.x, sideTexCoordsMaxs.y);
 			renderer->Vertex3i(blockCoordsMins.x, blockCoordsMaxs.y, blockCoordsMins.z);
 			renderer->TexCoord2f(sideTexCoordsMaxs.x, sideTexCoordsMaxs.y);
@@ -268,483 +392,456 @@ void Chunk::PopulateWithBlocks(){
 	int groundHeightForEachColumn[BLOCKS_PER_CHUNK_LAYER];
 	int dirtHeightForEachColumn[BLOCKS_PER_CHUNK_LAYER];
 	float biomeForEachColumn[BLOCKS_PER_CHUNK_LAYER];
+	Vec2 columnPositions[BLOCKS_PER_CHUNK_LAYER];
 	for (int column = 0; column < BLOCKS_PER_CHUNK_LAYER; ++column){
-		const WorldCoords worldCoords = GetWorldCoordsAtIndex((BlockIndex)column);
-		dirtHeightForEachColumn[column] = (int)(10.0f + ComputePerlinNoiseValueAtPosition2D(Vec2(worldCoords.x, worldCoords.y), 40.0f, 8, 6.0f, 0.5f));
-		biomeForEachColumn[column] = CalculateBiomeAtWorldCoords(worldCoords, groundHeightForEachColumn[column]);
-	}
-
-	//determine block type
-	for (BlockIndex index = 0; index < BLOCKS_PER_CHUNK; ++index){
-		Block& block = m_blocks[index];
-		const LocalCoords localCoords = GetLocalCoordsAtIndex(index);
-		int height = (index & BLOCKINDEX_Z_MASK) >> (CHUNKS_WIDE_EXPONENT + CHUNKS_LONG_EXPONENT);
-		int column = index & CHUNK_LAYER_MASK;
-		if (height > groundHeightForEachColumn[column]){
-			if (height > (int)SEA_LEVEL)
-				block.m_type = BT_AIR;
-			else{
-				if (biomeForEachColumn[column] < PERLIN_MINIMUM_SNOW_BIOME + (SEA_LEVEL - height) * 0.03f)
-					block.m_type = BT_WATER;
-				else
-					block.m_type = BT_ICE;
-			}
+		columnPositions[column] = Vec2(GetWorldCoordsAtIndex((BlockIndex)column));
+	}
+
+	float dirtNoiseForEachColumn[BLOCKS_PER_CHUNK_LAYER];
+	ComputePerlinNoiseValuesAtPositions2D(columnPositions, BLOCKS_PER_CHUNK_LAYER, 40.0f, 8, 6.0f, 0.5f, dirtNoiseForEachColumn);
+	for (int column = 0; column < BLOCKS_PER_CHUNK_LAYER; ++column){
+		dirtHeightForEachColumn[column] = (int)(10.0f + dirtNoiseForEachColumn[column]);
+	}
+	CalculateBiomesAtPositions(columnPositions, BLOCKS_PER_CHUNK_LAYER, biomeForEachColumn, groundHeightForEachColumn);
+	memcpy(m_columnBiomes, biomeForEachColumn, sizeof(m_columnBiomes));
+	m_areColumnBiomesCached = true;
+
+	//find the heights where every column is still stone, and above which every column is air
+	int highestAllStoneHeight = BLOCKS_PER_CHUNK_Z;
+	int lowestAllAirHeight = (int)SEA_LEVEL + 1;
+	for (int column = 0; column < BLOCKS_PER_CHUNK_LAYER; ++column){
+		int skyHeight = max(groundHeightForEachColumn[column], (int)SEA_LEVEL) + 1; //water and ice fill up to sea level
+		m_skyHeights[column] = (unsigned char)min(skyHeight, BLOCKS_PER_CHUNK_Z);
+
+		int topStoneHeight = groundHeightForEachColumn[column] - dirtHeightForEachColumn[column];
+		if (topStoneHeight >= groundHeightForEachColumn[column])
+			topStoneHeight = groundHeightForEachColumn[column] - 1;
+
+		if (topStoneHeight < highestAllStoneHeight)
+			highestAllStoneHeight = topStoneHeight;
+		if (groundHeightForEachColumn[column] + 1 > lowestAllAirHeight)
+			lowestAllAirHeight = groundHeightForEachColumn[column] + 1;
+	}
+
+	//determine block type, filling whole sections at once where possible
+	memset(m_lightDirtyBits, 0, sizeof(m_lightDirtyBits));
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		PalettedBlockStorage& sectionBlockTypes = m_sections[section].m_blockTypes;
+		int sectionBottomHeight = section * BLOCKS_PER_SECTION_Z;
+		int sectionTopHeight = sectionBottomHeight + BLOCKS_PER_SECTION_Z - 1;
+		BlockIndex sectionStartIndex = (BlockIndex)(section << SECTION_INDEX_SHIFT);
+
+		if (sectionBottomHeight >= lowestAllAirHeight || sectionTopHeight <= highestAllStoneHeight){
+			unsigned char blockType = (sectionBottomHeight >= lowestAllAirHeight) ? (unsigned char)BT_AIR : (unsigned char)BT_STONE;
+			sectionBlockTypes.Fill(blockType);
+			memset(&m_lightValues[sectionStartIndex], g_blockDefinitions[blockType].m_inherentLightValue, BLOCKS_PER_SECTION);
+			continue;
 		}
-		else if (height == groundHeightForEachColumn[column]){
-			if (height == (int)SEA_LEVEL){
-				if (biomeForEachColumn[column] < PERLIN_MINIMUM_SNOW_BIOME)
-					block.m_type = BT_SAND;
-				else
-					block.m_type = BT_SNOW;
+
+		sectionBlockTypes.Fill(BT_AIR);
+		for (int sectionBlock = 0; sectionBlock < BLOCKS_PER_SECTION; ++sectionBlock){
+			BlockIndex index = (BlockIndex)(sectionStartIndex + sectionBlock);
+			unsigned char blockType;
+			int height = (index & BLOCKINDEX_Z_MASK) >> (CHUNKS_WIDE_EXPONENT + CHUNKS_LONG_EXPONENT);
+			int column = index & CHUNK_LAYER_MASK;
+			if (height > groundHeightForEachColumn[column]){
+				if (height > (int)SEA_LEVEL)
+					blockType = BT_AIR;
+				else{
+					if (biomeForEachColumn[column] < PERLIN_MINIMUM_SNOW_BIOME + (SEA_LEVEL - height) * 0.03f)
+						blockType = BT_WATER;
+					else
+						blockType = BT_ICE;
+				}
 			}
-			else if (height > (int)SEA_LEVEL){
-				if (biomeForEachColumn[column] < PERLIN_MINIMUM_SNOW_BIOME)
-					block.m_type = BT_GRASS;
+			else if (height == groundHeightForEachColumn[column]){
+				if (height == (int)SEA_LEVEL){
+					if (biomeForEachColumn[column] < PERLIN_MINIMUM_SNOW_BIOME)
+						blockType = BT_SAND;
+					else
+						blockType = BT_SNOW;
+				}
+				else if (height > (int)SEA_LEVEL){
+					if (biomeForEachColumn[column] < PERLIN_MINIMUM_SNOW_BIOME)
+						blockType = BT_GRASS;
+					else
+						blockType = BT_SNOW;
+				}
 				else
-					block.m_type = BT_SNOW;
+					blockType = BT_DIRT;
 			}
+			else if (height > (groundHeightForEachColumn[column] - dirtHeightForEachColumn[column]))
+				blockType = BT_DIRT;
 			else
-				block.m_type = BT_DIRT;
-		}
-		else if (height > (groundHeightForEachColumn[column] - dirtHeightForEachColumn[column]))
-			block.m_type = BT_DIRT;
-		else
-			block.m_type = BT_STONE;
+				blockType = BT_STONE;
 
-		block.m_lightingAndFlags = g_blockDefinitions[block.m_type].m_inherentLightValue;
+			sectionBlockTypes.SetType(sectionBlock, blockType);
+			m_lightValues[index] = g_blockDefinitions[blockType].m_inherentLightValue;
+		}
+		sectionBlockTypes.Compact(); //e.g. a section that turned out to be all water
 	}
 }
 
 ///=====================================================
 /// 
 ///=====================================================
-void Chunk::SaveToDisk() const{
-	size_t rleBufferSize;
-	unsigned char* rleBuffer = CreateRLEBuffer(rleBufferSize);
-	std::string mapFilePath = GetFilePath();
-
-	WriteBufferToFile(rleBuffer, rleBufferSize, mapFilePath);
-
-	delete rleBuffer;
-}
+void Chunk::CreateRLEBuffer(std::vector<unsigned char>& out_rleBuffer) const{
+	out_rleBuffer.clear();
+	out_rleBuffer.reserve(4096);
 
-///=====================================================
-/// 
-///=====================================================
-unsigned char* Chunk::CreateRLEBuffer(size_t& out_rleBufferSize) const{
-	std::vector<unsigned char> buffer;
-	buffer.reserve(4096);
+	unsigned char currentBlockType = GetBlockType(0);
+	unsigned short currentBlockCount = 0;
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		const PalettedBlockStorage& sectionBlockTypes = m_sections[section].m_blockTypes;
+		if (sectionBlockTypes.IsUniform()){ //the whole section extends or starts a single run
+			unsigned char blockType = sectionBlockTypes.GetUniformType();
+			if (blockType != currentBlockType){
+				AppendToRLEBuffer(currentBlockType, currentBlockCount, out_rleBuffer);
+				currentBlockType = blockType;
+				currentBlockCount = 0;
+			}
+			currentBlockCount += BLOCKS_PER_SECTION;
+			continue;
+		}
 
-	unsigned char currentBlockType = m_blocks[0].m_type;
-	unsigned short currentBlockCount = 1;
-	for (BlockIndex index = 1; index < BLOCKS_PER_CHUNK; ++index){ //start at 2nd block, previously initialized with first block
-		const Block& block = m_blocks[index];
-		if (block.m_type != currentBlockType){ //start new RLE sequence
-			AppendToRLEBuffer(currentBlockType, currentBlockCount, buffer);
+		for (int sectionBlock = 0; sectionBlock < BLOCKS_PER_SECTION; ++sectionBlock){
+			unsigned char blockType = sectionBlockTypes.GetType(sectionBlock);
+			if (blockType != currentBlockType){ //start new RLE sequence
+				AppendToRLEBuffer(currentBlockType, currentBlockCount, out_rleBuffer);
 
-			currentBlockType = block.m_type;
-			currentBlockCount = 1;
-		}
-		else{
-			++currentBlockCount;
+				currentBlockType = blockType;
+				currentBlockCount = 1;
+			}
+			else{
+				++currentBlockCount;
+			}
 		}
 	}
 
 	//end sequence with final block type
-	AppendToRLEBuffer(currentBlockType, currentBlockCount, buffer);
-
-	out_rleBufferSize = buffer.size();
-
-	unsigned char* rleBuffer = new unsigned char[out_rleBufferSize];
-	memcpy(rleBuffer, buffer.data(), out_rleBufferSize * sizeof(buffer[0]));
-
-	return rleBuffer;
-}
-
-///=====================================================
-/// 
-///=====================================================
-std::string Chunk::GetFilePath() const{
-	const ChunkCoords chunkCoords = GetChunkCoordsAtWorldCoords(m_worldCoordsMins);
-
-	std::stringstream ss;
-	ss << "Data/Chunks/Chunk" << chunkCoords.x << "," << chunkCoords.y << ".chunk";
-	return ss.str();
+	AppendToRLEBuffer(currentBlockType, currentBlockCount, out_rleBuffer);
 }
 
 ///=====================================================
-/// 
+/// rleBuffer must hold a whole chunk, as written by CreateRLEBuffer
 ///=====================================================
-void Chunk::PopulateFromTempRLEBuffer(){
+void Chunk::PopulateFromRLEBuffer(const unsigned char* rleBuffer){
 	int bufferIndex = 0;
-	unsigned char currentBlockType = s_tempRLEBuffer[bufferIndex];
+	unsigned char currentBlockType = rleBuffer[bufferIndex];
 	unsigned short currentBlockCount = 0;
 	unsigned short numBlocksAssigned = 0;
-	for (BlockIndex index = 0; index < BLOCKS_PER_CHUNK; ++index){
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		m_sections[section].m_blockTypes.Fill(BT_AIR);
+	}
+	memset(m_lightDirtyBits, 0, sizeof(m_lightDirtyBits));
+	memset(m_skyHeights, 0, sizeof(m_skyHeights));
+
+	int index = 0;
+	while (index < BLOCKS_PER_CHUNK){
 		if (numBlocksAssigned == currentBlockCount){
-			currentBlockType = s_tempRLEBuffer[bufferIndex++];
-			currentBlockCount = (s_tempRLEBuffer[bufferIndex++] << 8);
-			currentBlockCount += s_tempRLEBuffer[bufferIndex++];
+			currentBlockType = rleBuffer[bufferIndex++];
+			currentBlockCount = (rleBuffer[bufferIndex++] << 8);
+			currentBlockCount += rleBuffer[bufferIndex++];
 			numBlocksAssigned = 0;
 		}
 
-		Block& block = m_blocks[index];
-		block.m_type = currentBlockType;
-		block.m_lightingAndFlags = g_blockDefinitions[block.m_type].m_inherentLightValue;
+		unsigned char inherentLightValue = g_blockDefinitions[currentBlockType].m_inherentLightValue;
+		if ((index & SECTION_BLOCK_MASK) == 0 && currentBlockCount - numBlocksAssigned >= BLOCKS_PER_SECTION){ //run covers this whole section
+			m_sections[index >> SECTION_INDEX_SHIFT].m_blockTypes.Fill(currentBlockType);
+			memset(&m_lightValues[index], inherentLightValue, BLOCKS_PER_SECTION);
+			index += BLOCKS_PER_SECTION;
+			numBlocksAssigned += BLOCKS_PER_SECTION;
+			continue;
+		}
+
+		SetBlockType((BlockIndex)index, currentBlockType);
+		m_lightValues[index] = inherentLightValue;
+		++index;
 		++numBlocksAssigned;
 	}
+
+	CompactSections();
+	CalculateSkyHeights();
 }
 
 ///=====================================================
-/// 
+/// marks the chunk for saving and remembers the block for its delta save; repeats are dropped whenever the list would grow
 ///=====================================================
-void Chunk::AppendToRLEBuffer(unsigned char blockType, unsigned short blockCount, std::vector<unsigned char>& buffer) const{
-	buffer.push_back(blockType);
-	buffer.push_back((unsigned char)(blockCount >> 8));
-	buffer.push_back((unsigned char)blockCount);
+void Chunk::RecordBlockEdit(BlockIndex blockIndex){
+	m_hasUnsavedEdits = true;
+	if (m_editedBlockIndexes.size() == m_editedBlockIndexes.capacity() && !m_editedBlockIndexes.empty()){
+		std::sort(m_editedBlockIndexes.begin(), m_editedBlockIndexes.end());
+		m_editedBlockIndexes.erase(std::unique(m_editedBlockIndexes.begin(), m_editedBlockIndexes.end()), m_editedBlockIndexes.end());
+	}
+	m_editedBlockIndexes.push_back(blockIndex);
 }
 
 ///=====================================================
-/// 
+/// Writes the current type of every edited block, in runs of consecutive indexes, to be applied over regenerated terrain.
+/// Needs no baseline terrain, so it's cheap enough for the main thread. Returns false if the delta isn't smaller than fullSaveBytes, or the edits aren't known.
 ///=====================================================
-bool Chunk::LoadFromDisk(){
-	std::string mapFilePath = GetFilePath();
+bool Chunk::CreateDeltaBuffer(std::vector<unsigned char>& out_deltaBuffer, size_t fullSaveBytes) const{
+	if (m_hasUntrackedEdits)
+		return false;
+
+	std::vector<BlockIndex> editedBlockIndexes(m_editedBlockIndexes);
+	std::sort(editedBlockIndexes.begin(), editedBlockIndexes.end());
+	editedBlockIndexes.erase(std::unique(editedBlockIndexes.begin(), editedBlockIndexes.end()), editedBlockIndexes.end());
+
+	out_deltaBuffer.assign(DELTA_HEADER_BYTES, 0);
+	out_deltaBuffer[0] = DELTA_SAVE_TAG;
+	out_deltaBuffer[1] = TERRAIN_GENERATION_VERSION;
+
+	unsigned short numRuns = 0;
+	size_t editIndex = 0;
+	while (editIndex < editedBlockIndexes.size()){
+		const int runStartIndex = editedBlockIndexes[editIndex];
+		const unsigned char runBlockType = GetBlockType((BlockIndex)runStartIndex);
+		int runLength = 1;
+		for (++editIndex; editIndex < editedBlockIndexes.size(); ++editIndex, ++runLength){
+			const BlockIndex blockIndex = editedBlockIndexes[editIndex];
+			if (blockIndex != runStartIndex + runLength || GetBlockType(blockIndex) != runBlockType)
+				break;
+		}
 
-	bool loaded = LoadFileToExistingBuffer(mapFilePath, s_tempRLEBuffer, MAX_RLE_BYTES);
-	if (loaded){
-		PopulateFromTempRLEBuffer();
+		out_deltaBuffer.push_back((unsigned char)(runStartIndex >> 8));
+		out_deltaBuffer.push_back((unsigned char)runStartIndex);
+		out_deltaBuffer.push_back((unsigned char)(runLength >> 8));
+		out_deltaBuffer.push_back((unsigned char)runLength);
+		out_deltaBuffer.push_back(runBlockType);
+		++numRuns;
+
+		if (out_deltaBuffer.size() >= fullSaveBytes)
+			return false;
 	}
-	return loaded;
+
+	out_deltaBuffer[2] = (unsigned char)(numRuns >> 8);
+	out_deltaBuffer[3] = (unsigned char)numRuns;
+	return out_deltaBuffer.size() < fullSaveBytes;
 }
 
 ///=====================================================
-/// 
+/// deltaBuffer must have passed IsValidDeltaBuffer; the blocks it sets count as edits again, so later saves stay deltas
 ///=====================================================
-void Chunk::PlaceBlockBeneathCoords(BlockType blocktype, const WorldCoords& worldCoords, BlockLocations& dirtyBlocksList){
-	BlockIndex index = Chunk::GetIndexAtWorldCoords(worldCoords);
-	const Block& playersBlock = m_blocks[index];
-	if (playersBlock.m_type != BT_AIR){ //inside a solid block, so can't place a block
-		return;
+void Chunk::ApplyDeltaBuffer(const unsigned char* deltaBuffer){
+	const unsigned short numRuns = (unsigned short)((deltaBuffer[2] << 8) | deltaBuffer[3]);
+	int bufferIndex = DELTA_HEADER_BYTES;
+	for (unsigned short run = 0; run < numRuns; ++run){
+		int index = (deltaBuffer[bufferIndex] << 8) | deltaBuffer[bufferIndex + 1];
+		const int runLength = (deltaBuffer[bufferIndex + 2] << 8) | deltaBuffer[bufferIndex + 3];
+		const unsigned char blockType = deltaBuffer[bufferIndex + 4];
+		bufferIndex += DELTA_RUN_BYTES;
+
+		for (const int runEndIndex = index + runLength; index < runEndIndex; ++index){
+			SetBlockType((BlockIndex)index, blockType);
+			m_lightValues[index] = g_blockDefinitions[blockType].m_inherentLightValue;
+			m_editedBlockIndexes.push_back((BlockIndex)index);
+		}
 	}
-	index -= BLOCKS_PER_CHUNK_LAYER;
-
-	while (index < BLOCKS_PER_CHUNK) {
-		const Block& block = m_blocks[index];
-		if (block.m_type != BT_AIR){
-			index += BLOCKS_PER_CHUNK_LAYER;
-			Block& blockToChange = m_blocks[index];
-			blockToChange.m_type = (unsigned char)blocktype;
-			m_isVboDirty = true;
-			blockToChange.UnmarkAsSky();
 
-			if (!block.IsLightingDirty()){
-				if (g_debugPointsEnabled)
-					g_debugPositions.push_back(GetWorldCoordsAtIndex(index));
+	CompactSections();
+	CalculateSkyHeights();
+}
 
-				BlockLocation blockLocation(this, index);
-				dirtyBlocksList.push_back(blockLocation);
-				blockToChange.SetLightValue(g_blockDefinitions[blockToChange.m_type].m_inherentLightValue);
-				//DirtyNonopaqueNeighbors(blockLocation, true); //can't do this from chunk, so lighting won't update properly
-			}
+///=====================================================
+/// every run must be a real block type, and together they must cover exactly one chunk
+///=====================================================
+bool Chunk::IsValidRLEBuffer(const unsigned char* rleBuffer, size_t rleBufferSize){
+	if (rleBufferSize == 0 || rleBufferSize % RLE_ENTRY_BYTES != 0)
+		return false;
+
+	int numBlocks = 0;
+	for (size_t bufferIndex = 0; bufferIndex < rleBufferSize; bufferIndex += RLE_ENTRY_BYTES){
+		const int blockCount = (rleBuffer[bufferIndex + 1] << 8) | rleBuffer[bufferIndex + 2];
+		if (rleBuffer[bufferIndex] >= BLOCK_TYPE_COUNT || blockCount == 0)
+			return false;
+
+		numBlocks += blockCount;
+		if (numBlocks > BLOCKS_PER_CHUNK)
+			return false;
+	}
+	return numBlocks == BLOCKS_PER_CHUNK;
+}
 
-			return;
-		}
-		index -= BLOCKS_PER_CHUNK_LAYER;
+///=====================================================
+/// the size must match the run count, and every run must be a real block type that stays inside the chunk
+///=====================================================
+bool Chunk::IsValidDeltaBuffer(const unsigned char* deltaBuffer, size_t deltaBufferSize){
+	if (deltaBufferSize < DELTA_HEADER_BYTES || deltaBuffer[0] != DELTA_SAVE_TAG)
+		return false;
+	const int numRuns = (deltaBuffer[2] << 8) | deltaBuffer[3];
+	if (deltaBufferSize != (size_t)(DELTA_HEADER_BYTES + numRuns * DELTA_RUN_BYTES))
+		return false;
+
+	for (size_t bufferIndex = DELTA_HEADER_BYTES; bufferIndex < deltaBufferSize; bufferIndex += DELTA_RUN_BYTES){
+		const int index = (deltaBuffer[bufferIndex] << 8) | deltaBuffer[bufferIndex + 1];
+		const int runLength = (deltaBuffer[bufferIndex + 2] << 8) | deltaBuffer[bufferIndex + 3];
+		if (deltaBuffer[bufferIndex + 4] >= BLOCK_TYPE_COUNT || runLength == 0 || index + runLength > BLOCKS_PER_CHUNK)
+			return false;
 	}
+	return true;
 }
 
 ///=====================================================
-/// 
+/// A delta save is applied on top of regenerated terrain, so m_worldCoordsMins must already be set, and this belongs on a generation worker rather than the I/O thread.
+/// Returns false without touching the chunk if the buffer is corrupt, or is a delta against another version of the terrain generator; the chunk is then generated instead.
 ///=====================================================
-void Chunk::DestroyBlockBeneathCoords(const WorldCoords& worldCoords, BlockLocations& dirtyBlocksList){
-	BlockIndex index = Chunk::GetIndexAtWorldCoords(worldCoords);
-	while (index < BLOCKS_PER_CHUNK) {
-		Block& block = m_blocks[index];
-		if (block.m_type != BT_AIR){
-			block.m_type = BT_AIR;
-			m_isVboDirty = true;
-
-			while (index < BLOCKS_PER_CHUNK){ //update new sky below destroyed block
-				Block& block = m_blocks[index];
-				block.MarkAsSky();
-				
-				if (!block.IsLightingDirty()){
-					if (g_debugPointsEnabled)
-						g_debugPositions.push_back(GetWorldCoordsAtIndex(index));
-
-					BlockLocation blockLocation(this, index);
-					dirtyBlocksList.push_back(blockLocation);
-					block.DirtyLighting();
-				}
+bool Chunk::PopulateFromSaveBuffer(const unsigned char* saveBuffer, size_t saveBufferSize){
+	if (saveBufferSize == 0)
+		return false;
+
+	if (saveBuffer[0] != DELTA_SAVE_TAG){
+		if (!IsValidRLEBuffer(saveBuffer, saveBufferSize))
+			return false;
+		PopulateFromRLEBuffer(saveBuffer);
+		m_hasUntrackedEdits = true;
+		return true;
+	}
 
-				index -= BLOCKS_PER_CHUNK_LAYER;
-			}
+	if (saveBufferSize < DELTA_HEADER_BYTES || saveBuffer[1] != TERRAIN_GENERATION_VERSION || !IsValidDeltaBuffer(saveBuffer, saveBufferSize))
+		return false;
+	PopulateWithBlocks();
+	ApplyDeltaBuffer(saveBuffer);
+	return true;
+}
 
-			return;
-		}
-		index -= BLOCKS_PER_CHUNK_LAYER;
+///=====================================================
+/// 
+///=====================================================
+void Chunk::CompactSections(){
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		m_sections[section].m_blockTypes.Compact();
 	}
 }
 
 ///=====================================================
 /// 
 ///=====================================================
-void Chunk::AddBlockVertexesToRenderingArray(const Block& block, BlockIndex blockIndex, Vertex3D_PCT_Faces& out_vertexFaceArray, bool useOpaqueBlocks) const{
-	const BlockType& type = (BlockType)(block.m_type);
-	const BlockDefinition& blockDef = g_blockDefinitions[type];
-
-	if (!blockDef.m_isVisible) return;
-	if (blockDef.m_isOpaque != useOpaqueBlocks) return;
-
-	const WorldCoords blockCoordsMins = GetWorldCoordsAtIndex(blockIndex);
-	const WorldCoords blockCoordsMaxs = blockCoordsMins + Vec3(1.0f, 1.0f, 1.0f);
+void Chunk::CalculateSkyHeights(){
+	for (int column = 0; column < BLOCKS_PER_CHUNK_LAYER; ++column){
+		m_skyHeights[column] = 0;
 
-	const static Vec2 TEX_COORD_SIZE_PER_TILE_VEC2(TEX_COORD_SIZE_PER_TILE, TEX_COORD_SIZE_PER_TILE);
+		for (int section = SECTIONS_PER_CHUNK - 1; section >= 0; --section){
+			const PalettedBlockStorage& sectionBlockTypes = m_sections[section].m_blockTypes;
+			if (sectionBlockTypes.IsUniform()){
+				if (sectionBlockTypes.GetUniformType() == BT_AIR)
+					continue;
 
-	Vertex3D_PCT vertex;
-	Vertex3D_PCT_Face vertexFace;
+				m_skyHeights[column] = (unsigned char)((section + 1) * BLOCKS_PER_SECTION_Z);
+				break;
+			}
 
-	BlockIndex aboveBlockIndex = blockIndex + BLOCKS_PER_CHUNK_LAYER;
-	if (aboveBlockIndex < BLOCKS_PER_CHUNK){
-		const Block& aboveBlock = m_blocks[aboveBlockIndex];
-		if (!g_blockDefinitions[aboveBlock.m_type].m_isOpaque && aboveBlock.m_type != type){
-			const Vec2& topTexCoordsMins = blockDef.m_topTexCoordsMins;
-			const Vec2 topTexCoordsMaxs = topTexCoordsMins + TEX_COORD_SIZE_PER_TILE_VEC2;
-			unsigned char lighting = aboveBlock.GetLightValue() << 4;
-			vertex.m_color = RGBAchars(lighting, lighting, lighting);
-
-			vertex.m_texCoords = Vec2(topTexCoordsMins.x, topTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMins.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[0] = vertex;
-			vertex.m_texCoords = Vec2(topTexCoordsMaxs.x, topTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMins.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[1] = vertex;
-			vertex.m_texCoords = Vec2(topTexCoordsMaxs.x, topTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMaxs.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[2] = vertex;
-			vertex.m_texCoords = Vec2(topTexCoordsMins.x, topTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMaxs.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[3] = vertex;
-			out_vertexFaceArray.push_back(vertexFace);
-
-			if (type == BT_WATER && aboveBlock.m_type == BT_AIR){ //create inner face for water, so you can see the top of water while inside it
-				vertex.m_position = vertexFace.vertexes[0].m_position;
-				vertexFace.vertexes[0].m_position = vertexFace.vertexes[1].m_position;
-				vertexFace.vertexes[1].m_position = vertex.m_position;
-
-				vertex.m_position = vertexFace.vertexes[2].m_position;
-				vertexFace.vertexes[2].m_position = vertexFace.vertexes[3].m_position;
-				vertexFace.vertexes[3].m_position = vertex.m_position;
-
-				out_vertexFaceArray.push_back(vertexFace);
+			int sectionBlock = column + SECTION_BLOCK_MASK + 1 - BLOCKS_PER_CHUNK_LAYER;
+			for (int localZ = BLOCKS_PER_SECTION_Z - 1; localZ >= 0; --localZ, sectionBlock -= BLOCKS_PER_CHUNK_LAYER){
+				if (sectionBlockTypes.GetType(sectionBlock) != BT_AIR){
+					m_skyHeights[column] = (unsigned char)(section * BLOCKS_PER_SECTION_Z + localZ + 1);
+					break;
+				}
 			}
+			if (m_skyHeights[column] != 0)
+				break;
 		}
 	}
+}
 
-	BlockIndex belowBlockIndex = blockIndex - BLOCKS_PER_CHUNK_LAYER;
-	if (belowBlockIndex < BLOCKS_PER_CHUNK){
-		const Block& belowBlock = m_blocks[belowBlockIndex];
-		if (!g_blockDefinitions[belowBlock.m_type].m_isOpaque && belowBlock.m_type != type){
-			const Vec2& bottomTexCoordsMins = blockDef.m_bottomTexCoordsMins;
-			const Vec2 bottomTexCoordsMaxs = bottomTexCoordsMins + TEX_COORD_SIZE_PER_TILE_VEC2;
-			unsigned char lighting = belowBlock.GetLightValue() << 4;
-			vertex.m_color = RGBAchars(lighting, lighting, lighting);
-
-			vertex.m_texCoords = Vec2(bottomTexCoordsMins.x, bottomTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMins.y, blockCoordsMins.z);
-			vertexFace.vertexes[0] = vertex;
-			vertex.m_texCoords = Vec2(bottomTexCoordsMaxs.x, bottomTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMins.y, blockCoordsMins.z);
-			vertexFace.vertexes[1] = vertex;
-			vertex.m_texCoords = Vec2(bottomTexCoordsMaxs.x, bottomTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMaxs.y, blockCoordsMins.z);
-			vertexFace.vertexes[2] = vertex;
-			vertex.m_texCoords = Vec2(bottomTexCoordsMins.x, bottomTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMaxs.y, blockCoordsMins.z);
-			vertexFace.vertexes[3] = vertex;
-			out_vertexFaceArray.push_back(vertexFace);
-		}
+///=====================================================
+/// Called when the highest non-air block of a column becomes air
+///=====================================================
+void Chunk::LowerSkyHeight(int column){
+	int height = m_skyHeights[column] - 1;
+	while (height > 0 && GetBlockType((BlockIndex)(column + (height - 1) * BLOCKS_PER_CHUNK_LAYER)) == BT_AIR){
+		--height;
 	}
+	m_skyHeights[column] = (unsigned char)height;
+}
 
-	const Vec2& sideTexCoordsMins = blockDef.m_sideTexCoordsMins;
-	const Vec2 sideTexCoordsMaxs = sideTexCoordsMins + TEX_COORD_SIZE_PER_TILE_VEC2;
-	if (((blockIndex & CHUNK_LAYER_MASK) >> CHUNKS_WIDE_EXPONENT) != (CHUNK_LAYER_MASK >> CHUNKS_WIDE_EXPONENT)){ //we are not on the northern edge of the chunk
-		BlockIndex northBlockIndex = blockIndex + BLOCKS_PER_CHUNK_X;
-		const Block& northBlock = m_blocks[northBlockIndex];
-		if (!g_blockDefinitions[northBlock.m_type].m_isOpaque && northBlock.m_type != type){
-			unsigned char lighting = northBlock.GetLightValue() << 4;
-			vertex.m_color = RGBAchars(lighting, lighting, lighting);
-
-			vertex.m_texCoords = Vec2(sideTexCoordsMins.x, sideTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMaxs.y, blockCoordsMins.z);
-			vertexFace.vertexes[0] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMaxs.x, sideTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMaxs.y, blockCoordsMins.z);
-			vertexFace.vertexes[1] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMaxs.x, sideTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMaxs.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[2] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMins.x, sideTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMaxs.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[3] = vertex;
-			out_vertexFaceArray.push_back(vertexFace);
-		}
-	}
-	else if (m_chunkToNorth){
-		BlockIndex northBlockIndex = blockIndex & ~BLOCKINDEX_Y_MASK;
-		const Block& northBlock = m_chunkToNorth->m_blocks[northBlockIndex];
-		if (!g_blockDefinitions[northBlock.m_type].m_isOpaque && northBlock.m_type != type){
-			unsigned char lighting = northBlock.GetLightValue() << 4;
-			vertex.m_color = RGBAchars(lighting, lighting, lighting);
-
-			vertex.m_texCoords = Vec2(sideTexCoordsMins.x, sideTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMaxs.y, blockCoordsMins.z);
-			vertexFace.vertexes[0] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMaxs.x, sideTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMaxs.y, blockCoordsMins.z);
-			vertexFace.vertexes[1] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMaxs.x, sideTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMaxs.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[2] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMins.x, sideTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMaxs.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[3] = vertex;
-			out_vertexFaceArray.push_back(vertexFace);
-		}
+///=====================================================
+/// 
+///=====================================================
+void Chunk::AppendToRLEBuffer(unsigned char blockType, unsigned short blockCount, std::vector<unsigned char>& buffer) const{
+	buffer.push_back(blockType);
+	buffer.push_back((unsigned char)(blockCount >> 8));
+	buffer.push_back((unsigned char)blockCount);
+}
+
+///=====================================================
+/// 
+///=====================================================
+void Chunk::PlaceBlockBeneathCoords(BlockType blocktype, const WorldCoords& worldCoords, BlockLocations& dirtyBlocksList){
+	BlockIndex index = Chunk::GetIndexAtWorldCoords(worldCoords);
+	if (GetBlockType(index) != BT_AIR){ //inside a solid block, so can't place a block
+		return;
 	}
 
-	if (((blockIndex & CHUNK_LAYER_MASK) >> CHUNKS_WIDE_EXPONENT) != 0){ //we are not on the southern edge of the chunk
-		BlockIndex southBlockIndex = blockIndex - BLOCKS_PER_CHUNK_X;
-		const Block& southBlock = m_blocks[southBlockIndex];
-		if (!g_blockDefinitions[southBlock.m_type].m_isOpaque && southBlock.m_type != type){
-			unsigned char lighting = southBlock.GetLightValue() << 4;
-			vertex.m_color = RGBAchars(lighting, lighting, lighting);
-
-			vertex.m_texCoords = Vec2(sideTexCoordsMins.x, sideTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMins.y, blockCoordsMins.z);
-			vertexFace.vertexes[0] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMaxs.x, sideTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMins.y, blockCoordsMins.z);
-			vertexFace.vertexes[1] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMaxs.x, sideTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMins.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[2] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMins.x, sideTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMins.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[3] = vertex;
-			out_vertexFaceArray.push_back(vertexFace);
-		}
+	int column = index & CHUNK_LAYER_MASK;
+	BlockIndex groundIndex;
+	if (IsSky(index)){ //everything down to the sky height is air
+		if (m_skyHeights[column] == 0)
+			return;
+		groundIndex = (BlockIndex)(column + (m_skyHeights[column] - 1) * BLOCKS_PER_CHUNK_LAYER);
 	}
-	else if (m_chunkToSouth){
-		BlockIndex southBlockIndex = blockIndex | BLOCKINDEX_Y_MASK;
-		const Block& southBlock = m_chunkToSouth->m_blocks[southBlockIndex];
-		if (!g_blockDefinitions[southBlock.m_type].m_isOpaque && southBlock.m_type != type){
-			unsigned char lighting = southBlock.GetLightValue() << 4;
-			vertex.m_color = RGBAchars(lighting, lighting, lighting);
-
-			vertex.m_texCoords = Vec2(sideTexCoordsMins.x, sideTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMins.y, blockCoordsMins.z);
-			vertexFace.vertexes[0] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMaxs.x, sideTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMins.y, blockCoordsMins.z);
-			vertexFace.vertexes[1] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMaxs.x, sideTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMins.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[2] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMins.x, sideTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMins.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[3] = vertex;
-			out_vertexFaceArray.push_back(vertexFace);
+	else{
+		groundIndex = index - BLOCKS_PER_CHUNK_LAYER;
+		while (groundIndex < BLOCKS_PER_CHUNK && GetBlockType(groundIndex) == BT_AIR){
+			groundIndex -= BLOCKS_PER_CHUNK_LAYER;
 		}
+		if (groundIndex >= BLOCKS_PER_CHUNK)
+			return;
 	}
 
-	if ((blockIndex & CHUNK_X_MASK) != CHUNK_X_MASK){ //we are not on the eastern edge of the chunk
-		BlockIndex eastBlockIndex = blockIndex + 1;
-		const Block& eastBlock = m_blocks[eastBlockIndex];
-		if (!g_blockDefinitions[eastBlock.m_type].m_isOpaque && eastBlock.m_type != type){
-			unsigned char lighting = eastBlock.GetLightValue() << 4;
-			vertex.m_color = RGBAchars(lighting, lighting, lighting);
-
-			vertex.m_texCoords = Vec2(sideTexCoordsMins.x, sideTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMins.y, blockCoordsMins.z);
-			vertexFace.vertexes[0] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMaxs.x, sideTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMaxs.y, blockCoordsMins.z);
-			vertexFace.vertexes[1] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMaxs.x, sideTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMaxs.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[2] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMins.x, sideTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMins.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[3] = vertex;
-			out_vertexFaceArray.push_back(vertexFace);
-		}
-	}
-	else if (m_chunkToEast){
-		BlockIndex eastBlockIndex = blockIndex & ~BLOCKINDEX_X_MASK;
-		const Block& eastBlock = m_chunkToEast->m_blocks[eastBlockIndex];
-		if (!g_blockDefinitions[eastBlock.m_type].m_isOpaque && eastBlock.m_type != type){
-			unsigned char lighting = eastBlock.GetLightValue() << 4;
-			vertex.m_color = RGBAchars(lighting, lighting, lighting);
-
-			vertex.m_texCoords = Vec2(sideTexCoordsMins.x, sideTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMins.y, blockCoordsMins.z);
-			vertexFace.vertexes[0] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMaxs.x, sideTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMaxs.y, blockCoordsMins.z);
-			vertexFace.vertexes[1] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMaxs.x, sideTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMaxs.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[2] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMins.x, sideTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMaxs.x, blockCoordsMins.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[3] = vertex;
-			out_vertexFaceArray.push_back(vertexFace);
-		}
+	index = groundIndex + BLOCKS_PER_CHUNK_LAYER;
+	Block blockToChange = GetBlock(index);
+	SetBlockType(index, (unsigned char)blocktype);
+	RecordBlockEdit(index);
+	DirtyMeshesAroundIndex(index);
+
+	//relighting the placed block also relights every neighbor it now blocks or lights
+	if (!blockToChange.IsLightingDirty()){
+		if (g_debugPointsEnabled)
+			g_debugPositions.push_back(GetWorldCoordsAtIndex(index));
+
+		DirtyLightingAtIndex(index, dirtyBlocksList);
 	}
+}
 
-	if ((blockIndex & CHUNK_X_MASK) != 0){ //we are not on the western edge of the chunk
-		BlockIndex westBlockIndex = blockIndex - 1;
-		const Block& westBlock = m_blocks[westBlockIndex];
-		if (!g_blockDefinitions[westBlock.m_type].m_isOpaque && westBlock.m_type != type){
-			unsigned char lighting = westBlock.GetLightValue() << 4;
-			vertex.m_color = RGBAchars(lighting, lighting, lighting);
-
-			vertex.m_texCoords = Vec2(sideTexCoordsMins.x, sideTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMaxs.y, blockCoordsMins.z);
-			vertexFace.vertexes[0] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMaxs.x, sideTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMins.y, blockCoordsMins.z);
-			vertexFace.vertexes[1] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMaxs.x, sideTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMins.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[2] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMins.x, sideTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMaxs.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[3] = vertex;
-			out_vertexFaceArray.push_back(vertexFace);
+///=====================================================
+/// 
+///=====================================================
+void Chunk::DestroyBlockBeneathCoords(const WorldCoords& worldCoords, BlockLocations& dirtyBlocksList){
+	BlockIndex index = Chunk::GetIndexAtWorldCoords(worldCoords);
+	if (index >= BLOCKS_PER_CHUNK)
+		return;
+
+	int column = index & CHUNK_LAYER_MASK;
+	if (IsSky(index)){ //everything down to the sky height is air
+		if (m_skyHeights[column] == 0)
+			return;
+		index = (BlockIndex)(column + (m_skyHeights[column] - 1) * BLOCKS_PER_CHUNK_LAYER);
+	}
+	else{
+		while (index < BLOCKS_PER_CHUNK && GetBlockType(index) == BT_AIR){
+			index -= BLOCKS_PER_CHUNK_LAYER;
 		}
+		if (index >= BLOCKS_PER_CHUNK)
+			return;
 	}
-	else if (m_chunkToWest){
-		BlockIndex westBlockIndex = blockIndex | BLOCKINDEX_X_MASK;
-		const Block& westBlock = m_chunkToWest->m_blocks[westBlockIndex];
-		if (!g_blockDefinitions[westBlock.m_type].m_isOpaque && westBlock.m_type != type){
-			unsigned char lighting = westBlock.GetLightValue() << 4;
-			vertex.m_color = RGBAchars(lighting, lighting, lighting);
-
-			vertex.m_texCoords = Vec2(sideTexCoordsMins.x, sideTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMaxs.y, blockCoordsMins.z);
-			vertexFace.vertexes[0] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMaxs.x, sideTexCoordsMaxs.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMins.y, blockCoordsMins.z);
-			vertexFace.vertexes[1] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMaxs.x, sideTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMins.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[2] = vertex;
-			vertex.m_texCoords = Vec2(sideTexCoordsMins.x, sideTexCoordsMins.y);
-			vertex.m_position = Vec3(blockCoordsMins.x, blockCoordsMaxs.y, blockCoordsMaxs.z);
-			vertexFace.vertexes[3] = vertex;
-			out_vertexFaceArray.push_back(vertexFace);
+
+	SetBlockType(index, BT_AIR);
+	RecordBlockEdit(index);
+	DirtyMeshesAroundIndex(index);
+
+	//relight the destroyed block, plus any blocks below it that just became sky
+	int destroyedHeight = index / BLOCKS_PER_CHUNK_LAYER;
+	int lowestChangedHeight = IsSky(index) ? m_skyHeights[column] : destroyedHeight;
+	for (int height = destroyedHeight; height >= lowestChangedHeight; --height){
+		BlockIndex changedIndex = (BlockIndex)(column + height * BLOCKS_PER_CHUNK_LAYER);
+		Block block = GetBlock(changedIndex);
+
+		if (!block.IsLightingDirty()){
+			if (g_debugPointsEnabled)
+				g_debugPositions.push_back(GetWorldCoordsAtIndex(changedIndex));
+
+			DirtyLightingAtIndex(changedIndex, dirtyBlocksList);
 		}
 	}
 }
@@ -752,7 +849,7 @@ void Chunk::AddBlockVertexesToRenderingArray(const Block& block, BlockIndex bloc
 ///=====================================================
 /// 
 ///=====================================================
-void Chunk::AddWeatherVertexesToRenderingArray(const Block& block, BlockIndex blockIndex, Vertex3D_PCT_Faces& out_vertexFaceArray, const Vec2& camForwardNormal, bool isSnow) const{
+void Chunk::AddWeatherVertexesToRenderingArray(BlockIndex blockIndex, Vertex3D_PCT_Faces& out_vertexFaceArray, const Vec2& camForwardNormal, bool isSnow) const{
 	const WorldCoords blockCoordsMins = GetWorldCoordsAtIndex(blockIndex);
 	const WorldCoords blockCoordsMaxs = blockCoordsMins + Vec3(1.0f, 1.0f, 1.0f);
 
@@ -772,7 +869,7 @@ void Chunk::AddWeatherVertexesToRenderingArray(const Block& block, BlockIndex bl
 	const Vec2 weatherWorldCoordMins(blockCoordsMins.x + 0.5f - 0.5f * camForwardNormal.y, blockCoordsMins.y + 0.5f + 0.5f * camForwardNormal.x);
 	const Vec2 weatherWorldCoordMaxs(blockCoordsMins.x + 0.5f + 0.5f * camForwardNormal.y, blockCoordsMins.y + 0.5f - 0.5f * camForwardNormal.x);
 
-	unsigned char lighting = block.GetLightValue() << 4;
+	unsigned char lighting = PackedBlockVertex::GetBrightnessAtLightValue(m_lightValues[blockIndex]);
 	vertex.m_color = RGBAchars(lighting, lighting, lighting);
 
 	vertex.m_texCoords = Vec2(weatherTexCoordsMins.x, weatherTexCoordsMaxs.y);
@@ -797,13 +894,11 @@ void Chunk::AddWeatherVertexesToRenderingArray(const Block& block, BlockIndex bl
 void Chunk::DirtyEastBorderNonopaqueBlocks(BlockLocations& dirtyBlocksList){
 	for (int colStart = BLOCKS_PER_CHUNK_X - 1; colStart < BLOCKS_PER_CHUNK; colStart += BLOCKS_PER_CHUNK_LAYER){
 		for (BlockIndex index = (BlockIndex)(colStart); index < colStart + BLOCKS_PER_CHUNK_LAYER; index += BLOCKS_PER_CHUNK_X){
-			Block& block = m_blocks[index];
-			if (!g_blockDefinitions[block.m_type].m_isOpaque && !block.IsLightingDirty()){
-				block.DirtyLighting();
-				BlockLocation blockLocation(this, index);
+			Block block = GetBlock(index);
+			if (!GetBlockDefinition(index).m_isOpaque && !block.IsLightingDirty()){
 				if (g_debugPointsEnabled)
 					g_debugPositions.push_back(GetWorldCoordsAtIndex(index));
-				dirtyBlocksList.push_back(blockLocation);
+				DirtyLightingAtIndex(index, dirtyBlocksList);
 			}
 		}
 	}
@@ -815,13 +910,11 @@ void Chunk::DirtyEastBorderNonopaqueBlocks(BlockLocations& dirtyBlocksList){
 void Chunk::DirtyWestBorderNonopaqueBlocks(BlockLocations& dirtyBlocksList){
 	for (int colStart = 0; colStart < BLOCKS_PER_CHUNK; colStart += BLOCKS_PER_CHUNK_LAYER){
 		for (BlockIndex index = (BlockIndex)(colStart); index < colStart + BLOCKS_PER_CHUNK_LAYER; index += BLOCKS_PER_CHUNK_X){
-			Block& block = m_blocks[index];
-			if (!g_blockDefinitions[block.m_type].m_isOpaque && !block.IsLightingDirty()){
-				block.DirtyLighting();
-				BlockLocation blockLocation(this, index);
+			Block block = GetBlock(index);
+			if (!GetBlockDefinition(index).m_isOpaque && !block.IsLightingDirty()){
 				if (g_debugPointsEnabled)
 					g_debugPositions.push_back(GetWorldCoordsAtIndex(index));
-				dirtyBlocksList.push_back(blockLocation);
+				DirtyLightingAtIndex(index, dirtyBlocksList);
 			}
 		}
 	}
@@ -833,13 +926,11 @@ void Chunk::DirtyWestBorderNonopaqueBlocks(BlockLocations& dirtyBlocksList){
 void Chunk::DirtyNorthBorderNonopaqueBlocks(BlockLocations& dirtyBlocksList){
 	for (int rowStart = BLOCKS_PER_CHUNK_LAYER - BLOCKS_PER_CHUNK_X; rowStart < BLOCKS_PER_CHUNK; rowStart += BLOCKS_PER_CHUNK_LAYER){
 		for (BlockIndex index = (BlockIndex)(rowStart); index < rowStart + BLOCKS_PER_CHUNK_X; ++index){
-			Block& block = m_blocks[index];
-			if (!g_blockDefinitions[block.m_type].m_isOpaque && !block.IsLightingDirty()){
-				block.DirtyLighting();
-				BlockLocation blockLocation(this, index);
+			Block block = GetBlock(index);
+			if (!GetBlockDefinition(index).m_isOpaque && !block.IsLightingDirty()){
 				if (g_debugPointsEnabled)
 					g_debugPositions.push_back(GetWorldCoordsAtIndex(index));
-				dirtyBlocksList.push_back(blockLocation);
+				DirtyLightingAtIndex(index, dirtyBlocksList);
 			}
 		}
 	}
@@ -851,13 +942,11 @@ void Chunk::DirtyNorthBorderNonopaqueBlocks(BlockLocations& dirtyBlocksList){
 void Chunk::DirtySouthBorderNonopaqueBlocks(BlockLocations& dirtyBlocksList){
 	for (int rowStart = 0; rowStart < BLOCKS_PER_CHUNK; rowStart += BLOCKS_PER_CHUNK_LAYER){
 		for (BlockIndex index = (BlockIndex)(rowStart); index < rowStart + BLOCKS_PER_CHUNK_X; ++index){
-			Block& block = m_blocks[index];
-			if (!g_blockDefinitions[block.m_type].m_isOpaque && !block.IsLightingDirty()){
-				block.DirtyLighting();
-				BlockLocation blockLocation(this, index);
+			Block block = GetBlock(index);
+			if (!GetBlockDefinition(index).m_isOpaque && !block.IsLightingDirty()){
 				if (g_debugPointsEnabled)
 					g_debugPositions.push_back(GetWorldCoordsAtIndex(index));
-				dirtyBlocksList.push_back(blockLocation);
+				DirtyLightingAtIndex(index, dirtyBlocksList);
 			}
 		}
 	}
@@ -890,20 +979,83 @@ bool Chunk::IsInFrontOfCamera(const Vec3& camPosition, const Vec3& camForward) c
 /// 
 ///=====================================================
 float Chunk::CalculateWeatherAtWorldCoords(const WorldCoords& worldCoords){
-	float currentSeconds = (float)GetCurrentSeconds();
-	return 0.5f + ComputePerlinNoiseValueAtPosition2D(Vec2(worldCoords.x - 1.5f * currentSeconds, worldCoords.y), 300.0f, 8, 0.5f, 0.5f);
+	const Vec2 position(worldCoords.x, worldCoords.y);
+	float weather;
+	CalculateWeatherAtPositions(&position, 1, &weather);
+	return weather;
 }
 
 ///=====================================================
 /// 
 ///=====================================================
 float Chunk::CalculateBiomeAtWorldCoords(const WorldCoords& worldCoords, int& out_groundHeightForColumn){
-	out_groundHeightForColumn = (int)(AVERAGE_GROUND_HEIGHT + ComputePerlinNoiseValueAtPosition2D(Vec2(worldCoords.x, worldCoords.y), 80.0f, 8, 18.0f, 0.5f));
-	float biome = 0.5f + ComputePerlinNoiseValueAtPosition2D(Vec2(worldCoords.x, worldCoords.y), 200.0f, 8, 0.5f, 0.5f);
-	biome *= sqrt((float)out_groundHeightForColumn * (1.0f / AVERAGE_GROUND_HEIGHT));
+	const Vec2 position(worldCoords.x, worldCoords.y);
+	float biome;
+	CalculateBiomesAtPositions(&position, 1, &biome, &out_groundHeightForColumn);
 	return biome;
 }
 
+///=====================================================
+/// Weather drifts with time, so every position in the batch is sampled at the same moment
+///=====================================================
+void Chunk::CalculateWeatherAtPositions(const Vec2* positions, int numPositions, float* out_weatherValues){
+	const float weatherOffsetX = 1.5f * (float)GetCurrentSeconds();
+	Vec2 driftedPositions[BLOCKS_PER_CHUNK_LAYER];
+	for (int batchStart = 0; batchStart < numPositions; batchStart += BLOCKS_PER_CHUNK_LAYER){
+		int batchSize = min(numPositions - batchStart, BLOCKS_PER_CHUNK_LAYER);
+		for (int positionIndex = 0; positionIndex < batchSize; ++positionIndex){
+			driftedPositions[positionIndex] = Vec2(positions[batchStart + positionIndex].x - weatherOffsetX, positions[batchStart + positionIndex].y);
+		}
+		ComputePerlinNoiseValuesAtPositions2D(driftedPositions, batchSize, 300.0f, 8, 0.5f, 0.5f, out_weatherValues + batchStart);
+	}
+
+	for (int positionIndex = 0; positionIndex < numPositions; ++positionIndex){
+		out_weatherValues[positionIndex] += 0.5f;
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+void Chunk::CalculateBiomesAtPositions(const Vec2* positions, int numPositions, float* out_biomeValues, int* out_groundHeights){
+	ComputePerlinNoiseValuesAtPositions2D(positions, numPositions, 80.0f, 8, 18.0f, 0.5f, out_biomeValues);
+	for (int positionIndex = 0; positionIndex < numPositions; ++positionIndex){
+		out_groundHeights[positionIndex] = (int)(AVERAGE_GROUND_HEIGHT + out_biomeValues[positionIndex]);
+	}
+
+	ComputePerlinNoiseValuesAtPositions2D(positions, numPositions, 200.0f, 8, 0.5f, 0.5f, out_biomeValues);
+	for (int positionIndex = 0; positionIndex < numPositions; ++positionIndex){
+		out_biomeValues[positionIndex] = (0.5f + out_biomeValues[positionIndex]) * sqrt((float)out_groundHeights[positionIndex] * (1.0f / AVERAGE_GROUND_HEIGHT));
+	}
+}
+
+///=====================================================
+/// Chunks loaded from disk skip generation, so their biomes are sampled the first time something asks for them
+///=====================================================
+void Chunk::CacheColumnBiomes(){
+	if (m_areColumnBiomesCached)
+		return;
+
+	Vec2 columnPositions[BLOCKS_PER_CHUNK_LAYER];
+	for (int column = 0; column < BLOCKS_PER_CHUNK_LAYER; ++column){
+		columnPositions[column] = Vec2(GetWorldCoordsAtIndex((BlockIndex)column));
+	}
+
+	int unused[BLOCKS_PER_CHUNK_LAYER];
+	CalculateBiomesAtPositions(columnPositions, BLOCKS_PER_CHUNK_LAYER, m_columnBiomes, unused);
+	m_areColumnBiomesCached = true;
+}
+
+///=====================================================
+/// 
+///=====================================================
+bool Chunk::IsRainingAtColumn(int column){
+	CacheColumnBiomes();
+	if (m_columnBiomes[column] >= PERLIN_MINIMUM_SNOW_BIOME)
+		return false;
+	return CalculateWeatherAtWorldCoords(GetWorldCoordsAtIndex((BlockIndex)column)) >= PERLIN_MINIMUM_PRECIPITATION;
+}
+
 ///=====================================================
 /// 
 ///=====================================================
@@ -9,6 +9,8 @@
 #define __included_Chunk__
 
 #include "Block.hpp"
+#include "PalettedBlockStorage.hpp"
+#include "PackedBlockVertex.hpp"
 #include "Engine/Renderer/OpenGLRenderer.hpp"
 #include "Engine/Math/IntVec2.hpp"
 #include "Engine/Math/IntVec3.hpp"
@@ -22,6 +24,15 @@ const int BLOCKS_PER_CHUNK_Y = 1 << CHUNKS_LONG_EXPONENT;
 const int BLOCKS_PER_CHUNK_Z = 1 << CHUNKS_HIGH_EXPONENT;
 const int BLOCKS_PER_CHUNK = BLOCKS_PER_CHUNK_X * BLOCKS_PER_CHUNK_Y * BLOCKS_PER_CHUNK_Z;
 const int BLOCKS_PER_CHUNK_LAYER = BLOCKS_PER_CHUNK_X * BLOCKS_PER_CHUNK_Y;
+const int LIGHT_DIRTY_WORDS_PER_CHUNK = BLOCKS_PER_CHUNK >> LIGHT_DIRTY_BITS_PER_WORD_EXPONENT;
+
+const int SECTIONS_HIGH_EXPONENT = 4;
+const int BLOCKS_PER_SECTION_Z = 1 << SECTIONS_HIGH_EXPONENT;
+const int BLOCKS_PER_SECTION = BLOCKS_PER_CHUNK_LAYER * BLOCKS_PER_SECTION_Z;
+const int SECTIONS_PER_CHUNK = BLOCKS_PER_CHUNK / BLOCKS_PER_SECTION;
+const int SECTION_INDEX_SHIFT = CHUNKS_WIDE_EXPONENT + CHUNKS_LONG_EXPONENT + SECTIONS_HIGH_EXPONENT;
+const int SECTION_BLOCK_MASK = BLOCKS_PER_SECTION - 1;
+const unsigned char ALL_SECTIONS_MASK = (unsigned char)((1 << SECTIONS_PER_CHUNK) - 1);
 
 const int CHUNK_X_MASK = BLOCKS_PER_CHUNK_X - 1;
 const int CHUNK_Y_MASK = BLOCKS_PER_CHUNK_Y - 1;
@@ -39,8 +50,12 @@ const BlockIndex BLOCKINDEX_X_MASK = (BlockIndex)(BLOCKS_PER_CHUNK_X - 1);
 const BlockIndex BLOCKINDEX_Y_MASK = (BlockIndex)((BLOCKS_PER_CHUNK_Y - 1) << CHUNKS_WIDE_EXPONENT);
 const BlockIndex BLOCKINDEX_Z_MASK = (BlockIndex)((BLOCKS_PER_CHUNK_Z - 1) << (CHUNKS_WIDE_EXPONENT + CHUNKS_LONG_EXPONENT));
 
-const int RLE_ENTRY_BYTES = sizeof(Block) + sizeof(BlockIndex);
+const int RLE_ENTRY_BYTES = sizeof(unsigned char) + sizeof(BlockIndex); //block type + run length
 const int MAX_RLE_BYTES = BLOCKS_PER_CHUNK * RLE_ENTRY_BYTES;
+const unsigned char DELTA_SAVE_TAG = 0xFF; //never a block type, so a full RLE save can't start with it
+const unsigned char TERRAIN_GENERATION_VERSION = 1; //bump whenever PopulateWithBlocks changes, so older delta saves regenerate instead of patching different terrain
+const int DELTA_HEADER_BYTES = sizeof(unsigned char) + sizeof(unsigned char) + sizeof(unsigned short); //tag + terrain generation version + number of runs
+const int DELTA_RUN_BYTES = sizeof(BlockIndex) + sizeof(unsigned short) + sizeof(unsigned char); //first block index + run length + block type
 
 typedef IntVec3 LocalCoords;
 typedef Vec3 WorldCoords;
@@ -60,38 +75,87 @@ public:
 	Vec3 m_impactSurfaceNormal;
 };
 
+enum BlockFace{
+	FACE_TOP,
+	FACE_BOTTOM,
+	FACE_NORTH,
+	FACE_SOUTH,
+	FACE_EAST,
+	FACE_WEST,
+	NUM_BLOCK_FACES
+};
+
+enum SectionContents{
+	SECTION_ALL_AIR,
+	SECTION_UNIFORM,
+	SECTION_MIXED
+};
+
+///=====================================================
+/// A 16x16x16 slice of a chunk. Uniform sections store a single block type and no per-block indexes.
+///=====================================================
+struct ChunkSection{
+public:
+	inline ChunkSection():m_blockTypes(BLOCKS_PER_SECTION){}
+
+	PalettedBlockStorage m_blockTypes;
+
+	SectionContents GetContents() const;
+};
+
 class Chunk{
 private:
-	int m_numVertexesInVBO;
-	Vertex3D_PCT_Faces m_translucentBlocksVertexFaceArray;
+	int m_numVertexesInSectionVBOs[SECTIONS_PER_CHUNK];
+	GLuint m_sectionVboIDs[SECTIONS_PER_CHUNK];
+	//Kept so the VBOs can be recolored without remeshing when the sky light level changes.
+	//A packed face is 32 bytes against the 96 it unpacks to in the VBO, so this costs at most a third of the largest VBO each section has had.
+	PackedBlockVertexFaces m_sectionOpaqueVertexFaceArrays[SECTIONS_PER_CHUNK];
+	PackedBlockVertexFaces m_sectionTranslucentVertexFaceArrays[SECTIONS_PER_CHUNK];
+	PackedBlockVertexFaces m_translucentBlocksVertexFaceArray; //every section's translucent faces, unpacked and sorted together each frame
+	std::vector<unsigned int> m_translucentSortOrder; //face indexes, furthest from the camera first
+	IntVec3 m_translucentSortCameraBlock; //the block the camera was in when m_translucentSortOrder was built
+	bool m_isTranslucentSortValid;
+	static std::vector<unsigned int> s_translucentSortKeys;
+	static Vertex3D_PCT_Faces s_unpackedVertexFaceArray; //scratch for faces on their way to the renderer
 	static Vertex3D_PCT_Faces s_weatherVertexFaceArray;
 
-	static unsigned char s_tempRLEBuffer[MAX_RLE_BYTES];
-
 	void DrawBlockAtIndex(const OpenGLRenderer* renderer, BlockIndex blockIndex) const;
 
-	unsigned char* CreateRLEBuffer(size_t& out_rleBufferSize) const;
-	void PopulateFromTempRLEBuffer();
+	void CompactSections();
+	void CalculateSkyHeights();
+	void LowerSkyHeight(int column);
 	void AppendToRLEBuffer(unsigned char blockType, unsigned short blockCount, std::vector<unsigned char>& buffer) const;
-	std::string GetFilePath() const;
+	void ApplyDeltaBuffer(const unsigned char* deltaBuffer);
+	static bool IsValidRLEBuffer(const unsigned char* rleBuffer, size_t rleBufferSize);
+	static bool IsValidDeltaBuffer(const unsigned char* deltaBuffer, size_t deltaBufferSize);
 
-	void AddBlockVertexesToRenderingArray(const Block& block, BlockIndex blockIndex, Vertex3D_PCT_Faces& out_vertexFaceArray, bool useOpaqueBlocks) const;
-	void AddWeatherVertexesToRenderingArray(const Block& block, BlockIndex blockIndex, Vertex3D_PCT_Faces& out_vertexFaceArray, const Vec2& camForwardNormal, bool isSnow) const;
-	void PopulateVertexFaceArray(Vertex3D_PCT_Faces& out_vertexFaceArray, bool useOpaqueBlocks, bool useWeather, bool isSnow, const Vec2& camForwardNormal, const Vec3& playerPosition) const;
-	void GenerateVertexArrayAndVBO(const OpenGLRenderer* renderer);
-	static bool SortBlocksFurthestToNearest(const Vertex3D_PCT_Face& vertexFace1, const Vertex3D_PCT_Face& vertexFace2);
+	void AddWeatherVertexesToRenderingArray(BlockIndex blockIndex, Vertex3D_PCT_Faces& out_vertexFaceArray, const Vec2& camForwardNormal, bool isSnow) const;
+	void PopulateWeatherVertexFaceArray(Vertex3D_PCT_Faces& out_vertexFaceArray, bool isSnow, const Vec2& camForwardNormal, const Vec3& playerPosition) const;
 
 	static float CalculateWeatherAtWorldCoords(const WorldCoords& worldCoords);
 	static float CalculateBiomeAtWorldCoords(const WorldCoords& worldCoords, int& out_groundHeightForColumn);
+	static void CalculateWeatherAtPositions(const Vec2* positions, int numPositions, float* out_weatherValues);
+	static void CalculateBiomesAtPositions(const Vec2* positions, int numPositions, float* out_biomeValues, int* out_groundHeights);
+	void CacheColumnBiomes();
 
 public:
 	const static float SEA_LEVEL;
 	const static float AVERAGE_GROUND_HEIGHT;
 
-	Block m_blocks[BLOCKS_PER_CHUNK];
+	ChunkSection m_sections[SECTIONS_PER_CHUNK];
+	unsigned char m_lightValues[BLOCKS_PER_CHUNK];
+	unsigned int m_lightDirtyBits[LIGHT_DIRTY_WORDS_PER_CHUNK]; //one bit per block, set while it waits to be relit
+	unsigned char m_skyHeights[BLOCKS_PER_CHUNK_LAYER]; //per column, the lowest height that is open to the sky (one above the highest non-air block)
+	float m_columnBiomes[BLOCKS_PER_CHUNK_LAYER]; //static per-column noise, only valid while m_areColumnBiomesCached
+	bool m_areColumnBiomesCached;
 	WorldCoords m_worldCoordsMins;
-	bool m_isVboDirty;
-	GLuint m_vboID;
+	unsigned char m_dirtySectionsMask; //bit n set when section n needs remeshing
+	unsigned int m_pendingMeshRevision; //0 when no mesh job is in flight
+	int m_numQueuedLightUpdates; //dirty blocks and light propagation queue entries in this chunk; remeshing waits until it's 0
+	unsigned char m_vboSkyLightLevel; //the sky light level every section VBO was colored at
+	bool m_hasUnsavedEdits; //set only by block edits; chunks without any match their file or regenerate identically, so aren't saved
+	std::vector<BlockIndex> m_editedBlockIndexes; //every block edited since the chunk was generated, possibly repeated; a delta save writes these
+	bool m_hasUntrackedEdits; //loaded from a full save, so which blocks differ from generated terrain is unknown and only full saves are written
 	static WorldCoords s_lastKnownCameraPosition;
 
 	Chunk* m_chunkToNorth;
@@ -100,17 +164,44 @@ public:
 	Chunk* m_chunkToWest;
 
 	Chunk();
+	void Reset();
 
 	void PopulateWithBlocks();
+
+	unsigned char GetBlockType(BlockIndex blockIndex) const;
+	void SetBlockType(BlockIndex blockIndex, unsigned char blockType);
+	const BlockDefinition& GetBlockDefinition(BlockIndex blockIndex) const;
+	Block GetBlock(BlockIndex blockIndex);
+	void DirtyLightingAtIndex(BlockIndex blockIndex, BlockLocations& dirtyBlocksList);
+	void UndirtyLightingAtIndex(BlockIndex blockIndex);
+	inline bool IsLightingSettled() const{ return m_numQueuedLightUpdates == 0; }
+	unsigned char GetLightValue(BlockIndex blockIndex) const;
+	bool IsSky(BlockIndex blockIndex) const;
+	int GetSkyHeight(int column) const;
+	bool IsRainingAtColumn(int column);
+	bool IsSectionUniformOpaqueAndUnlit(int section) const;
+	size_t GetNumBlockBytesUsed() const;
 	
 	bool IsInFrontOfCamera(const Vec3& camPosition, const Vec3& camForward) const;
 	void RenderWithVAs(const OpenGLRenderer* renderer, const AnimatedTexture& texture, bool useWeather, bool isSnow, const Vec2& camForwardNormal, const Vec3& playerPosition);
 	void RenderWithVBOs(const OpenGLRenderer* renderer, const AnimatedTexture& textureAtlas);
+	void UploadSectionMeshes(const OpenGLRenderer* renderer, unsigned char sectionsMask, const PackedBlockVertexFaces* opaqueVertexFaces, const PackedBlockVertexFaces* translucentVertexFaces);
+	void SortTranslucentFacesFurthestToNearest();
+	inline const std::vector<unsigned int>& GetTranslucentSortOrder() const{ return m_translucentSortOrder; }
+	void RefreshVboLighting(const OpenGLRenderer* renderer);
+	size_t GetNumKeptFaceBytes() const;
+	void DeleteBuffers(const OpenGLRenderer* renderer);
+	void DirtyMeshAtIndex(BlockIndex blockIndex);
+	void DirtyMeshesAroundIndex(BlockIndex blockIndex);
+	inline void DirtyAllSectionMeshes(){ m_dirtySectionsMask = ALL_SECTIONS_MASK; }
 	void RenderWithGLBegin(const OpenGLRenderer* renderer, const AnimatedTexture& textureAtlas) const;
 	void Update(double deltaSeconds);
 
-	void SaveToDisk() const;
-	bool LoadFromDisk();
+	void CreateRLEBuffer(std::vector<unsigned char>& out_rleBuffer) const;
+	void PopulateFromRLEBuffer(const unsigned char* rleBuffer);
+	void RecordBlockEdit(BlockIndex blockIndex);
+	bool CreateDeltaBuffer(std::vector<unsigned char>& out_deltaBuffer, size_t fullSaveBytes) const;
+	bool PopulateFromSaveBuffer(const unsigned char* saveBuffer, size_t saveBufferSize);
 
 	void PlaceBlockBeneathCoords(BlockType blocktype, const WorldCoords& worldCoords, BlockLocations& dirtyBlocksList);
 	void DestroyBlockBeneathCoords(const WorldCoords& worldCoords, BlockLocations& dirtyBlocksList);
@@ -120,6 +211,7 @@ public:
 	void DirtyNorthBorderNonopaqueBlocks(BlockLocations& dirtyBlocksList);
 	void DirtySouthBorderNonopaqueBlocks(BlockLocations& dirtyBlocksList);
 
+	static int GetSectionAtIndex(BlockIndex blockIndex);
 	static const LocalCoords GetLocalCoordsAtIndex(BlockIndex blockIndex);
 	static BlockIndex GetIndexAtLocalCoords(const LocalCoords& localCoords);
 	static const ChunkCoords GetChunkCoordsAtWorldCoords(const WorldCoords& worldCoords);
@@ -131,20 +223,134 @@ public:
 
 	static bool IsRainingAtWorldCoords(const WorldCoords& worldCoords);
 };
-typedef std::map<ChunkCoords, Chunk*> Chunks;
 
 ///=====================================================
 /// 
 ///=====================================================
 inline Chunk::Chunk()
-:m_isVboDirty(true),
-m_vboID(0),
+:m_dirtySectionsMask(ALL_SECTIONS_MASK),
+m_pendingMeshRevision(0),
+m_numQueuedLightUpdates(0),
+m_hasUnsavedEdits(false),
+m_hasUntrackedEdits(false),
+m_vboSkyLightLevel(PackedBlockVertex::GetSkyLightLevel()),
+m_isTranslucentSortValid(false),
 m_chunkToWest(NULL),
 m_chunkToSouth(NULL),
 m_chunkToNorth(NULL),
 m_chunkToEast(NULL),
-m_numVertexesInVBO(0),
+m_areColumnBiomesCached(false),
 m_worldCoordsMins(0.0f, 0.0f, 0.0f){
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		m_numVertexesInSectionVBOs[section] = 0;
+		m_sectionVboIDs[section] = 0;
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline unsigned char Chunk::GetBlockType(BlockIndex blockIndex) const{
+	return m_sections[blockIndex >> SECTION_INDEX_SHIFT].m_blockTypes.GetType(blockIndex & SECTION_BLOCK_MASK);
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline void Chunk::SetBlockType(BlockIndex blockIndex, unsigned char blockType){
+	m_sections[blockIndex >> SECTION_INDEX_SHIFT].m_blockTypes.SetType(blockIndex & SECTION_BLOCK_MASK, blockType);
+
+	int column = blockIndex & CHUNK_LAYER_MASK;
+	int height = blockIndex >> (CHUNKS_WIDE_EXPONENT + CHUNKS_LONG_EXPONENT);
+	if (blockType != BT_AIR){
+		if (height >= m_skyHeights[column])
+			m_skyHeights[column] = (unsigned char)(height + 1);
+	}
+	else if (height == m_skyHeights[column] - 1){
+		LowerSkyHeight(column);
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline const BlockDefinition& Chunk::GetBlockDefinition(BlockIndex blockIndex) const{
+	return g_blockDefinitions[GetBlockType(blockIndex)];
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline Block Chunk::GetBlock(BlockIndex blockIndex){
+	return Block(&m_lightValues[blockIndex], m_lightDirtyBits, blockIndex);
+}
+
+///=====================================================
+/// queues the block for relighting; callers check IsLightingDirty first, so a block is never queued twice
+///=====================================================
+inline void Chunk::DirtyLightingAtIndex(BlockIndex blockIndex, BlockLocations& dirtyBlocksList){
+	GetBlock(blockIndex).DirtyLighting();
+	dirtyBlocksList.push_back(BlockLocation(this, blockIndex));
+	++m_numQueuedLightUpdates;
+}
+
+///=====================================================
+/// for a block taken off a dirty blocks list
+///=====================================================
+inline void Chunk::UndirtyLightingAtIndex(BlockIndex blockIndex){
+	GetBlock(blockIndex).UndirtyLighting();
+	--m_numQueuedLightUpdates;
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline unsigned char Chunk::GetLightValue(BlockIndex blockIndex) const{
+	return m_lightValues[blockIndex];
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline bool Chunk::IsSky(BlockIndex blockIndex) const{
+	return (blockIndex >> (CHUNKS_WIDE_EXPONENT + CHUNKS_LONG_EXPONENT)) >= m_skyHeights[blockIndex & CHUNK_LAYER_MASK];
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline int Chunk::GetSkyHeight(int column) const{
+	return m_skyHeights[column];
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline bool Chunk::IsSectionUniformOpaqueAndUnlit(int section) const{
+	const PalettedBlockStorage& sectionBlockTypes = m_sections[section].m_blockTypes;
+	if (!sectionBlockTypes.IsUniform())
+		return false;
+
+	const BlockDefinition& blockDef = g_blockDefinitions[sectionBlockTypes.GetUniformType()];
+	return blockDef.m_isOpaque && blockDef.m_inherentLightValue == 0;
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline size_t Chunk::GetNumBlockBytesUsed() const{
+	size_t numBytesUsed = sizeof(m_lightValues) + sizeof(m_lightDirtyBits) + sizeof(m_skyHeights);
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		numBytesUsed += m_sections[section].m_blockTypes.GetNumBytesUsed();
+	}
+	return numBytesUsed;
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline int Chunk::GetSectionAtIndex(BlockIndex blockIndex){
+	return blockIndex >> SECTION_INDEX_SHIFT;
 }
 
 ///=====================================================
@@ -219,4 +425,15 @@ inline const WorldCoords Chunk::GetWorldCoordsAtIndex(BlockIndex blockIndex) con
 	return WorldCoords((float)localX + m_worldCoordsMins.x, (float)localY + m_worldCoordsMins.y, (float)localZ + m_worldCoordsMins.z);
 }
 
+///=====================================================
+/// 
+///=====================================================
+inline SectionContents ChunkSection::GetContents() const{
+	if (!m_blockTypes.IsUniform())
+		return SECTION_MIXED;
+	if (m_blockTypes.GetUniformType() == BT_AIR)
+		return SECTION_ALL_AIR;
+	return SECTION_UNIFORM;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,84 @@
+//=====================================================
+// ChunkJobs.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "ChunkJobs.hpp"
+#include "Engine/Time/Time.hpp"
+
+///=====================================================
+/// 
+///=====================================================
+void ChunkGenerationJob::Execute(){
+	if (m_saveBuffer.empty() || !m_chunk->PopulateFromSaveBuffer(&m_saveBuffer[0], m_saveBuffer.size()))
+		m_chunk->PopulateWithBlocks();
+}
+
+///=====================================================
+/// 
+///=====================================================
+void ChunkMeshJob::Prepare(const ChunkCoords& chunkCoords, const Chunk& chunk, unsigned char sectionsMask, unsigned int meshRevision){
+	m_chunkCoords = chunkCoords;
+	m_meshRevision = meshRevision;
+	m_sectionsMask = sectionsMask;
+	m_snapshot.CopyFromChunk(chunk, sectionsMask);
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		m_opaqueVertexFaces[section].clear();
+		m_translucentVertexFaces[section].clear();
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+ChunkIOJob::ChunkIOJob(JobType type, const ChunkCoords& chunkCoords, RegionFileCache& regionFiles)
+:Job(type),
+m_chunkCoords(chunkCoords),
+m_regionFiles(regionFiles),
+m_submitSeconds(GetCurrentSeconds()),
+m_completeSeconds(m_submitSeconds){
+}
+
+///=====================================================
+/// 
+///=====================================================
+ChunkLoadJob::ChunkLoadJob(const ChunkCoords& chunkCoords, Chunk* chunk, RegionFileCache& regionFiles)
+:ChunkIOJob(JOB_TYPE_LOAD_CHUNK, chunkCoords, regionFiles),
+m_chunk(chunk),
+m_didLoad(false){
+}
+
+///=====================================================
+/// 
+///=====================================================
+void ChunkLoadJob::Execute(){
+	m_rleBuffer.resize(MAX_RLE_BYTES);
+	size_t rleBufferSize = 0;
+	m_didLoad = m_regionFiles.LoadChunk(m_chunkCoords, &m_rleBuffer[0], m_rleBuffer.size(), rleBufferSize);
+	m_rleBuffer.resize(rleBufferSize);
+
+	m_completeSeconds = GetCurrentSeconds();
+}
+
+///=====================================================
+/// 
+///=====================================================
+ChunkSaveJob::ChunkSaveJob(const ChunkCoords& chunkCoords, const Chunk& chunk, RegionFileCache& regionFiles)
+:ChunkIOJob(JOB_TYPE_SAVE_CHUNK, chunkCoords, regionFiles),
+m_editedBlockIndexes(chunk.m_editedBlockIndexes),
+m_hasUntrackedEdits(chunk.m_hasUntrackedEdits),
+m_numBytesSaved(0),
+m_didSave(false){
+	chunk.CreateRLEBuffer(m_rleBuffer);
+	m_useDeltaBuffer = chunk.CreateDeltaBuffer(m_deltaBuffer, m_rleBuffer.size());
+}
+
+///=====================================================
+/// 
+///=====================================================
+void ChunkSaveJob::Execute(){
+	const std::vector<unsigned char>& saveBuffer = m_useDeltaBuffer ? m_deltaBuffer : m_rleBuffer;
+	m_didSave = m_regionFiles.SaveChunk(m_chunkCoords, &saveBuffer[0], saveBuffer.size());
+	m_numBytesSaved = m_didSave ? saveBuffer.size() : 0;
+	m_completeSeconds = GetCurrentSeconds();
+}
@@ -0,0 +1,102 @@
+//=====================================================
+// ChunkJobs.hpp
+// by Andrew Socha
+//=====================================================
+
+#pragma once
+
+#ifndef __included_ChunkJobs__
+#define __included_ChunkJobs__
+
+#include "Job.hpp"
+#include "Chunk.hpp"
+#include "ChunkMeshSnapshot.hpp"
+#include "RegionFile.hpp"
+
+///=====================================================
+/// Fills a pooled chunk with terrain off the main thread. The chunk isn't linked into the world until the job completes.
+/// A chunk read from its region file is populated from that save instead; a delta save regenerates the terrain here, not on the I/O thread.
+///=====================================================
+class ChunkGenerationJob : public Job{
+public:
+	ChunkCoords m_chunkCoords;
+	Chunk* m_chunk;
+	std::vector<unsigned char> m_saveBuffer; //empty unless the chunk was loaded; generated as usual if the save is corrupt or out of date
+
+	inline ChunkGenerationJob(const ChunkCoords& chunkCoords, Chunk* chunk):Job(JOB_TYPE_GENERATE_CHUNK), m_chunkCoords(chunkCoords), m_chunk(chunk){}
+
+	virtual void Execute();
+};
+
+///=====================================================
+/// Builds the vertex arrays for a chunk's dirty sections off the main thread from a snapshot of the blocks it reads,
+/// so later edits can't race with the mesher. The main thread uploads the result if the revision still matches.
+/// Jobs are pooled by World and re-prepared for each mesh; uploading copies the vertex arrays into the chunk,
+/// so each job's arrays keep their capacity and meshing doesn't touch the heap once warm.
+///=====================================================
+class ChunkMeshJob : public Job{
+public:
+	ChunkCoords m_chunkCoords;
+	unsigned int m_meshRevision;
+	unsigned char m_sectionsMask;
+	ChunkMeshSnapshot m_snapshot;
+	PackedBlockVertexFaces m_opaqueVertexFaces[SECTIONS_PER_CHUNK];
+	PackedBlockVertexFaces m_translucentVertexFaces[SECTIONS_PER_CHUNK];
+
+	inline ChunkMeshJob():Job(JOB_TYPE_MESH_CHUNK), m_meshRevision(0), m_sectionsMask(0){}
+
+	void Prepare(const ChunkCoords& chunkCoords, const Chunk& chunk, unsigned char sectionsMask, unsigned int meshRevision);
+
+	inline virtual void Execute(){ m_snapshot.BuildSectionMeshes(m_sectionsMask, m_opaqueVertexFaces, m_translucentVertexFaces); }
+};
+
+///=====================================================
+/// A chunk load or save run on the I/O thread, timed from submission to completion.
+/// Each job owns its own RLE buffer, so any number can be queued at once.
+///=====================================================
+class ChunkIOJob : public Job{
+public:
+	ChunkCoords m_chunkCoords;
+	RegionFileCache& m_regionFiles;
+	std::vector<unsigned char> m_rleBuffer;
+	double m_submitSeconds;
+	double m_completeSeconds;
+
+	ChunkIOJob(JobType type, const ChunkCoords& chunkCoords, RegionFileCache& regionFiles);
+
+	inline float GetLatencyMilliseconds() const{ return (float)((m_completeSeconds - m_submitSeconds) * 1000.0); }
+};
+
+///=====================================================
+/// Only reads a chunk's save from its region file, so the I/O thread never waits on terrain generation.
+/// The main thread hands the save to a ChunkGenerationJob, which populates the pooled chunk from it; m_didLoad is false if nothing was saved.
+///=====================================================
+class ChunkLoadJob : public ChunkIOJob{
+public:
+	Chunk* m_chunk;
+	bool m_didLoad;
+
+	ChunkLoadJob(const ChunkCoords& chunkCoords, Chunk* chunk, RegionFileCache& regionFiles);
+
+	virtual void Execute();
+};
+
+///=====================================================
+/// Encodes a chunk on the main thread when created, so the chunk can be recycled right away, then only writes it out on the I/O thread.
+/// Only the blocks edited since the chunk was generated are written, unless the full snapshot is smaller.
+///=====================================================
+class ChunkSaveJob : public ChunkIOJob{
+public:
+	std::vector<unsigned char> m_deltaBuffer; //kept apart from m_rleBuffer, which the main thread may still read to reload the chunk
+	bool m_useDeltaBuffer;
+	std::vector<BlockIndex> m_editedBlockIndexes; //handed back to the chunk if it's reloaded before this save lands
+	bool m_hasUntrackedEdits;
+	size_t m_numBytesSaved;
+	bool m_didSave;
+
+	ChunkSaveJob(const ChunkCoords& chunkCoords, const Chunk& chunk, RegionFileCache& regionFiles);
+
+	virtual void Execute();
+};
+
+#endif
@@ -0,0 +1,251 @@
+//=====================================================
+// ChunkMeshSnapshot.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "ChunkMeshSnapshot.hpp"
+#include "BlockDefinition.hpp"
+
+const unsigned char FACE_CORNER_MAXS_BITS[NUM_BLOCK_FACES][4] = { //bit 0 = x maxs, bit 1 = y maxs, bit 2 = z maxs; same winding as the per-face mesher
+	{ 4, 5, 7, 6 },
+	{ 1, 0, 2, 3 },
+	{ 3, 2, 6, 7 },
+	{ 0, 1, 5, 4 },
+	{ 1, 3, 7, 5 },
+	{ 2, 0, 4, 6 }
+};
+
+///=====================================================
+/// 
+///=====================================================
+ChunkMeshSnapshot::ChunkMeshSnapshot(){
+	for (int border = 0; border < NUM_CHUNK_BORDERS; ++border){
+		m_hasNeighbor[border] = false;
+	}
+}
+
+///=====================================================
+/// Copies the given sections plus the ones directly above and below them, since faces on a section's top and bottom depend on those.
+/// Side faces along the chunk's edges only need the neighbors' blocks at the same heights as the given sections.
+///=====================================================
+void ChunkMeshSnapshot::CopyFromChunk(const Chunk& chunk, unsigned char sectionsMask){
+	const unsigned char copiedSectionsMask = (unsigned char)(sectionsMask | (sectionsMask << 1) | (sectionsMask >> 1));
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		if ((copiedSectionsMask & (1 << section)) == 0) continue;
+
+		m_sections[section].m_blockTypes.CopyFrom(chunk.m_sections[section].m_blockTypes);
+		memcpy(&m_lightValues[section << SECTION_INDEX_SHIFT], &chunk.m_lightValues[section << SECTION_INDEX_SHIFT], BLOCKS_PER_SECTION);
+	}
+
+	CopyNeighborBorder(chunk.m_chunkToNorth, BORDER_NORTH, sectionsMask);
+	CopyNeighborBorder(chunk.m_chunkToSouth, BORDER_SOUTH, sectionsMask);
+	CopyNeighborBorder(chunk.m_chunkToEast, BORDER_EAST, sectionsMask);
+	CopyNeighborBorder(chunk.m_chunkToWest, BORDER_WEST, sectionsMask);
+}
+
+///=====================================================
+/// copies the layer of the neighbor that touches this chunk, e.g. the southmost row of the chunk to the north
+///=====================================================
+void ChunkMeshSnapshot::CopyNeighborBorder(const Chunk* neighborChunk, ChunkBorder border, unsigned char sectionsMask){
+	m_hasNeighbor[border] = (neighborChunk != NULL);
+	if (neighborChunk == NULL) return;
+
+	int firstNeighborIndex;
+	int stepAlongBorder;
+	switch (border){
+	case BORDER_NORTH:
+		firstNeighborIndex = 0;
+		stepAlongBorder = STEP_EAST;
+		break;
+	case BORDER_SOUTH:
+		firstNeighborIndex = BLOCKINDEX_Y_MASK;
+		stepAlongBorder = STEP_EAST;
+		break;
+	case BORDER_EAST:
+		firstNeighborIndex = 0;
+		stepAlongBorder = STEP_NORTH;
+		break;
+	default: //BORDER_WEST
+		firstNeighborIndex = BLOCKINDEX_X_MASK;
+		stepAlongBorder = STEP_NORTH;
+		break;
+	}
+
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		if ((sectionsMask & (1 << section)) == 0) continue;
+
+		for (int height = section * BLOCKS_PER_SECTION_Z; height < (section + 1) * BLOCKS_PER_SECTION_Z; ++height){
+			int neighborIndex = firstNeighborIndex + height * BLOCKS_PER_CHUNK_LAYER;
+			int borderIndex = height * BLOCKS_PER_CHUNK_X;
+			for (int positionAlongBorder = 0; positionAlongBorder < BLOCKS_PER_CHUNK_X; ++positionAlongBorder){
+				m_borderBlockTypes[border][borderIndex] = neighborChunk->GetBlockType((BlockIndex)neighborIndex);
+				m_borderLightValues[border][borderIndex] = neighborChunk->m_lightValues[neighborIndex];
+				neighborIndex += stepAlongBorder;
+				++borderIndex;
+			}
+		}
+	}
+}
+
+///=====================================================
+/// Only reads the snapshot, so it is safe to run on a worker while the chunk itself keeps changing
+///=====================================================
+void ChunkMeshSnapshot::BuildSectionMeshes(unsigned char sectionsMask, PackedBlockVertexFaces* out_opaqueVertexFaces, PackedBlockVertexFaces* out_translucentVertexFaces) const{
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		if ((sectionsMask & (1 << section)) == 0) continue;
+
+		PopulateSectionVertexFaceArray(section, out_opaqueVertexFaces[section], true);
+		PopulateSectionVertexFaceArray(section, out_translucentVertexFaces[section], false);
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline bool ChunkMeshSnapshot::GetBorderTypeAndLight(ChunkBorder border, int positionAlongBorder, BlockIndex blockIndex, unsigned char& out_type, unsigned char& out_light) const{
+	if (!m_hasNeighbor[border]) return false;
+
+	const int borderIndex = positionAlongBorder + (blockIndex >> (CHUNKS_WIDE_EXPONENT + CHUNKS_LONG_EXPONENT)) * BLOCKS_PER_CHUNK_X;
+	out_type = m_borderBlockTypes[border][borderIndex];
+	out_light = m_borderLightValues[border][borderIndex];
+	return true;
+}
+
+///=====================================================
+/// returns false if the neighbor is outside the world or in a chunk that wasn't active when the snapshot was taken
+///=====================================================
+bool ChunkMeshSnapshot::GetNeighborTypeAndLight(BlockIndex blockIndex, BlockFace face, unsigned char& out_type, unsigned char& out_light) const{
+	BlockIndex neighborIndex;
+	switch (face){
+	case FACE_TOP:
+		neighborIndex = blockIndex + BLOCKS_PER_CHUNK_LAYER;
+		if (neighborIndex >= BLOCKS_PER_CHUNK) return false;
+		break;
+	case FACE_BOTTOM:
+		neighborIndex = blockIndex - BLOCKS_PER_CHUNK_LAYER;
+		if (neighborIndex >= BLOCKS_PER_CHUNK) return false;
+		break;
+	case FACE_NORTH:
+		if ((blockIndex & BLOCKINDEX_Y_MASK) == BLOCKINDEX_Y_MASK)
+			return GetBorderTypeAndLight(BORDER_NORTH, blockIndex & BLOCKINDEX_X_MASK, blockIndex, out_type, out_light);
+		neighborIndex = blockIndex + BLOCKS_PER_CHUNK_X;
+		break;
+	case FACE_SOUTH:
+		if ((blockIndex & BLOCKINDEX_Y_MASK) == 0)
+			return GetBorderTypeAndLight(BORDER_SOUTH, blockIndex & BLOCKINDEX_X_MASK, blockIndex, out_type, out_light);
+		neighborIndex = blockIndex - BLOCKS_PER_CHUNK_X;
+		break;
+	case FACE_EAST:
+		if ((blockIndex & BLOCKINDEX_X_MASK) == BLOCKINDEX_X_MASK)
+			return GetBorderTypeAndLight(BORDER_EAST, (blockIndex & BLOCKINDEX_Y_MASK) >> CHUNKS_WIDE_EXPONENT, blockIndex, out_type, out_light);
+		neighborIndex = blockIndex + 1;
+		break;
+	default: //FACE_WEST
+		if ((blockIndex & BLOCKINDEX_X_MASK) == 0)
+			return GetBorderTypeAndLight(BORDER_WEST, (blockIndex & BLOCKINDEX_Y_MASK) >> CHUNKS_WIDE_EXPONENT, blockIndex, out_type, out_light);
+		neighborIndex = blockIndex - 1;
+		break;
+	}
+
+	out_type = GetBlockType(neighborIndex);
+	out_light = m_lightValues[neighborIndex];
+	return true;
+}
+
+///=====================================================
+/// 
+///=====================================================
+void ChunkMeshSnapshot::PopulateSectionVertexFaceArray(int section, PackedBlockVertexFaces& out_vertexFaceArray, bool useOpaqueBlocks) const{
+	if (m_sections[section].m_blockTypes.IsUniform()){
+		AddUniformSectionVertexesToRenderingArray(section, out_vertexFaceArray, useOpaqueBlocks);
+		return;
+	}
+
+	BlockIndex sectionEndIndex = (BlockIndex)((section + 1) << SECTION_INDEX_SHIFT);
+	for (BlockIndex blockIndex = (BlockIndex)(section << SECTION_INDEX_SHIFT); blockIndex < sectionEndIndex; ++blockIndex){
+		AddBlockVertexesToRenderingArray(blockIndex, out_vertexFaceArray, useOpaqueBlocks);
+	}
+}
+
+///=====================================================
+/// Interior faces of a uniform section are always hidden by a neighbor of the same type, so only its outer shell is visited
+///=====================================================
+void ChunkMeshSnapshot::AddUniformSectionVertexesToRenderingArray(int section, PackedBlockVertexFaces& out_vertexFaceArray, bool useOpaqueBlocks) const{
+	const BlockDefinition& blockDef = g_blockDefinitions[m_sections[section].m_blockTypes.GetUniformType()];
+	if (!blockDef.m_isVisible) return;
+	if (blockDef.m_isOpaque != useOpaqueBlocks) return;
+
+	for (int localZ = 0; localZ < BLOCKS_PER_SECTION_Z; ++localZ){
+		bool isOuterLayer = (localZ == 0 || localZ == BLOCKS_PER_SECTION_Z - 1);
+		int layerStartIndex = (section << SECTION_INDEX_SHIFT) + localZ * BLOCKS_PER_CHUNK_LAYER;
+
+		for (int localY = 0; localY < BLOCKS_PER_CHUNK_Y; ++localY){
+			bool isOuterRow = isOuterLayer || localY == 0 || localY == CHUNK_Y_MASK;
+			int xStep = isOuterRow ? 1 : CHUNK_X_MASK; //inner rows only touch the shell at their two ends
+			int rowStartIndex = layerStartIndex + (localY << CHUNKS_WIDE_EXPONENT);
+
+			for (int localX = 0; localX < BLOCKS_PER_CHUNK_X; localX += xStep){
+				AddBlockVertexesToRenderingArray((BlockIndex)(rowStartIndex + localX), out_vertexFaceArray, useOpaqueBlocks);
+			}
+		}
+	}
+}
+
+///=====================================================
+/// Corners come from FACE_CORNER_MAXS_BITS; the texcoords span one atlas tile
+///=====================================================
+void ChunkMeshSnapshot::AddPackedFaceToRenderingArray(BlockFace face, const LocalCoords& blockLocalCoords, const Vec2& texCoordsMins, unsigned char lightValue, PackedBlockVertexFaces& out_vertexFaceArray){
+	const unsigned char texTileMinX = PackedBlockVertex::GetTexTileAtTexCoord(texCoordsMins.x);
+	const unsigned char texTileMinY = PackedBlockVertex::GetTexTileAtTexCoord(texCoordsMins.y);
+	const unsigned char texTileMaxX = texTileMinX + 1;
+	const unsigned char texTileMaxY = texTileMinY + 1;
+	const unsigned char cornerTexTiles[4][2] = { { texTileMinX, texTileMaxY }, { texTileMaxX, texTileMaxY }, { texTileMaxX, texTileMinY }, { texTileMinX, texTileMinY } };
+
+	PackedBlockVertexFace vertexFace;
+	for (int corner = 0; corner < 4; ++corner){
+		const unsigned char maxsBits = FACE_CORNER_MAXS_BITS[face][corner];
+		PackedBlockVertex& vertex = vertexFace.vertexes[corner];
+		vertex.m_localX = (unsigned char)(blockLocalCoords.x + (maxsBits & 1));
+		vertex.m_localY = (unsigned char)(blockLocalCoords.y + ((maxsBits >> 1) & 1));
+		vertex.m_localZ = (unsigned char)(blockLocalCoords.z + ((maxsBits >> 2) & 1));
+		vertex.m_lightValue = lightValue;
+		vertex.m_texTileX = cornerTexTiles[corner][0];
+		vertex.m_texTileY = cornerTexTiles[corner][1];
+		vertex.m_unused = 0;
+	}
+	out_vertexFaceArray.push_back(vertexFace);
+}
+
+///=====================================================
+/// 
+///=====================================================
+void ChunkMeshSnapshot::AddBlockVertexesToRenderingArray(BlockIndex blockIndex, PackedBlockVertexFaces& out_vertexFaceArray, bool useOpaqueBlocks) const{
+	const unsigned char type = GetBlockType(blockIndex);
+	const BlockDefinition& blockDef = g_blockDefinitions[type];
+
+	if (!blockDef.m_isVisible) return;
+	if (blockDef.m_isOpaque != useOpaqueBlocks) return;
+
+	const LocalCoords localCoords = Chunk::GetLocalCoordsAtIndex(blockIndex);
+
+	for (int face = 0; face < NUM_BLOCK_FACES; ++face){
+		unsigned char neighborType, neighborLight;
+		if (!GetNeighborTypeAndLight(blockIndex, (BlockFace)face, neighborType, neighborLight)) continue;
+		if (g_blockDefinitions[neighborType].m_isOpaque || neighborType == type) continue;
+
+		const Vec2& texCoordsMins = (face == FACE_TOP) ? blockDef.m_topTexCoordsMins : ((face == FACE_BOTTOM) ? blockDef.m_bottomTexCoordsMins : blockDef.m_sideTexCoordsMins);
+		AddPackedFaceToRenderingArray((BlockFace)face, localCoords, texCoordsMins, neighborLight, out_vertexFaceArray);
+
+		if (face == FACE_TOP && type == BT_WATER && neighborType == BT_AIR){ //create inner face for water, so you can see the top of water while inside it
+			const PackedBlockVertexFace topFace = out_vertexFaceArray.back();
+			PackedBlockVertexFace innerFace = topFace;
+			for (int corner = 0; corner < 4; ++corner){ //reverse the winding by swapping corner positions 0<->1 and 2<->3, keeping the texcoords
+				const PackedBlockVertex& mirroredVertex = topFace.vertexes[corner ^ 1];
+				innerFace.vertexes[corner].m_localX = mirroredVertex.m_localX;
+				innerFace.vertexes[corner].m_localY = mirroredVertex.m_localY;
+				innerFace.vertexes[corner].m_localZ = mirroredVertex.m_localZ;
+			}
+			out_vertexFaceArray.push_back(innerFace);
+		}
+	}
+}
@@ -0,0 +1,61 @@
+//=====================================================
+// ChunkMeshSnapshot.hpp
+// by Andrew Socha
+//=====================================================
+
+#pragma once
+
+#ifndef __included_ChunkMeshSnapshot__
+#define __included_ChunkMeshSnapshot__
+
+#include "Chunk.hpp"
+
+enum ChunkBorder{
+	BORDER_NORTH,
+	BORDER_SOUTH,
+	BORDER_EAST,
+	BORDER_WEST,
+	NUM_CHUNK_BORDERS
+};
+
+const int BLOCKS_PER_CHUNK_BORDER = BLOCKS_PER_CHUNK_X * BLOCKS_PER_CHUNK_Z; //chunks are as wide as they are long, so every border is the same size
+
+///=====================================================
+/// The blocks a mesh job reads, copied on the main thread so later edits can't race with the mesher:
+/// the dirty sections and the sections directly above and below them, plus the blocks each neighbor has touching the dirty sections.
+/// Kept in a pooled job, so copying into it doesn't touch the heap once its section storage has grown.
+///=====================================================
+class ChunkMeshSnapshot{
+private:
+	ChunkSection m_sections[SECTIONS_PER_CHUNK]; //only the copied sections are valid
+	unsigned char m_lightValues[BLOCKS_PER_CHUNK];
+	unsigned char m_borderBlockTypes[NUM_CHUNK_BORDERS][BLOCKS_PER_CHUNK_BORDER]; //indexed by position along the border + height * BLOCKS_PER_CHUNK_X
+	unsigned char m_borderLightValues[NUM_CHUNK_BORDERS][BLOCKS_PER_CHUNK_BORDER];
+	bool m_hasNeighbor[NUM_CHUNK_BORDERS];
+
+	void CopyNeighborBorder(const Chunk* neighborChunk, ChunkBorder border, unsigned char sectionsMask);
+
+	unsigned char GetBlockType(BlockIndex blockIndex) const;
+	bool GetBorderTypeAndLight(ChunkBorder border, int positionAlongBorder, BlockIndex blockIndex, unsigned char& out_type, unsigned char& out_light) const;
+	bool GetNeighborTypeAndLight(BlockIndex blockIndex, BlockFace face, unsigned char& out_type, unsigned char& out_light) const;
+
+	void PopulateSectionVertexFaceArray(int section, PackedBlockVertexFaces& out_vertexFaceArray, bool useOpaqueBlocks) const;
+	void AddUniformSectionVertexesToRenderingArray(int section, PackedBlockVertexFaces& out_vertexFaceArray, bool useOpaqueBlocks) const;
+	void AddBlockVertexesToRenderingArray(BlockIndex blockIndex, PackedBlockVertexFaces& out_vertexFaceArray, bool useOpaqueBlocks) const;
+	static void AddPackedFaceToRenderingArray(BlockFace face, const LocalCoords& blockLocalCoords, const Vec2& texCoordsMins, unsigned char lightValue, PackedBlockVertexFaces& out_vertexFaceArray);
+
+public:
+	ChunkMeshSnapshot();
+
+	void CopyFromChunk(const Chunk& chunk, unsigned char sectionsMask);
+	void BuildSectionMeshes(unsigned char sectionsMask, PackedBlockVertexFaces* out_opaqueVertexFaces, PackedBlockVertexFaces* out_translucentVertexFaces) const;
+};
+
+///=====================================================
+/// 
+///=====================================================
+inline unsigned char ChunkMeshSnapshot::GetBlockType(BlockIndex blockIndex) const{
+	return m_sections[blockIndex >> SECTION_INDEX_SHIFT].m_blockTypes.GetType(blockIndex & SECTION_BLOCK_MASK);
+}
+
+#endif
@@ -0,0 +1,287 @@
+//=====================================================
+// ChunkMeshTests.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "TestHarness.hpp"
+#include "ChunkMeshSnapshot.hpp"
+#include "BlockDefinition.hpp"
+#include "TestWorld.hpp"
+#include "WorldBlockAccessor.hpp"
+#include <string.h>
+#include <stdio.h>
+#include <vector>
+
+///=====================================================
+/// generated terrain, lit with full sky light above each column's sky height and a varied block light pattern below it
+///=====================================================
+static void PopulateTestChunk(Chunk& chunk, const ChunkCoords& chunkCoords){
+	chunk.m_worldCoordsMins = Chunk::GetWorldCoordsAtChunkCoords(chunkCoords);
+	chunk.PopulateWithBlocks();
+
+	for (int blockIndex = 0; blockIndex < BLOCKS_PER_CHUNK; ++blockIndex){
+		const LocalCoords localCoords = Chunk::GetLocalCoordsAtIndex((BlockIndex)blockIndex);
+		if (chunk.IsSky((BlockIndex)blockIndex))
+			chunk.m_lightValues[blockIndex] = FULL_SKY_LIGHT_VALUE;
+		else
+			chunk.m_lightValues[blockIndex] = (unsigned char)(((localCoords.x >> 2) + (localCoords.y >> 2) + localCoords.z) & BLOCK_LIGHT_MASK);
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void BuildSectionMeshes(const Chunk& chunk, unsigned char sectionsMask, PackedBlockVertexFaces* out_opaqueVertexFaces, PackedBlockVertexFaces* out_translucentVertexFaces){
+	ChunkMeshSnapshot* snapshot = new ChunkMeshSnapshot();
+	snapshot->CopyFromChunk(chunk, sectionsMask);
+	snapshot->BuildSectionMeshes(sectionsMask, out_opaqueVertexFaces, out_translucentVertexFaces);
+	delete snapshot;
+}
+
+///=====================================================
+/// 
+///=====================================================
+static bool AreVertexFacesEqual(const PackedBlockVertexFaces& firstVertexFaces, const PackedBlockVertexFaces& secondVertexFaces){
+	if (firstVertexFaces.size() != secondVertexFaces.size())
+		return false;
+	return firstVertexFaces.empty() || memcmp(&firstVertexFaces[0], &secondVertexFaces[0], firstVertexFaces.size() * sizeof(PackedBlockVertexFace)) == 0;
+}
+
+///=====================================================
+/// A snapshot of one dirty section, the sections around it and the neighbors' borders must mesh exactly like a snapshot of everything
+///=====================================================
+static void TestPartialSnapshotMatchesFullSnapshot(const Chunk& chunk){
+	PackedBlockVertexFaces fullOpaqueVertexFaces[SECTIONS_PER_CHUNK];
+	PackedBlockVertexFaces fullTranslucentVertexFaces[SECTIONS_PER_CHUNK];
+	BuildSectionMeshes(chunk, ALL_SECTIONS_MASK, fullOpaqueVertexFaces, fullTranslucentVertexFaces);
+
+	bool doSectionsMatch = true;
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		PackedBlockVertexFaces opaqueVertexFaces[SECTIONS_PER_CHUNK];
+		PackedBlockVertexFaces translucentVertexFaces[SECTIONS_PER_CHUNK];
+		BuildSectionMeshes(chunk, (unsigned char)(1 << section), opaqueVertexFaces, translucentVertexFaces);
+		doSectionsMatch &= AreVertexFacesEqual(opaqueVertexFaces[section], fullOpaqueVertexFaces[section]);
+		doSectionsMatch &= AreVertexFacesEqual(translucentVertexFaces[section], fullTranslucentVertexFaces[section]);
+	}
+	TEST_CHECK(doSectionsMatch);
+}
+
+///=====================================================
+/// The float face the mesher built before vertexes were packed: corners and texcoords written out per face, lit by the block in front of it
+///=====================================================
+static void BuildReferenceVertexFace(BlockFace face, const WorldCoords& blockCoordsMins, const Vec2& texCoordsMins, unsigned char lightValue, Vertex3D_PCT_Face& out_vertexFace){
+	const WorldCoords blockCoordsMaxs = blockCoordsMins + Vec3(1.0f, 1.0f, 1.0f);
+	const Vec2 texCoordsMaxs = texCoordsMins + Vec2(1.0f / (float)TEX_TILES_PER_ATLAS_SIDE, 1.0f / (float)TEX_TILES_PER_ATLAS_SIDE);
+	const float minX = blockCoordsMins.x, minY = blockCoordsMins.y, minZ = blockCoordsMins.z;
+	const float maxX = blockCoordsMaxs.x, maxY = blockCoordsMaxs.y, maxZ = blockCoordsMaxs.z;
+
+	switch (face){
+	case FACE_TOP:
+		out_vertexFace.vertexes[0].m_position = Vec3(minX, minY, maxZ);
+		out_vertexFace.vertexes[1].m_position = Vec3(maxX, minY, maxZ);
+		out_vertexFace.vertexes[2].m_position = Vec3(maxX, maxY, maxZ);
+		out_vertexFace.vertexes[3].m_position = Vec3(minX, maxY, maxZ);
+		break;
+	case FACE_BOTTOM:
+		out_vertexFace.vertexes[0].m_position = Vec3(maxX, minY, minZ);
+		out_vertexFace.vertexes[1].m_position = Vec3(minX, minY, minZ);
+		out_vertexFace.vertexes[2].m_position = Vec3(minX, maxY, minZ);
+		out_vertexFace.vertexes[3].m_position = Vec3(maxX, maxY, minZ);
+		break;
+	case FACE_NORTH:
+		out_vertexFace.vertexes[0].m_position = Vec3(maxX, maxY, minZ);
+		out_vertexFace.vertexes[1].m_position = Vec3(minX, maxY, minZ);
+		out_vertexFace.vertexes[2].m_position = Vec3(minX, maxY, maxZ);
+		out_vertexFace.vertexes[3].m_position = Vec3(maxX, maxY, maxZ);
+		break;
+	case FACE_SOUTH:
+		out_vertexFace.vertexes[0].m_position = Vec3(minX, minY, minZ);
+		out_vertexFace.vertexes[1].m_position = Vec3(maxX, minY, minZ);
+		out_vertexFace.vertexes[2].m_position = Vec3(maxX, minY, maxZ);
+		out_vertexFace.vertexes[3].m_position = Vec3(minX, minY, maxZ);
+		break;
+	case FACE_EAST:
+		out_vertexFace.vertexes[0].m_position = Vec3(maxX, minY, minZ);
+		out_vertexFace.vertexes[1].m_position = Vec3(maxX, maxY, minZ);
+		out_vertexFace.vertexes[2].m_position = Vec3(maxX, maxY, maxZ);
+		out_vertexFace.vertexes[3].m_position = Vec3(maxX, minY, maxZ);
+		break;
+	default: //FACE_WEST
+		out_vertexFace.vertexes[0].m_position = Vec3(minX, maxY, minZ);
+		out_vertexFace.vertexes[1].m_position = Vec3(minX, minY, minZ);
+		out_vertexFace.vertexes[2].m_position = Vec3(minX, minY, maxZ);
+		out_vertexFace.vertexes[3].m_position = Vec3(minX, maxY, maxZ);
+		break;
+	}
+
+	out_vertexFace.vertexes[0].m_texCoords = Vec2(texCoordsMins.x, texCoordsMaxs.y);
+	out_vertexFace.vertexes[1].m_texCoords = Vec2(texCoordsMaxs.x, texCoordsMaxs.y);
+	out_vertexFace.vertexes[2].m_texCoords = Vec2(texCoordsMaxs.x, texCoordsMins.y);
+	out_vertexFace.vertexes[3].m_texCoords = Vec2(texCoordsMins.x, texCoordsMins.y);
+
+	//at full daylight the brighter of the two nibbles shows
+	const unsigned char skyLight = lightValue >> SKY_LIGHT_SHIFT;
+	const unsigned char blockLight = lightValue & BLOCK_LIGHT_MASK;
+	const unsigned char lighting = (unsigned char)(((skyLight > blockLight) ? skyLight : blockLight) << 4);
+	for (int corner = 0; corner < 4; ++corner){
+		out_vertexFace.vertexes[corner].m_color = RGBAchars(lighting, lighting, lighting);
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+static bool AreVertexesEqual(const Vertex3D_PCT& vertex, const Vertex3D_PCT& otherVertex){
+	return vertex.m_position == otherVertex.m_position
+		&& vertex.m_texCoords.x == otherVertex.m_texCoords.x && vertex.m_texCoords.y == otherVertex.m_texCoords.y
+		&& vertex.m_color.r == otherVertex.m_color.r && vertex.m_color.g == otherVertex.m_color.g && vertex.m_color.b == otherVertex.m_color.b && vertex.m_color.a == otherVertex.m_color.a;
+}
+
+///=====================================================
+/// 
+///=====================================================
+static bool ContainsVertexFace(const Vertex3D_PCT_Faces& vertexFaces, const Vertex3D_PCT_Face& vertexFace){
+	for (size_t faceIndex = 0; faceIndex < vertexFaces.size(); ++faceIndex){
+		bool doCornersMatch = true;
+		for (int corner = 0; corner < 4; ++corner){
+			doCornersMatch &= AreVertexesEqual(vertexFaces[faceIndex].vertexes[corner], vertexFace.vertexes[corner]);
+		}
+		if (doCornersMatch)
+			return true;
+	}
+	return false;
+}
+
+///=====================================================
+/// Every face direction of a lone block, and the inside of a water surface, must unpack to exactly the float vertexes meshed before packing
+///=====================================================
+static void TestUnpackedFacesMatchFloatVertexes(){
+	static const unsigned char NEIGHBOR_LIGHT_VALUES[NUM_BLOCK_FACES] = { 0xF0, 0x03, 0x5A, 0x77, 0xC1, 0x0E }; //sky and block light nibbles, a different mix per face
+
+	Chunk* chunk = new Chunk();
+	chunk->m_worldCoordsMins = Chunk::GetWorldCoordsAtChunkCoords(ChunkCoords(2, -3));
+	memset(chunk->m_skyHeights, 0, sizeof(chunk->m_skyHeights));
+	memset(chunk->m_lightValues, FULL_SKY_LIGHT_VALUE, sizeof(chunk->m_lightValues));
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		chunk->m_sections[section].m_blockTypes.Fill(BT_AIR);
+	}
+
+	const BlockIndex grassIndex = Chunk::GetIndexAtLocalCoords(LocalCoords(5, 7, 40));
+	const BlockIndex waterIndex = Chunk::GetIndexAtLocalCoords(LocalCoords(9, 3, 60));
+	chunk->SetBlockType(grassIndex, BT_GRASS);
+	chunk->SetBlockType(waterIndex, BT_WATER);
+	for (int face = 0; face < NUM_BLOCK_FACES; ++face){
+		const BlockLocation neighborLocation = WorldBlockAccessor::GetNeighborBlockLocation(BlockLocation(chunk, grassIndex), (BlockFace)face);
+		chunk->m_lightValues[neighborLocation.m_index] = NEIGHBOR_LIGHT_VALUES[face];
+	}
+
+	PackedBlockVertexFaces opaqueVertexFaces[SECTIONS_PER_CHUNK];
+	PackedBlockVertexFaces translucentVertexFaces[SECTIONS_PER_CHUNK];
+	BuildSectionMeshes(*chunk, ALL_SECTIONS_MASK, opaqueVertexFaces, translucentVertexFaces);
+	Vertex3D_PCT_Faces grassVertexFaces;
+	Vertex3D_PCT_Faces waterVertexFaces;
+	UnpackVertexFaces(opaqueVertexFaces[Chunk::GetSectionAtIndex(grassIndex)], chunk->m_worldCoordsMins, grassVertexFaces);
+	UnpackVertexFaces(translucentVertexFaces[Chunk::GetSectionAtIndex(waterIndex)], chunk->m_worldCoordsMins, waterVertexFaces);
+	TEST_CHECK(grassVertexFaces.size() == NUM_BLOCK_FACES);
+	TEST_CHECK(waterVertexFaces.size() == NUM_BLOCK_FACES + 1);
+
+	const BlockDefinition& grassDef = g_blockDefinitions[BT_GRASS];
+	const BlockDefinition& waterDef = g_blockDefinitions[BT_WATER];
+	bool doGrassFacesMatch = true;
+	bool doWaterFacesMatch = true;
+	for (int face = 0; face < NUM_BLOCK_FACES; ++face){
+		const Vec2& grassTexCoordsMins = (face == FACE_TOP) ? grassDef.m_topTexCoordsMins : ((face == FACE_BOTTOM) ? grassDef.m_bottomTexCoordsMins : grassDef.m_sideTexCoordsMins);
+		Vertex3D_PCT_Face referenceFace;
+		BuildReferenceVertexFace((BlockFace)face, chunk->GetWorldCoordsAtIndex(grassIndex), grassTexCoordsMins, NEIGHBOR_LIGHT_VALUES[face], referenceFace);
+		doGrassFacesMatch &= ContainsVertexFace(grassVertexFaces, referenceFace);
+
+		BuildReferenceVertexFace((BlockFace)face, chunk->GetWorldCoordsAtIndex(waterIndex), waterDef.m_sideTexCoordsMins, FULL_SKY_LIGHT_VALUE, referenceFace);
+		doWaterFacesMatch &= ContainsVertexFace(waterVertexFaces, referenceFace);
+	}
+	TEST_CHECK(doGrassFacesMatch);
+	TEST_CHECK(doWaterFacesMatch);
+
+	//the inside of the water's top swaps corners 0<->1 and 2<->3 but keeps their texcoords
+	Vertex3D_PCT_Face innerFace;
+	BuildReferenceVertexFace(FACE_TOP, chunk->GetWorldCoordsAtIndex(waterIndex), waterDef.m_topTexCoordsMins, FULL_SKY_LIGHT_VALUE, innerFace);
+	const Vec3 firstCornerPosition = innerFace.vertexes[0].m_position;
+	innerFace.vertexes[0].m_position = innerFace.vertexes[1].m_position;
+	innerFace.vertexes[1].m_position = firstCornerPosition;
+	const Vec3 thirdCornerPosition = innerFace.vertexes[2].m_position;
+	innerFace.vertexes[2].m_position = innerFace.vertexes[3].m_position;
+	innerFace.vertexes[3].m_position = thirdCornerPosition;
+	TEST_CHECK(ContainsVertexFace(waterVertexFaces, innerFace));
+
+	delete chunk;
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void ClearDirtySectionMasks(TestWorld& world){
+	for (Chunks::iterator chunkIter = world.m_chunks.begin(); chunkIter != world.m_chunks.end(); ++chunkIter){
+		chunkIter->second->m_dirtySectionsMask = 0;
+	}
+}
+
+///=====================================================
+/// An edit on a chunk's border remeshes the section beside it in the neighboring chunk, even if the block was already waiting to be relit
+///=====================================================
+static void TestBorderEditsDirtyNeighborSections(){
+	TestWorld world;
+	world.AddAirChunks(ChunkCoords(-1, -1), ChunkCoords(1, 1));
+	world.FillBlocks(-BLOCKS_PER_CHUNK_X, -BLOCKS_PER_CHUNK_Y, 0, 2 * BLOCKS_PER_CHUNK_X - 1, 2 * BLOCKS_PER_CHUNK_Y - 1, 40, BT_STONE);
+	Chunk* centerChunk = world.m_chunks.at(ChunkCoords(0, 0));
+	const unsigned char editedSectionBit = (unsigned char)(1 << (40 / BLOCKS_PER_SECTION_Z));
+	BlockLocations dirtyBlocks;
+
+	ClearDirtySectionMasks(world);
+	centerChunk->DestroyBlockBeneathCoords(WorldCoords(15.5f, 15.5f, 50.0f), dirtyBlocks); //the northeast corner
+	TEST_CHECK((centerChunk->m_dirtySectionsMask & editedSectionBit) != 0);
+	TEST_CHECK(world.m_chunks.at(ChunkCoords(1, 0))->m_dirtySectionsMask == editedSectionBit);
+	TEST_CHECK(world.m_chunks.at(ChunkCoords(0, 1))->m_dirtySectionsMask == editedSectionBit);
+	TEST_CHECK(world.m_chunks.at(ChunkCoords(-1, 0))->m_dirtySectionsMask == 0);
+	TEST_CHECK(world.m_chunks.at(ChunkCoords(0, -1))->m_dirtySectionsMask == 0);
+
+	ClearDirtySectionMasks(world);
+	const BlockIndex westBorderIndex = Chunk::GetIndexAtLocalCoords(LocalCoords(0, 8, 40));
+	centerChunk->GetBlock(westBorderIndex).DirtyLighting(); //still queued for relighting from an earlier edit
+	centerChunk->DestroyBlockBeneathCoords(WorldCoords(0.5f, 8.5f, 50.0f), dirtyBlocks);
+	TEST_CHECK(world.m_chunks.at(ChunkCoords(-1, 0))->m_dirtySectionsMask == editedSectionBit);
+	TEST_CHECK(world.m_chunks.at(ChunkCoords(1, 0))->m_dirtySectionsMask == 0);
+
+	ClearDirtySectionMasks(world);
+	centerChunk->PlaceBlockBeneathCoords(BT_DIRT, WorldCoords(7.5f, 0.5f, 50.0f), dirtyBlocks); //lands at z 41, on the south border
+	TEST_CHECK(world.m_chunks.at(ChunkCoords(0, -1))->m_dirtySectionsMask == editedSectionBit);
+	TEST_CHECK(world.m_chunks.at(ChunkCoords(-1, 0))->m_dirtySectionsMask == 0);
+
+	ClearDirtySectionMasks(world);
+	centerChunk->PlaceBlockBeneathCoords(BT_DIRT, WorldCoords(7.5f, 7.5f, 50.0f), dirtyBlocks); //away from every border
+	TEST_CHECK(world.m_chunks.at(ChunkCoords(1, 0))->m_dirtySectionsMask == 0 && world.m_chunks.at(ChunkCoords(-1, 0))->m_dirtySectionsMask == 0);
+	TEST_CHECK(world.m_chunks.at(ChunkCoords(0, 1))->m_dirtySectionsMask == 0 && world.m_chunks.at(ChunkCoords(0, -1))->m_dirtySectionsMask == 0);
+}
+
+///=====================================================
+/// 
+///=====================================================
+void RunChunkMeshTests(){
+	printf("Chunk meshing\n");
+
+	Chunk* chunks = new Chunk[5];
+	Chunk& centerChunk = chunks[0];
+	PopulateTestChunk(centerChunk, ChunkCoords(3, -2));
+	PopulateTestChunk(chunks[1], ChunkCoords(3, -1));
+	PopulateTestChunk(chunks[2], ChunkCoords(3, -3));
+	PopulateTestChunk(chunks[3], ChunkCoords(4, -2));
+	PopulateTestChunk(chunks[4], ChunkCoords(2, -2));
+	centerChunk.m_chunkToNorth = &chunks[1];
+	centerChunk.m_chunkToSouth = &chunks[2];
+	centerChunk.m_chunkToEast = &chunks[3];
+	centerChunk.m_chunkToWest = &chunks[4];
+
+	TestPartialSnapshotMatchesFullSnapshot(centerChunk);
+	TestUnpackedFacesMatchFloatVertexes();
+	TestBorderEditsDirtyNeighborSections();
+
+	delete[] chunks;
+}
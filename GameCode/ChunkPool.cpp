@@ -0,0 +1,61 @@
+//=====================================================
+// ChunkPool.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "ChunkPool.hpp"
+
+///=====================================================
+/// 
+///=====================================================
+ChunkPool::ChunkPool(size_t capacity)
+:m_capacity(capacity),
+m_numHits(0),
+m_numMisses(0){
+	m_freeChunks.reserve(capacity);
+}
+
+///=====================================================
+/// 
+///=====================================================
+Chunk* ChunkPool::AcquireChunk(const ChunkCoords& chunkCoords){
+	Chunk* chunk;
+	if (m_freeChunks.empty()){
+		++m_numMisses;
+		chunk = new Chunk();
+	}
+	else{
+		++m_numHits;
+		chunk = m_freeChunks.back();
+		m_freeChunks.pop_back();
+		chunk->Reset();
+	}
+
+	chunk->m_worldCoordsMins = Chunk::GetWorldCoordsAtChunkCoords(chunkCoords);
+	return chunk;
+}
+
+///=====================================================
+/// 
+///=====================================================
+void ChunkPool::ReleaseChunk(Chunk* chunk, const OpenGLRenderer* renderer){
+	if (m_freeChunks.size() < m_capacity){
+		m_freeChunks.push_back(chunk);
+		return;
+	}
+
+	chunk->DeleteBuffers(renderer);
+	delete chunk;
+}
+
+///=====================================================
+/// 
+///=====================================================
+void ChunkPool::Clear(const OpenGLRenderer* renderer){
+	for (std::vector<Chunk*>::iterator chunkIter = m_freeChunks.begin(); chunkIter != m_freeChunks.end(); ++chunkIter){
+		Chunk* chunk = *chunkIter;
+		chunk->DeleteBuffers(renderer);
+		delete chunk;
+	}
+	m_freeChunks.clear();
+}
@@ -0,0 +1,36 @@
+//=====================================================
+// ChunkPool.hpp
+// by Andrew Socha
+//=====================================================
+
+#pragma once
+
+#ifndef __included_ChunkPool__
+#define __included_ChunkPool__
+
+#include "Chunk.hpp"
+
+///=====================================================
+/// Recycles deactivated chunks, along with their VBOs and vertex arrays, so streaming chunks in and out doesn't touch the heap.
+/// Holds at most m_capacity free chunks; chunks released past that are destroyed.
+///=====================================================
+class ChunkPool{
+private:
+	std::vector<Chunk*> m_freeChunks;
+	size_t m_capacity;
+	unsigned int m_numHits;
+	unsigned int m_numMisses;
+
+public:
+	explicit ChunkPool(size_t capacity);
+
+	Chunk* AcquireChunk(const ChunkCoords& chunkCoords);
+	void ReleaseChunk(Chunk* chunk, const OpenGLRenderer* renderer);
+	void Clear(const OpenGLRenderer* renderer);
+
+	inline size_t GetNumFreeChunks() const{ return m_freeChunks.size(); }
+	inline unsigned int GetNumHits() const{ return m_numHits; }
+	inline unsigned int GetNumMisses() const{ return m_numMisses; }
+};
+
+#endif
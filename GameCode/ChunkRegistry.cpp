@@ -0,0 +1,83 @@
+//=====================================================
+// ChunkRegistry.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "ChunkRegistry.hpp"
+#include <assert.h>
+
+///=====================================================
+/// 
+///=====================================================
+ChunkRegistry::ChunkRegistry()
+:m_slots(MIN_NUM_CHUNK_SLOTS, EMPTY_CHUNK_SLOT),
+m_slotMask(MIN_NUM_CHUNK_SLOTS - 1){
+}
+
+///=====================================================
+/// inserts a NULL chunk if chunkCoords isn't registered yet
+///=====================================================
+Chunk*& ChunkRegistry::operator[](const ChunkCoords& chunkCoords){
+	unsigned int slot = FindSlot(chunkCoords);
+	if (m_slots[slot] == EMPTY_CHUNK_SLOT){
+		if ((m_entries.size() + 1) * 2 > m_slots.size()){ //keep the load factor at or below 1/2
+			Rehash(m_slots.size() * 2);
+			slot = FindSlot(chunkCoords);
+		}
+
+		m_slots[slot] = (int)m_entries.size();
+		m_entries.push_back(Entry(chunkCoords, (Chunk*)NULL));
+	}
+
+	return m_entries[m_slots[slot]].second;
+}
+
+///=====================================================
+/// 
+///=====================================================
+Chunk* ChunkRegistry::at(const ChunkCoords& chunkCoords) const{
+	const_iterator entryIter = find(chunkCoords);
+	assert(entryIter != end());
+	return entryIter->second;
+}
+
+///=====================================================
+/// 
+///=====================================================
+void ChunkRegistry::erase(const ChunkCoords& chunkCoords){
+	unsigned int slot = FindSlot(chunkCoords);
+	int entryIndex = m_slots[slot];
+	if (entryIndex == EMPTY_CHUNK_SLOT)
+		return;
+
+	//move the last entry into the erased one's place so entries stay dense
+	int lastEntryIndex = (int)m_entries.size() - 1;
+	if (entryIndex != lastEntryIndex){
+		m_slots[FindSlot(m_entries[lastEntryIndex].first)] = entryIndex;
+		m_entries[entryIndex] = m_entries[lastEntryIndex];
+	}
+	m_entries.pop_back();
+
+	//shift later members of the probe chain back so lookups never stop early at the hole
+	unsigned int holeSlot = slot;
+	for (unsigned int nextSlot = (slot + 1) & m_slotMask; m_slots[nextSlot] != EMPTY_CHUNK_SLOT; nextSlot = (nextSlot + 1) & m_slotMask){
+		unsigned int homeSlot = HashChunkCoords(m_entries[m_slots[nextSlot]].first) & m_slotMask;
+		if (((nextSlot - homeSlot) & m_slotMask) >= ((nextSlot - holeSlot) & m_slotMask)){
+			m_slots[holeSlot] = m_slots[nextSlot];
+			holeSlot = nextSlot;
+		}
+	}
+	m_slots[holeSlot] = EMPTY_CHUNK_SLOT;
+}
+
+///=====================================================
+/// 
+///=====================================================
+void ChunkRegistry::Rehash(unsigned int numSlots){
+	m_slots.assign(numSlots, EMPTY_CHUNK_SLOT);
+	m_slotMask = numSlots - 1;
+
+	for (int entryIndex = 0; entryIndex < (int)m_entries.size(); ++entryIndex){
+		m_slots[FindSlot(m_entries[entryIndex].first)] = entryIndex;
+	}
+}
@@ -0,0 +1,92 @@
+//=====================================================
+// ChunkRegistry.hpp
+// by Andrew Socha
+//=====================================================
+
+#pragma once
+
+#ifndef __included_ChunkRegistry__
+#define __included_ChunkRegistry__
+
+#include "Chunk.hpp"
+#include <utility>
+
+const int EMPTY_CHUNK_SLOT = -1;
+const unsigned int MIN_NUM_CHUNK_SLOTS = 64; //must be a power of two
+
+///=====================================================
+/// Maps chunk coords to active chunks with an open-addressing hash table (linear probing).
+/// Entries live densely in a vector, so iteration only touches active chunks.
+/// Slots hold entry indexes; erase swaps the last entry into the hole, invalidating iterators.
+///=====================================================
+class ChunkRegistry{
+public:
+	typedef std::pair<ChunkCoords, Chunk*> Entry;
+	typedef std::vector<Entry>::iterator iterator;
+	typedef std::vector<Entry>::const_iterator const_iterator;
+
+private:
+	std::vector<Entry> m_entries;
+	std::vector<int> m_slots;
+	unsigned int m_slotMask;
+
+	static unsigned int HashChunkCoords(const ChunkCoords& chunkCoords);
+	unsigned int FindSlot(const ChunkCoords& chunkCoords) const;
+	void Rehash(unsigned int numSlots);
+
+public:
+	ChunkRegistry();
+
+	iterator find(const ChunkCoords& chunkCoords);
+	const_iterator find(const ChunkCoords& chunkCoords) const;
+	Chunk*& operator[](const ChunkCoords& chunkCoords);
+	Chunk* at(const ChunkCoords& chunkCoords) const;
+	void erase(const ChunkCoords& chunkCoords);
+
+	inline iterator begin(){ return m_entries.begin(); }
+	inline iterator end(){ return m_entries.end(); }
+	inline const_iterator begin() const{ return m_entries.begin(); }
+	inline const_iterator end() const{ return m_entries.end(); }
+	inline size_t size() const{ return m_entries.size(); }
+	inline bool empty() const{ return m_entries.empty(); }
+};
+typedef ChunkRegistry Chunks;
+
+///=====================================================
+/// 
+///=====================================================
+inline unsigned int ChunkRegistry::HashChunkCoords(const ChunkCoords& chunkCoords){
+	unsigned int hash = (unsigned int)chunkCoords.x * 0x9E3779B1u;
+	hash ^= (unsigned int)chunkCoords.y * 0x85EBCA77u;
+	hash ^= hash >> 15;
+	return hash;
+}
+
+///=====================================================
+/// returns the slot holding chunkCoords, or the empty slot where it would be inserted
+///=====================================================
+inline unsigned int ChunkRegistry::FindSlot(const ChunkCoords& chunkCoords) const{
+	unsigned int slot = HashChunkCoords(chunkCoords) & m_slotMask;
+	while (m_slots[slot] != EMPTY_CHUNK_SLOT && !(m_entries[m_slots[slot]].first == chunkCoords)){
+		slot = (slot + 1) & m_slotMask;
+	}
+	return slot;
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline ChunkRegistry::iterator ChunkRegistry::find(const ChunkCoords& chunkCoords){
+	int entryIndex = m_slots[FindSlot(chunkCoords)];
+	return (entryIndex == EMPTY_CHUNK_SLOT) ? m_entries.end() : m_entries.begin() + entryIndex;
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline ChunkRegistry::const_iterator ChunkRegistry::find(const ChunkCoords& chunkCoords) const{
+	int entryIndex = m_slots[FindSlot(chunkCoords)];
+	return (entryIndex == EMPTY_CHUNK_SLOT) ? m_entries.end() : m_entries.begin() + entryIndex;
+}
+
+#endif
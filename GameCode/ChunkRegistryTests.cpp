@@ -0,0 +1,204 @@
+//=====================================================
+// ChunkRegistryTests.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "TestHarness.hpp"
+#include "ChunkRegistry.hpp"
+#include "Engine/Time/Time.hpp"
+#include <stdio.h>
+#include <map>
+#include <vector>
+
+typedef std::map<ChunkCoords, Chunk*> ReferenceChunks;
+
+const int NUM_RANDOM_REGISTRY_OPERATIONS = 200000;
+const int RANDOM_REGISTRY_COORDS_RADIUS = 24;
+const int REGISTRY_BENCHMARK_RING_RADIUS = 16; //a 33x33 ring of active chunks
+const int NUM_REGISTRY_BENCHMARK_PASSES = 200;
+
+static char s_testChunkTokens[NUM_RANDOM_REGISTRY_OPERATIONS]; //distinct addresses standing in for chunks, never dereferenced
+
+///=====================================================
+/// 
+///=====================================================
+static unsigned int GetNextTestRandom(unsigned int& state){
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+///=====================================================
+/// 
+///=====================================================
+static bool DoesRegistryMatchReference(const ChunkRegistry& registry, const ReferenceChunks& referenceChunks){
+	if (registry.size() != referenceChunks.size() || registry.empty() != referenceChunks.empty())
+		return false;
+
+	for (ReferenceChunks::const_iterator referenceIter = referenceChunks.begin(); referenceIter != referenceChunks.end(); ++referenceIter){
+		ChunkRegistry::const_iterator entryIter = registry.find(referenceIter->first);
+		if (entryIter == registry.end() || entryIter->second != referenceIter->second)
+			return false;
+	}
+
+	for (ChunkRegistry::const_iterator entryIter = registry.begin(); entryIter != registry.end(); ++entryIter){
+		ReferenceChunks::const_iterator referenceIter = referenceChunks.find(entryIter->first);
+		if (referenceIter == referenceChunks.end() || referenceIter->second != entryIter->second)
+			return false;
+	}
+	return true;
+}
+
+///=====================================================
+/// Inserts, overwrites, erases and finds random coords in a small area, so probe chains collide and wrap
+///=====================================================
+static void TestRandomOperationsMatchMap(){
+	ChunkRegistry registry;
+	ReferenceChunks referenceChunks;
+	unsigned int state = 2024u;
+	const int coordsWidth = RANDOM_REGISTRY_COORDS_RADIUS * 2 + 1;
+
+	bool didFindMatch = true;
+	bool didMatch = true;
+	for (int operation = 0; operation < NUM_RANDOM_REGISTRY_OPERATIONS; ++operation){
+		const ChunkCoords chunkCoords((int)(GetNextTestRandom(state) % coordsWidth) - RANDOM_REGISTRY_COORDS_RADIUS, (int)(GetNextTestRandom(state) % coordsWidth) - RANDOM_REGISTRY_COORDS_RADIUS);
+		const unsigned int roll = GetNextTestRandom(state) % 10;
+
+		//lean toward inserting for the first half and erasing for the second, so the table grows and drains
+		const bool isFirstHalf = operation < NUM_RANDOM_REGISTRY_OPERATIONS / 2;
+		if (roll < (isFirstHalf ? 5u : 3u)){
+			Chunk* chunk = (Chunk*)&s_testChunkTokens[operation];
+			registry[chunkCoords] = chunk;
+			referenceChunks[chunkCoords] = chunk;
+		}
+		else if (roll < 8){
+			registry.erase(chunkCoords);
+			referenceChunks.erase(chunkCoords);
+		}
+		else{
+			ChunkRegistry::iterator entryIter = registry.find(chunkCoords);
+			ReferenceChunks::iterator referenceIter = referenceChunks.find(chunkCoords);
+			const bool isInRegistry = entryIter != registry.end();
+			const bool isInReference = referenceIter != referenceChunks.end();
+			didFindMatch = didFindMatch && isInRegistry == isInReference && (!isInRegistry || entryIter->second == referenceIter->second);
+		}
+
+		if (operation % 5000 == 4999)
+			didMatch = didMatch && DoesRegistryMatchReference(registry, referenceChunks);
+	}
+	TEST_CHECK(didFindMatch);
+	TEST_CHECK(didMatch);
+	TEST_CHECK(DoesRegistryMatchReference(registry, referenceChunks));
+
+	while (!referenceChunks.empty()){
+		registry.erase(referenceChunks.begin()->first);
+		referenceChunks.erase(referenceChunks.begin());
+	}
+	TEST_CHECK(registry.empty());
+	TEST_CHECK(registry.find(ChunkCoords(0, 0)) == registry.end());
+}
+
+///=====================================================
+/// operator[] inserts NULL, at() finds what was set, and erasing a missing chunk changes nothing
+///=====================================================
+static void TestRegistryAccessors(){
+	ChunkRegistry registry;
+	TEST_CHECK(registry[ChunkCoords(3, -4)] == NULL);
+	TEST_CHECK(registry.size() == 1);
+
+	Chunk* chunk = (Chunk*)&s_testChunkTokens[0];
+	registry[ChunkCoords(3, -4)] = chunk;
+	TEST_CHECK(registry.at(ChunkCoords(3, -4)) == chunk);
+	TEST_CHECK(registry.size() == 1);
+
+	registry.erase(ChunkCoords(-4, 3));
+	TEST_CHECK(registry.size() == 1);
+	TEST_CHECK(registry.at(ChunkCoords(3, -4)) == chunk);
+}
+
+///=====================================================
+/// Walks a ring of active chunks east one column at a time, the way the player does, unloading the trailing column
+///=====================================================
+static void TestMovingRingMatchesMap(){
+	ChunkRegistry registry;
+	ReferenceChunks referenceChunks;
+	int tokenIndex = 0;
+	for (int chunkY = -REGISTRY_BENCHMARK_RING_RADIUS; chunkY <= REGISTRY_BENCHMARK_RING_RADIUS; ++chunkY){
+		for (int chunkX = -REGISTRY_BENCHMARK_RING_RADIUS; chunkX <= REGISTRY_BENCHMARK_RING_RADIUS; ++chunkX){
+			Chunk* chunk = (Chunk*)&s_testChunkTokens[tokenIndex++];
+			registry[ChunkCoords(chunkX, chunkY)] = chunk;
+			referenceChunks[ChunkCoords(chunkX, chunkY)] = chunk;
+		}
+	}
+
+	bool didMatch = true;
+	for (int step = 0; step < 200; ++step){
+		for (int chunkY = -REGISTRY_BENCHMARK_RING_RADIUS; chunkY <= REGISTRY_BENCHMARK_RING_RADIUS; ++chunkY){
+			registry.erase(ChunkCoords(step - REGISTRY_BENCHMARK_RING_RADIUS, chunkY));
+			referenceChunks.erase(ChunkCoords(step - REGISTRY_BENCHMARK_RING_RADIUS, chunkY));
+
+			Chunk* chunk = (Chunk*)&s_testChunkTokens[tokenIndex++];
+			registry[ChunkCoords(step + REGISTRY_BENCHMARK_RING_RADIUS + 1, chunkY)] = chunk;
+			referenceChunks[ChunkCoords(step + REGISTRY_BENCHMARK_RING_RADIUS + 1, chunkY)] = chunk;
+		}
+		if (step % 20 == 19)
+			didMatch = didMatch && DoesRegistryMatchReference(registry, referenceChunks);
+	}
+	TEST_CHECK(didMatch);
+}
+
+///=====================================================
+/// Finds each chunk of a 33x33 ring and its four neighbors, as linking and lighting do, against std::map
+///=====================================================
+static void BenchmarkRegistryLookups(){
+	ChunkRegistry registry;
+	ReferenceChunks referenceChunks;
+	std::vector<ChunkCoords> ringCoords;
+	for (int chunkY = -REGISTRY_BENCHMARK_RING_RADIUS; chunkY <= REGISTRY_BENCHMARK_RING_RADIUS; ++chunkY){
+		for (int chunkX = -REGISTRY_BENCHMARK_RING_RADIUS; chunkX <= REGISTRY_BENCHMARK_RING_RADIUS; ++chunkX){
+			Chunk* chunk = (Chunk*)&s_testChunkTokens[ringCoords.size()];
+			ringCoords.push_back(ChunkCoords(chunkX, chunkY));
+			registry[ringCoords.back()] = chunk;
+			referenceChunks[ringCoords.back()] = chunk;
+		}
+	}
+
+	const ChunkCoords neighborOffsets[5] = {ChunkCoords(0, 0), ChunkCoords(1, 0), ChunkCoords(-1, 0), ChunkCoords(0, 1), ChunkCoords(0, -1)};
+	int numRegistryHits = 0;
+	double startSeconds = GetCurrentSeconds();
+	for (int pass = 0; pass < NUM_REGISTRY_BENCHMARK_PASSES; ++pass){
+		for (std::vector<ChunkCoords>::const_iterator coordsIter = ringCoords.begin(); coordsIter != ringCoords.end(); ++coordsIter){
+			for (int neighbor = 0; neighbor < 5; ++neighbor){
+				if (registry.find(ChunkCoords(coordsIter->x + neighborOffsets[neighbor].x, coordsIter->y + neighborOffsets[neighbor].y)) != registry.end())
+					++numRegistryHits;
+			}
+		}
+	}
+	const double registrySeconds = GetCurrentSeconds() - startSeconds;
+
+	int numMapHits = 0;
+	startSeconds = GetCurrentSeconds();
+	for (int pass = 0; pass < NUM_REGISTRY_BENCHMARK_PASSES; ++pass){
+		for (std::vector<ChunkCoords>::const_iterator coordsIter = ringCoords.begin(); coordsIter != ringCoords.end(); ++coordsIter){
+			for (int neighbor = 0; neighbor < 5; ++neighbor){
+				if (referenceChunks.find(ChunkCoords(coordsIter->x + neighborOffsets[neighbor].x, coordsIter->y + neighborOffsets[neighbor].y)) != referenceChunks.end())
+					++numMapHits;
+			}
+		}
+	}
+	const double mapSeconds = GetCurrentSeconds() - startSeconds;
+	TEST_CHECK(numRegistryHits == numMapHits);
+
+	const double numLookups = (double)NUM_REGISTRY_BENCHMARK_PASSES * ringCoords.size() * 5;
+	printf("  %d chunks: registry %.1f M lookups/sec, std::map %.1f M lookups/sec (%.1fx)\n", (int)ringCoords.size(), numLookups / registrySeconds * 1e-6, numLookups / mapSeconds * 1e-6, mapSeconds / registrySeconds);
+}
+
+///=====================================================
+/// 
+///=====================================================
+void RunChunkRegistryTests(){
+	printf("Chunk registry\n");
+	TestRegistryAccessors();
+	TestRandomOperationsMatchMap();
+	TestMovingRingMatchesMap();
+	BenchmarkRegistryLookups();
+}
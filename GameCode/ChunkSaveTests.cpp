@@ -0,0 +1,279 @@
+//=====================================================
+// ChunkSaveTests.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "TestHarness.hpp"
+#include "ChunkJobs.hpp"
+#include <string.h>
+#include <vector>
+
+const ChunkCoords SAVE_TEST_CHUNK_COORDS(3, -2);
+
+///=====================================================
+/// 
+///=====================================================
+static Chunk* CreateGeneratedTestChunk(){
+	Chunk* chunk = new Chunk();
+	chunk->m_worldCoordsMins = Chunk::GetWorldCoordsAtChunkCoords(SAVE_TEST_CHUNK_COORDS);
+	chunk->PopulateWithBlocks();
+	return chunk;
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void EditTestBlock(Chunk& chunk, const LocalCoords& localCoords, BlockType blockType){
+	const BlockIndex blockIndex = Chunk::GetIndexAtLocalCoords(localCoords);
+	chunk.SetBlockType(blockIndex, (unsigned char)blockType);
+	chunk.RecordBlockEdit(blockIndex);
+}
+
+///=====================================================
+/// 
+///=====================================================
+static bool DoChunksHaveSameBlocks(const Chunk& chunk, const Chunk& otherChunk){
+	for (int blockIndex = 0; blockIndex < BLOCKS_PER_CHUNK; ++blockIndex){
+		if (chunk.GetBlockType((BlockIndex)blockIndex) != otherChunk.GetBlockType((BlockIndex)blockIndex))
+			return false;
+	}
+	return memcmp(chunk.m_skyHeights, otherChunk.m_skyHeights, sizeof(chunk.m_skyHeights)) == 0;
+}
+
+///=====================================================
+/// a few scattered edits, a run of them, a block edited back to its generated type, and a block edited twice
+///=====================================================
+static void MakeTestEdits(Chunk& chunk){
+	for (int x = 2; x < 9; ++x){
+		EditTestBlock(chunk, LocalCoords(x, 4, 100), BT_GLOWSTONE);
+	}
+	EditTestBlock(chunk, LocalCoords(0, 0, 1), BT_AIR);
+	EditTestBlock(chunk, LocalCoords(15, 15, 127), BT_SAND);
+	EditTestBlock(chunk, LocalCoords(7, 7, 60), BT_WATER);
+	EditTestBlock(chunk, LocalCoords(7, 7, 60), BT_ICE);
+
+	const BlockIndex restoredIndex = Chunk::GetIndexAtLocalCoords(LocalCoords(9, 9, 0));
+	const BlockType generatedType = (BlockType)chunk.GetBlockType(restoredIndex);
+	EditTestBlock(chunk, LocalCoords(9, 9, 0), BT_SNOW);
+	EditTestBlock(chunk, LocalCoords(9, 9, 0), generatedType);
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void TestDeltaSaveRoundTrip(){
+	Chunk* editedChunk = CreateGeneratedTestChunk();
+	MakeTestEdits(*editedChunk);
+	TEST_CHECK(editedChunk->m_hasUnsavedEdits);
+
+	std::vector<unsigned char> rleBuffer;
+	std::vector<unsigned char> deltaBuffer;
+	editedChunk->CreateRLEBuffer(rleBuffer);
+	TEST_CHECK(editedChunk->CreateDeltaBuffer(deltaBuffer, rleBuffer.size()));
+	TEST_CHECK(deltaBuffer.size() == (size_t)(DELTA_HEADER_BYTES + 5 * DELTA_RUN_BYTES)); //the glowstone row is one run
+	TEST_CHECK(deltaBuffer[0] == DELTA_SAVE_TAG && deltaBuffer[1] == TERRAIN_GENERATION_VERSION);
+
+	Chunk* loadedChunk = new Chunk();
+	loadedChunk->m_worldCoordsMins = editedChunk->m_worldCoordsMins;
+	TEST_CHECK(loadedChunk->PopulateFromSaveBuffer(&deltaBuffer[0], deltaBuffer.size()));
+	TEST_CHECK(DoChunksHaveSameBlocks(*editedChunk, *loadedChunk));
+	TEST_CHECK(!loadedChunk->m_hasUnsavedEdits && !loadedChunk->m_hasUntrackedEdits);
+
+	//the loaded chunk remembers its edits, so saving it again writes the same delta
+	std::vector<unsigned char> reloadedRleBuffer;
+	std::vector<unsigned char> reloadedDeltaBuffer;
+	loadedChunk->CreateRLEBuffer(reloadedRleBuffer);
+	TEST_CHECK(loadedChunk->CreateDeltaBuffer(reloadedDeltaBuffer, reloadedRleBuffer.size()));
+	TEST_CHECK(reloadedDeltaBuffer == deltaBuffer);
+
+	delete loadedChunk;
+	delete editedChunk;
+}
+
+///=====================================================
+/// a chunk loaded from a full save can't tell its edits from its terrain, so it keeps saving in full
+///=====================================================
+static void TestFullSaveRoundTrip(){
+	Chunk* editedChunk = CreateGeneratedTestChunk();
+	MakeTestEdits(*editedChunk);
+	std::vector<unsigned char> rleBuffer;
+	editedChunk->CreateRLEBuffer(rleBuffer);
+
+	Chunk* loadedChunk = new Chunk();
+	loadedChunk->m_worldCoordsMins = editedChunk->m_worldCoordsMins;
+	TEST_CHECK(loadedChunk->PopulateFromSaveBuffer(&rleBuffer[0], rleBuffer.size()));
+	TEST_CHECK(DoChunksHaveSameBlocks(*editedChunk, *loadedChunk));
+	TEST_CHECK(loadedChunk->m_hasUntrackedEdits);
+
+	EditTestBlock(*loadedChunk, LocalCoords(1, 1, 120), BT_STONE);
+	std::vector<unsigned char> deltaBuffer;
+	TEST_CHECK(!loadedChunk->CreateDeltaBuffer(deltaBuffer, rleBuffer.size()));
+
+	delete loadedChunk;
+	delete editedChunk;
+}
+
+///=====================================================
+/// every block edited, to alternating types, takes more bytes as delta runs than as a full save
+///=====================================================
+static void TestScatteredEditsSaveInFull(){
+	Chunk* editedChunk = CreateGeneratedTestChunk();
+	for (int blockIndex = 0; blockIndex < BLOCKS_PER_CHUNK; ++blockIndex){
+		editedChunk->SetBlockType((BlockIndex)blockIndex, (unsigned char)((blockIndex & 1) ? BT_SAND : BT_DIRT));
+		editedChunk->RecordBlockEdit((BlockIndex)blockIndex);
+	}
+
+	std::vector<unsigned char> rleBuffer;
+	std::vector<unsigned char> deltaBuffer;
+	editedChunk->CreateRLEBuffer(rleBuffer);
+	TEST_CHECK(!editedChunk->CreateDeltaBuffer(deltaBuffer, rleBuffer.size()));
+	delete editedChunk;
+}
+
+///=====================================================
+/// editing the same few blocks over and over doesn't grow the edit list
+///=====================================================
+static void TestRepeatedEditsStayBounded(){
+	Chunk* chunk = CreateGeneratedTestChunk();
+	for (int edit = 0; edit < 100000; ++edit){
+		EditTestBlock(*chunk, LocalCoords(edit & 3, 0, 64), (edit & 1) ? BT_STONE : BT_AIR);
+	}
+	TEST_CHECK(chunk->m_editedBlockIndexes.size() < 16);
+	delete chunk;
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void CheckSaveBufferIsRejected(Chunk& chunk, const Chunk& unchangedChunk, const std::vector<unsigned char>& saveBuffer){
+	TEST_CHECK(!chunk.PopulateFromSaveBuffer(saveBuffer.empty() ? NULL : &saveBuffer[0], saveBuffer.size()));
+	TEST_CHECK(DoChunksHaveSameBlocks(chunk, unchangedChunk));
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void SetTestDeltaRun(std::vector<unsigned char>& deltaBuffer, int run, int index, int runLength, unsigned char blockType){
+	const int bufferIndex = DELTA_HEADER_BYTES + run * DELTA_RUN_BYTES;
+	deltaBuffer[bufferIndex] = (unsigned char)(index >> 8);
+	deltaBuffer[bufferIndex + 1] = (unsigned char)index;
+	deltaBuffer[bufferIndex + 2] = (unsigned char)(runLength >> 8);
+	deltaBuffer[bufferIndex + 3] = (unsigned char)runLength;
+	deltaBuffer[bufferIndex + 4] = blockType;
+}
+
+///=====================================================
+/// Corrupt saves, and deltas from another terrain generator version, are rejected before the chunk is touched, so it can be generated instead
+///=====================================================
+static void TestBadSaveBuffersAreRejected(){
+	Chunk* editedChunk = CreateGeneratedTestChunk();
+	MakeTestEdits(*editedChunk);
+	std::vector<unsigned char> rleBuffer;
+	std::vector<unsigned char> deltaBuffer;
+	editedChunk->CreateRLEBuffer(rleBuffer);
+	editedChunk->CreateDeltaBuffer(deltaBuffer, rleBuffer.size());
+
+	Chunk* chunk = CreateGeneratedTestChunk();
+	Chunk* unchangedChunk = CreateGeneratedTestChunk();
+	std::vector<unsigned char> badBuffer;
+	CheckSaveBufferIsRejected(*chunk, *unchangedChunk, badBuffer);
+
+	badBuffer = deltaBuffer;
+	++badBuffer[1];
+	CheckSaveBufferIsRejected(*chunk, *unchangedChunk, badBuffer);
+
+	badBuffer.assign(deltaBuffer.begin(), deltaBuffer.begin() + DELTA_HEADER_BYTES - 1);
+	CheckSaveBufferIsRejected(*chunk, *unchangedChunk, badBuffer);
+
+	badBuffer.assign(deltaBuffer.begin(), deltaBuffer.end() - 1);
+	CheckSaveBufferIsRejected(*chunk, *unchangedChunk, badBuffer);
+
+	badBuffer = deltaBuffer;
+	badBuffer.push_back(0);
+	CheckSaveBufferIsRejected(*chunk, *unchangedChunk, badBuffer);
+
+	badBuffer = deltaBuffer;
+	SetTestDeltaRun(badBuffer, 1, BLOCKS_PER_CHUNK - 4, 5, BT_STONE);
+	CheckSaveBufferIsRejected(*chunk, *unchangedChunk, badBuffer);
+
+	badBuffer = deltaBuffer;
+	SetTestDeltaRun(badBuffer, 1, 0xFFFF, 1, BT_STONE);
+	CheckSaveBufferIsRejected(*chunk, *unchangedChunk, badBuffer);
+
+	badBuffer = deltaBuffer;
+	SetTestDeltaRun(badBuffer, 2, 100, 0, BT_STONE);
+	CheckSaveBufferIsRejected(*chunk, *unchangedChunk, badBuffer);
+
+	badBuffer = deltaBuffer;
+	SetTestDeltaRun(badBuffer, 0, 100, 1, BLOCK_TYPE_COUNT);
+	CheckSaveBufferIsRejected(*chunk, *unchangedChunk, badBuffer);
+
+	badBuffer = rleBuffer;
+	badBuffer[0] = BLOCK_TYPE_COUNT;
+	CheckSaveBufferIsRejected(*chunk, *unchangedChunk, badBuffer);
+
+	badBuffer.assign(rleBuffer.begin(), rleBuffer.end() - RLE_ENTRY_BYTES); //too few blocks
+	CheckSaveBufferIsRejected(*chunk, *unchangedChunk, badBuffer);
+
+	badBuffer = rleBuffer;
+	badBuffer.push_back(BT_AIR);
+	badBuffer.push_back(0);
+	badBuffer.push_back(1); //too many blocks
+	CheckSaveBufferIsRejected(*chunk, *unchangedChunk, badBuffer);
+
+	badBuffer = rleBuffer;
+	badBuffer.insert(badBuffer.begin(), 3, 0); //an empty run, which the reader would never step past
+	CheckSaveBufferIsRejected(*chunk, *unchangedChunk, badBuffer);
+
+	delete unchangedChunk;
+	delete chunk;
+	delete editedChunk;
+}
+
+///=====================================================
+/// A loaded save reaches its chunk through a generation job, so a delta's terrain is regenerated on a worker rather than the I/O thread.
+/// A save the job can't use is ignored and the chunk generated as if it had never been saved.
+///=====================================================
+static void TestGenerationJobPopulatesFromSave(){
+	Chunk* editedChunk = CreateGeneratedTestChunk();
+	MakeTestEdits(*editedChunk);
+	std::vector<unsigned char> rleBuffer;
+	std::vector<unsigned char> deltaBuffer;
+	editedChunk->CreateRLEBuffer(rleBuffer);
+	editedChunk->CreateDeltaBuffer(deltaBuffer, rleBuffer.size());
+
+	Chunk* loadedChunk = new Chunk();
+	loadedChunk->m_worldCoordsMins = editedChunk->m_worldCoordsMins;
+	ChunkGenerationJob deltaJob(SAVE_TEST_CHUNK_COORDS, loadedChunk);
+	deltaJob.m_saveBuffer = deltaBuffer;
+	deltaJob.Execute();
+	TEST_CHECK(DoChunksHaveSameBlocks(*editedChunk, *loadedChunk));
+	TEST_CHECK(!loadedChunk->m_hasUntrackedEdits);
+
+	Chunk* staleChunk = new Chunk();
+	staleChunk->m_worldCoordsMins = editedChunk->m_worldCoordsMins;
+	ChunkGenerationJob staleJob(SAVE_TEST_CHUNK_COORDS, staleChunk);
+	staleJob.m_saveBuffer = deltaBuffer;
+	++staleJob.m_saveBuffer[1]; //another terrain generator version
+	staleJob.Execute();
+	Chunk* generatedChunk = CreateGeneratedTestChunk();
+	TEST_CHECK(DoChunksHaveSameBlocks(*generatedChunk, *staleChunk));
+	TEST_CHECK(staleChunk->m_editedBlockIndexes.empty());
+
+	delete generatedChunk;
+	delete staleChunk;
+	delete loadedChunk;
+	delete editedChunk;
+}
+
+///=====================================================
+/// 
+///=====================================================
+void RunChunkSaveTests(){
+	TestDeltaSaveRoundTrip();
+	TestFullSaveRoundTrip();
+	TestScatteredEditsSaveInFull();
+	TestRepeatedEditsStayBounded();
+	TestBadSaveBuffersAreRejected();
+	TestGenerationJobPopulatesFromSave();
+}
@@ -0,0 +1,37 @@
+//=====================================================
+// Job.hpp
+// by Andrew Socha
+//=====================================================
+
+#pragma once
+
+#ifndef __included_Job__
+#define __included_Job__
+
+#include <vector>
+
+enum JobType{
+	JOB_TYPE_GENERATE_CHUNK,
+	JOB_TYPE_MESH_CHUNK,
+	JOB_TYPE_LOAD_CHUNK,
+	JOB_TYPE_SAVE_CHUNK
+};
+
+///=====================================================
+/// A unit of work run on a JobSystem worker thread, then handed back to the main thread through the completed job queue
+///=====================================================
+class Job{
+private:
+	JobType m_type;
+
+public:
+	inline explicit Job(JobType type):m_type(type){}
+	virtual ~Job(){}
+
+	virtual void Execute() = 0;
+
+	inline JobType GetType() const{ return m_type; }
+};
+typedef std::vector<Job*> Jobs;
+
+#endif
@@ -0,0 +1,105 @@
+//=====================================================
+// JobSystem.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "JobSystem.hpp"
+
+///=====================================================
+/// 
+///=====================================================
+JobSystem::JobSystem()
+:m_isShuttingDown(false){
+}
+
+///=====================================================
+/// 
+///=====================================================
+int JobSystem::GetDefaultNumWorkerThreads(){
+	int numHardwareThreads = (int)std::thread::hardware_concurrency();
+	return (numHardwareThreads > 2) ? numHardwareThreads - 1 : 1; //leave a core for the main thread
+}
+
+///=====================================================
+/// 
+///=====================================================
+void JobSystem::Startup(int numWorkerThreads){
+	m_isShuttingDown = false;
+	m_workerThreads.reserve(numWorkerThreads);
+	for (int i = 0; i < numWorkerThreads; ++i){
+		m_workerThreads.push_back(std::thread(&JobSystem::WorkerThreadMain, this));
+	}
+}
+
+///=====================================================
+/// Workers finish every queued job before exiting, so all submitted jobs end up in the completed queue
+///=====================================================
+void JobSystem::Shutdown(){
+	{
+		std::lock_guard<std::mutex> lock(m_queuedJobsMutex);
+		m_isShuttingDown = true;
+	}
+	m_jobQueuedCondition.notify_all();
+
+	for (std::vector<std::thread>::iterator threadIter = m_workerThreads.begin(); threadIter != m_workerThreads.end(); ++threadIter){
+		threadIter->join();
+	}
+	m_workerThreads.clear();
+}
+
+///=====================================================
+/// Without worker threads, jobs run immediately on the calling thread
+///=====================================================
+void JobSystem::SubmitJob(Job* job){
+	if (m_workerThreads.empty()){
+		job->Execute();
+		CompleteJob(job);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_queuedJobsMutex);
+		m_queuedJobs.push_back(job);
+	}
+	m_jobQueuedCondition.notify_one();
+}
+
+///=====================================================
+/// 
+///=====================================================
+void JobSystem::PopCompletedJobs(Jobs& out_completedJobs){
+	std::lock_guard<std::mutex> lock(m_completedJobsMutex);
+	out_completedJobs.insert(out_completedJobs.end(), m_completedJobs.begin(), m_completedJobs.end());
+	m_completedJobs.clear();
+}
+
+///=====================================================
+/// 
+///=====================================================
+void JobSystem::CompleteJob(Job* job){
+	std::lock_guard<std::mutex> lock(m_completedJobsMutex);
+	m_completedJobs.push_back(job);
+}
+
+///=====================================================
+/// 
+///=====================================================
+void JobSystem::WorkerThreadMain(){
+	for (;;){
+		Job* job;
+		{
+			std::unique_lock<std::mutex> lock(m_queuedJobsMutex);
+			while (m_queuedJobs.empty() && !m_isShuttingDown){
+				m_jobQueuedCondition.wait(lock);
+			}
+			if (m_queuedJobs.empty())
+				return;
+
+			job = m_queuedJobs.front();
+			m_queuedJobs.pop_front();
+		}
+
+		job->Execute();
+		CompleteJob(job);
+	}
+}
@@ -0,0 +1,50 @@
+//=====================================================
+// JobSystem.hpp
+// by Andrew Socha
+//=====================================================
+
+#pragma once
+
+#ifndef __included_JobSystem__
+#define __included_JobSystem__
+
+#include "Job.hpp"
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+///=====================================================
+/// Runs submitted jobs on a fixed set of worker threads.
+/// Finished jobs wait in a completed queue until the main thread pops them, so results are only ever applied on the main thread.
+///=====================================================
+class JobSystem{
+private:
+	std::vector<std::thread> m_workerThreads;
+	std::deque<Job*> m_queuedJobs;
+	Jobs m_completedJobs;
+	std::mutex m_queuedJobsMutex;
+	std::mutex m_completedJobsMutex;
+	std::condition_variable m_jobQueuedCondition;
+	bool m_isShuttingDown;
+
+	JobSystem(const JobSystem&);
+	JobSystem& operator=(const JobSystem&);
+
+	void WorkerThreadMain();
+	void CompleteJob(Job* job);
+
+public:
+	JobSystem();
+
+	void Startup(int numWorkerThreads);
+	void Shutdown();
+
+	void SubmitJob(Job* job);
+	void PopCompletedJobs(Jobs& out_completedJobs);
+
+	inline int GetNumWorkerThreads() const{ return (int)m_workerThreads.size(); }
+	static int GetDefaultNumWorkerThreads();
+};
+
+#endif
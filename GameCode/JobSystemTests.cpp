@@ -0,0 +1,179 @@
+//=====================================================
+// JobSystemTests.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "TestHarness.hpp"
+#include "JobSystem.hpp"
+#include "ChunkJobs.hpp"
+#include "Engine/Time/Time.hpp"
+#include <stdio.h>
+#include <vector>
+
+const int NUM_JOB_TEST_CHUNKS = 12;
+const int NUM_JOB_TEST_WORKER_THREADS = 3;
+const int NUM_GENERATION_BENCHMARK_CHUNKS = 64;
+
+///=====================================================
+/// 
+///=====================================================
+static const ChunkCoords GetJobTestChunkCoords(int chunk){
+	return ChunkCoords(chunk % 8 - 4, chunk / 8 - 4);
+}
+
+///=====================================================
+/// the chunks are reused between runs, the way World reuses pooled chunks
+///=====================================================
+static void PrepareGenerationJobs(std::vector<Chunk*>& chunks, std::vector<ChunkGenerationJob*>& out_jobs){
+	for (std::vector<ChunkGenerationJob*>::iterator jobIter = out_jobs.begin(); jobIter != out_jobs.end(); ++jobIter){
+		delete *jobIter;
+	}
+	out_jobs.clear();
+
+	for (int chunk = 0; chunk < (int)chunks.size(); ++chunk){
+		chunks[chunk]->Reset();
+		chunks[chunk]->m_worldCoordsMins = Chunk::GetWorldCoordsAtChunkCoords(GetJobTestChunkCoords(chunk));
+		out_jobs.push_back(new ChunkGenerationJob(GetJobTestChunkCoords(chunk), chunks[chunk]));
+	}
+}
+
+///=====================================================
+/// submits every job, then polls for completions the way World does each frame; returns how many came back
+///=====================================================
+static int RunGenerationJobs(JobSystem& jobSystem, const std::vector<ChunkGenerationJob*>& jobs){
+	for (std::vector<ChunkGenerationJob*>::const_iterator jobIter = jobs.begin(); jobIter != jobs.end(); ++jobIter){
+		jobSystem.SubmitJob(*jobIter);
+	}
+
+	Jobs completedJobs;
+	while (completedJobs.size() < jobs.size()){
+		jobSystem.PopCompletedJobs(completedJobs);
+		if (completedJobs.size() < jobs.size())
+			std::this_thread::yield();
+	}
+	return (int)completedJobs.size();
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void DeleteTestChunksAndJobs(std::vector<Chunk*>& chunks, std::vector<ChunkGenerationJob*>& jobs){
+	for (std::vector<Chunk*>::iterator chunkIter = chunks.begin(); chunkIter != chunks.end(); ++chunkIter){
+		delete *chunkIter;
+	}
+	for (std::vector<ChunkGenerationJob*>::iterator jobIter = jobs.begin(); jobIter != jobs.end(); ++jobIter){
+		delete *jobIter;
+	}
+	chunks.clear();
+	jobs.clear();
+}
+
+///=====================================================
+/// Chunks generated on worker threads should match chunks generated on the main thread, block for block
+///=====================================================
+static void TestWorkerGenerationMatchesMainThread(){
+	std::vector<Chunk*> chunks;
+	for (int chunk = 0; chunk < NUM_JOB_TEST_CHUNKS; ++chunk){
+		chunks.push_back(new Chunk());
+	}
+	std::vector<ChunkGenerationJob*> jobs;
+	PrepareGenerationJobs(chunks, jobs);
+
+	JobSystem jobSystem;
+	jobSystem.Startup(NUM_JOB_TEST_WORKER_THREADS);
+	TEST_CHECK(jobSystem.GetNumWorkerThreads() == NUM_JOB_TEST_WORKER_THREADS);
+	TEST_CHECK(RunGenerationJobs(jobSystem, jobs) == NUM_JOB_TEST_CHUNKS);
+	jobSystem.Shutdown();
+
+	bool doBlocksMatch = true;
+	Chunk* referenceChunk = new Chunk();
+	for (int chunk = 0; chunk < NUM_JOB_TEST_CHUNKS; ++chunk){
+		referenceChunk->Reset();
+		referenceChunk->m_worldCoordsMins = Chunk::GetWorldCoordsAtChunkCoords(GetJobTestChunkCoords(chunk));
+		referenceChunk->PopulateWithBlocks();
+		for (int blockIndex = 0; blockIndex < BLOCKS_PER_CHUNK && doBlocksMatch; ++blockIndex){
+			doBlocksMatch = chunks[chunk]->GetBlockType((BlockIndex)blockIndex) == referenceChunk->GetBlockType((BlockIndex)blockIndex);
+		}
+	}
+	TEST_CHECK(doBlocksMatch);
+	delete referenceChunk;
+
+	DeleteTestChunksAndJobs(chunks, jobs);
+}
+
+///=====================================================
+/// Shutting down finishes everything still queued, and with no workers jobs run as they're submitted
+///=====================================================
+static void TestJobsCompleteWithoutPolling(){
+	std::vector<Chunk*> chunks;
+	for (int chunk = 0; chunk < NUM_JOB_TEST_CHUNKS; ++chunk){
+		chunks.push_back(new Chunk());
+	}
+	std::vector<ChunkGenerationJob*> jobs;
+	PrepareGenerationJobs(chunks, jobs);
+
+	JobSystem jobSystem;
+	jobSystem.Startup(NUM_JOB_TEST_WORKER_THREADS);
+	for (std::vector<ChunkGenerationJob*>::iterator jobIter = jobs.begin(); jobIter != jobs.end(); ++jobIter){
+		jobSystem.SubmitJob(*jobIter);
+	}
+	jobSystem.Shutdown();
+	Jobs completedJobs;
+	jobSystem.PopCompletedJobs(completedJobs);
+	TEST_CHECK(completedJobs.size() == jobs.size());
+
+	JobSystem inlineJobSystem;
+	PrepareGenerationJobs(chunks, jobs);
+	inlineJobSystem.SubmitJob(jobs[0]);
+	completedJobs.clear();
+	inlineJobSystem.PopCompletedJobs(completedJobs);
+	TEST_CHECK(completedJobs.size() == 1 && completedJobs[0] == jobs[0]);
+	TEST_CHECK(chunks[0]->GetSkyHeight(0) > 0);
+
+	DeleteTestChunksAndJobs(chunks, jobs);
+}
+
+///=====================================================
+/// Chunks generated per second with 1 to N worker threads, N being the hardware thread count
+///=====================================================
+static void BenchmarkGenerationThroughput(){
+	std::vector<Chunk*> chunks;
+	for (int chunk = 0; chunk < NUM_GENERATION_BENCHMARK_CHUNKS; ++chunk){
+		chunks.push_back(new Chunk());
+	}
+	std::vector<ChunkGenerationJob*> jobs;
+
+	int maxNumWorkerThreads = (int)std::thread::hardware_concurrency();
+	if (maxNumWorkerThreads < 1)
+		maxNumWorkerThreads = 1;
+
+	double singleThreadChunksPerSecond = 0.0;
+	for (int numWorkerThreads = 1; numWorkerThreads <= maxNumWorkerThreads; ++numWorkerThreads){
+		PrepareGenerationJobs(chunks, jobs);
+		JobSystem jobSystem;
+		jobSystem.Startup(numWorkerThreads);
+
+		const double startSeconds = GetCurrentSeconds();
+		const int numChunksGenerated = RunGenerationJobs(jobSystem, jobs);
+		const double elapsedSeconds = GetCurrentSeconds() - startSeconds;
+		jobSystem.Shutdown();
+		TEST_CHECK(numChunksGenerated == NUM_GENERATION_BENCHMARK_CHUNKS);
+
+		const double chunksPerSecond = numChunksGenerated / elapsedSeconds;
+		if (numWorkerThreads == 1)
+			singleThreadChunksPerSecond = chunksPerSecond;
+		printf("  %d worker threads: %.0f chunks/sec (%.2fx)\n", numWorkerThreads, chunksPerSecond, chunksPerSecond / singleThreadChunksPerSecond);
+	}
+
+	DeleteTestChunksAndJobs(chunks, jobs);
+}
+
+///=====================================================
+/// 
+///=====================================================
+void RunJobSystemTests(){
+	printf("Job system\n");
+	TestWorkerGenerationMatchesMainThread();
+	TestJobsCompleteWithoutPolling();
+	BenchmarkGenerationThroughput();
+}
@@ -0,0 +1,204 @@
+//=====================================================
+// LightPropagator.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "LightPropagator.hpp"
+
+///=====================================================
+/// 
+///=====================================================
+LightPropagator::LightPropagator()
+:m_removalQueueHead(0),
+m_additionQueueHead(0){
+	m_removalQueue.reserve(10000);
+	m_additionQueue.reserve(10000);
+}
+
+///=====================================================
+/// faces are lit by the block in front of them, so a light change can show up in a neighboring chunk's mesh
+///=====================================================
+void LightPropagator::DirtyMeshesShowingBlock(const BlockLocation& blockLocation){
+	blockLocation.m_chunk->DirtyMeshAtIndex(blockLocation.m_index);
+
+	for (int face = FACE_NORTH; face < NUM_BLOCK_FACES; ++face){
+		const BlockLocation neighborLocation = WorldBlockAccessor::GetNeighborBlockLocation(blockLocation, (BlockFace)face);
+		if (neighborLocation.m_chunk != NULL && neighborLocation.m_chunk != blockLocation.m_chunk)
+			neighborLocation.m_chunk->DirtyMeshAtIndex(neighborLocation.m_index);
+	}
+}
+
+///=====================================================
+/// queues a block whose type, sky exposure or neighbors changed; nothing is relit until PropagateLight
+///=====================================================
+void LightPropagator::RelightBlock(const BlockLocation& blockLocation){
+	unsigned char& lightValue = blockLocation.m_chunk->m_lightValues[blockLocation.m_index];
+	const unsigned char oldLightValue = lightValue;
+	lightValue = GetEmittedLightValue(blockLocation);
+	if (lightValue == oldLightValue && lightValue == 0 && blockLocation.m_chunk->GetBlockDefinition(blockLocation.m_index).m_isOpaque)
+		return; //stays dark either way
+
+	if (lightValue != oldLightValue)
+		DirtyMeshesShowingBlock(blockLocation);
+
+	//only the nibbles that got dimmer need removing
+	unsigned char removedLightValue = 0;
+	for (int shift = 0; shift <= SKY_LIGHT_SHIFT; shift += SKY_LIGHT_SHIFT){
+		const unsigned char oldLight = (oldLightValue >> shift) & BLOCK_LIGHT_MASK;
+		if (oldLight > ((lightValue >> shift) & BLOCK_LIGHT_MASK))
+			removedLightValue |= oldLight << shift;
+	}
+	if (removedLightValue != 0)
+		PushRemoval(blockLocation, removedLightValue);
+	if (lightValue != 0)
+		PushAddition(blockLocation);
+
+	//pull light back in from the neighbors, since the block may be open to light it used to block
+	if (!blockLocation.m_chunk->GetBlockDefinition(blockLocation.m_index).m_isOpaque){
+		for (int face = 0; face < NUM_BLOCK_FACES; ++face){
+			const BlockLocation neighborLocation = WorldBlockAccessor::GetNeighborBlockLocation(blockLocation, (BlockFace)face);
+			if (neighborLocation.m_chunk && neighborLocation.m_chunk->m_lightValues[neighborLocation.m_index] != 0)
+				PushAddition(neighborLocation);
+		}
+	}
+}
+
+///=====================================================
+/// returns how many queued blocks were processed, which is at most maxBlocks
+///=====================================================
+int LightPropagator::PropagateLight(int maxBlocks){
+	int numBlocksProcessed = PropagateRemovals(maxBlocks);
+	if (m_removalQueueHead == m_removalQueue.size())
+		numBlocksProcessed += PropagateAdditions(maxBlocks - numBlocksProcessed);
+	return numBlocksProcessed;
+}
+
+///=====================================================
+/// drops processed entries from the front of a queue, so a queue that never fully drains doesn't keep growing
+///=====================================================
+template <typename T>
+static void TrimQueue(std::vector<T>& queue, size_t& queueHead){
+	if (queueHead == queue.size()){
+		queue.clear();
+		queueHead = 0;
+	}
+	else if (queueHead * 2 > queue.size()){
+		queue.erase(queue.begin(), queue.begin() + queueHead);
+		queueHead = 0;
+	}
+}
+
+///=====================================================
+/// per nibble, neighbors dimmer than a removed block may have been lit by it, so they are removed too;
+/// anything at least as bright was lit some other way and refills the removed area afterward
+///=====================================================
+int LightPropagator::PropagateRemovals(int maxBlocks){
+	int numBlocksProcessed = 0;
+	for (; m_removalQueueHead < m_removalQueue.size() && numBlocksProcessed < maxBlocks; ++m_removalQueueHead, ++numBlocksProcessed){
+		const LightRemovalNode node = m_removalQueue[m_removalQueueHead]; //copied, since pushing below can reallocate the queue
+		--node.m_location.m_chunk->m_numQueuedLightUpdates;
+
+		for (int face = 0; face < NUM_BLOCK_FACES; ++face){
+			const BlockLocation neighborLocation = WorldBlockAccessor::GetNeighborBlockLocation(node.m_location, (BlockFace)face);
+			if (!neighborLocation.m_chunk)
+				continue;
+
+			unsigned char& neighborLightValue = neighborLocation.m_chunk->m_lightValues[neighborLocation.m_index];
+			if (neighborLightValue == 0)
+				continue;
+
+			const unsigned char emittedLightValue = GetEmittedLightValue(neighborLocation);
+			unsigned char removedLightValue = 0;
+			unsigned char newLightValue = neighborLightValue;
+			bool needsAddition = false;
+			for (int shift = 0; shift <= SKY_LIGHT_SHIFT; shift += SKY_LIGHT_SHIFT){
+				const unsigned char neighborLight = (neighborLightValue >> shift) & BLOCK_LIGHT_MASK;
+				const unsigned char nodeRemovedLight = (node.m_oldLightValue >> shift) & BLOCK_LIGHT_MASK;
+				if (neighborLight == 0 || nodeRemovedLight == 0)
+					continue;
+
+				const unsigned char emittedLight = (emittedLightValue >> shift) & BLOCK_LIGHT_MASK;
+				if (neighborLight >= nodeRemovedLight || emittedLight >= neighborLight){
+					needsAddition = true;
+					continue;
+				}
+
+				removedLightValue |= neighborLight << shift;
+				newLightValue = (unsigned char)((newLightValue & ~(BLOCK_LIGHT_MASK << shift)) | (emittedLight << shift));
+				if (emittedLight != 0)
+					needsAddition = true;
+			}
+
+			if (removedLightValue != 0){
+				PushRemoval(neighborLocation, removedLightValue);
+				neighborLightValue = newLightValue;
+				DirtyMeshesShowingBlock(neighborLocation);
+			}
+			if (needsAddition)
+				PushAddition(neighborLocation);
+		}
+	}
+
+	TrimQueue(m_removalQueue, m_removalQueueHead);
+	return numBlocksProcessed;
+}
+
+///=====================================================
+/// 
+///=====================================================
+int LightPropagator::PropagateAdditions(int maxBlocks){
+	int numBlocksProcessed = 0;
+	for (; m_additionQueueHead < m_additionQueue.size() && numBlocksProcessed < maxBlocks; ++m_additionQueueHead, ++numBlocksProcessed){
+		const BlockLocation location = m_additionQueue[m_additionQueueHead];
+		--location.m_chunk->m_numQueuedLightUpdates;
+		const unsigned char lightValue = location.m_chunk->m_lightValues[location.m_index];
+		const unsigned char skyLight = lightValue >> SKY_LIGHT_SHIFT;
+		const unsigned char blockLight = lightValue & BLOCK_LIGHT_MASK;
+		if (skyLight <= 1 && blockLight <= 1)
+			continue;
+
+		const unsigned char spreadSkyLight = (skyLight > 0) ? skyLight - 1 : 0;
+		const unsigned char spreadBlockLight = (blockLight > 0) ? blockLight - 1 : 0;
+		for (int face = 0; face < NUM_BLOCK_FACES; ++face){
+			const BlockLocation neighborLocation = WorldBlockAccessor::GetNeighborBlockLocation(location, (BlockFace)face);
+			if (!neighborLocation.m_chunk)
+				continue;
+
+			unsigned char& neighborLightValue = neighborLocation.m_chunk->m_lightValues[neighborLocation.m_index];
+			const unsigned char neighborSkyLight = neighborLightValue >> SKY_LIGHT_SHIFT;
+			const unsigned char neighborBlockLight = neighborLightValue & BLOCK_LIGHT_MASK;
+			if (neighborSkyLight >= spreadSkyLight && neighborBlockLight >= spreadBlockLight)
+				continue;
+			if (neighborLocation.m_chunk->GetBlockDefinition(neighborLocation.m_index).m_isOpaque)
+				continue;
+
+			neighborLightValue = (unsigned char)((max(neighborSkyLight, spreadSkyLight) << SKY_LIGHT_SHIFT) | max(neighborBlockLight, spreadBlockLight));
+			DirtyMeshesShowingBlock(neighborLocation);
+			PushAddition(neighborLocation);
+		}
+	}
+
+	TrimQueue(m_additionQueue, m_additionQueueHead);
+	return numBlocksProcessed;
+}
+
+///=====================================================
+/// must be called before a chunk is deactivated, since the queues hold pointers to it; the chunk's own count is reset with it
+///=====================================================
+void LightPropagator::DiscardBlocksInChunk(const Chunk* chunk){
+	size_t numKept = 0;
+	for (size_t queueIndex = m_removalQueueHead; queueIndex < m_removalQueue.size(); ++queueIndex){
+		if (m_removalQueue[queueIndex].m_location.m_chunk != chunk)
+			m_removalQueue[numKept++] = m_removalQueue[queueIndex];
+	}
+	m_removalQueue.resize(numKept);
+	m_removalQueueHead = 0;
+
+	numKept = 0;
+	for (size_t queueIndex = m_additionQueueHead; queueIndex < m_additionQueue.size(); ++queueIndex){
+		if (m_additionQueue[queueIndex].m_chunk != chunk)
+			m_additionQueue[numKept++] = m_additionQueue[queueIndex];
+	}
+	m_additionQueue.resize(numKept);
+	m_additionQueueHead = 0;
+}
@@ -0,0 +1,81 @@
+//=====================================================
+// LightPropagator.hpp
+// by Andrew Socha
+//=====================================================
+
+#pragma once
+
+#ifndef __included_LightPropagator__
+#define __included_LightPropagator__
+
+#include "WorldBlockAccessor.hpp"
+
+struct LightRemovalNode{
+	BlockLocation m_location;
+	unsigned char m_oldLightValue;
+
+	inline LightRemovalNode(){}
+	inline LightRemovalNode(const BlockLocation& location, unsigned char oldLightValue):m_location(location), m_oldLightValue(oldLightValue){}
+};
+
+///=====================================================
+/// Breadth-first light propagation with separate removal and addition queues.
+/// Sky light and block light are propagated side by side in their own nibbles of each light value.
+/// In each, a block's light is the brightest of what it emits and each neighbor's light minus 1; blocks open to the sky emit full sky light.
+/// Opaque blocks only ever hold the light they emit, and never pass light through.
+/// Relit blocks drop to their own emitted light, the removal spreads through every neighbor lit more dimly than they were,
+/// and then light refills from the brighter blocks bordering the removal and from every source it uncovered.
+/// Propagation can stop after any number of blocks and resume later; no light is added while removals are still queued.
+///=====================================================
+class LightPropagator{
+private:
+	std::vector<LightRemovalNode> m_removalQueue;
+	BlockLocations m_additionQueue;
+	size_t m_removalQueueHead;
+	size_t m_additionQueueHead;
+
+	void PushRemoval(const BlockLocation& blockLocation, unsigned char removedLightValue);
+	void PushAddition(const BlockLocation& blockLocation);
+	int PropagateRemovals(int maxBlocks);
+	int PropagateAdditions(int maxBlocks);
+	static void DirtyMeshesShowingBlock(const BlockLocation& blockLocation);
+
+public:
+	LightPropagator();
+
+	static unsigned char GetEmittedLightValue(const BlockLocation& blockLocation);
+	void RelightBlock(const BlockLocation& blockLocation);
+	int PropagateLight(int maxBlocks);
+	void DiscardBlocksInChunk(const Chunk* chunk);
+
+	inline bool IsSettled() const{ return m_removalQueueHead == m_removalQueue.size() && m_additionQueueHead == m_additionQueue.size(); }
+	inline size_t GetNumQueuedBlocks() const{ return (m_removalQueue.size() - m_removalQueueHead) + (m_additionQueue.size() - m_additionQueueHead); }
+};
+
+///=====================================================
+/// queued blocks count toward their chunk's m_numQueuedLightUpdates until they're processed
+///=====================================================
+inline void LightPropagator::PushRemoval(const BlockLocation& blockLocation, unsigned char removedLightValue){
+	m_removalQueue.push_back(LightRemovalNode(blockLocation, removedLightValue));
+	++blockLocation.m_chunk->m_numQueuedLightUpdates;
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline void LightPropagator::PushAddition(const BlockLocation& blockLocation){
+	m_additionQueue.push_back(blockLocation);
+	++blockLocation.m_chunk->m_numQueuedLightUpdates;
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline unsigned char LightPropagator::GetEmittedLightValue(const BlockLocation& blockLocation){
+	const BlockDefinition& blockDef = blockLocation.m_chunk->GetBlockDefinition(blockLocation.m_index);
+	if (!blockDef.m_isOpaque && blockLocation.m_chunk->IsSky(blockLocation.m_index))
+		return FULL_SKY_LIGHT_VALUE | blockDef.m_inherentLightValue;
+	return blockDef.m_inherentLightValue;
+}
+
+#endif
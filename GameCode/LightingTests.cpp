@@ -0,0 +1,780 @@
+//=====================================================
+// LightingTests.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "TestHarness.hpp"
+#include "TestWorld.hpp"
+#include "ChunkMeshSnapshot.hpp"
+#include "LightPropagator.hpp"
+#include "ChunkJobs.hpp"
+#include "BlockRaycast.hpp"
+#include "Engine/Time/Time.hpp"
+#include <string.h>
+#include <stdio.h>
+#include <vector>
+
+const unsigned char TEST_SKY_LIGHT_LEVELS[] = { 10, 6 }; //World's MEDIUMLIGHT and MOONLIGHT
+const int NUM_TEST_SKY_LIGHT_LEVELS = sizeof(TEST_SKY_LIGHT_LEVELS) / sizeof(TEST_SKY_LIGHT_LEVELS[0]);
+const int LIGHTING_TEST_FLOOR_HEIGHT = 10;
+const int LIGHTING_TEST_ROOF_HEIGHT = 14;
+const int NUM_RELIGHT_BENCHMARK_ROUNDS = 50;
+const int LIGHT_BANDWIDTH_RING_RADIUS = 16; //a full 33x33 ring of active chunks
+const int NUM_LIGHT_BANDWIDTH_SOURCE_CHUNKS = 8;
+const int NUM_LIGHT_BANDWIDTH_PASSES = 3;
+const int NUM_EDIT_LATENCY_BENCHMARK_EDITS = 64;
+const float EDIT_LATENCY_RAYCAST_LENGTH = 8.0f; //the reach World uses for placing and digging
+
+//blocks as they were laid out before light values moved to their own array, each block's type beside its light
+struct InterleavedTestBlock{
+	unsigned char m_type;
+	unsigned char m_lightValue;
+};
+typedef std::vector<InterleavedTestBlock> InterleavedTestBlocks;
+
+struct ChunkLightingState{
+	unsigned char m_lightValues[BLOCKS_PER_CHUNK];
+	unsigned int m_lightDirtyBits[LIGHT_DIRTY_WORDS_PER_CHUNK];
+	unsigned char m_dirtySectionsMask;
+};
+
+///=====================================================
+/// 
+///=====================================================
+static void SaveChunkLightingState(const Chunk& chunk, ChunkLightingState& out_state){
+	memcpy(out_state.m_lightValues, chunk.m_lightValues, sizeof(out_state.m_lightValues));
+	memcpy(out_state.m_lightDirtyBits, chunk.m_lightDirtyBits, sizeof(out_state.m_lightDirtyBits));
+	out_state.m_dirtySectionsMask = chunk.m_dirtySectionsMask;
+}
+
+///=====================================================
+/// 
+///=====================================================
+static bool DoesChunkMatchLightingState(const Chunk& chunk, const ChunkLightingState& state){
+	return memcmp(state.m_lightValues, chunk.m_lightValues, sizeof(state.m_lightValues)) == 0
+		&& memcmp(state.m_lightDirtyBits, chunk.m_lightDirtyBits, sizeof(state.m_lightDirtyBits)) == 0
+		&& state.m_dirtySectionsMask == chunk.m_dirtySectionsMask;
+}
+
+///=====================================================
+/// Admits up to maxBlocksToAdmit dirty blocks, then propagates up to maxBlocksToPropagate; returns how many blocks were processed
+///=====================================================
+static int UpdateTestLighting(BlockLocations& dirtyBlocks, LightPropagator& lightPropagator, int maxBlocksToAdmit, int maxBlocksToPropagate){
+	int numBlocksAdmitted = 0;
+	while (!dirtyBlocks.empty() && numBlocksAdmitted < maxBlocksToAdmit){
+		const BlockLocation blockLocation = dirtyBlocks.back();
+		dirtyBlocks.pop_back();
+		blockLocation.m_chunk->UndirtyLightingAtIndex(blockLocation.m_index);
+		lightPropagator.RelightBlock(blockLocation);
+		++numBlocksAdmitted;
+	}
+	return numBlocksAdmitted + lightPropagator.PropagateLight(maxBlocksToPropagate);
+}
+
+///=====================================================
+/// Drains the dirty list and the propagator the way World::UpdateLighting does each frame, with no budget; returns how many blocks were processed
+///=====================================================
+static int SettleTestLighting(BlockLocations& dirtyBlocks, LightPropagator& lightPropagator){
+	int numBlocksProcessed = 0;
+	while (!dirtyBlocks.empty() || !lightPropagator.IsSettled()){
+		numBlocksProcessed += UpdateTestLighting(dirtyBlocks, lightPropagator, BLOCKS_PER_CHUNK, BLOCKS_PER_CHUNK);
+	}
+	return numBlocksProcessed;
+}
+
+///=====================================================
+/// Changes a block and queues it, plus every block in its column whose sky exposure changed, the way World's block edits do
+///=====================================================
+static void EditTestBlock(TestWorld& world, int blockX, int blockY, int blockZ, BlockType blockType, BlockLocations& dirtyBlocks){
+	Chunk* chunk = world.m_chunks.at(ChunkCoords(blockX >> CHUNKS_WIDE_EXPONENT, blockY >> CHUNKS_LONG_EXPONENT));
+	const int column = (blockX & CHUNK_X_MASK) | ((blockY & CHUNK_Y_MASK) << CHUNKS_WIDE_EXPONENT);
+	const int oldSkyHeight = chunk->GetSkyHeight(column);
+	world.SetBlockType(blockX, blockY, blockZ, blockType);
+	const int newSkyHeight = chunk->GetSkyHeight(column);
+
+	int lowestChangedHeight = (oldSkyHeight < newSkyHeight) ? oldSkyHeight : newSkyHeight;
+	int highestChangedHeight = ((oldSkyHeight > newSkyHeight) ? oldSkyHeight : newSkyHeight) - 1;
+	if (blockZ < lowestChangedHeight)
+		lowestChangedHeight = blockZ;
+	if (blockZ > highestChangedHeight)
+		highestChangedHeight = blockZ;
+	for (int height = lowestChangedHeight; height <= highestChangedHeight; ++height){
+		const BlockIndex blockIndex = (BlockIndex)(column + height * BLOCKS_PER_CHUNK_LAYER);
+		if (!chunk->GetBlock(blockIndex).IsLightingDirty())
+			chunk->DirtyLightingAtIndex(blockIndex, dirtyBlocks);
+	}
+}
+
+///=====================================================
+/// Recomputes every light value from scratch, starting from what each block emits and relaxing until nothing changes.
+/// That is the least fixpoint of the lighting rules, which the propagator must reach however its work was split up.
+/// The world's light values are restored afterward.
+///=====================================================
+static bool DoesLightingMatchBruteForce(TestWorld& world){
+	std::vector<unsigned char> propagatedLightValues;
+	propagatedLightValues.reserve(world.m_chunks.size() * BLOCKS_PER_CHUNK);
+	for (Chunks::iterator chunkIter = world.m_chunks.begin(); chunkIter != world.m_chunks.end(); ++chunkIter){
+		Chunk* chunk = chunkIter->second;
+		propagatedLightValues.insert(propagatedLightValues.end(), chunk->m_lightValues, chunk->m_lightValues + BLOCKS_PER_CHUNK);
+		for (int blockIndex = 0; blockIndex < BLOCKS_PER_CHUNK; ++blockIndex){
+			chunk->m_lightValues[blockIndex] = LightPropagator::GetEmittedLightValue(BlockLocation(chunk, (BlockIndex)blockIndex));
+		}
+	}
+
+	bool didAnyLightChange = true;
+	while (didAnyLightChange){
+		didAnyLightChange = false;
+		for (Chunks::iterator chunkIter = world.m_chunks.begin(); chunkIter != world.m_chunks.end(); ++chunkIter){
+			Chunk* chunk = chunkIter->second;
+			for (int blockIndex = 0; blockIndex < BLOCKS_PER_CHUNK; ++blockIndex){
+				if (chunk->GetBlockDefinition((BlockIndex)blockIndex).m_isOpaque)
+					continue;
+
+				const BlockLocation blockLocation(chunk, (BlockIndex)blockIndex);
+				int skyLight = chunk->m_lightValues[blockIndex] >> SKY_LIGHT_SHIFT;
+				int blockLight = chunk->m_lightValues[blockIndex] & BLOCK_LIGHT_MASK;
+				for (int face = 0; face < NUM_BLOCK_FACES; ++face){
+					const BlockLocation neighborLocation = WorldBlockAccessor::GetNeighborBlockLocation(blockLocation, (BlockFace)face);
+					if (!neighborLocation.m_chunk)
+						continue;
+
+					const unsigned char neighborLightValue = neighborLocation.m_chunk->m_lightValues[neighborLocation.m_index];
+					if ((neighborLightValue >> SKY_LIGHT_SHIFT) - 1 > skyLight)
+						skyLight = (neighborLightValue >> SKY_LIGHT_SHIFT) - 1;
+					if ((neighborLightValue & BLOCK_LIGHT_MASK) - 1 > blockLight)
+						blockLight = (neighborLightValue & BLOCK_LIGHT_MASK) - 1;
+				}
+
+				const unsigned char lightValue = (unsigned char)((skyLight << SKY_LIGHT_SHIFT) | blockLight);
+				if (lightValue != chunk->m_lightValues[blockIndex]){
+					chunk->m_lightValues[blockIndex] = lightValue;
+					didAnyLightChange = true;
+				}
+			}
+		}
+	}
+
+	bool doAllLightValuesMatch = true;
+	size_t chunkIndex = 0;
+	for (Chunks::iterator chunkIter = world.m_chunks.begin(); chunkIter != world.m_chunks.end(); ++chunkIter, ++chunkIndex){
+		Chunk* chunk = chunkIter->second;
+		const unsigned char* propagatedChunkLightValues = &propagatedLightValues[chunkIndex * BLOCKS_PER_CHUNK];
+		if (memcmp(chunk->m_lightValues, propagatedChunkLightValues, BLOCKS_PER_CHUNK) != 0)
+			doAllLightValuesMatch = false;
+		memcpy(chunk->m_lightValues, propagatedChunkLightValues, BLOCKS_PER_CHUNK);
+	}
+	return doAllLightValuesMatch;
+}
+
+///=====================================================
+/// A stone floor with a partly roofed room, lit by a glowstone inside it and the sky around it, with water outside
+///=====================================================
+static void SetUpLitTestWorld(TestWorld& world, BlockLocations& dirtyBlocks, LightPropagator& lightPropagator){
+	world.AddAirChunks(ChunkCoords(-1, -1), ChunkCoords(1, 1));
+	world.FillBlocks(0, 0, LIGHTING_TEST_FLOOR_HEIGHT, BLOCKS_PER_CHUNK_X - 1, BLOCKS_PER_CHUNK_Y - 1, LIGHTING_TEST_FLOOR_HEIGHT, BT_STONE);
+	world.FillBlocks(2, 2, LIGHTING_TEST_ROOF_HEIGHT, 9, 9, LIGHTING_TEST_ROOF_HEIGHT, BT_STONE);
+	world.SetBlockType(5, 5, LIGHTING_TEST_FLOOR_HEIGHT + 1, BT_GLOWSTONE);
+	world.SetBlockType(12, 12, LIGHTING_TEST_FLOOR_HEIGHT + 1, BT_WATER);
+
+	Chunk* chunk = world.m_chunks.at(ChunkCoords(0, 0));
+	for (int blockIndex = 0; blockIndex < BLOCKS_PER_CHUNK; ++blockIndex){
+		if (Chunk::GetLocalCoordsAtIndex((BlockIndex)blockIndex).z > LIGHTING_TEST_ROOF_HEIGHT + 1)
+			continue;
+		chunk->DirtyLightingAtIndex((BlockIndex)blockIndex, dirtyBlocks);
+	}
+	SettleTestLighting(dirtyBlocks, lightPropagator);
+
+	for (Chunks::iterator chunkIter = world.m_chunks.begin(); chunkIter != world.m_chunks.end(); ++chunkIter){
+		chunkIter->second->m_dirtySectionsMask = 0;
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void BuildTestSectionMeshes(const Chunk& chunk, PackedBlockVertexFaces* out_opaqueVertexFaces, PackedBlockVertexFaces* out_translucentVertexFaces){
+	ChunkMeshSnapshot* snapshot = new ChunkMeshSnapshot();
+	snapshot->CopyFromChunk(chunk, ALL_SECTIONS_MASK);
+	snapshot->BuildSectionMeshes(ALL_SECTIONS_MASK, out_opaqueVertexFaces, out_translucentVertexFaces);
+	delete snapshot;
+}
+
+///=====================================================
+/// 
+///=====================================================
+static bool ArePackedFacesEqual(const PackedBlockVertexFaces& faces, const PackedBlockVertexFaces& otherFaces){
+	if (faces.size() != otherFaces.size())
+		return false;
+	return faces.empty() || memcmp(&faces[0], &otherFaces[0], faces.size() * sizeof(PackedBlockVertexFace)) == 0;
+}
+
+///=====================================================
+/// Changing the sky light level must only change the brightness vertexes unpack to.
+/// Nothing is queued for relighting, no light value or dirty flag changes, and remeshing would produce exactly the same faces.
+///=====================================================
+static void TestSkyLightLevelChangeOnlyRecolors(){
+	TestWorld world;
+	BlockLocations dirtyBlocks;
+	LightPropagator lightPropagator;
+	SetUpLitTestWorld(world, dirtyBlocks, lightPropagator);
+	const Chunk& litChunk = *world.m_chunks.at(ChunkCoords(0, 0));
+
+	std::vector<ChunkLightingState> savedStates(world.m_chunks.size());
+	size_t chunkIndex = 0;
+	for (Chunks::const_iterator chunkIter = world.m_chunks.begin(); chunkIter != world.m_chunks.end(); ++chunkIter, ++chunkIndex){
+		SaveChunkLightingState(*chunkIter->second, savedStates[chunkIndex]);
+	}
+
+	PackedBlockVertexFaces daylightOpaqueFaces[SECTIONS_PER_CHUNK];
+	PackedBlockVertexFaces daylightTranslucentFaces[SECTIONS_PER_CHUNK];
+	BuildTestSectionMeshes(litChunk, daylightOpaqueFaces, daylightTranslucentFaces);
+	Vertex3D_PCT_Faces daylightVertexFaces;
+	UnpackVertexFaces(daylightOpaqueFaces[0], litChunk.m_worldCoordsMins, daylightVertexFaces);
+
+	for (int level = 0; level < NUM_TEST_SKY_LIGHT_LEVELS; ++level){
+		PackedBlockVertex::SetSkyLightLevel(TEST_SKY_LIGHT_LEVELS[level]);
+
+		TEST_CHECK(dirtyBlocks.empty());
+		TEST_CHECK(lightPropagator.IsSettled());
+		TEST_CHECK(lightPropagator.PropagateLight(BLOCKS_PER_CHUNK) == 0);
+
+		bool doAllChunksMatch = true;
+		chunkIndex = 0;
+		for (Chunks::const_iterator chunkIter = world.m_chunks.begin(); chunkIter != world.m_chunks.end(); ++chunkIter, ++chunkIndex){
+			if (!DoesChunkMatchLightingState(*chunkIter->second, savedStates[chunkIndex]))
+				doAllChunksMatch = false;
+		}
+		TEST_CHECK(doAllChunksMatch);
+
+		PackedBlockVertexFaces opaqueFaces[SECTIONS_PER_CHUNK];
+		PackedBlockVertexFaces translucentFaces[SECTIONS_PER_CHUNK];
+		BuildTestSectionMeshes(litChunk, opaqueFaces, translucentFaces);
+		bool doAllFacesMatch = true;
+		for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+			if (!ArePackedFacesEqual(opaqueFaces[section], daylightOpaqueFaces[section]) || !ArePackedFacesEqual(translucentFaces[section], daylightTranslucentFaces[section]))
+				doAllFacesMatch = false;
+		}
+		TEST_CHECK(doAllFacesMatch);
+
+		//sky-lit faces dim, while faces lit brighter by the glowstone than by the dimmed sky keep their color
+		Vertex3D_PCT_Faces vertexFaces;
+		UnpackVertexFaces(opaqueFaces[0], litChunk.m_worldCoordsMins, vertexFaces);
+		const int skyLightDimming = MAX_LIGHT_LEVEL - TEST_SKY_LIGHT_LEVELS[level];
+		int numDimmedVertexes = 0;
+		int numBlockLitVertexes = 0;
+		bool areAllColorsExpected = (vertexFaces.size() == daylightVertexFaces.size());
+		for (size_t faceIndex = 0; faceIndex < vertexFaces.size() && areAllColorsExpected; ++faceIndex){
+			for (int corner = 0; corner < 4; ++corner){
+				const unsigned char lightValue = opaqueFaces[0][faceIndex].vertexes[corner].m_lightValue;
+				const int skyLight = (lightValue >> SKY_LIGHT_SHIFT) - skyLightDimming;
+				const int blockLight = lightValue & BLOCK_LIGHT_MASK;
+				const unsigned char color = vertexFaces[faceIndex].vertexes[corner].m_color.r;
+				const unsigned char daylightColor = daylightVertexFaces[faceIndex].vertexes[corner].m_color.r;
+				if (color != PackedBlockVertex::GetBrightnessAtLightValue(lightValue))
+					areAllColorsExpected = false;
+				if (blockLight >= skyLight && blockLight >= (lightValue >> SKY_LIGHT_SHIFT)){
+					++numBlockLitVertexes;
+					if (color != daylightColor)
+						areAllColorsExpected = false;
+				}
+				else if (color < daylightColor)
+					++numDimmedVertexes;
+			}
+		}
+		TEST_CHECK(areAllColorsExpected);
+		TEST_CHECK(numDimmedVertexes > 0);
+		TEST_CHECK(numBlockLitVertexes > 0);
+	}
+
+	PackedBlockVertex::SetSkyLightLevel(MAX_LIGHT_LEVEL);
+}
+
+///=====================================================
+/// a packed face is a third of the size of the unpacked face uploaded to the VBO, which bounds the opaque faces chunks keep for recoloring
+///=====================================================
+static void TestKeptOpaqueFacesAreSmallerThanVbos(){
+	TEST_CHECK(3 * sizeof(PackedBlockVertexFace) <= sizeof(Vertex3D_PCT_Face));
+
+	TestWorld world;
+	BlockLocations dirtyBlocks;
+	LightPropagator lightPropagator;
+	SetUpLitTestWorld(world, dirtyBlocks, lightPropagator);
+	const Chunk& litChunk = *world.m_chunks.at(ChunkCoords(0, 0));
+
+	PackedBlockVertexFaces opaqueFaces[SECTIONS_PER_CHUNK];
+	PackedBlockVertexFaces translucentFaces[SECTIONS_PER_CHUNK];
+	BuildTestSectionMeshes(litChunk, opaqueFaces, translucentFaces);
+	size_t numKeptBytes = 0;
+	size_t numVboBytes = 0;
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		numKeptBytes += opaqueFaces[section].size() * sizeof(PackedBlockVertexFace);
+		numVboBytes += opaqueFaces[section].size() * sizeof(Vertex3D_PCT_Face);
+	}
+	printf("  kept opaque faces %d bytes, VBOs %d bytes\n", (int)numKeptBytes, (int)numVboBytes);
+	TEST_CHECK(numKeptBytes > 0);
+	TEST_CHECK(3 * numKeptBytes <= numVboBytes);
+}
+
+///=====================================================
+/// 
+///=====================================================
+static int GetTotalQueuedLightUpdates(const TestWorld& world){
+	int numQueuedLightUpdates = 0;
+	for (Chunks::const_iterator chunkIter = world.m_chunks.begin(); chunkIter != world.m_chunks.end(); ++chunkIter){
+		numQueuedLightUpdates += chunkIter->second->m_numQueuedLightUpdates;
+	}
+	return numQueuedLightUpdates;
+}
+
+///=====================================================
+/// Chunks count their own queued blocks, so remeshing can wait on them without scanning the queues every frame
+///=====================================================
+static void TestQueuedLightUpdatesAreCountedPerChunk(){
+	TestWorld world;
+	BlockLocations dirtyBlocks;
+	LightPropagator lightPropagator;
+	SetUpLitTestWorld(world, dirtyBlocks, lightPropagator);
+	TEST_CHECK(GetTotalQueuedLightUpdates(world) == 0);
+
+	//take the glowstone away, which darkens the room and spills removals across the border into the neighbors
+	Chunk* litChunk = world.m_chunks.at(ChunkCoords(0, 0));
+	const BlockIndex glowstoneIndex = Chunk::GetIndexAtLocalCoords(LocalCoords(5, 5, LIGHTING_TEST_FLOOR_HEIGHT + 1));
+	litChunk->SetBlockType(glowstoneIndex, BT_AIR);
+	litChunk->DirtyLightingAtIndex(glowstoneIndex, dirtyBlocks);
+	TEST_CHECK(!litChunk->IsLightingSettled());
+
+	bool doCountsMatchQueues = true;
+	const BlockLocation blockLocation = dirtyBlocks.back();
+	dirtyBlocks.pop_back();
+	litChunk->UndirtyLightingAtIndex(blockLocation.m_index);
+	lightPropagator.RelightBlock(blockLocation);
+	while (!lightPropagator.IsSettled()){
+		doCountsMatchQueues &= (GetTotalQueuedLightUpdates(world) == (int)lightPropagator.GetNumQueuedBlocks());
+		lightPropagator.PropagateLight(7);
+	}
+	TEST_CHECK(doCountsMatchQueues);
+
+	bool areAllChunksSettled = true;
+	for (Chunks::const_iterator chunkIter = world.m_chunks.begin(); chunkIter != world.m_chunks.end(); ++chunkIter){
+		areAllChunksSettled &= chunkIter->second->IsLightingSettled();
+	}
+	TEST_CHECK(areAllChunksSettled);
+}
+
+///=====================================================
+/// glowstones placed and removed inside the room, beside the glowstone already there, and against the chunk's east border
+///=====================================================
+static void TestGlowstoneEditsMatchBruteForce(){
+	TestWorld world;
+	BlockLocations dirtyBlocks;
+	LightPropagator lightPropagator;
+	SetUpLitTestWorld(world, dirtyBlocks, lightPropagator);
+	TEST_CHECK(DoesLightingMatchBruteForce(world));
+
+	EditTestBlock(world, 7, 3, LIGHTING_TEST_FLOOR_HEIGHT + 1, BT_GLOWSTONE, dirtyBlocks);
+	SettleTestLighting(dirtyBlocks, lightPropagator);
+	TEST_CHECK(DoesLightingMatchBruteForce(world));
+
+	EditTestBlock(world, 5, 5, LIGHTING_TEST_FLOOR_HEIGHT + 1, BT_AIR, dirtyBlocks);
+	SettleTestLighting(dirtyBlocks, lightPropagator);
+	TEST_CHECK(DoesLightingMatchBruteForce(world));
+
+	EditTestBlock(world, 7, 3, LIGHTING_TEST_FLOOR_HEIGHT + 1, BT_AIR, dirtyBlocks);
+	SettleTestLighting(dirtyBlocks, lightPropagator);
+	TEST_CHECK(DoesLightingMatchBruteForce(world));
+
+	EditTestBlock(world, BLOCKS_PER_CHUNK_X - 1, 8, LIGHTING_TEST_FLOOR_HEIGHT - 3, BT_GLOWSTONE, dirtyBlocks); //under the floor, lighting the chunk to the east
+	SettleTestLighting(dirtyBlocks, lightPropagator);
+	TEST_CHECK(DoesLightingMatchBruteForce(world));
+
+	EditTestBlock(world, BLOCKS_PER_CHUNK_X - 1, 8, LIGHTING_TEST_FLOOR_HEIGHT - 3, BT_AIR, dirtyBlocks);
+	SettleTestLighting(dirtyBlocks, lightPropagator);
+	TEST_CHECK(DoesLightingMatchBruteForce(world));
+}
+
+///=====================================================
+/// sky light pouring in through holes cut in the room's roof, then shut out again as they're sealed
+///=====================================================
+static void TestCaveOpeningAndSealingMatchBruteForce(){
+	TestWorld world;
+	BlockLocations dirtyBlocks;
+	LightPropagator lightPropagator;
+	SetUpLitTestWorld(world, dirtyBlocks, lightPropagator);
+
+	EditTestBlock(world, 4, 4, LIGHTING_TEST_ROOF_HEIGHT, BT_AIR, dirtyBlocks);
+	SettleTestLighting(dirtyBlocks, lightPropagator);
+	TEST_CHECK(DoesLightingMatchBruteForce(world));
+
+	for (int blockX = 6; blockX <= 9; ++blockX){
+		EditTestBlock(world, blockX, 8, LIGHTING_TEST_ROOF_HEIGHT, BT_AIR, dirtyBlocks);
+	}
+	SettleTestLighting(dirtyBlocks, lightPropagator);
+	TEST_CHECK(DoesLightingMatchBruteForce(world));
+
+	EditTestBlock(world, 4, 4, LIGHTING_TEST_ROOF_HEIGHT, BT_STONE, dirtyBlocks);
+	SettleTestLighting(dirtyBlocks, lightPropagator);
+	TEST_CHECK(DoesLightingMatchBruteForce(world));
+
+	for (int blockX = 6; blockX <= 9; ++blockX){
+		EditTestBlock(world, blockX, 8, LIGHTING_TEST_ROOF_HEIGHT, BT_STONE, dirtyBlocks);
+	}
+	SettleTestLighting(dirtyBlocks, lightPropagator);
+	TEST_CHECK(DoesLightingMatchBruteForce(world));
+
+	//a hole in the floor lets sky light down into the space underneath
+	EditTestBlock(world, 12, 3, LIGHTING_TEST_FLOOR_HEIGHT, BT_AIR, dirtyBlocks);
+	SettleTestLighting(dirtyBlocks, lightPropagator);
+	TEST_CHECK(DoesLightingMatchBruteForce(world));
+
+	EditTestBlock(world, 12, 3, LIGHTING_TEST_FLOOR_HEIGHT, BT_STONE, dirtyBlocks);
+	SettleTestLighting(dirtyBlocks, lightPropagator);
+	TEST_CHECK(DoesLightingMatchBruteForce(world));
+}
+
+///=====================================================
+/// Edits land while earlier relighting is still queued, with only a few blocks admitted and propagated per step, as under World's frame budget
+///=====================================================
+static void TestBudgetedRelightingMatchesBruteForce(){
+	TestWorld world;
+	BlockLocations dirtyBlocks;
+	LightPropagator lightPropagator;
+	SetUpLitTestWorld(world, dirtyBlocks, lightPropagator);
+
+	int numEditsWhileUnsettled = 0;
+	for (int step = 0; step < 400; ++step){
+		const bool isUnsettled = !dirtyBlocks.empty() || !lightPropagator.IsSettled();
+		switch (step){
+		case 0:
+			EditTestBlock(world, 4, 4, LIGHTING_TEST_ROOF_HEIGHT, BT_AIR, dirtyBlocks);
+			EditTestBlock(world, 5, 5, LIGHTING_TEST_FLOOR_HEIGHT + 1, BT_AIR, dirtyBlocks);
+			break;
+		case 3:
+			EditTestBlock(world, 7, 7, LIGHTING_TEST_FLOOR_HEIGHT + 1, BT_GLOWSTONE, dirtyBlocks);
+			numEditsWhileUnsettled += isUnsettled ? 1 : 0;
+			break;
+		case 10:
+			EditTestBlock(world, 4, 4, LIGHTING_TEST_ROOF_HEIGHT, BT_STONE, dirtyBlocks);
+			numEditsWhileUnsettled += isUnsettled ? 1 : 0;
+			break;
+		case 25:
+			EditTestBlock(world, 7, 7, LIGHTING_TEST_FLOOR_HEIGHT + 1, BT_AIR, dirtyBlocks);
+			EditTestBlock(world, 5, 5, LIGHTING_TEST_FLOOR_HEIGHT + 1, BT_GLOWSTONE, dirtyBlocks);
+			numEditsWhileUnsettled += isUnsettled ? 1 : 0;
+			break;
+		default:
+			break;
+		}
+		UpdateTestLighting(dirtyBlocks, lightPropagator, 2, 20);
+	}
+	SettleTestLighting(dirtyBlocks, lightPropagator);
+
+	TEST_CHECK(numEditsWhileUnsettled == 3);
+	TEST_CHECK(DoesLightingMatchBruteForce(world));
+}
+
+///=====================================================
+/// time to settle the lighting after each of a few typical edits
+///=====================================================
+static void BenchmarkRelighting(){
+	TestWorld world;
+	BlockLocations dirtyBlocks;
+	LightPropagator lightPropagator;
+	SetUpLitTestWorld(world, dirtyBlocks, lightPropagator);
+
+	int numBlocksProcessed = 0;
+	int numEdits = 0;
+	const double startSeconds = GetCurrentSeconds();
+	for (int round = 0; round < NUM_RELIGHT_BENCHMARK_ROUNDS; ++round){
+		EditTestBlock(world, 5, 5, LIGHTING_TEST_FLOOR_HEIGHT + 1, BT_AIR, dirtyBlocks);
+		numBlocksProcessed += SettleTestLighting(dirtyBlocks, lightPropagator);
+		EditTestBlock(world, 5, 5, LIGHTING_TEST_FLOOR_HEIGHT + 1, BT_GLOWSTONE, dirtyBlocks);
+		numBlocksProcessed += SettleTestLighting(dirtyBlocks, lightPropagator);
+		EditTestBlock(world, 4, 4, LIGHTING_TEST_ROOF_HEIGHT, BT_AIR, dirtyBlocks);
+		numBlocksProcessed += SettleTestLighting(dirtyBlocks, lightPropagator);
+		EditTestBlock(world, 4, 4, LIGHTING_TEST_ROOF_HEIGHT, BT_STONE, dirtyBlocks);
+		numBlocksProcessed += SettleTestLighting(dirtyBlocks, lightPropagator);
+		numEdits += 4;
+	}
+	const double elapsedSeconds = GetCurrentSeconds() - startSeconds;
+
+	printf("  relit %d edits in %.3f ms each, %d blocks processed per edit (%.2f M blocks/sec)\n", numEdits, elapsedSeconds * 1000.0 / numEdits, numBlocksProcessed / numEdits, numBlocksProcessed / elapsedSeconds * 1e-6);
+	TEST_CHECK(DoesLightingMatchBruteForce(world));
+}
+
+///=====================================================
+/// Sums every light value, then the brightest of each interior block's six neighbors, as the lighting pass reads them
+///=====================================================
+static unsigned int SumSplitLightValues(const std::vector<Chunk*>& chunks, unsigned int& out_neighborSum, double& out_sweepSeconds, double& out_neighborSeconds){
+	const int neighborOffsets[6] = {1, -1, BLOCKS_PER_CHUNK_X, -BLOCKS_PER_CHUNK_X, BLOCKS_PER_CHUNK_LAYER, -BLOCKS_PER_CHUNK_LAYER};
+	unsigned int sum = 0;
+	double startSeconds = GetCurrentSeconds();
+	for (int pass = 0; pass < NUM_LIGHT_BANDWIDTH_PASSES; ++pass){
+		for (std::vector<Chunk*>::const_iterator chunkIter = chunks.begin(); chunkIter != chunks.end(); ++chunkIter){
+			const unsigned char* lightValues = (*chunkIter)->m_lightValues;
+			for (int index = 0; index < BLOCKS_PER_CHUNK; ++index){
+				sum += lightValues[index];
+			}
+		}
+	}
+	out_sweepSeconds = GetCurrentSeconds() - startSeconds;
+
+	out_neighborSum = 0;
+	startSeconds = GetCurrentSeconds();
+	for (int pass = 0; pass < NUM_LIGHT_BANDWIDTH_PASSES; ++pass){
+		for (std::vector<Chunk*>::const_iterator chunkIter = chunks.begin(); chunkIter != chunks.end(); ++chunkIter){
+			const unsigned char* lightValues = (*chunkIter)->m_lightValues;
+			for (int index = BLOCKS_PER_CHUNK_LAYER; index < BLOCKS_PER_CHUNK - BLOCKS_PER_CHUNK_LAYER; ++index){
+				unsigned char brightestNeighbor = 0;
+				for (int neighbor = 0; neighbor < 6; ++neighbor){
+					if (lightValues[index + neighborOffsets[neighbor]] > brightestNeighbor)
+						brightestNeighbor = lightValues[index + neighborOffsets[neighbor]];
+				}
+				out_neighborSum += brightestNeighbor;
+			}
+		}
+	}
+	out_neighborSeconds = GetCurrentSeconds() - startSeconds;
+	return sum;
+}
+
+///=====================================================
+/// the same two passes over the interleaved layout
+///=====================================================
+static unsigned int SumInterleavedLightValues(const std::vector<InterleavedTestBlocks>& chunkBlocks, unsigned int& out_neighborSum, double& out_sweepSeconds, double& out_neighborSeconds){
+	const int neighborOffsets[6] = {1, -1, BLOCKS_PER_CHUNK_X, -BLOCKS_PER_CHUNK_X, BLOCKS_PER_CHUNK_LAYER, -BLOCKS_PER_CHUNK_LAYER};
+	unsigned int sum = 0;
+	double startSeconds = GetCurrentSeconds();
+	for (int pass = 0; pass < NUM_LIGHT_BANDWIDTH_PASSES; ++pass){
+		for (std::vector<InterleavedTestBlocks>::const_iterator blocksIter = chunkBlocks.begin(); blocksIter != chunkBlocks.end(); ++blocksIter){
+			const InterleavedTestBlock* blocks = &(*blocksIter)[0];
+			for (int index = 0; index < BLOCKS_PER_CHUNK; ++index){
+				sum += blocks[index].m_lightValue;
+			}
+		}
+	}
+	out_sweepSeconds = GetCurrentSeconds() - startSeconds;
+
+	out_neighborSum = 0;
+	startSeconds = GetCurrentSeconds();
+	for (int pass = 0; pass < NUM_LIGHT_BANDWIDTH_PASSES; ++pass){
+		for (std::vector<InterleavedTestBlocks>::const_iterator blocksIter = chunkBlocks.begin(); blocksIter != chunkBlocks.end(); ++blocksIter){
+			const InterleavedTestBlock* blocks = &(*blocksIter)[0];
+			for (int index = BLOCKS_PER_CHUNK_LAYER; index < BLOCKS_PER_CHUNK - BLOCKS_PER_CHUNK_LAYER; ++index){
+				unsigned char brightestNeighbor = 0;
+				for (int neighbor = 0; neighbor < 6; ++neighbor){
+					const unsigned char lightValue = blocks[index + neighborOffsets[neighbor]].m_lightValue;
+					if (lightValue > brightestNeighbor)
+						brightestNeighbor = lightValue;
+				}
+				out_neighborSum += brightestNeighbor;
+			}
+		}
+	}
+	out_neighborSeconds = GetCurrentSeconds() - startSeconds;
+	return sum;
+}
+
+///=====================================================
+/// Light reads over a full 33x33 ring of generated chunks, from the separate light arrays and from the old interleaved layout.
+/// The ring is built from a few generated chunks copied around it, with sky light above each column's sky height.
+///=====================================================
+static void BenchmarkLightValueBandwidth(){
+	std::vector<Chunk*> sourceChunks;
+	for (int source = 0; source < NUM_LIGHT_BANDWIDTH_SOURCE_CHUNKS; ++source){
+		Chunk* chunk = new Chunk();
+		chunk->m_worldCoordsMins = Chunk::GetWorldCoordsAtChunkCoords(ChunkCoords(source * 5, source * -3));
+		chunk->PopulateWithBlocks();
+		for (int index = 0; index < BLOCKS_PER_CHUNK; ++index){
+			if (chunk->IsSky((BlockIndex)index))
+				chunk->m_lightValues[index] |= FULL_SKY_LIGHT_VALUE;
+		}
+		sourceChunks.push_back(chunk);
+	}
+
+	const int ringWidth = LIGHT_BANDWIDTH_RING_RADIUS * 2 + 1;
+	std::vector<Chunk*> ringChunks;
+	std::vector<InterleavedTestBlocks> ringInterleavedBlocks(ringWidth * ringWidth);
+	for (int ringChunk = 0; ringChunk < ringWidth * ringWidth; ++ringChunk){
+		const Chunk& sourceChunk = *sourceChunks[ringChunk % NUM_LIGHT_BANDWIDTH_SOURCE_CHUNKS];
+		Chunk* chunk = new Chunk();
+		memcpy(chunk->m_lightValues, sourceChunk.m_lightValues, sizeof(chunk->m_lightValues));
+		ringChunks.push_back(chunk);
+
+		InterleavedTestBlocks& blocks = ringInterleavedBlocks[ringChunk];
+		blocks.resize(BLOCKS_PER_CHUNK);
+		for (int index = 0; index < BLOCKS_PER_CHUNK; ++index){
+			blocks[index].m_type = sourceChunk.GetBlockType((BlockIndex)index);
+			blocks[index].m_lightValue = sourceChunk.m_lightValues[index];
+		}
+	}
+
+	unsigned int splitNeighborSum = 0;
+	unsigned int interleavedNeighborSum = 0;
+	double splitSweepSeconds = 0.0;
+	double splitNeighborSeconds = 0.0;
+	double interleavedSweepSeconds = 0.0;
+	double interleavedNeighborSeconds = 0.0;
+	const unsigned int splitSum = SumSplitLightValues(ringChunks, splitNeighborSum, splitSweepSeconds, splitNeighborSeconds);
+	const unsigned int interleavedSum = SumInterleavedLightValues(ringInterleavedBlocks, interleavedNeighborSum, interleavedSweepSeconds, interleavedNeighborSeconds);
+	TEST_CHECK(splitSum == interleavedSum);
+	TEST_CHECK(splitNeighborSum == interleavedNeighborSum);
+
+	const double numRingMegabytes = (double)ringChunks.size() * BLOCKS_PER_CHUNK / (1024.0 * 1024.0);
+	printf("  %d chunk ring: light values %.0f MB split, %.0f MB interleaved\n", (int)ringChunks.size(), numRingMegabytes, numRingMegabytes * sizeof(InterleavedTestBlock));
+	printf("  light sweep: split %.1f ms, interleaved %.1f ms; six-neighbor pass: split %.1f ms, interleaved %.1f ms\n", splitSweepSeconds * 1000.0 / NUM_LIGHT_BANDWIDTH_PASSES, interleavedSweepSeconds * 1000.0 / NUM_LIGHT_BANDWIDTH_PASSES, splitNeighborSeconds * 1000.0 / NUM_LIGHT_BANDWIDTH_PASSES, interleavedNeighborSeconds * 1000.0 / NUM_LIGHT_BANDWIDTH_PASSES);
+
+	for (std::vector<Chunk*>::iterator chunkIter = ringChunks.begin(); chunkIter != ringChunks.end(); ++chunkIter){
+		delete *chunkIter;
+	}
+	for (std::vector<Chunk*>::iterator chunkIter = sourceChunks.begin(); chunkIter != sourceChunks.end(); ++chunkIter){
+		delete *chunkIter;
+	}
+}
+
+///=====================================================
+/// Generated terrain in 3x3 chunks under full sky light, with every block below the sky unlit and queued, then settled
+///=====================================================
+static void SetUpLitTerrainTestWorld(TestWorld& world, BlockLocations& dirtyBlocks, LightPropagator& lightPropagator){
+	world.AddAirChunks(ChunkCoords(-1, -1), ChunkCoords(1, 1));
+	for (Chunks::iterator chunkIter = world.m_chunks.begin(); chunkIter != world.m_chunks.end(); ++chunkIter){
+		Chunk* chunk = chunkIter->second;
+		chunk->PopulateWithBlocks();
+		for (int blockIndex = 0; blockIndex < BLOCKS_PER_CHUNK; ++blockIndex){
+			if (chunk->IsSky((BlockIndex)blockIndex)){
+				chunk->m_lightValues[blockIndex] = FULL_SKY_LIGHT_VALUE;
+				continue;
+			}
+			chunk->m_lightValues[blockIndex] = 0;
+			chunk->DirtyLightingAtIndex((BlockIndex)blockIndex, dirtyBlocks);
+		}
+	}
+	SettleTestLighting(dirtyBlocks, lightPropagator);
+}
+
+///=====================================================
+/// Meshes and uploads every chunk with dirty sections, the way a mesh job and its completion do; returns how many sections were meshed.
+/// With remeshWholeChunks, every section of a dirty chunk is meshed, as the single dirty flag per chunk did.
+///=====================================================
+static int RemeshDirtyTestChunks(TestWorld& world, const OpenGLRenderer* renderer, ChunkMeshJob& meshJob, bool remeshWholeChunks){
+	int numSectionsMeshed = 0;
+	for (Chunks::iterator chunkIter = world.m_chunks.begin(); chunkIter != world.m_chunks.end(); ++chunkIter){
+		Chunk* chunk = chunkIter->second;
+		if (chunk->m_dirtySectionsMask == 0)
+			continue;
+
+		const unsigned char sectionsMask = remeshWholeChunks ? (unsigned char)ALL_SECTIONS_MASK : chunk->m_dirtySectionsMask;
+		meshJob.Prepare(chunkIter->first, *chunk, sectionsMask, 1);
+		meshJob.Execute();
+		chunk->UploadSectionMeshes(renderer, sectionsMask, meshJob.m_opaqueVertexFaces, meshJob.m_translucentVertexFaces);
+		chunk->m_dirtySectionsMask = 0;
+
+		for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+			if ((sectionsMask & (1 << section)) != 0)
+				++numSectionsMeshed;
+		}
+	}
+	return numSectionsMeshed;
+}
+
+///=====================================================
+/// Places a block on whatever the ray hits, with the steps World::PlaceBlockWithRaycast takes; returns false if nothing was placed
+///=====================================================
+static bool PlaceTestBlockWithRaycast(TestWorld& world, const WorldCoords& rayStart, const WorldCoords& rayEnd, BlockLocations& dirtyBlocks, int& out_blockX, int& out_blockY, int& out_blockZ){
+	const Raycast3DResult raycastResult = RaycastBlocks(world.m_chunks, rayStart, rayEnd);
+	if (!raycastResult.m_didImpact)
+		return false;
+
+	const WorldCoords newBlockCoords(raycastResult.m_impactWorldCoordsMins + raycastResult.m_impactSurfaceNormal);
+	const BlockLocation newBlockLocation = WorldBlockAccessor(world.m_chunks).GetBlockLocationAtWorldCoords(newBlockCoords);
+	if (!newBlockLocation.m_chunk || newBlockLocation.m_chunk->GetBlockType(newBlockLocation.m_index) != BT_AIR)
+		return false;
+
+	out_blockX = RoundDownToInt(newBlockCoords.x);
+	out_blockY = RoundDownToInt(newBlockCoords.y);
+	out_blockZ = RoundDownToInt(newBlockCoords.z);
+	EditTestBlock(world, out_blockX, out_blockY, out_blockZ, BT_GLOWSTONE, dirtyBlocks);
+	newBlockLocation.m_chunk->RecordBlockEdit(newBlockLocation.m_index);
+	newBlockLocation.m_chunk->DirtyMeshesAroundIndex(newBlockLocation.m_index);
+	return true;
+}
+
+///=====================================================
+/// Milliseconds per edit from placing a block to its meshes being uploaded, relighting included; each block is removed again untimed
+///=====================================================
+static double TimeEditToVisibleLatency(TestWorld& world, const OpenGLRenderer* renderer, ChunkMeshJob& meshJob, BlockLocations& dirtyBlocks, LightPropagator& lightPropagator, bool remeshWholeChunks, int& out_numEdits, int& out_numSectionsMeshed){
+	out_numEdits = 0;
+	out_numSectionsMeshed = 0;
+	double elapsedSeconds = 0.0;
+	for (int edit = 0; edit < NUM_EDIT_LATENCY_BENCHMARK_EDITS; ++edit){
+		//aim down at columns spread over the center chunk, a quarter of them on its borders
+		const int localX = (edit % 4 == 0) ? CHUNK_X_MASK * (edit / 4 % 2) : (edit * 7) & CHUNK_X_MASK;
+		const int localY = (edit * 5) & CHUNK_Y_MASK;
+		const Chunk* chunk = world.m_chunks.at(ChunkCoords(0, 0));
+		const float cameraHeight = (float)chunk->GetSkyHeight(localX | (localY << CHUNKS_WIDE_EXPONENT)) + 3.6f;
+		const WorldCoords rayStart((float)localX + 0.5f, (float)localY + 0.5f, cameraHeight);
+		const WorldCoords rayEnd(rayStart.x + 0.2f, rayStart.y - 0.1f, cameraHeight - EDIT_LATENCY_RAYCAST_LENGTH);
+
+		int blockX, blockY, blockZ;
+		const double startSeconds = GetCurrentSeconds();
+		if (!PlaceTestBlockWithRaycast(world, rayStart, rayEnd, dirtyBlocks, blockX, blockY, blockZ))
+			continue;
+		SettleTestLighting(dirtyBlocks, lightPropagator);
+		out_numSectionsMeshed += RemeshDirtyTestChunks(world, renderer, meshJob, remeshWholeChunks);
+		elapsedSeconds += GetCurrentSeconds() - startSeconds;
+		++out_numEdits;
+
+		const BlockLocation blockLocation = WorldBlockAccessor(world.m_chunks).GetBlockLocationAtBlockCoords(blockX, blockY, blockZ);
+		EditTestBlock(world, blockX, blockY, blockZ, BT_AIR, dirtyBlocks);
+		blockLocation.m_chunk->DirtyMeshesAroundIndex(blockLocation.m_index);
+		SettleTestLighting(dirtyBlocks, lightPropagator);
+		RemeshDirtyTestChunks(world, renderer, meshJob, remeshWholeChunks);
+	}
+	return (out_numEdits == 0) ? 0.0 : elapsedSeconds * 1000.0 / out_numEdits;
+}
+
+///=====================================================
+/// Edit-to-visible latency for glowstone placed by raycast on generated terrain, remeshing only the dirty sections and then whole chunks.
+/// The job runs inline here; in game it also waits a frame or two for a worker and for the upload.
+///=====================================================
+static void BenchmarkEditToVisibleLatency(){
+	TestWorld world;
+	BlockLocations dirtyBlocks;
+	LightPropagator lightPropagator;
+	SetUpLitTerrainTestWorld(world, dirtyBlocks, lightPropagator);
+
+	OpenGLRenderer renderer;
+	ChunkMeshJob* meshJob = new ChunkMeshJob();
+	RemeshDirtyTestChunks(world, &renderer, *meshJob, true);
+
+	int numSectionEdits, numSectionsMeshed;
+	const double sectionMilliseconds = TimeEditToVisibleLatency(world, &renderer, *meshJob, dirtyBlocks, lightPropagator, false, numSectionEdits, numSectionsMeshed);
+	int numWholeChunkEdits, numWholeChunkSectionsMeshed;
+	const double wholeChunkMilliseconds = TimeEditToVisibleLatency(world, &renderer, *meshJob, dirtyBlocks, lightPropagator, true, numWholeChunkEdits, numWholeChunkSectionsMeshed);
+	TEST_CHECK(numSectionEdits == NUM_EDIT_LATENCY_BENCHMARK_EDITS && numWholeChunkEdits == numSectionEdits);
+	TEST_CHECK(numSectionsMeshed < numWholeChunkSectionsMeshed);
+	TEST_CHECK(DoesLightingMatchBruteForce(world));
+
+	printf("  placed %d blocks: %.3f ms edit to upload remeshing dirty sections (%.1f sections each), %.3f ms remeshing whole chunks (%.1f sections each)\n", numSectionEdits,
+		sectionMilliseconds, (double)numSectionsMeshed / numSectionEdits, wholeChunkMilliseconds, (double)numWholeChunkSectionsMeshed / numWholeChunkEdits);
+
+	for (Chunks::iterator chunkIter = world.m_chunks.begin(); chunkIter != world.m_chunks.end(); ++chunkIter){
+		chunkIter->second->DeleteBuffers(&renderer);
+	}
+	delete meshJob;
+}
+
+///=====================================================
+/// 
+///=====================================================
+void RunLightingTests(){
+	printf("Lighting\n");
+	TestSkyLightLevelChangeOnlyRecolors();
+	TestKeptOpaqueFacesAreSmallerThanVbos();
+	TestQueuedLightUpdatesAreCountedPerChunk();
+	TestGlowstoneEditsMatchBruteForce();
+	TestCaveOpeningAndSealingMatchBruteForce();
+	TestBudgetedRelightingMatchesBruteForce();
+	BenchmarkRelighting();
+	BenchmarkEditToVisibleLatency();
+	BenchmarkLightValueBandwidth();
+}
@@ -0,0 +1,86 @@
+//=====================================================
+// Main_Tests.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "TestHarness.hpp"
+#include "BlockDefinition.hpp"
+#include "PackedBlockVertex.hpp"
+#include <stdio.h>
+
+int s_numTestChecks = 0;
+int s_numFailedTestChecks = 0;
+
+///=====================================================
+/// 
+///=====================================================
+bool RecordTestCheck(bool didPass, const char* expression, const char* file, int line){
+	++s_numTestChecks;
+	if (!didPass){
+		++s_numFailedTestChecks;
+		printf("FAILED: %s (%s:%d)\n", expression, file, line);
+	}
+	return didPass;
+}
+
+///=====================================================
+/// 
+///=====================================================
+static const Vec2 GetTestAtlasTexCoordsMins(int atlasTile){
+	return Vec2((float)(atlasTile % TEX_TILES_PER_ATLAS_SIDE) / (float)TEX_TILES_PER_ATLAS_SIDE, (float)(atlasTile / TEX_TILES_PER_ATLAS_SIDE) / (float)TEX_TILES_PER_ATLAS_SIDE);
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void SetUpTestBlockDefinition(BlockType type, int topTile, int sideTile, int bottomTile, bool isSolid, bool isOpaque, bool isVisible, bool fallsWithGravity, unsigned char inherentLightValue){
+	BlockDefinition& blockDef = g_blockDefinitions[type];
+	blockDef.m_type = type;
+	blockDef.m_topTexCoordsMins = GetTestAtlasTexCoordsMins(topTile);
+	blockDef.m_sideTexCoordsMins = GetTestAtlasTexCoordsMins(sideTile);
+	blockDef.m_bottomTexCoordsMins = GetTestAtlasTexCoordsMins(bottomTile);
+	blockDef.m_isSolid = isSolid;
+	blockDef.m_isOpaque = isOpaque;
+	blockDef.m_isVisible = isVisible;
+	blockDef.m_fallsWithGravity = fallsWithGravity;
+	blockDef.m_inherentLightValue = inherentLightValue;
+}
+
+///=====================================================
+/// the same tiles and flags World::Startup gives each type, without loading the atlas or sounds
+///=====================================================
+void SetUpTestBlockDefinitions(){
+	SetUpTestBlockDefinition(BT_AIR, 0, 0, 0, false, false, false, false, 0);
+	SetUpTestBlockDefinition(BT_GRASS, 695, 627, 626, true, true, true, false, 0);
+	SetUpTestBlockDefinition(BT_DIRT, 626, 626, 626, true, true, true, false, 0);
+	SetUpTestBlockDefinition(BT_STONE, 624, 624, 624, true, true, true, false, 0);
+	SetUpTestBlockDefinition(BT_WATER, 1022, 1022, 1022, false, false, true, true, 0);
+	SetUpTestBlockDefinition(BT_SAND, 658, 658, 658, true, true, true, false, 0);
+	SetUpTestBlockDefinition(BT_GLOWSTONE, 201, 201, 201, true, true, true, false, 14);
+	SetUpTestBlockDefinition(BT_ICE, 755, 755, 755, true, false, true, false, 0);
+	SetUpTestBlockDefinition(BT_SNOW, 754, 756, 626, true, true, true, false, 0);
+	PackedBlockVertex::SetSkyLightLevel(MAX_LIGHT_LEVEL);
+}
+
+///=====================================================
+/// 
+///=====================================================
+int main(){
+	SetUpTestBlockDefinitions();
+
+	RunNoiseTests();
+	RunChunkMeshTests();
+	RunBlockCollisionTests();
+	RunRaycastTests();
+	RunLightingTests();
+	RunChunkSaveTests();
+	RunPalettedBlockStorageTests();
+	RunChunkRegistryTests();
+	RunRegionFileTests();
+	RunJobSystemTests();
+	RunRadixSortTests();
+	RunWorldBlockAccessorTests();
+
+	printf("%d of %d checks passed\n", s_numTestChecks - s_numFailedTestChecks, s_numTestChecks);
+	return (s_numFailedTestChecks == 0) ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+//=====================================================
+// NoiseTests.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "TestHarness.hpp"
+#include "BatchedNoise.hpp"
+#include "Engine/Math/Noise.hpp"
+#include "Engine/Time/Time.hpp"
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+struct NoiseField{
+	const char* m_name;
+	float m_gridCellSize;
+	int m_numOctaves;
+	float m_baseAmplitude;
+	float m_persistance;
+};
+
+//the fields Chunk samples for terrain and weather
+const NoiseField NOISE_FIELDS[] = {
+	{ "dirt", 40.0f, 8, 6.0f, 0.5f },
+	{ "ground", 80.0f, 8, 18.0f, 0.5f },
+	{ "biome", 200.0f, 8, 0.5f, 0.5f },
+	{ "weather", 300.0f, 8, 0.5f, 0.5f }
+};
+const int NUM_NOISE_FIELDS = sizeof(NOISE_FIELDS) / sizeof(NOISE_FIELDS[0]);
+const int NUM_NOISE_TEST_POSITIONS = 1 << 16;
+
+///=====================================================
+/// block corners and centers scattered far from the origin in both directions, plus a short batch to exercise the padded lanes
+///=====================================================
+static void CreateNoiseTestPositions(std::vector<Vec2>& out_positions){
+	out_positions.resize(NUM_NOISE_TEST_POSITIONS);
+	unsigned int state = 12345;
+	for (int positionIndex = 0; positionIndex < NUM_NOISE_TEST_POSITIONS; ++positionIndex){
+		state = state * 1664525u + 1013904223u;
+		const int blockX = (int)(state >> 12) - (1 << 19);
+		state = state * 1664525u + 1013904223u;
+		const int blockY = (int)(state >> 12) - (1 << 19);
+		const float centerOffset = (positionIndex & 1) ? 0.5f : 0.0f;
+		out_positions[positionIndex] = Vec2((float)blockX + centerOffset, (float)blockY + centerOffset);
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void TestBatchedNoiseMatchesScalar(const std::vector<Vec2>& positions, const NoiseField& field){
+	std::vector<float> batchedValues(positions.size());
+	ComputePerlinNoiseValuesAtPositions2D(&positions[0], (int)positions.size(), field.m_gridCellSize, field.m_numOctaves, field.m_baseAmplitude, field.m_persistance, &batchedValues[0]);
+
+	float maxError = 0.0f;
+	for (size_t positionIndex = 0; positionIndex < positions.size(); ++positionIndex){
+		const float scalarValue = ComputePerlinNoiseValueAtPosition2D(positions[positionIndex], field.m_gridCellSize, field.m_numOctaves, field.m_baseAmplitude, field.m_persistance);
+		const float error = fabs(batchedValues[positionIndex] - scalarValue);
+		if (error > maxError)
+			maxError = error;
+	}
+	printf("  %-8s max error %g (%g per unit amplitude)\n", field.m_name, maxError, maxError / field.m_baseAmplitude);
+	TEST_CHECK(maxError <= BATCHED_PERLIN_TOLERANCE_PER_AMPLITUDE * field.m_baseAmplitude);
+
+	float shortBatchValues[3];
+	ComputePerlinNoiseValuesAtPositions2D(&positions[5], 3, field.m_gridCellSize, field.m_numOctaves, field.m_baseAmplitude, field.m_persistance, shortBatchValues);
+	for (int positionIndex = 0; positionIndex < 3; ++positionIndex){
+		TEST_CHECK(shortBatchValues[positionIndex] == batchedValues[5 + positionIndex]);
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void BenchmarkNoise(const std::vector<Vec2>& positions, const NoiseField& field){
+	std::vector<float> values(positions.size());
+
+	double startSeconds = GetCurrentSeconds();
+	for (size_t positionIndex = 0; positionIndex < positions.size(); ++positionIndex){
+		values[positionIndex] = ComputePerlinNoiseValueAtPosition2D(positions[positionIndex], field.m_gridCellSize, field.m_numOctaves, field.m_baseAmplitude, field.m_persistance);
+	}
+	const double scalarSeconds = GetCurrentSeconds() - startSeconds;
+
+	startSeconds = GetCurrentSeconds();
+	ComputePerlinNoiseValuesAtPositions2D(&positions[0], (int)positions.size(), field.m_gridCellSize, field.m_numOctaves, field.m_baseAmplitude, field.m_persistance, &values[0]);
+	const double batchedSeconds = GetCurrentSeconds() - startSeconds;
+
+	const double numSamples = (double)positions.size();
+	printf("  %-8s scalar %.2f M samples/sec, batched %.2f M samples/sec (%.1fx)\n", field.m_name, numSamples / scalarSeconds * 1e-6, numSamples / batchedSeconds * 1e-6, scalarSeconds / batchedSeconds);
+}
+
+///=====================================================
+/// 
+///=====================================================
+void RunNoiseTests(){
+	printf("Batched Perlin noise\n");
+	std::vector<Vec2> positions;
+	CreateNoiseTestPositions(positions);
+
+	for (int field = 0; field < NUM_NOISE_FIELDS; ++field){
+		TestBatchedNoiseMatchesScalar(positions, NOISE_FIELDS[field]);
+	}
+	for (int field = 0; field < NUM_NOISE_FIELDS; ++field){
+		BenchmarkNoise(positions, NOISE_FIELDS[field]);
+	}
+}
@@ -0,0 +1,51 @@
+//=====================================================
+// PackedBlockVertex.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "PackedBlockVertex.hpp"
+
+unsigned char PackedBlockVertex::s_brightnessAtLightValue[256];
+unsigned char PackedBlockVertex::s_skyLightLevel = 0;
+
+///=====================================================
+/// Sky light dims by however far the sky level is below full daylight, then the brighter of it and block light is used.
+/// Only vertexes unpacked after this see the new level; VBOs already uploaded keep the old one until they're refreshed.
+///=====================================================
+void PackedBlockVertex::SetSkyLightLevel(unsigned char skyLightLevel){
+	s_skyLightLevel = skyLightLevel;
+	const int skyLightDimming = MAX_LIGHT_LEVEL - skyLightLevel;
+	for (int lightValue = 0; lightValue < 256; ++lightValue){
+		int skyLight = (lightValue >> SKY_LIGHT_SHIFT) - skyLightDimming;
+		int blockLight = lightValue & BLOCK_LIGHT_MASK;
+		s_brightnessAtLightValue[lightValue] = (unsigned char)(((skyLight > blockLight) ? skyLight : blockLight) << 4);
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+void UnpackVertexFaces(const PackedBlockVertexFaces& packedVertexFaces, const Vec3& chunkMins, Vertex3D_PCT_Faces& out_vertexFaces){
+	out_vertexFaces.resize(packedVertexFaces.size());
+	for (size_t faceIndex = 0; faceIndex < packedVertexFaces.size(); ++faceIndex){
+		const PackedBlockVertexFace& packedVertexFace = packedVertexFaces[faceIndex];
+		Vertex3D_PCT_Face& vertexFace = out_vertexFaces[faceIndex];
+		for (int corner = 0; corner < 4; ++corner){
+			packedVertexFace.vertexes[corner].Unpack(chunkMins, vertexFace.vertexes[corner]);
+		}
+	}
+}
+
+///=====================================================
+/// out_vertexFaces[n] is the unpacked packedVertexFaces[faceOrder[n]]
+///=====================================================
+void UnpackVertexFacesInOrder(const PackedBlockVertexFaces& packedVertexFaces, const std::vector<unsigned int>& faceOrder, const Vec3& chunkMins, Vertex3D_PCT_Faces& out_vertexFaces){
+	out_vertexFaces.resize(faceOrder.size());
+	for (size_t faceIndex = 0; faceIndex < faceOrder.size(); ++faceIndex){
+		const PackedBlockVertexFace& packedVertexFace = packedVertexFaces[faceOrder[faceIndex]];
+		Vertex3D_PCT_Face& vertexFace = out_vertexFaces[faceIndex];
+		for (int corner = 0; corner < 4; ++corner){
+			packedVertexFace.vertexes[corner].Unpack(chunkMins, vertexFace.vertexes[corner]);
+		}
+	}
+}
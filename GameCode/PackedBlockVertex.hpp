@@ -0,0 +1,66 @@
+//=====================================================
+// PackedBlockVertex.hpp
+// by Andrew Socha
+//=====================================================
+
+#pragma once
+
+#ifndef __included_PackedBlockVertex__
+#define __included_PackedBlockVertex__
+
+#include "Engine/Renderer/OpenGLRenderer.hpp"
+#include "Block.hpp"
+#include <vector>
+
+const int TEX_TILES_PER_ATLAS_SIDE = 32;
+
+///=====================================================
+/// 8-byte block vertex, relative to its chunk's mins.
+/// Block corners always land on whole coordinates and atlas tile edges, so every field fits in a byte.
+///=====================================================
+struct PackedBlockVertex{
+public:
+	unsigned char m_localX; //0-16
+	unsigned char m_localY; //0-16
+	unsigned char m_localZ; //0-128
+	unsigned char m_lightValue; //block light and sky light nibbles, as in Chunk::m_lightValues
+	unsigned char m_texTileX; //atlas texcoords in whole tiles, 0-32
+	unsigned char m_texTileY;
+	unsigned short m_unused;
+
+	static unsigned char s_brightnessAtLightValue[256];
+	static unsigned char s_skyLightLevel;
+
+	static unsigned char GetTexTileAtTexCoord(float texCoord);
+	static void SetSkyLightLevel(unsigned char skyLightLevel);
+	static unsigned char GetSkyLightLevel(){ return s_skyLightLevel; }
+	static unsigned char GetBrightnessAtLightValue(unsigned char lightValue){ return s_brightnessAtLightValue[lightValue]; }
+	void Unpack(const Vec3& chunkMins, Vertex3D_PCT& out_vertex) const;
+};
+
+struct PackedBlockVertexFace{
+	PackedBlockVertex vertexes[4];
+};
+typedef std::vector<PackedBlockVertexFace> PackedBlockVertexFaces;
+
+void UnpackVertexFaces(const PackedBlockVertexFaces& packedVertexFaces, const Vec3& chunkMins, Vertex3D_PCT_Faces& out_vertexFaces);
+void UnpackVertexFacesInOrder(const PackedBlockVertexFaces& packedVertexFaces, const std::vector<unsigned int>& faceOrder, const Vec3& chunkMins, Vertex3D_PCT_Faces& out_vertexFaces);
+
+///=====================================================
+/// 
+///=====================================================
+inline unsigned char PackedBlockVertex::GetTexTileAtTexCoord(float texCoord){
+	return (unsigned char)(texCoord * (float)TEX_TILES_PER_ATLAS_SIDE + 0.5f);
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline void PackedBlockVertex::Unpack(const Vec3& chunkMins, Vertex3D_PCT& out_vertex) const{
+	out_vertex.m_position = chunkMins + Vec3((float)m_localX, (float)m_localY, (float)m_localZ);
+	unsigned char lighting = s_brightnessAtLightValue[m_lightValue];
+	out_vertex.m_color = RGBAchars(lighting, lighting, lighting);
+	out_vertex.m_texCoords = Vec2((float)m_texTileX / (float)TEX_TILES_PER_ATLAS_SIDE, (float)m_texTileY / (float)TEX_TILES_PER_ATLAS_SIDE);
+}
+
+#endif
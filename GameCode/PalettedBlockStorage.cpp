@@ -0,0 +1,194 @@
+//=====================================================
+// PalettedBlockStorage.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "PalettedBlockStorage.hpp"
+#include <assert.h>
+#include <string.h>
+
+const unsigned char MAX_BITS_PER_BLOCK_EXPONENT = 3; //8 bits per block
+
+///=====================================================
+/// 
+///=====================================================
+PalettedBlockStorage::PalettedBlockStorage(int numBlocks)
+:m_numBlocks(numBlocks),
+m_bitsPerBlockExponent(0),
+m_paletteSize(0),
+m_wordShift(0),
+m_slotMask(0),
+m_paletteIndexMask(0),
+m_packedIndexes(&m_uniformWord),
+m_uniformWord(0){
+	Fill(0);
+}
+
+///=====================================================
+/// Every index maps to bit 0 of one word with a 0 mask, so lookups stay branch-free
+///=====================================================
+void PalettedBlockStorage::SetUniformLayout(){
+	m_bitsPerBlockExponent = 0;
+	m_wordShift = 31;
+	m_slotMask = 0;
+	m_paletteIndexMask = 0;
+	m_uniformWord = 0;
+	m_packedIndexes = &m_uniformWord;
+	std::vector<unsigned int>().swap(m_packedIndexStorage); //swap to release memory from any packed layout
+}
+
+///=====================================================
+/// 
+///=====================================================
+void PalettedBlockStorage::SetBitsPerBlockExponent(unsigned char bitsPerBlockExponent){
+	m_bitsPerBlockExponent = bitsPerBlockExponent;
+	m_wordShift = PACKED_WORD_BITS_EXPONENT - bitsPerBlockExponent;
+	m_slotMask = (1 << m_wordShift) - 1;
+	m_paletteIndexMask = (1 << (1 << bitsPerBlockExponent)) - 1;
+}
+
+///=====================================================
+/// 
+///=====================================================
+void PalettedBlockStorage::Fill(unsigned char type){
+	memset(m_paletteIndexForType, PALETTE_INDEX_NONE, sizeof(m_paletteIndexForType));
+	m_palette[0] = type;
+	m_paletteIndexForType[type] = 0;
+	m_paletteSize = 1;
+
+	SetUniformLayout();
+}
+
+///=====================================================
+/// Compacts before widening, so types edited out of a storage don't push it to a wider index
+///=====================================================
+unsigned char PalettedBlockStorage::GetOrAddPaletteIndex(unsigned char type){
+	unsigned char paletteIndex = m_paletteIndexForType[type];
+	if (paletteIndex != PALETTE_INDEX_NONE)
+		return paletteIndex;
+
+	if (m_paletteSize > m_paletteIndexMask)
+		Compact();
+
+	assert(m_paletteSize < MAX_PALETTE_ENTRIES);
+	paletteIndex = m_paletteSize;
+	m_palette[m_paletteSize++] = type;
+	m_paletteIndexForType[type] = paletteIndex;
+
+	if (paletteIndex > m_paletteIndexMask)
+		Widen();
+
+	return paletteIndex;
+}
+
+///=====================================================
+/// Rewrites every index at the new width, remapping palette indexes if a remap is given
+///=====================================================
+void PalettedBlockStorage::Repack(unsigned char newBitsPerBlockExponent, const unsigned char* newPaletteIndexForOld){
+	const bool wasUniform = IsUniform();
+	std::vector<unsigned int> oldPackedIndexes;
+	oldPackedIndexes.swap(m_packedIndexStorage); //so narrowing releases the wider array
+	const unsigned int oldWordShift = m_wordShift;
+	const unsigned int oldSlotMask = m_slotMask;
+	const unsigned int oldPaletteIndexMask = m_paletteIndexMask;
+	const unsigned char oldBitsPerBlockExponent = m_bitsPerBlockExponent;
+
+	SetBitsPerBlockExponent(newBitsPerBlockExponent);
+	m_packedIndexStorage.assign(m_numBlocks >> m_wordShift, 0);
+	m_packedIndexes = &m_packedIndexStorage[0];
+
+	if (wasUniform)
+		return; //every index was 0, which the new array already holds
+
+	for (int index = 0; index < m_numBlocks; ++index){
+		unsigned int oldWord = oldPackedIndexes[index >> oldWordShift];
+		unsigned int oldBitOffset = (index & oldSlotMask) << oldBitsPerBlockExponent;
+		unsigned int paletteIndex = (oldWord >> oldBitOffset) & oldPaletteIndexMask;
+		if (newPaletteIndexForOld != NULL)
+			paletteIndex = newPaletteIndexForOld[paletteIndex];
+		if (paletteIndex != 0)
+			SetPaletteIndex(index, paletteIndex);
+	}
+}
+
+///=====================================================
+/// Doubles the bits used per block, or leaves uniform mode at 1 bit per block
+///=====================================================
+void PalettedBlockStorage::Widen(){
+	if (IsUniform()){
+		Repack(0, NULL);
+		return;
+	}
+
+	assert(m_bitsPerBlockExponent < MAX_BITS_PER_BLOCK_EXPONENT);
+	Repack(m_bitsPerBlockExponent + 1, NULL);
+}
+
+///=====================================================
+/// Drops palette entries no block uses anymore and shrinks to the narrowest width
+///=====================================================
+void PalettedBlockStorage::Compact(){
+	if (IsUniform())
+		return;
+
+	int useCounts[MAX_PALETTE_ENTRIES];
+	memset(useCounts, 0, sizeof(useCounts));
+	for (int index = 0; index < m_numBlocks; ++index){
+		++useCounts[GetPaletteIndex(index)];
+	}
+
+	unsigned char newPaletteIndexForOld[MAX_PALETTE_ENTRIES];
+	unsigned char newPalette[MAX_PALETTE_ENTRIES];
+	unsigned char newPaletteSize = 0;
+	for (int oldPaletteIndex = 0; oldPaletteIndex < m_paletteSize; ++oldPaletteIndex){
+		if (useCounts[oldPaletteIndex] != 0){
+			newPaletteIndexForOld[oldPaletteIndex] = newPaletteSize;
+			newPalette[newPaletteSize++] = m_palette[oldPaletteIndex];
+		}
+	}
+
+	if (newPaletteSize == 1){
+		Fill(newPalette[0]);
+		return;
+	}
+	if (newPaletteSize == m_paletteSize)
+		return;
+
+	unsigned char newBitsPerBlockExponent = 0;
+	while ((1 << (1 << newBitsPerBlockExponent)) < newPaletteSize){
+		++newBitsPerBlockExponent;
+	}
+
+	memset(m_paletteIndexForType, PALETTE_INDEX_NONE, sizeof(m_paletteIndexForType));
+	for (unsigned char paletteIndex = 0; paletteIndex < newPaletteSize; ++paletteIndex){
+		m_palette[paletteIndex] = newPalette[paletteIndex];
+		m_paletteIndexForType[newPalette[paletteIndex]] = paletteIndex;
+	}
+	m_paletteSize = newPaletteSize;
+
+	Repack(newBitsPerBlockExponent, newPaletteIndexForOld);
+}
+
+///=====================================================
+/// explicit rather than a copy constructor, so storages are never copied by accident
+///=====================================================
+void PalettedBlockStorage::CopyFrom(const PalettedBlockStorage& other){
+	m_numBlocks = other.m_numBlocks;
+	m_bitsPerBlockExponent = other.m_bitsPerBlockExponent;
+	m_paletteSize = other.m_paletteSize;
+	m_wordShift = other.m_wordShift;
+	m_slotMask = other.m_slotMask;
+	m_paletteIndexMask = other.m_paletteIndexMask;
+	memcpy(m_palette, other.m_palette, sizeof(m_palette));
+	memcpy(m_paletteIndexForType, other.m_paletteIndexForType, sizeof(m_paletteIndexForType));
+	m_uniformWord = other.m_uniformWord;
+	m_packedIndexStorage = other.m_packedIndexStorage;
+	m_packedIndexes = other.IsUniform() ? &m_uniformWord : &m_packedIndexStorage[0];
+}
+
+///=====================================================
+/// 
+///=====================================================
+size_t PalettedBlockStorage::GetNumBytesUsed() const{
+	return sizeof(*this) + m_packedIndexStorage.capacity() * sizeof(m_packedIndexStorage[0]);
+}
@@ -0,0 +1,100 @@
+//=====================================================
+// PalettedBlockStorage.hpp
+// by Andrew Socha
+//=====================================================
+
+#pragma once
+
+#ifndef __included_PalettedBlockStorage__
+#define __included_PalettedBlockStorage__
+
+#include <vector>
+#include <cstddef>
+
+const int MAX_PALETTE_ENTRIES = 255;
+const unsigned char PALETTE_INDEX_NONE = 0xFF;
+const int PACKED_WORD_BITS_EXPONENT = 5; //32 bits per packed word
+
+///=====================================================
+/// Stores one block type per block as an index into a small per-storage palette.
+/// Indexes are bit-packed at 1, 2, 4 or 8 bits per block, widening automatically
+/// whenever a new type no longer fits in the current width.
+/// SetType never drops a palette entry by itself; unused entries are only dropped by Compact,
+/// which chunks call after generating or loading, and which SetType calls before it would widen.
+/// A storage holding a single type is uniform and allocates no index array at all.
+///=====================================================
+class PalettedBlockStorage{
+private:
+	int m_numBlocks;
+	unsigned char m_bitsPerBlockExponent; //bits per block = 1 << exponent
+	unsigned char m_paletteSize;
+	unsigned int m_wordShift;
+	unsigned int m_slotMask;
+	unsigned int m_paletteIndexMask; //0 while uniform
+	unsigned char m_palette[MAX_PALETTE_ENTRIES];
+	unsigned char m_paletteIndexForType[256];
+	unsigned int* m_packedIndexes;
+	unsigned int m_uniformWord; //every lookup reads this word while uniform
+	std::vector<unsigned int> m_packedIndexStorage;
+
+	PalettedBlockStorage(const PalettedBlockStorage&);
+	PalettedBlockStorage& operator=(const PalettedBlockStorage&);
+
+	void SetUniformLayout();
+	void SetBitsPerBlockExponent(unsigned char bitsPerBlockExponent);
+	void Repack(unsigned char newBitsPerBlockExponent, const unsigned char* newPaletteIndexForOld);
+	void Widen();
+	unsigned char GetOrAddPaletteIndex(unsigned char type);
+	unsigned int GetPaletteIndex(int index) const;
+	void SetPaletteIndex(int index, unsigned int paletteIndex);
+
+public:
+	explicit PalettedBlockStorage(int numBlocks);
+
+	unsigned char GetType(int index) const;
+	void SetType(int index, unsigned char type);
+	void Fill(unsigned char type);
+	void Compact();
+	void CopyFrom(const PalettedBlockStorage& other);
+
+	inline bool IsUniform() const{ return m_paletteIndexMask == 0; }
+	inline unsigned char GetUniformType() const{ return m_palette[0]; }
+	inline int GetBitsPerBlock() const{ return IsUniform() ? 0 : 1 << m_bitsPerBlockExponent; }
+	inline int GetPaletteSize() const{ return m_paletteSize; }
+	size_t GetNumBytesUsed() const;
+};
+
+///=====================================================
+/// 
+///=====================================================
+inline unsigned int PalettedBlockStorage::GetPaletteIndex(int index) const{
+	unsigned int word = m_packedIndexes[index >> m_wordShift];
+	unsigned int bitOffset = (index & m_slotMask) << m_bitsPerBlockExponent;
+	return (word >> bitOffset) & m_paletteIndexMask;
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline void PalettedBlockStorage::SetPaletteIndex(int index, unsigned int paletteIndex){
+	unsigned int& word = m_packedIndexes[index >> m_wordShift];
+	unsigned int bitOffset = (index & m_slotMask) << m_bitsPerBlockExponent;
+	word &= ~(m_paletteIndexMask << bitOffset);
+	word |= paletteIndex << bitOffset;
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline unsigned char PalettedBlockStorage::GetType(int index) const{
+	return m_palette[GetPaletteIndex(index)];
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline void PalettedBlockStorage::SetType(int index, unsigned char type){
+	SetPaletteIndex(index, GetOrAddPaletteIndex(type));
+}
+
+#endif
@@ -0,0 +1,290 @@
+//=====================================================
+// PalettedBlockStorageTests.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "TestHarness.hpp"
+#include "Chunk.hpp"
+#include "Engine/Time/Time.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+const int NUM_RANDOM_STORAGE_EDITS = 20000;
+const int NUM_STORAGE_BENCHMARK_PASSES = 200;
+const int STORAGE_BENCHMARK_CHUNKS_WIDE = 3;
+
+///=====================================================
+/// 
+///=====================================================
+static unsigned int GetNextTestRandom(unsigned int& state){
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+///=====================================================
+/// 
+///=====================================================
+static bool DoesStorageMatchFlatTypes(const PalettedBlockStorage& storage, const std::vector<unsigned char>& flatTypes){
+	for (int index = 0; index < (int)flatTypes.size(); ++index){
+		if (storage.GetType(index) != flatTypes[index])
+			return false;
+	}
+	return true;
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void TestUniformStorage(){
+	PalettedBlockStorage storage(BLOCKS_PER_SECTION);
+	TEST_CHECK(storage.IsUniform());
+	TEST_CHECK(storage.GetBitsPerBlock() == 0);
+	TEST_CHECK(storage.GetPaletteSize() == 1);
+	TEST_CHECK(storage.GetNumBytesUsed() == sizeof(storage));
+	TEST_CHECK(storage.GetType(0) == 0 && storage.GetType(BLOCKS_PER_SECTION - 1) == 0);
+
+	storage.SetType(7, BT_STONE);
+	TEST_CHECK(!storage.IsUniform());
+	TEST_CHECK(storage.GetNumBytesUsed() > sizeof(storage));
+
+	storage.Fill(BT_WATER);
+	TEST_CHECK(storage.IsUniform());
+	TEST_CHECK(storage.GetUniformType() == BT_WATER);
+	TEST_CHECK(storage.GetType(7) == BT_WATER);
+	TEST_CHECK(storage.GetNumBytesUsed() == sizeof(storage));
+
+	storage.SetType(7, BT_WATER);
+	TEST_CHECK(storage.IsUniform());
+}
+
+///=====================================================
+/// Each new type past a power of two should double the width without disturbing the types already stored
+///=====================================================
+static void TestStorageWidens(){
+	PalettedBlockStorage storage(BLOCKS_PER_SECTION);
+	std::vector<unsigned char> flatTypes(BLOCKS_PER_SECTION, 0);
+
+	const int expectedBitsAfterType[] = {0, 1, 2, 2, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 8};
+	bool didKeepTypes = true;
+	bool didWidenOnTime = true;
+	for (int type = 1; type <= 16; ++type){
+		for (int index = type; index < BLOCKS_PER_SECTION; index += 17){
+			storage.SetType(index, (unsigned char)type);
+			flatTypes[index] = (unsigned char)type;
+		}
+		didKeepTypes = didKeepTypes && DoesStorageMatchFlatTypes(storage, flatTypes);
+		didWidenOnTime = didWidenOnTime && storage.GetBitsPerBlock() == expectedBitsAfterType[type];
+	}
+	TEST_CHECK(didKeepTypes);
+	TEST_CHECK(didWidenOnTime);
+	TEST_CHECK(storage.GetPaletteSize() == 17);
+	TEST_CHECK(storage.GetNumBytesUsed() >= sizeof(storage) + BLOCKS_PER_SECTION);
+
+	for (int type = 17; type < MAX_PALETTE_ENTRIES; ++type){
+		storage.SetType(type, (unsigned char)type);
+		flatTypes[type] = (unsigned char)type;
+	}
+	TEST_CHECK(storage.GetPaletteSize() == MAX_PALETTE_ENTRIES);
+	TEST_CHECK(DoesStorageMatchFlatTypes(storage, flatTypes));
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void TestStorageCompacts(){
+	PalettedBlockStorage storage(BLOCKS_PER_SECTION);
+	std::vector<unsigned char> flatTypes(BLOCKS_PER_SECTION, BT_STONE);
+	storage.Fill(BT_STONE);
+	for (int type = BT_GRASS; type <= BT_SNOW; ++type){
+		storage.SetType(type * 100, (unsigned char)type);
+		flatTypes[type * 100] = (unsigned char)type;
+	}
+	TEST_CHECK(storage.GetBitsPerBlock() == 4);
+
+	//leave stone, dirt and glowstone
+	for (int type = BT_GRASS; type <= BT_SNOW; ++type){
+		if (type != BT_DIRT && type != BT_GLOWSTONE){
+			storage.SetType(type * 100, BT_STONE);
+			flatTypes[type * 100] = BT_STONE;
+		}
+	}
+	TEST_CHECK(storage.GetBitsPerBlock() == 4); //SetType alone never drops entries
+
+	storage.Compact();
+	TEST_CHECK(storage.GetPaletteSize() == 3);
+	TEST_CHECK(storage.GetBitsPerBlock() == 2);
+	TEST_CHECK(storage.GetNumBytesUsed() == sizeof(storage) + BLOCKS_PER_SECTION * 2 / 8);
+	TEST_CHECK(DoesStorageMatchFlatTypes(storage, flatTypes));
+
+	storage.SetType(BT_DIRT * 100, BT_STONE);
+	storage.SetType(BT_GLOWSTONE * 100, BT_STONE);
+	storage.Compact();
+	TEST_CHECK(storage.IsUniform());
+	TEST_CHECK(storage.GetUniformType() == BT_STONE);
+	TEST_CHECK(storage.GetNumBytesUsed() == sizeof(storage));
+
+	storage.Compact();
+	TEST_CHECK(storage.IsUniform());
+}
+
+///=====================================================
+/// A type edited out of a full palette should make room for the next one instead of widening
+///=====================================================
+static void TestStorageCompactsBeforeWidening(){
+	PalettedBlockStorage storage(BLOCKS_PER_SECTION);
+	storage.Fill(BT_AIR);
+	storage.SetType(10, BT_SAND);
+	TEST_CHECK(storage.GetBitsPerBlock() == 1);
+
+	storage.SetType(10, BT_AIR);
+	storage.SetType(20, BT_ICE);
+	TEST_CHECK(storage.GetBitsPerBlock() == 1);
+	TEST_CHECK(storage.GetPaletteSize() == 2);
+	TEST_CHECK(storage.GetType(10) == BT_AIR && storage.GetType(20) == BT_ICE);
+
+	storage.SetType(30, BT_SNOW);
+	TEST_CHECK(storage.GetBitsPerBlock() == 2);
+	TEST_CHECK(storage.GetType(20) == BT_ICE && storage.GetType(30) == BT_SNOW);
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void TestStorageCopies(){
+	PalettedBlockStorage packedStorage(BLOCKS_PER_SECTION);
+	std::vector<unsigned char> flatTypes(BLOCKS_PER_SECTION, 0);
+	for (int index = 0; index < BLOCKS_PER_SECTION; index += 3){
+		flatTypes[index] = (unsigned char)(index % 5);
+		packedStorage.SetType(index, flatTypes[index]);
+	}
+
+	PalettedBlockStorage copy(BLOCKS_PER_SECTION);
+	copy.CopyFrom(packedStorage);
+	TEST_CHECK(DoesStorageMatchFlatTypes(copy, flatTypes));
+	TEST_CHECK(copy.GetBitsPerBlock() == packedStorage.GetBitsPerBlock());
+
+	copy.SetType(0, BT_GLOWSTONE);
+	packedStorage.SetType(3, BT_ICE);
+	TEST_CHECK(packedStorage.GetType(0) == flatTypes[0]);
+	TEST_CHECK(copy.GetType(3) == flatTypes[3]);
+
+	PalettedBlockStorage uniformStorage(BLOCKS_PER_SECTION);
+	uniformStorage.Fill(BT_WATER);
+	copy.CopyFrom(uniformStorage);
+	TEST_CHECK(copy.IsUniform());
+	TEST_CHECK(copy.GetType(0) == BT_WATER && copy.GetType(BLOCKS_PER_SECTION - 1) == BT_WATER);
+
+	copy.SetType(5, BT_SAND);
+	TEST_CHECK(uniformStorage.IsUniform());
+	TEST_CHECK(copy.GetType(5) == BT_SAND && copy.GetType(6) == BT_WATER);
+}
+
+///=====================================================
+/// Random edits with a growing set of types, compacting now and then, checked against a flat array
+///=====================================================
+static void TestRandomEditsMatchFlatTypes(){
+	PalettedBlockStorage storage(BLOCKS_PER_SECTION);
+	std::vector<unsigned char> flatTypes(BLOCKS_PER_SECTION, 0);
+	unsigned int state = 12345u;
+
+	bool didMatch = true;
+	for (int edit = 0; edit < NUM_RANDOM_STORAGE_EDITS; ++edit){
+		const int index = (int)(GetNextTestRandom(state) % BLOCKS_PER_SECTION);
+		const int numTypes = 2 + edit * 40 / NUM_RANDOM_STORAGE_EDITS;
+		const unsigned char type = (unsigned char)(GetNextTestRandom(state) % numTypes);
+		storage.SetType(index, type);
+		flatTypes[index] = type;
+
+		if (edit % 2000 == 1999){
+			storage.Compact();
+			didMatch = didMatch && DoesStorageMatchFlatTypes(storage, flatTypes);
+		}
+	}
+	TEST_CHECK(didMatch);
+	TEST_CHECK(DoesStorageMatchFlatTypes(storage, flatTypes));
+}
+
+///=====================================================
+/// Block type bytes per generated chunk, and block type reads and writes, against a flat byte per block
+///=====================================================
+static void BenchmarkBlockStorage(){
+	std::vector<Chunk*> chunks;
+	size_t numPalettedBytes = 0;
+	for (int chunkY = 0; chunkY < STORAGE_BENCHMARK_CHUNKS_WIDE; ++chunkY){
+		for (int chunkX = 0; chunkX < STORAGE_BENCHMARK_CHUNKS_WIDE; ++chunkX){
+			Chunk* chunk = new Chunk();
+			chunk->m_worldCoordsMins = Chunk::GetWorldCoordsAtChunkCoords(ChunkCoords(chunkX, chunkY));
+			chunk->PopulateWithBlocks();
+			for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+				numPalettedBytes += chunk->m_sections[section].m_blockTypes.GetNumBytesUsed();
+			}
+			chunks.push_back(chunk);
+		}
+	}
+	const size_t numFlatBytes = chunks.size() * BLOCKS_PER_CHUNK;
+	printf("  %d generated chunks: paletted %d bytes, flat %d bytes (%.1f%%)\n", (int)chunks.size(), (int)numPalettedBytes, (int)numFlatBytes, 100.0 * numPalettedBytes / numFlatBytes);
+
+	Chunk& chunk = *chunks[0];
+	std::vector<unsigned char> flatTypes(BLOCKS_PER_CHUNK);
+	for (int index = 0; index < BLOCKS_PER_CHUNK; ++index){
+		flatTypes[index] = chunk.GetBlockType((BlockIndex)index);
+	}
+
+	unsigned int palettedSum = 0;
+	double startSeconds = GetCurrentSeconds();
+	for (int pass = 0; pass < NUM_STORAGE_BENCHMARK_PASSES; ++pass){
+		for (int index = 0; index < BLOCKS_PER_CHUNK; ++index){
+			palettedSum += chunk.GetBlockType((BlockIndex)index);
+		}
+	}
+	const double palettedReadSeconds = GetCurrentSeconds() - startSeconds;
+
+	unsigned int flatSum = 0;
+	startSeconds = GetCurrentSeconds();
+	for (int pass = 0; pass < NUM_STORAGE_BENCHMARK_PASSES; ++pass){
+		for (int index = 0; index < BLOCKS_PER_CHUNK; ++index){
+			flatSum += flatTypes[index];
+		}
+	}
+	const double flatReadSeconds = GetCurrentSeconds() - startSeconds;
+	TEST_CHECK(palettedSum == flatSum);
+
+	startSeconds = GetCurrentSeconds();
+	for (int pass = 0; pass < NUM_STORAGE_BENCHMARK_PASSES; ++pass){
+		for (int index = 0; index < BLOCKS_PER_CHUNK; ++index){
+			chunk.SetBlockType((BlockIndex)index, (unsigned char)(flatTypes[index] ^ (pass & 1)));
+		}
+	}
+	const double palettedWriteSeconds = GetCurrentSeconds() - startSeconds;
+
+	startSeconds = GetCurrentSeconds();
+	for (int pass = 0; pass < NUM_STORAGE_BENCHMARK_PASSES; ++pass){
+		for (int index = 0; index < BLOCKS_PER_CHUNK; ++index){
+			flatTypes[index] = (unsigned char)(flatTypes[index] ^ (pass & 1));
+		}
+	}
+	const double flatWriteSeconds = GetCurrentSeconds() - startSeconds;
+
+	const double numBlocks = (double)NUM_STORAGE_BENCHMARK_PASSES * BLOCKS_PER_CHUNK;
+	printf("  reads: paletted %.0f M blocks/sec, flat %.0f M blocks/sec\n", numBlocks / palettedReadSeconds * 1e-6, numBlocks / flatReadSeconds * 1e-6);
+	printf("  writes: paletted %.0f M blocks/sec, flat %.0f M blocks/sec\n", numBlocks / palettedWriteSeconds * 1e-6, numBlocks / flatWriteSeconds * 1e-6);
+
+	for (std::vector<Chunk*>::iterator chunkIter = chunks.begin(); chunkIter != chunks.end(); ++chunkIter){
+		delete *chunkIter;
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+void RunPalettedBlockStorageTests(){
+	printf("Paletted block storage\n");
+	TestUniformStorage();
+	TestStorageWidens();
+	TestStorageCompacts();
+	TestStorageCompactsBeforeWidening();
+	TestStorageCopies();
+	TestRandomEditsMatchFlatTypes();
+	BenchmarkBlockStorage();
+}
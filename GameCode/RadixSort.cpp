@@ -0,0 +1,60 @@
+//=====================================================
+// RadixSort.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "RadixSort.hpp"
+#include <string.h>
+
+const int RADIX_BITS = 8;
+const int RADIX_SIZE = 1 << RADIX_BITS;
+const int NUM_RADIX_PASSES = 32 / RADIX_BITS;
+
+///=====================================================
+/// 
+///=====================================================
+void RadixSortIndexesByKey(const unsigned int* keys, int numKeys, std::vector<unsigned int>& out_sortedIndexes){
+	static std::vector<unsigned int> s_scratchIndexes;
+
+	out_sortedIndexes.resize(numKeys);
+	if (numKeys == 0)
+		return;
+	s_scratchIndexes.resize(numKeys);
+
+	//count every digit up front, so each pass only has to scatter
+	int digitCounts[NUM_RADIX_PASSES][RADIX_SIZE];
+	memset(digitCounts, 0, sizeof(digitCounts));
+	for (int keyIndex = 0; keyIndex < numKeys; ++keyIndex){
+		out_sortedIndexes[keyIndex] = (unsigned int)keyIndex;
+		for (int pass = 0; pass < NUM_RADIX_PASSES; ++pass){
+			++digitCounts[pass][(keys[keyIndex] >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1)];
+		}
+	}
+
+	unsigned int* sourceIndexes = &out_sortedIndexes[0];
+	unsigned int* destIndexes = &s_scratchIndexes[0];
+	for (int pass = 0; pass < NUM_RADIX_PASSES; ++pass){
+		const int shift = pass * RADIX_BITS;
+		if (digitCounts[pass][(keys[0] >> shift) & (RADIX_SIZE - 1)] == numKeys)
+			continue; //every key shares this digit, so the pass wouldn't move anything
+
+		int digitOffsets[RADIX_SIZE];
+		int offset = 0;
+		for (int digit = 0; digit < RADIX_SIZE; ++digit){
+			digitOffsets[digit] = offset;
+			offset += digitCounts[pass][digit];
+		}
+
+		for (int position = 0; position < numKeys; ++position){
+			unsigned int keyIndex = sourceIndexes[position];
+			destIndexes[digitOffsets[(keys[keyIndex] >> shift) & (RADIX_SIZE - 1)]++] = keyIndex;
+		}
+
+		unsigned int* swapIndexes = sourceIndexes;
+		sourceIndexes = destIndexes;
+		destIndexes = swapIndexes;
+	}
+
+	if (sourceIndexes != &out_sortedIndexes[0])
+		memcpy(&out_sortedIndexes[0], sourceIndexes, numKeys * sizeof(unsigned int));
+}
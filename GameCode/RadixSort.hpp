@@ -0,0 +1,20 @@
+//=====================================================
+// RadixSort.hpp
+// by Andrew Socha
+//=====================================================
+
+#pragma once
+
+#ifndef __included_RadixSort__
+#define __included_RadixSort__
+
+#include <vector>
+
+///=====================================================
+/// Fills out_sortedIndexes with 0..numKeys-1 ordered by ascending key, using an LSD radix sort at 8 bits per pass.
+/// Passes where every key has the same byte are skipped, and equal keys keep their original order.
+/// Uses shared scratch memory, so only call it from the main thread.
+///=====================================================
+void RadixSortIndexesByKey(const unsigned int* keys, int numKeys, std::vector<unsigned int>& out_sortedIndexes);
+
+#endif
@@ -0,0 +1,244 @@
+//=====================================================
+// RadixSortTests.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "TestHarness.hpp"
+#include "RadixSort.hpp"
+#include "ChunkMeshSnapshot.hpp"
+#include "Engine/Time/Time.hpp"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+const int NUM_SORT_TEST_KEYS = 20000;
+const int WATER_RING_RADIUS = 4; //a 9x9 ring
+const int WATER_SHEET_MIN_HEIGHT = 48;
+const int NUM_WATER_SHEETS = 8;
+const int NUM_WATER_BENCHMARK_FRAMES = 16;
+const float WATER_BENCHMARK_CAMERA_STEP = 0.25f; //blocks per frame, so the camera crosses into a new block every fourth frame
+
+static const unsigned int* s_stableSortKeys = NULL;
+static Vec3 s_oldSortCameraPosition;
+
+///=====================================================
+/// 
+///=====================================================
+static unsigned int GetNextTestRandom(unsigned int& state){
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+///=====================================================
+/// 
+///=====================================================
+static bool IsKeyIndexLess(unsigned int firstKeyIndex, unsigned int secondKeyIndex){
+	return s_stableSortKeys[firstKeyIndex] < s_stableSortKeys[secondKeyIndex];
+}
+
+///=====================================================
+/// 
+///=====================================================
+static bool DoesRadixSortMatchStableSort(const std::vector<unsigned int>& keys){
+	std::vector<unsigned int> expectedOrder(keys.size());
+	for (size_t keyIndex = 0; keyIndex < keys.size(); ++keyIndex){
+		expectedOrder[keyIndex] = (unsigned int)keyIndex;
+	}
+	s_stableSortKeys = keys.empty() ? NULL : &keys[0];
+	std::stable_sort(expectedOrder.begin(), expectedOrder.end(), IsKeyIndexLess);
+
+	std::vector<unsigned int> sortedIndexes(3, 7u); //stale contents should be overwritten
+	RadixSortIndexesByKey(keys.empty() ? NULL : &keys[0], (int)keys.size(), sortedIndexes);
+	return sortedIndexes == expectedOrder;
+}
+
+///=====================================================
+/// Keys that vary in every byte, in only one byte, not at all, or like the flipped float distances the translucent sort uses
+///=====================================================
+static void TestRadixSortMatchesStableSort(){
+	TEST_CHECK(DoesRadixSortMatchStableSort(std::vector<unsigned int>()));
+	TEST_CHECK(DoesRadixSortMatchStableSort(std::vector<unsigned int>(1, 42u)));
+	TEST_CHECK(DoesRadixSortMatchStableSort(std::vector<unsigned int>(NUM_SORT_TEST_KEYS, 0xDEADBEEFu)));
+
+	unsigned int state = 99u;
+	std::vector<unsigned int> keys(NUM_SORT_TEST_KEYS);
+	for (int keyIndex = 0; keyIndex < NUM_SORT_TEST_KEYS; ++keyIndex){
+		keys[keyIndex] = GetNextTestRandom(state) ^ (GetNextTestRandom(state) << 24);
+	}
+	TEST_CHECK(DoesRadixSortMatchStableSort(keys));
+
+	for (int byte = 0; byte < 4; ++byte){
+		for (int keyIndex = 0; keyIndex < NUM_SORT_TEST_KEYS; ++keyIndex){
+			keys[keyIndex] = 0x12345678u ^ ((GetNextTestRandom(state) & 0xFFu) << (byte * 8));
+		}
+		TEST_CHECK(DoesRadixSortMatchStableSort(keys));
+	}
+
+	//few distinct keys, so stability decides most of the order
+	for (int keyIndex = 0; keyIndex < NUM_SORT_TEST_KEYS; ++keyIndex){
+		keys[keyIndex] = (GetNextTestRandom(state) % 5) << 20;
+	}
+	TEST_CHECK(DoesRadixSortMatchStableSort(keys));
+
+	for (int keyIndex = 0; keyIndex < NUM_SORT_TEST_KEYS; ++keyIndex){
+		float distanceSquared = (float)(GetNextTestRandom(state) % 4096) * 0.25f;
+		unsigned int distanceBits;
+		memcpy(&distanceBits, &distanceSquared, sizeof(distanceBits));
+		keys[keyIndex] = ~distanceBits;
+	}
+	TEST_CHECK(DoesRadixSortMatchStableSort(keys));
+}
+
+///=====================================================
+/// the per-comparison sort the translucent faces used before they were keyed
+///=====================================================
+static bool IsFaceFurtherFromOldSortCamera(const Vertex3D_PCT_Face& vertexFace1, const Vertex3D_PCT_Face& vertexFace2){
+	const Vec3 face1MinsPlusMaxes = vertexFace1.vertexes[0].m_position + vertexFace1.vertexes[2].m_position;
+	const Vec3 face2MinsPlusMaxes = vertexFace2.vertexes[0].m_position + vertexFace2.vertexes[2].m_position;
+	const Vec3 center1(face1MinsPlusMaxes * 0.5f);
+	const Vec3 center2(face2MinsPlusMaxes * 0.5f);
+	float distanceSquared1 = CalcDistanceSquared(center1, s_oldSortCameraPosition);
+	float distanceSquared2 = CalcDistanceSquared(center2, s_oldSortCameraPosition);
+	return (distanceSquared1 > distanceSquared2);
+}
+
+///=====================================================
+/// stacked sheets of water with air between them, so every sheet shows its top and bottom faces
+///=====================================================
+static void BuildWaterSheetFaces(PackedBlockVertexFaces* out_translucentVertexFaces){
+	Chunk* chunk = new Chunk();
+	for (int sheet = 0; sheet < NUM_WATER_SHEETS; ++sheet){
+		for (int column = 0; column < BLOCKS_PER_CHUNK_LAYER; ++column){
+			chunk->SetBlockType((BlockIndex)(column + (WATER_SHEET_MIN_HEIGHT + sheet * 2) * BLOCKS_PER_CHUNK_LAYER), BT_WATER);
+		}
+	}
+
+	PackedBlockVertexFaces opaqueVertexFaces[SECTIONS_PER_CHUNK];
+	ChunkMeshSnapshot* snapshot = new ChunkMeshSnapshot();
+	snapshot->CopyFromChunk(*chunk, ALL_SECTIONS_MASK);
+	snapshot->BuildSectionMeshes(ALL_SECTIONS_MASK, opaqueVertexFaces, out_translucentVertexFaces);
+	delete snapshot;
+	delete chunk;
+}
+
+///=====================================================
+/// 
+///=====================================================
+static float GetFaceCenterDistanceSquared(const Vertex3D_PCT_Face& vertexFace, const Vec3& cameraPosition){
+	const Vec3 center((vertexFace.vertexes[0].m_position + vertexFace.vertexes[2].m_position) * 0.5f);
+	return CalcDistanceSquared(center, cameraPosition);
+}
+
+///=====================================================
+/// The chunk's keyed order should put the faces furthest first, as the comparison sort did, from inside or outside the chunk
+///=====================================================
+static void TestTranslucentFacesSortFurthestFirst(const PackedBlockVertexFaces* translucentVertexFaces, const PackedBlockVertexFaces& chunkTranslucentVertexFaces){
+	OpenGLRenderer renderer;
+	PackedBlockVertexFaces opaqueVertexFaces[SECTIONS_PER_CHUNK];
+	Chunk* chunk = new Chunk();
+	chunk->m_worldCoordsMins = Chunk::GetWorldCoordsAtChunkCoords(ChunkCoords(1, -1));
+	chunk->UploadSectionMeshes(&renderer, ALL_SECTIONS_MASK, opaqueVertexFaces, translucentVertexFaces);
+
+	Vertex3D_PCT_Faces unpackedVertexFaces;
+	UnpackVertexFaces(chunkTranslucentVertexFaces, chunk->m_worldCoordsMins, unpackedVertexFaces);
+	const WorldCoords cameraPositions[3] = {chunk->m_worldCoordsMins + Vec3(5.3f, 9.8f, 52.5f), chunk->m_worldCoordsMins + Vec3(-20.0f, 3.0f, 90.0f), Vec3(0.5f, 0.5f, 0.5f)};
+	for (int camera = 0; camera < 3; ++camera){
+		Chunk::s_lastKnownCameraPosition = cameraPositions[camera];
+		chunk->SortTranslucentFacesFurthestToNearest();
+		const std::vector<unsigned int>& sortOrder = chunk->GetTranslucentSortOrder();
+		TEST_CHECK(sortOrder.size() == unpackedVertexFaces.size());
+
+		bool isFurthestFirst = sortOrder.size() == unpackedVertexFaces.size();
+		for (size_t position = 1; position < sortOrder.size() && isFurthestFirst; ++position){
+			isFurthestFirst = GetFaceCenterDistanceSquared(unpackedVertexFaces[sortOrder[position - 1]], cameraPositions[camera]) >= GetFaceCenterDistanceSquared(unpackedVertexFaces[sortOrder[position]], cameraPositions[camera]);
+		}
+		TEST_CHECK(isFurthestFirst);
+	}
+
+	chunk->DeleteBuffers(&renderer);
+	delete chunk;
+}
+
+///=====================================================
+/// milliseconds per frame to order and unpack the translucent faces of every ring chunk, as RenderWithVAs does, along the given camera path
+///=====================================================
+static double TimeKeyedSorting(const std::vector<Chunk*>& ringChunks, const PackedBlockVertexFaces& chunkTranslucentVertexFaces, const std::vector<WorldCoords>& cameraPositions){
+	Vertex3D_PCT_Faces unpackedVertexFaces;
+	const double startSeconds = GetCurrentSeconds();
+	for (std::vector<WorldCoords>::const_iterator cameraIter = cameraPositions.begin(); cameraIter != cameraPositions.end(); ++cameraIter){
+		Chunk::s_lastKnownCameraPosition = *cameraIter;
+		for (std::vector<Chunk*>::const_iterator chunkIter = ringChunks.begin(); chunkIter != ringChunks.end(); ++chunkIter){
+			(*chunkIter)->SortTranslucentFacesFurthestToNearest();
+			UnpackVertexFacesInOrder(chunkTranslucentVertexFaces, (*chunkIter)->GetTranslucentSortOrder(), (*chunkIter)->m_worldCoordsMins, unpackedVertexFaces);
+		}
+	}
+	return (GetCurrentSeconds() - startSeconds) * 1000.0 / cameraPositions.size();
+}
+
+///=====================================================
+/// Per frame cost of ordering the translucent faces of a 9x9 ring of water-heavy chunks while the camera flies over them:
+/// sorting the unpacked faces by comparison as before, then keyed and radix sorted, moving a block or a quarter block per frame.
+/// Every variant includes unpacking the faces, which the renderer needs either way.
+///=====================================================
+static void BenchmarkWaterRingSorting(const PackedBlockVertexFaces* translucentVertexFaces, const PackedBlockVertexFaces& chunkTranslucentVertexFaces){
+	PackedBlockVertexFaces opaqueVertexFaces[SECTIONS_PER_CHUNK];
+	OpenGLRenderer renderer;
+	std::vector<Chunk*> ringChunks;
+	for (int chunkY = -WATER_RING_RADIUS; chunkY <= WATER_RING_RADIUS; ++chunkY){
+		for (int chunkX = -WATER_RING_RADIUS; chunkX <= WATER_RING_RADIUS; ++chunkX){
+			Chunk* chunk = new Chunk();
+			chunk->m_worldCoordsMins = Chunk::GetWorldCoordsAtChunkCoords(ChunkCoords(chunkX, chunkY));
+			chunk->UploadSectionMeshes(&renderer, ALL_SECTIONS_MASK, opaqueVertexFaces, translucentVertexFaces);
+			ringChunks.push_back(chunk);
+		}
+	}
+
+	const float cameraHeight = (float)(WATER_SHEET_MIN_HEIGHT + NUM_WATER_SHEETS * 2) + 3.5f;
+	std::vector<WorldCoords> blockStepCameraPositions;
+	std::vector<WorldCoords> quarterStepCameraPositions;
+	for (int frame = 0; frame < NUM_WATER_BENCHMARK_FRAMES; ++frame){
+		blockStepCameraPositions.push_back(WorldCoords(0.3f + (float)frame, 0.6f, cameraHeight));
+		quarterStepCameraPositions.push_back(WorldCoords(0.3f + frame * WATER_BENCHMARK_CAMERA_STEP, 0.6f, cameraHeight));
+	}
+
+	Vertex3D_PCT_Faces unpackedVertexFaces;
+	const double startSeconds = GetCurrentSeconds();
+	for (std::vector<WorldCoords>::const_iterator cameraIter = blockStepCameraPositions.begin(); cameraIter != blockStepCameraPositions.end(); ++cameraIter){
+		s_oldSortCameraPosition = *cameraIter;
+		for (std::vector<Chunk*>::const_iterator chunkIter = ringChunks.begin(); chunkIter != ringChunks.end(); ++chunkIter){
+			UnpackVertexFaces(chunkTranslucentVertexFaces, (*chunkIter)->m_worldCoordsMins, unpackedVertexFaces);
+			std::sort(unpackedVertexFaces.begin(), unpackedVertexFaces.end(), IsFaceFurtherFromOldSortCamera);
+		}
+	}
+	const double comparisonSortMilliseconds = (GetCurrentSeconds() - startSeconds) * 1000.0 / NUM_WATER_BENCHMARK_FRAMES;
+	const double blockStepMilliseconds = TimeKeyedSorting(ringChunks, chunkTranslucentVertexFaces, blockStepCameraPositions);
+	const double quarterStepMilliseconds = TimeKeyedSorting(ringChunks, chunkTranslucentVertexFaces, quarterStepCameraPositions);
+
+	printf("  %d chunks, %d water faces each\n", (int)ringChunks.size(), (int)chunkTranslucentVertexFaces.size());
+	printf("  comparison sort %.2f ms/frame, keyed radix sort %.2f ms/frame, reusing the order within a block %.2f ms/frame\n", comparisonSortMilliseconds, blockStepMilliseconds, quarterStepMilliseconds);
+
+	for (std::vector<Chunk*>::iterator chunkIter = ringChunks.begin(); chunkIter != ringChunks.end(); ++chunkIter){
+		(*chunkIter)->DeleteBuffers(&renderer);
+		delete *chunkIter;
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+void RunRadixSortTests(){
+	printf("Radix sort\n");
+	TestRadixSortMatchesStableSort();
+
+	PackedBlockVertexFaces translucentVertexFaces[SECTIONS_PER_CHUNK];
+	BuildWaterSheetFaces(translucentVertexFaces);
+	PackedBlockVertexFaces chunkTranslucentVertexFaces;
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		chunkTranslucentVertexFaces.insert(chunkTranslucentVertexFaces.end(), translucentVertexFaces[section].begin(), translucentVertexFaces[section].end());
+	}
+	TEST_CHECK(chunkTranslucentVertexFaces.size() >= (size_t)(NUM_WATER_SHEETS * BLOCKS_PER_CHUNK_LAYER * 2));
+
+	TestTranslucentFacesSortFurthestFirst(translucentVertexFaces, chunkTranslucentVertexFaces);
+	BenchmarkWaterRingSorting(translucentVertexFaces, chunkTranslucentVertexFaces);
+}
@@ -0,0 +1,393 @@
+//=====================================================
+// RaycastTests.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "TestHarness.hpp"
+#include "TestWorld.hpp"
+#include "BlockRaycast.hpp"
+#include "BlockDefinition.hpp"
+#include "Engine/Time/Time.hpp"
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+const float RAYCAST_TEST_LENGTH = 8.0f; //the reach World uses for placing and digging
+const int NUM_RANDOM_TEST_RAYS = 2000;
+const int NUM_REFERENCE_SAMPLES_PER_RAY = 80000; //one sample every 0.0001 blocks
+const int NUM_BENCHMARK_PASSES = 100;
+const int RANDOM_TEST_CHUNKS_PER_SIDE = 4;
+
+struct ReferenceRaycastResult{
+	bool m_didImpact;
+	int m_blockCoords[3];
+	float m_surfaceNormal[3];
+	bool m_isSurfaceNormalKnown; //false when one sample stepped across more than one block boundary
+	double m_impactT;
+};
+
+struct TestRay{
+	WorldCoords m_start;
+	WorldCoords m_end;
+};
+
+///=====================================================
+/// looks chunks up in the registry directly, so it doesn't share WorldBlockAccessor with the code under test
+///=====================================================
+static bool GetReferenceBlockType(const Chunks& chunks, int blockX, int blockY, int blockZ, unsigned char& out_blockType){
+	Chunks::const_iterator chunkIter = chunks.find(ChunkCoords(blockX >> CHUNKS_WIDE_EXPONENT, blockY >> CHUNKS_LONG_EXPONENT));
+	if (chunkIter == chunks.end())
+		return false;
+	out_blockType = chunkIter->second->GetBlockType(Chunk::GetIndexAtLocalCoords(LocalCoords(blockX & CHUNK_X_MASK, blockY & CHUNK_Y_MASK, blockZ)));
+	return true;
+}
+
+///=====================================================
+/// Samples the segment at tiny fixed steps in double precision and reports the first visible block a sample lands in.
+/// Slow, but simple enough to trust; it can only miss blocks the segment clips for less than one step.
+///=====================================================
+static const ReferenceRaycastResult BruteForceRaycast(const Chunks& chunks, const WorldCoords& start, const WorldCoords& end){
+	ReferenceRaycastResult result;
+	result.m_didImpact = false;
+	result.m_isSurfaceNormalKnown = false;
+	result.m_impactT = 1.0;
+
+	const double startCoords[3] = { start.x, start.y, start.z };
+	const double displacements[3] = { (double)end.x - start.x, (double)end.y - start.y, (double)end.z - start.z };
+	int previousBlockCoords[3];
+	for (int axis = 0; axis < 3; ++axis){
+		previousBlockCoords[axis] = (int)floor(startCoords[axis]);
+	}
+
+	unsigned char blockType;
+	if (previousBlockCoords[2] < 0 || previousBlockCoords[2] >= BLOCKS_PER_CHUNK_Z)
+		return result;
+	if (!GetReferenceBlockType(chunks, previousBlockCoords[0], previousBlockCoords[1], previousBlockCoords[2], blockType) || g_blockDefinitions[blockType].m_isVisible)
+		return result;
+
+	for (int sample = 1; sample <= NUM_REFERENCE_SAMPLES_PER_RAY; ++sample){
+		const double t = (double)sample / (double)NUM_REFERENCE_SAMPLES_PER_RAY;
+		int blockCoords[3];
+		int numChangedAxes = 0;
+		int changedAxis = 0;
+		for (int axis = 0; axis < 3; ++axis){
+			blockCoords[axis] = (int)floor(startCoords[axis] + t * displacements[axis]);
+			if (blockCoords[axis] != previousBlockCoords[axis]){
+				++numChangedAxes;
+				changedAxis = axis;
+			}
+		}
+		if (numChangedAxes == 0)
+			continue;
+
+		if (blockCoords[2] < 0 || blockCoords[2] >= BLOCKS_PER_CHUNK_Z)
+			return result;
+		if (!GetReferenceBlockType(chunks, blockCoords[0], blockCoords[1], blockCoords[2], blockType))
+			return result;
+
+		if (g_blockDefinitions[blockType].m_isVisible){
+			result.m_didImpact = true;
+			result.m_impactT = t;
+			result.m_isSurfaceNormalKnown = (numChangedAxes == 1);
+			for (int axis = 0; axis < 3; ++axis){
+				result.m_blockCoords[axis] = blockCoords[axis];
+				result.m_surfaceNormal[axis] = 0.0f;
+			}
+			result.m_surfaceNormal[changedAxis] = (blockCoords[changedAxis] > previousBlockCoords[changedAxis]) ? -1.0f : 1.0f;
+			return result;
+		}
+
+		for (int axis = 0; axis < 3; ++axis){
+			previousBlockCoords[axis] = blockCoords[axis];
+		}
+	}
+	return result;
+}
+
+///=====================================================
+/// the range of t over which the segment is inside a block, or false if it never enters it
+///=====================================================
+static bool GetSegmentTRangeInBlock(const WorldCoords& start, const WorldCoords& end, const Vec3& blockMins, double& out_enterT, double& out_exitT){
+	const double startCoords[3] = { start.x, start.y, start.z };
+	const double displacements[3] = { (double)end.x - start.x, (double)end.y - start.y, (double)end.z - start.z };
+	const double mins[3] = { blockMins.x, blockMins.y, blockMins.z };
+	out_enterT = 0.0;
+	out_exitT = 1.0;
+	for (int axis = 0; axis < 3; ++axis){
+		if (displacements[axis] == 0.0){
+			if (startCoords[axis] < mins[axis] || startCoords[axis] > mins[axis] + 1.0)
+				return false;
+			continue;
+		}
+		double nearT = (mins[axis] - startCoords[axis]) / displacements[axis];
+		double farT = (mins[axis] + 1.0 - startCoords[axis]) / displacements[axis];
+		if (nearT > farT){
+			const double swapT = nearT;
+			nearT = farT;
+			farT = swapT;
+		}
+		if (nearT > out_enterT)
+			out_enterT = nearT;
+		if (farT < out_exitT)
+			out_exitT = farT;
+	}
+	return out_enterT <= out_exitT;
+}
+
+///=====================================================
+/// 
+///=====================================================
+static bool DoesResultMatchReference(const Raycast3DResult& result, const ReferenceRaycastResult& reference){
+	if (result.m_didImpact != reference.m_didImpact)
+		return false;
+	if (!result.m_didImpact)
+		return true;
+
+	if (result.m_impactWorldCoordsMins.x != (float)reference.m_blockCoords[0] || result.m_impactWorldCoordsMins.y != (float)reference.m_blockCoords[1] || result.m_impactWorldCoordsMins.z != (float)reference.m_blockCoords[2])
+		return false;
+	if (!reference.m_isSurfaceNormalKnown)
+		return true;
+	return result.m_impactSurfaceNormal.x == reference.m_surfaceNormal[0] && result.m_impactSurfaceNormal.y == reference.m_surfaceNormal[1] && result.m_impactSurfaceNormal.z == reference.m_surfaceNormal[2];
+}
+
+///=====================================================
+/// a mismatch is only acceptable where the reference stepped over a block the segment barely clips before its own hit
+///=====================================================
+static bool IsMismatchAGrazingHit(const TestRay& ray, const Raycast3DResult& result, const ReferenceRaycastResult& reference){
+	if (!result.m_didImpact)
+		return false;
+
+	double enterT, exitT;
+	if (!GetSegmentTRangeInBlock(ray.m_start, ray.m_end, result.m_impactWorldCoordsMins, enterT, exitT))
+		return false;
+	const double maxSkippedT = 2.0 / (double)NUM_REFERENCE_SAMPLES_PER_RAY;
+	return (exitT - enterT) < maxSkippedT && enterT <= reference.m_impactT;
+}
+
+///=====================================================
+/// a hit's outline corners all lie on the hit face, starting at m_impactWorldCoords
+///=====================================================
+static bool IsImpactFaceConsistent(const Raycast3DResult& result){
+	if (result.m_impactFaceCoords.size() != 4)
+		return false;
+	if (!(result.m_impactWorldCoords == result.m_impactFaceCoords[0]))
+		return false;
+
+	const Vec3& mins = result.m_impactWorldCoordsMins;
+	const Vec3& normal = result.m_impactSurfaceNormal;
+	for (int corner = 0; corner < 4; ++corner){
+		const Vec3 offset = result.m_impactFaceCoords[corner] - mins;
+		const float offsets[3] = { offset.x, offset.y, offset.z };
+		const float normals[3] = { normal.x, normal.y, normal.z };
+		for (int axis = 0; axis < 3; ++axis){
+			if (offsets[axis] != 0.0f && offsets[axis] != 1.0f)
+				return false;
+			if (normals[axis] != 0.0f && offsets[axis] != ((normals[axis] > 0.0f) ? 1.0f : 0.0f))
+				return false;
+		}
+	}
+	return true;
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void CheckRaycastHit(const Chunks& chunks, const WorldCoords& start, const WorldCoords& end, const Vec3& expectedBlockMins, const Vec3& expectedNormal){
+	const Raycast3DResult result = RaycastBlocks(chunks, start, end);
+	TEST_CHECK(result.m_didImpact);
+	if (!result.m_didImpact)
+		return;
+	TEST_CHECK(result.m_impactWorldCoordsMins == expectedBlockMins);
+	TEST_CHECK(result.m_impactSurfaceNormal == expectedNormal);
+	TEST_CHECK(IsImpactFaceConsistent(result));
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void CheckRaycastMiss(const Chunks& chunks, const WorldCoords& start, const WorldCoords& end){
+	const Raycast3DResult result = RaycastBlocks(chunks, start, end);
+	TEST_CHECK(!result.m_didImpact);
+}
+
+///=====================================================
+/// rays along each axis, from the center of a block column, hit the face pointing back at them
+///=====================================================
+static void TestAxisAlignedRays(){
+	TestWorld world;
+	world.AddAirChunks(ChunkCoords(-1, -1), ChunkCoords(1, 1));
+	world.SetBlockType(5, 5, 20, BT_STONE);
+	const Vec3 blockMins(5.0f, 5.0f, 20.0f);
+	const WorldCoords blockCenter(5.5f, 5.5f, 20.5f);
+
+	CheckRaycastHit(world.m_chunks, blockCenter + Vec3(0.0f, 0.0f, 5.0f), blockCenter, blockMins, Vec3(0.0f, 0.0f, 1.0f));
+	CheckRaycastHit(world.m_chunks, blockCenter + Vec3(0.0f, 0.0f, -5.0f), blockCenter, blockMins, Vec3(0.0f, 0.0f, -1.0f));
+	CheckRaycastHit(world.m_chunks, blockCenter + Vec3(0.0f, 5.0f, 0.0f), blockCenter, blockMins, Vec3(0.0f, 1.0f, 0.0f));
+	CheckRaycastHit(world.m_chunks, blockCenter + Vec3(0.0f, -5.0f, 0.0f), blockCenter, blockMins, Vec3(0.0f, -1.0f, 0.0f));
+	CheckRaycastHit(world.m_chunks, blockCenter + Vec3(5.0f, 0.0f, 0.0f), blockCenter, blockMins, Vec3(1.0f, 0.0f, 0.0f));
+	CheckRaycastHit(world.m_chunks, blockCenter + Vec3(-5.0f, 0.0f, 0.0f), blockCenter, blockMins, Vec3(-1.0f, 0.0f, 0.0f));
+
+	//a ray that ends just short of the face misses
+	CheckRaycastMiss(world.m_chunks, blockCenter + Vec3(-5.0f, 0.0f, 0.0f), blockCenter + Vec3(-0.51f, 0.0f, 0.0f));
+
+	//a ray starting inside a visible block never hits anything
+	world.SetBlockType(5, 5, 21, BT_STONE);
+	CheckRaycastMiss(world.m_chunks, blockCenter, blockCenter + Vec3(0.0f, 0.0f, 5.0f));
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void TestRaysAcrossChunkBorders(){
+	TestWorld world;
+	world.AddAirChunks(ChunkCoords(-1, -1), ChunkCoords(1, 1));
+	world.SetBlockType(BLOCKS_PER_CHUNK_X, 5, 20, BT_STONE);
+	world.SetBlockType(BLOCKS_PER_CHUNK_X - 1, 8, 20, BT_STONE);
+	world.SetBlockType(-1, 5, 20, BT_STONE);
+	world.SetBlockType(BLOCKS_PER_CHUNK_X, BLOCKS_PER_CHUNK_Y, 20, BT_STONE);
+	const float chunkMaxX = (float)BLOCKS_PER_CHUNK_X;
+
+	CheckRaycastHit(world.m_chunks, WorldCoords(chunkMaxX - 3.5f, 5.5f, 20.5f), WorldCoords(chunkMaxX + 3.0f, 5.5f, 20.5f), Vec3(chunkMaxX, 5.0f, 20.0f), Vec3(-1.0f, 0.0f, 0.0f));
+
+	//starting exactly on the border, in the eastern chunk
+	CheckRaycastHit(world.m_chunks, WorldCoords(chunkMaxX, 8.5f, 20.5f), WorldCoords(chunkMaxX - 3.0f, 8.5f, 20.5f), Vec3(chunkMaxX - 1.0f, 8.0f, 20.0f), Vec3(1.0f, 0.0f, 0.0f));
+
+	//into the chunk with negative coords
+	CheckRaycastHit(world.m_chunks, WorldCoords(2.5f, 5.5f, 20.5f), WorldCoords(-3.0f, 5.5f, 20.5f), Vec3(-1.0f, 5.0f, 20.0f), Vec3(1.0f, 0.0f, 0.0f));
+
+	//diagonally through the corner where four chunks meet
+	const Raycast3DResult cornerResult = RaycastBlocks(world.m_chunks, WorldCoords(chunkMaxX - 1.5f, (float)BLOCKS_PER_CHUNK_Y - 1.5f, 20.5f), WorldCoords(chunkMaxX + 1.5f, (float)BLOCKS_PER_CHUNK_Y + 1.5f, 20.5f));
+	TEST_CHECK(cornerResult.m_didImpact);
+	TEST_CHECK(cornerResult.m_impactWorldCoordsMins == Vec3(chunkMaxX, (float)BLOCKS_PER_CHUNK_Y, 20.0f));
+
+	//leaving the active chunks misses, even if the end is past them
+	CheckRaycastMiss(world.m_chunks, WorldCoords(2.0f * chunkMaxX - 0.5f, 2.5f, 20.5f), WorldCoords(2.0f * chunkMaxX + 7.5f, 2.5f, 20.5f));
+	CheckRaycastMiss(world.m_chunks, WorldCoords(2.0f * chunkMaxX + 0.5f, 2.5f, 20.5f), WorldCoords(2.0f * chunkMaxX - 7.5f, 2.5f, 20.5f));
+}
+
+///=====================================================
+/// rays hit the bottom and top layers of the world, and miss cleanly when they leave its height
+///=====================================================
+static void TestRaysAtWorldVerticalBounds(){
+	TestWorld world;
+	world.AddAirChunks(ChunkCoords(-1, -1), ChunkCoords(1, 1));
+	world.SetBlockType(5, 5, 0, BT_STONE);
+	world.SetBlockType(5, 5, BLOCKS_PER_CHUNK_Z - 1, BT_STONE);
+	const float worldTop = (float)BLOCKS_PER_CHUNK_Z;
+
+	CheckRaycastHit(world.m_chunks, WorldCoords(5.5f, 5.5f, 3.0f), WorldCoords(5.5f, 5.5f, -5.0f), Vec3(5.0f, 5.0f, 0.0f), Vec3(0.0f, 0.0f, 1.0f));
+	CheckRaycastHit(world.m_chunks, WorldCoords(5.5f, 5.5f, worldTop - 3.0f), WorldCoords(5.5f, 5.5f, worldTop + 5.0f), Vec3(5.0f, 5.0f, worldTop - 1.0f), Vec3(0.0f, 0.0f, -1.0f));
+
+	CheckRaycastMiss(world.m_chunks, WorldCoords(6.5f, 6.5f, 3.0f), WorldCoords(7.5f, 6.5f, -5.0f));
+	CheckRaycastMiss(world.m_chunks, WorldCoords(6.5f, 6.5f, worldTop - 3.0f), WorldCoords(6.5f, 7.5f, worldTop + 5.0f));
+
+	//rays starting outside the world's height miss, even when aimed at a block inside it
+	CheckRaycastMiss(world.m_chunks, WorldCoords(5.5f, 5.5f, worldTop + 1.0f), WorldCoords(5.5f, 5.5f, worldTop - 5.0f));
+	CheckRaycastMiss(world.m_chunks, WorldCoords(5.5f, 5.5f, -1.0f), WorldCoords(5.5f, 5.5f, 5.0f));
+}
+
+///=====================================================
+/// 
+///=====================================================
+static float GetNextTestRandomZeroToOne(unsigned int& state){
+	state = state * 1664525u + 1013904223u;
+	return (float)(state >> 8) / (float)(1 << 24);
+}
+
+///=====================================================
+/// Scatters a few visible blocks through a 4x4 chunk world and casts random rays through it, some along one or two axes.
+/// Some rays start outside the world's height, and some leave the active chunks.
+///=====================================================
+static void CreateRandomRaycastTest(TestWorld& world, std::vector<TestRay>& out_rays){
+	world.AddAirChunks(ChunkCoords(0, 0), ChunkCoords(RANDOM_TEST_CHUNKS_PER_SIDE - 1, RANDOM_TEST_CHUNKS_PER_SIDE - 1));
+	const int worldWidth = RANDOM_TEST_CHUNKS_PER_SIDE * BLOCKS_PER_CHUNK_X;
+	const int worldLength = RANDOM_TEST_CHUNKS_PER_SIDE * BLOCKS_PER_CHUNK_Y;
+	const BlockType VISIBLE_TYPES[3] = { BT_STONE, BT_WATER, BT_ICE };
+
+	unsigned int state = 24680;
+	for (int blockZ = 0; blockZ < BLOCKS_PER_CHUNK_Z; ++blockZ){
+		for (int blockY = 0; blockY < worldLength; ++blockY){
+			for (int blockX = 0; blockX < worldWidth; ++blockX){
+				const float roll = GetNextTestRandomZeroToOne(state);
+				if (roll < 0.03f)
+					world.SetBlockType(blockX, blockY, blockZ, VISIBLE_TYPES[(int)(roll * 100.0f)]);
+			}
+		}
+	}
+
+	out_rays.resize(NUM_RANDOM_TEST_RAYS);
+	for (int rayIndex = 0; rayIndex < NUM_RANDOM_TEST_RAYS; ++rayIndex){
+		TestRay& ray = out_rays[rayIndex];
+		ray.m_start = WorldCoords(GetNextTestRandomZeroToOne(state) * (float)worldWidth, GetNextTestRandomZeroToOne(state) * (float)worldLength, GetNextTestRandomZeroToOne(state) * (float)(BLOCKS_PER_CHUNK_Z + 4) - 2.0f);
+
+		Vec3 direction(GetNextTestRandomZeroToOne(state) - 0.5f, GetNextTestRandomZeroToOne(state) - 0.5f, GetNextTestRandomZeroToOne(state) - 0.5f);
+		if (rayIndex % 8 == 1)
+			direction.x = 0.0f;
+		if (rayIndex % 16 == 1)
+			direction.y = 0.0f;
+		const float directionLength = sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+		ray.m_end = ray.m_start + (RAYCAST_TEST_LENGTH / directionLength) * direction;
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void TestRandomRaysMatchBruteForce(const Chunks& chunks, const std::vector<TestRay>& rays){
+	int numHits = 0;
+	int numGrazingHits = 0;
+	int numMismatches = 0;
+	for (std::vector<TestRay>::const_iterator rayIter = rays.begin(); rayIter != rays.end(); ++rayIter){
+		const Raycast3DResult result = RaycastBlocks(chunks, rayIter->m_start, rayIter->m_end);
+		const ReferenceRaycastResult reference = BruteForceRaycast(chunks, rayIter->m_start, rayIter->m_end);
+		if (result.m_didImpact){
+			++numHits;
+			if (!IsImpactFaceConsistent(result))
+				++numMismatches;
+		}
+
+		if (DoesResultMatchReference(result, reference))
+			continue;
+		if (IsMismatchAGrazingHit(*rayIter, result, reference))
+			++numGrazingHits;
+		else
+			++numMismatches;
+	}
+
+	printf("  %d rays, %d hits, %d grazing hits the reference stepped over\n", (int)rays.size(), numHits, numGrazingHits);
+	TEST_CHECK(numMismatches == 0);
+	TEST_CHECK(numHits > (int)rays.size() / 4); //the rays are exercising hits, not just misses
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void BenchmarkRaycasts(const Chunks& chunks, const std::vector<TestRay>& rays){
+	int numHits = 0;
+	const double startSeconds = GetCurrentSeconds();
+	for (int pass = 0; pass < NUM_BENCHMARK_PASSES; ++pass){
+		for (std::vector<TestRay>::const_iterator rayIter = rays.begin(); rayIter != rays.end(); ++rayIter){
+			if (RaycastBlocks(chunks, rayIter->m_start, rayIter->m_end).m_didImpact)
+				++numHits;
+		}
+	}
+	const double elapsedSeconds = GetCurrentSeconds() - startSeconds;
+	const double numRays = (double)NUM_BENCHMARK_PASSES * (double)rays.size();
+	printf("  %.2f M rays/sec (%d hits)\n", numRays / elapsedSeconds * 1e-6, numHits);
+}
+
+///=====================================================
+/// 
+///=====================================================
+void RunRaycastTests(){
+	printf("Block raycasts\n");
+	TestAxisAlignedRays();
+	TestRaysAcrossChunkBorders();
+	TestRaysAtWorldVerticalBounds();
+
+	TestWorld world;
+	std::vector<TestRay> rays;
+	CreateRandomRaycastTest(world, rays);
+	TestRandomRaysMatchBruteForce(world.m_chunks, rays);
+	BenchmarkRaycasts(world.m_chunks, rays);
+}
@@ -0,0 +1,403 @@
+//=====================================================
+// RegionFile.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "RegionFile.hpp"
+#include "Engine/Core/Utilities.hpp"
+#include <Windows.h>
+#include <sstream>
+#include <string.h>
+
+///=====================================================
+/// 
+///=====================================================
+RegionFile::RegionFile()
+:m_file(NULL),
+m_firstFreeSector(REGION_HEADER_SECTORS){
+	memset(m_entries, 0, sizeof(m_entries));
+}
+
+///=====================================================
+/// 
+///=====================================================
+RegionFile::~RegionFile(){
+	Close();
+}
+
+///=====================================================
+/// creates the file with an empty header if it doesn't exist yet
+///=====================================================
+bool RegionFile::Open(const std::string& filePath){
+	Close();
+	memset(m_entries, 0, sizeof(m_entries));
+	m_isSectorUsed.assign(REGION_HEADER_SECTORS, true);
+	m_firstFreeSector = REGION_HEADER_SECTORS;
+
+	if (fopen_s(&m_file, filePath.c_str(), "r+b") != 0){
+		m_file = NULL;
+		if (fopen_s(&m_file, filePath.c_str(), "w+b") != 0){
+			m_file = NULL;
+			return false;
+		}
+
+		const std::vector<unsigned char> emptyHeader(REGION_HEADER_SECTORS * REGION_SECTOR_BYTES, 0);
+		fwrite(&emptyHeader[0], 1, emptyHeader.size(), m_file);
+		return true;
+	}
+
+	fseek(m_file, 0, SEEK_END);
+	const int numSectors = max(GetSectorsForBytes((size_t)ftell(m_file)), REGION_HEADER_SECTORS);
+	m_isSectorUsed.resize(numSectors, false);
+
+	fseek(m_file, 0, SEEK_SET);
+	if (fread(m_entries, sizeof(m_entries), 1, m_file) != 1)
+		memset(m_entries, 0, sizeof(m_entries)); //a truncated header can't be trusted
+
+	//drop entries that run past the end of the file or overlap another chunk, rather than handing out bad data
+	for (int chunkIndex = 0; chunkIndex < CHUNKS_PER_REGION; ++chunkIndex){
+		RegionChunkEntry& entry = m_entries[chunkIndex];
+		if (entry.m_numBytes == 0)
+			continue;
+
+		const int numChunkSectors = GetSectorsForBytes(entry.m_numBytes);
+		bool isValid = entry.m_firstSector >= (unsigned int)REGION_HEADER_SECTORS && entry.m_firstSector + numChunkSectors <= (unsigned int)numSectors;
+		for (int sector = 0; isValid && sector < numChunkSectors; ++sector){
+			isValid = !m_isSectorUsed[entry.m_firstSector + sector];
+		}
+
+		if (isValid){
+			SetSectorsUsed(entry.m_firstSector, numChunkSectors, true);
+		}
+		else{
+			entry.m_firstSector = 0;
+			entry.m_numBytes = 0;
+		}
+	}
+
+	return true;
+}
+
+///=====================================================
+/// 
+///=====================================================
+void RegionFile::Close(){
+	if (m_file == NULL)
+		return;
+
+	fclose(m_file);
+	m_file = NULL;
+}
+
+///=====================================================
+/// 
+///=====================================================
+void RegionFile::SetSectorsUsed(unsigned int firstSector, int numSectors, bool isUsed){
+	for (int sector = 0; sector < numSectors; ++sector){
+		m_isSectorUsed[firstSector + sector] = isUsed;
+	}
+
+	if (!isUsed && numSectors > 0 && (int)firstSector < m_firstFreeSector)
+		m_firstFreeSector = (int)firstSector;
+	while (m_firstFreeSector < (int)m_isSectorUsed.size() && m_isSectorUsed[m_firstFreeSector]){
+		++m_firstFreeSector;
+	}
+}
+
+///=====================================================
+/// first fit among the free sectors, otherwise grows the file; the sectors returned are marked used
+///=====================================================
+int RegionFile::AllocateSectors(int numSectors){
+	int runStart = m_firstFreeSector;
+	int runLength = 0;
+	for (int sector = m_firstFreeSector; sector < (int)m_isSectorUsed.size(); ++sector){
+		if (m_isSectorUsed[sector]){
+			runStart = sector + 1;
+			runLength = 0;
+			continue;
+		}
+
+		if (++runLength == numSectors){
+			SetSectorsUsed(runStart, numSectors, true);
+			return runStart;
+		}
+	}
+
+	//runStart is where the free sectors at the end of the file begin, if there are any
+	m_isSectorUsed.resize(runStart + numSectors, false);
+	SetSectorsUsed(runStart, numSectors, true);
+	return runStart;
+}
+
+///=====================================================
+/// 
+///=====================================================
+bool RegionFile::WriteEntry(int chunkIndex){
+	fseek(m_file, chunkIndex * sizeof(RegionChunkEntry), SEEK_SET);
+	return fwrite(&m_entries[chunkIndex], sizeof(RegionChunkEntry), 1, m_file) == 1;
+}
+
+///=====================================================
+/// 
+///=====================================================
+bool RegionFile::ReadChunk(int chunkIndex, unsigned char* buffer, size_t maxBytes, size_t& out_numBytes){
+	const RegionChunkEntry& entry = m_entries[chunkIndex];
+	if (m_file == NULL || entry.m_numBytes == 0 || entry.m_numBytes > maxBytes)
+		return false;
+
+	fseek(m_file, entry.m_firstSector * REGION_SECTOR_BYTES, SEEK_SET);
+	if (fread(buffer, 1, entry.m_numBytes, m_file) != entry.m_numBytes)
+		return false;
+
+	out_numBytes = entry.m_numBytes;
+	return true;
+}
+
+///=====================================================
+/// overwrites the chunk in place if it still fits its sectors, freeing any it no longer needs
+///=====================================================
+bool RegionFile::WriteChunk(int chunkIndex, const unsigned char* buffer, size_t numBytes){
+	if (m_file == NULL || numBytes == 0)
+		return false;
+
+	RegionChunkEntry& entry = m_entries[chunkIndex];
+	const int numSectors = GetSectorsForBytes(numBytes);
+	const int oldNumSectors = GetSectorsForBytes(entry.m_numBytes);
+	const unsigned int oldFirstSector = entry.m_firstSector;
+
+	const bool fitsInPlace = entry.m_numBytes != 0 && numSectors <= oldNumSectors;
+	const unsigned int firstSector = fitsInPlace ? oldFirstSector : (unsigned int)AllocateSectors(numSectors);
+
+	fseek(m_file, firstSector * REGION_SECTOR_BYTES, SEEK_SET);
+	if (fwrite(buffer, 1, numBytes, m_file) != numBytes){
+		if (!fitsInPlace)
+			SetSectorsUsed(firstSector, numSectors, false);
+		return false;
+	}
+
+	if (fitsInPlace)
+		SetSectorsUsed(firstSector + numSectors, oldNumSectors - numSectors, false);
+	else if (entry.m_numBytes != 0)
+		SetSectorsUsed(oldFirstSector, oldNumSectors, false);
+
+	entry.m_firstSector = firstSector;
+	entry.m_numBytes = (unsigned int)numBytes;
+	return WriteEntry(chunkIndex);
+}
+
+///=====================================================
+/// 
+///=====================================================
+int RegionFile::GetNumFreeSectors() const{
+	int numFreeSectors = 0;
+	for (size_t sector = 0; sector < m_isSectorUsed.size(); ++sector){
+		if (!m_isSectorUsed[sector])
+			++numFreeSectors;
+	}
+	return numFreeSectors;
+}
+
+///=====================================================
+/// 
+///=====================================================
+SavedChunkIndex::SavedChunkIndex()
+:m_numSavedChunks(0){
+}
+
+///=====================================================
+/// 
+///=====================================================
+bool SavedChunkIndex::HasChunk(const ChunkCoords& chunkCoords) const{
+	std::map<RegionCoords, std::vector<bool> >::const_iterator regionIter = m_savedChunksByRegion.find(RegionFile::GetRegionCoordsAtChunkCoords(chunkCoords));
+	if (regionIter == m_savedChunksByRegion.end())
+		return false;
+
+	return regionIter->second[RegionFile::GetChunkIndexAtChunkCoords(chunkCoords)];
+}
+
+///=====================================================
+/// 
+///=====================================================
+void SavedChunkIndex::AddChunk(const ChunkCoords& chunkCoords){
+	std::vector<bool>& savedChunks = m_savedChunksByRegion[RegionFile::GetRegionCoordsAtChunkCoords(chunkCoords)];
+	if (savedChunks.empty())
+		savedChunks.assign(CHUNKS_PER_REGION, false);
+
+	std::vector<bool>::reference isSaved = savedChunks[RegionFile::GetChunkIndexAtChunkCoords(chunkCoords)];
+	if (!isSaved){
+		isSaved = true;
+		++m_numSavedChunks;
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+void SavedChunkIndex::AddRegion(const RegionCoords& regionCoords, const RegionFile& regionFile){
+	std::vector<bool>& savedChunks = m_savedChunksByRegion[regionCoords];
+	if (savedChunks.empty())
+		savedChunks.assign(CHUNKS_PER_REGION, false);
+
+	for (int chunkIndex = 0; chunkIndex < CHUNKS_PER_REGION; ++chunkIndex){
+		if (regionFile.HasChunk(chunkIndex) && !savedChunks[chunkIndex]){
+			savedChunks[chunkIndex] = true;
+			++m_numSavedChunks;
+		}
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+RegionFileCache::RegionFileCache(const std::string& directory)
+:m_directory(directory),
+m_useTime(0){
+	m_openRegions.reserve(MAX_OPEN_REGION_FILES);
+}
+
+///=====================================================
+/// 
+///=====================================================
+RegionFileCache::~RegionFileCache(){
+	CloseAll();
+}
+
+///=====================================================
+/// 
+///=====================================================
+void RegionFileCache::CloseAll(){
+	for (std::vector<OpenRegion>::iterator regionIter = m_openRegions.begin(); regionIter != m_openRegions.end(); ++regionIter){
+		delete regionIter->m_regionFile;
+	}
+	m_openRegions.clear();
+}
+
+///=====================================================
+/// 
+///=====================================================
+std::string RegionFileCache::GetRegionFilePath(const RegionCoords& regionCoords) const{
+	std::stringstream ss;
+	ss << m_directory << "/Region" << regionCoords.x << "," << regionCoords.y << ".region";
+	return ss.str();
+}
+
+///=====================================================
+/// a region with no file yet stays cached unopened, so loads from it don't keep retrying the open
+///=====================================================
+RegionFile* RegionFileCache::GetRegionFile(const RegionCoords& regionCoords, bool createIfMissing){
+	OpenRegion* openRegion = NULL;
+	for (std::vector<OpenRegion>::iterator regionIter = m_openRegions.begin(); regionIter != m_openRegions.end(); ++regionIter){
+		if (regionIter->m_regionCoords == regionCoords){
+			openRegion = &*regionIter;
+			break;
+		}
+	}
+
+	if (openRegion == NULL){
+		if (m_openRegions.size() == MAX_OPEN_REGION_FILES){ //close the least recently used region
+			std::vector<OpenRegion>::iterator oldestRegion = m_openRegions.begin();
+			for (std::vector<OpenRegion>::iterator regionIter = m_openRegions.begin(); regionIter != m_openRegions.end(); ++regionIter){
+				if (regionIter->m_lastUsedTime < oldestRegion->m_lastUsedTime)
+					oldestRegion = regionIter;
+			}
+			delete oldestRegion->m_regionFile;
+			*oldestRegion = m_openRegions.back();
+			m_openRegions.pop_back();
+		}
+
+		OpenRegion newRegion;
+		newRegion.m_regionCoords = regionCoords;
+		newRegion.m_regionFile = new RegionFile();
+		const std::string filePath = GetRegionFilePath(regionCoords);
+		if (GetFileAttributesA(filePath.c_str()) != INVALID_FILE_ATTRIBUTES)
+			newRegion.m_regionFile->Open(filePath);
+
+		m_openRegions.push_back(newRegion);
+		openRegion = &m_openRegions.back();
+	}
+
+	openRegion->m_lastUsedTime = ++m_useTime;
+	if (!openRegion->m_regionFile->IsOpen() && createIfMissing){
+		CreateDirectoryA(m_directory.c_str(), NULL); //fails harmlessly if it already exists
+		openRegion->m_regionFile->Open(GetRegionFilePath(regionCoords));
+	}
+
+	return openRegion->m_regionFile->IsOpen() ? openRegion->m_regionFile : NULL;
+}
+
+///=====================================================
+/// 
+///=====================================================
+bool RegionFileCache::LoadChunk(const ChunkCoords& chunkCoords, unsigned char* buffer, size_t maxBytes, size_t& out_numBytes){
+	RegionFile* regionFile = GetRegionFile(RegionFile::GetRegionCoordsAtChunkCoords(chunkCoords), false);
+	if (regionFile == NULL)
+		return false;
+
+	return regionFile->ReadChunk(RegionFile::GetChunkIndexAtChunkCoords(chunkCoords), buffer, maxBytes, out_numBytes);
+}
+
+///=====================================================
+/// 
+///=====================================================
+bool RegionFileCache::SaveChunk(const ChunkCoords& chunkCoords, const unsigned char* buffer, size_t numBytes){
+	RegionFile* regionFile = GetRegionFile(RegionFile::GetRegionCoordsAtChunkCoords(chunkCoords), true);
+	if (regionFile == NULL)
+		return false;
+
+	return regionFile->WriteChunk(RegionFile::GetChunkIndexAtChunkCoords(chunkCoords), buffer, numBytes);
+}
+
+///=====================================================
+/// moves every ChunkX,Y.chunk file in chunkDirectory into its region, deleting each file once it's stored
+///=====================================================
+int RegionFileCache::ConvertChunkFiles(const std::string& chunkDirectory){
+	WIN32_FIND_DATAA findData;
+	HANDLE findHandle = FindFirstFileA((chunkDirectory + "/Chunk*.chunk").c_str(), &findData);
+	if (findHandle == INVALID_HANDLE_VALUE)
+		return 0;
+
+	std::vector<unsigned char> buffer(MAX_RLE_BYTES);
+	int numChunksConverted = 0;
+	do{
+		ChunkCoords chunkCoords;
+		if (sscanf_s(findData.cFileName, "Chunk%d,%d.chunk", &chunkCoords.x, &chunkCoords.y) != 2)
+			continue;
+
+		const std::string chunkFilePath = chunkDirectory + "/" + findData.cFileName;
+		const size_t numBytes = (size_t)findData.nFileSizeLow;
+		if (findData.nFileSizeHigh != 0 || numBytes == 0 || numBytes > buffer.size())
+			continue;
+		if (!LoadFileToExistingBuffer(chunkFilePath, &buffer[0], buffer.size()))
+			continue;
+
+		if (SaveChunk(chunkCoords, &buffer[0], numBytes)){
+			DeleteFileA(chunkFilePath.c_str());
+			++numChunksConverted;
+		}
+	} while (FindNextFileA(findHandle, &findData));
+
+	FindClose(findHandle);
+	return numChunksConverted;
+}
+
+///=====================================================
+/// reads the header of every region file in the directory; only call while no I/O thread is using the cache
+///=====================================================
+void RegionFileCache::IndexSavedChunks(SavedChunkIndex& out_savedChunkIndex){
+	WIN32_FIND_DATAA findData;
+	HANDLE findHandle = FindFirstFileA((m_directory + "/Region*.region").c_str(), &findData);
+	if (findHandle == INVALID_HANDLE_VALUE)
+		return;
+
+	do{
+		RegionCoords regionCoords;
+		if (sscanf_s(findData.cFileName, "Region%d,%d.region", &regionCoords.x, &regionCoords.y) != 2)
+			continue;
+
+		const RegionFile* regionFile = GetRegionFile(regionCoords, false);
+		if (regionFile != NULL)
+			out_savedChunkIndex.AddRegion(regionCoords, *regionFile);
+	} while (FindNextFileA(findHandle, &findData));
+
+	FindClose(findHandle);
+}
@@ -0,0 +1,144 @@
+//=====================================================
+// RegionFile.hpp
+// by Andrew Socha
+//=====================================================
+
+#pragma once
+
+#ifndef __included_RegionFile__
+#define __included_RegionFile__
+
+#include "Chunk.hpp"
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+const int CHUNKS_PER_REGION_SIDE_EXPONENT = 5;
+const int CHUNKS_PER_REGION_SIDE = 1 << CHUNKS_PER_REGION_SIDE_EXPONENT; //32x32 chunks per region
+const int CHUNKS_PER_REGION = CHUNKS_PER_REGION_SIDE * CHUNKS_PER_REGION_SIDE;
+const int REGION_SECTOR_BYTES = 512;
+const int MAX_OPEN_REGION_FILES = 16;
+
+typedef IntVec2 RegionCoords;
+
+struct RegionChunkEntry{
+	unsigned int m_firstSector;
+	unsigned int m_numBytes; //0 when the chunk isn't stored
+};
+
+const int REGION_HEADER_SECTORS = (CHUNKS_PER_REGION * sizeof(RegionChunkEntry) + REGION_SECTOR_BYTES - 1) / REGION_SECTOR_BYTES;
+
+///=====================================================
+/// One file holding up to 32x32 chunks, each in a run of whole sectors after a header table of offsets and lengths.
+/// A chunk that still fits its sectors is overwritten in place; otherwise it moves to the first free run, or the end of the file.
+/// A moved chunk's data is written before its header entry, so an interrupted move leaves the old copy in use.
+///=====================================================
+class RegionFile{
+private:
+	FILE* m_file;
+	RegionChunkEntry m_entries[CHUNKS_PER_REGION];
+	std::vector<bool> m_isSectorUsed;
+	int m_firstFreeSector; //no sector before this one is free
+
+	RegionFile(const RegionFile&);
+	RegionFile& operator=(const RegionFile&);
+
+	int AllocateSectors(int numSectors);
+	void SetSectorsUsed(unsigned int firstSector, int numSectors, bool isUsed);
+	bool WriteEntry(int chunkIndex);
+
+public:
+	RegionFile();
+	~RegionFile();
+
+	bool Open(const std::string& filePath);
+	void Close();
+
+	bool ReadChunk(int chunkIndex, unsigned char* buffer, size_t maxBytes, size_t& out_numBytes);
+	bool WriteChunk(int chunkIndex, const unsigned char* buffer, size_t numBytes);
+
+	inline bool IsOpen() const{ return m_file != NULL; }
+	inline bool HasChunk(int chunkIndex) const{ return m_entries[chunkIndex].m_numBytes != 0; }
+	inline int GetNumSectors() const{ return (int)m_isSectorUsed.size(); }
+	int GetNumFreeSectors() const;
+
+	static int GetSectorsForBytes(size_t numBytes);
+	static RegionCoords GetRegionCoordsAtChunkCoords(const ChunkCoords& chunkCoords);
+	static int GetChunkIndexAtChunkCoords(const ChunkCoords& chunkCoords);
+};
+
+///=====================================================
+/// Which chunks have saved data, one bit per chunk slot of each region with a file.
+/// Lets the main thread send never-saved chunks straight to generation without touching the disk.
+///=====================================================
+class SavedChunkIndex{
+private:
+	std::map<RegionCoords, std::vector<bool> > m_savedChunksByRegion;
+	int m_numSavedChunks;
+
+public:
+	SavedChunkIndex();
+
+	bool HasChunk(const ChunkCoords& chunkCoords) const;
+	void AddChunk(const ChunkCoords& chunkCoords);
+	void AddRegion(const RegionCoords& regionCoords, const RegionFile& regionFile);
+
+	inline int GetNumSavedChunks() const{ return m_numSavedChunks; }
+};
+
+///=====================================================
+/// Keeps the most recently used region files open and routes chunk loads and saves to them
+///=====================================================
+class RegionFileCache{
+private:
+	struct OpenRegion{
+		RegionCoords m_regionCoords;
+		RegionFile* m_regionFile;
+		unsigned int m_lastUsedTime;
+	};
+
+	std::string m_directory;
+	std::vector<OpenRegion> m_openRegions;
+	unsigned int m_useTime;
+
+	RegionFileCache(const RegionFileCache&);
+	RegionFileCache& operator=(const RegionFileCache&);
+
+	RegionFile* GetRegionFile(const RegionCoords& regionCoords, bool createIfMissing);
+	std::string GetRegionFilePath(const RegionCoords& regionCoords) const;
+
+public:
+	explicit RegionFileCache(const std::string& directory);
+	~RegionFileCache();
+
+	bool LoadChunk(const ChunkCoords& chunkCoords, unsigned char* buffer, size_t maxBytes, size_t& out_numBytes);
+	bool SaveChunk(const ChunkCoords& chunkCoords, const unsigned char* buffer, size_t numBytes);
+	void CloseAll();
+
+	int ConvertChunkFiles(const std::string& chunkDirectory);
+	void IndexSavedChunks(SavedChunkIndex& out_savedChunkIndex);
+};
+
+///=====================================================
+/// 
+///=====================================================
+inline int RegionFile::GetSectorsForBytes(size_t numBytes){
+	return (int)((numBytes + REGION_SECTOR_BYTES - 1) / REGION_SECTOR_BYTES);
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline RegionCoords RegionFile::GetRegionCoordsAtChunkCoords(const ChunkCoords& chunkCoords){
+	return RegionCoords(chunkCoords.x >> CHUNKS_PER_REGION_SIDE_EXPONENT, chunkCoords.y >> CHUNKS_PER_REGION_SIDE_EXPONENT);
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline int RegionFile::GetChunkIndexAtChunkCoords(const ChunkCoords& chunkCoords){
+	return (chunkCoords.x & (CHUNKS_PER_REGION_SIDE - 1)) | ((chunkCoords.y & (CHUNKS_PER_REGION_SIDE - 1)) << CHUNKS_PER_REGION_SIDE_EXPONENT);
+}
+
+#endif
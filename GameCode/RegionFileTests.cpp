@@ -0,0 +1,454 @@
+//=====================================================
+// RegionFileTests.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "TestHarness.hpp"
+#include "RegionFile.hpp"
+#include "ChunkJobs.hpp"
+#include "Engine/Time/Time.hpp"
+#include <Windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+const char* const REGION_TEST_DIRECTORY = "RegionTestData";
+const char* const REGION_TEST_FILE_PATH = "RegionTestData/Test.region";
+const int REGION_BENCHMARK_CHUNKS_WIDE = 32; //one full region
+const int NUM_REGION_BENCHMARK_SOURCE_CHUNKS = 16;
+const int NUM_INDEX_BENCHMARK_SAVED_CHUNKS = 100000;
+const int INDEX_BENCHMARK_CHUNKS_WIDE = 10 * CHUNKS_PER_REGION_SIDE;
+const int SESSION_VIEW_CHUNKS_WIDE = 33;
+const int NUM_SESSION_COLUMNS_CROSSED = 64;
+const int SESSION_EDIT_INTERVAL_COLUMNS = 16;
+
+enum SessionSaveMode{
+	SAVE_EVERY_CHUNK_IN_FULL, //what World::DeactivateChunk did before edits were tracked
+	SAVE_EVERY_CHUNK,
+	SAVE_EDITED_CHUNKS
+};
+
+///=====================================================
+/// 
+///=====================================================
+static void DeleteMatchingTestFiles(const std::string& pattern){
+	WIN32_FIND_DATAA findData;
+	HANDLE findHandle = FindFirstFileA((std::string(REGION_TEST_DIRECTORY) + "/" + pattern).c_str(), &findData);
+	if (findHandle == INVALID_HANDLE_VALUE)
+		return;
+
+	do{
+		DeleteFileA((std::string(REGION_TEST_DIRECTORY) + "/" + findData.cFileName).c_str());
+	} while (FindNextFileA(findHandle, &findData));
+	FindClose(findHandle);
+}
+
+///=====================================================
+/// also clears anything left behind by an earlier run that stopped partway
+///=====================================================
+static void ResetTestDirectory(){
+	DeleteMatchingTestFiles("*.region");
+	DeleteMatchingTestFiles("*.chunk");
+	CreateDirectoryA(REGION_TEST_DIRECTORY, NULL);
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void DeleteTestDirectory(){
+	DeleteMatchingTestFiles("*.region");
+	DeleteMatchingTestFiles("*.chunk");
+	RemoveDirectoryA(REGION_TEST_DIRECTORY);
+}
+
+///=====================================================
+/// numBytes of a pattern unique to seed, so a chunk read back from the wrong sectors doesn't match
+///=====================================================
+static std::vector<unsigned char> CreateTestChunkBytes(size_t numBytes, unsigned int seed){
+	std::vector<unsigned char> bytes(numBytes);
+	unsigned int state = seed * 2654435761u + 1u;
+	for (size_t byte = 0; byte < numBytes; ++byte){
+		state = state * 1664525u + 1013904223u;
+		bytes[byte] = (unsigned char)(state >> 24);
+	}
+	return bytes;
+}
+
+///=====================================================
+/// 
+///=====================================================
+static bool DoesRegionChunkMatch(RegionFile& regionFile, int chunkIndex, const std::vector<unsigned char>& expectedBytes){
+	std::vector<unsigned char> buffer(MAX_RLE_BYTES);
+	size_t numBytes = 0;
+	if (!regionFile.ReadChunk(chunkIndex, &buffer[0], buffer.size(), numBytes))
+		return false;
+	return numBytes == expectedBytes.size() && memcmp(&buffer[0], &expectedBytes[0], numBytes) == 0;
+}
+
+///=====================================================
+/// A chunk that outgrows its sectors moves to the end of the file, and the next chunk that fits takes the run it left
+///=====================================================
+static void TestFreedSectorsAreReused(){
+	ResetTestDirectory();
+	RegionFile regionFile;
+	TEST_CHECK(regionFile.Open(REGION_TEST_FILE_PATH));
+
+	const std::vector<unsigned char> firstBytes = CreateTestChunkBytes(3 * REGION_SECTOR_BYTES, 1);
+	const std::vector<unsigned char> secondBytes = CreateTestChunkBytes(2 * REGION_SECTOR_BYTES - 7, 2);
+	const std::vector<unsigned char> grownFirstBytes = CreateTestChunkBytes(5 * REGION_SECTOR_BYTES, 3);
+	const std::vector<unsigned char> thirdBytes = CreateTestChunkBytes(REGION_SECTOR_BYTES + 1, 4);
+	const std::vector<unsigned char> fourthBytes = CreateTestChunkBytes(10, 5);
+
+	TEST_CHECK(regionFile.WriteChunk(0, &firstBytes[0], firstBytes.size()));
+	TEST_CHECK(regionFile.WriteChunk(1, &secondBytes[0], secondBytes.size()));
+	TEST_CHECK(regionFile.GetNumSectors() == REGION_HEADER_SECTORS + 5);
+	TEST_CHECK(regionFile.GetNumFreeSectors() == 0);
+
+	TEST_CHECK(regionFile.WriteChunk(0, &grownFirstBytes[0], grownFirstBytes.size()));
+	TEST_CHECK(regionFile.GetNumSectors() == REGION_HEADER_SECTORS + 10);
+	TEST_CHECK(regionFile.GetNumFreeSectors() == 3);
+
+	TEST_CHECK(regionFile.WriteChunk(2, &thirdBytes[0], thirdBytes.size()));
+	TEST_CHECK(regionFile.GetNumSectors() == REGION_HEADER_SECTORS + 10);
+	TEST_CHECK(regionFile.GetNumFreeSectors() == 1);
+
+	TEST_CHECK(regionFile.WriteChunk(3, &fourthBytes[0], fourthBytes.size()));
+	TEST_CHECK(regionFile.GetNumSectors() == REGION_HEADER_SECTORS + 10);
+	TEST_CHECK(regionFile.GetNumFreeSectors() == 0);
+
+	TEST_CHECK(DoesRegionChunkMatch(regionFile, 0, grownFirstBytes));
+	TEST_CHECK(DoesRegionChunkMatch(regionFile, 1, secondBytes));
+	TEST_CHECK(DoesRegionChunkMatch(regionFile, 2, thirdBytes));
+	TEST_CHECK(DoesRegionChunkMatch(regionFile, 3, fourthBytes));
+	TEST_CHECK(!regionFile.HasChunk(4));
+	regionFile.Close();
+}
+
+///=====================================================
+/// A chunk that still fits is rewritten where it is, and the sectors it no longer needs are freed for others
+///=====================================================
+static void TestShrinkingChunkIsOverwrittenInPlace(){
+	ResetTestDirectory();
+	RegionFile regionFile;
+	TEST_CHECK(regionFile.Open(REGION_TEST_FILE_PATH));
+
+	const std::vector<unsigned char> largeBytes = CreateTestChunkBytes(4 * REGION_SECTOR_BYTES, 10);
+	const std::vector<unsigned char> neighborBytes = CreateTestChunkBytes(REGION_SECTOR_BYTES, 11);
+	const std::vector<unsigned char> smallBytes = CreateTestChunkBytes(REGION_SECTOR_BYTES - 100, 12);
+	const std::vector<unsigned char> fillerBytes = CreateTestChunkBytes(3 * REGION_SECTOR_BYTES, 13);
+
+	TEST_CHECK(regionFile.WriteChunk(5, &largeBytes[0], largeBytes.size()));
+	TEST_CHECK(regionFile.WriteChunk(6, &neighborBytes[0], neighborBytes.size()));
+	TEST_CHECK(regionFile.WriteChunk(5, &smallBytes[0], smallBytes.size()));
+	TEST_CHECK(regionFile.GetNumSectors() == REGION_HEADER_SECTORS + 5);
+	TEST_CHECK(regionFile.GetNumFreeSectors() == 3);
+	TEST_CHECK(DoesRegionChunkMatch(regionFile, 5, smallBytes));
+
+	//rewriting at the same size stays in place too
+	TEST_CHECK(regionFile.WriteChunk(5, &smallBytes[0], smallBytes.size()));
+	TEST_CHECK(regionFile.GetNumFreeSectors() == 3);
+
+	TEST_CHECK(regionFile.WriteChunk(7, &fillerBytes[0], fillerBytes.size()));
+	TEST_CHECK(regionFile.GetNumSectors() == REGION_HEADER_SECTORS + 5);
+	TEST_CHECK(regionFile.GetNumFreeSectors() == 0);
+
+	TEST_CHECK(DoesRegionChunkMatch(regionFile, 5, smallBytes));
+	TEST_CHECK(DoesRegionChunkMatch(regionFile, 6, neighborBytes));
+	TEST_CHECK(DoesRegionChunkMatch(regionFile, 7, fillerBytes));
+	regionFile.Close();
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void WriteTestHeaderEntry(int chunkIndex, unsigned int firstSector, unsigned int numBytes){
+	FILE* file = NULL;
+	if (fopen_s(&file, REGION_TEST_FILE_PATH, "r+b") != 0)
+		return;
+
+	RegionChunkEntry entry;
+	entry.m_firstSector = firstSector;
+	entry.m_numBytes = numBytes;
+	fseek(file, chunkIndex * sizeof(RegionChunkEntry), SEEK_SET);
+	fwrite(&entry, sizeof(entry), 1, file);
+	fclose(file);
+}
+
+///=====================================================
+/// Reopening keeps good chunks and their sectors, and drops entries that overlap, point into the header, or run past the end
+///=====================================================
+static void TestHeaderIsValidatedOnReopen(){
+	ResetTestDirectory();
+	const std::vector<unsigned char> firstBytes = CreateTestChunkBytes(2 * REGION_SECTOR_BYTES, 20);
+	const std::vector<unsigned char> secondBytes = CreateTestChunkBytes(REGION_SECTOR_BYTES / 2, 21);
+	const std::vector<unsigned char> grownSecondBytes = CreateTestChunkBytes(3 * REGION_SECTOR_BYTES, 22);
+	{
+		RegionFile regionFile;
+		TEST_CHECK(regionFile.Open(REGION_TEST_FILE_PATH));
+		TEST_CHECK(regionFile.WriteChunk(0, &firstBytes[0], firstBytes.size()));
+		TEST_CHECK(regionFile.WriteChunk(1, &secondBytes[0], secondBytes.size()));
+		TEST_CHECK(regionFile.WriteChunk(1, &grownSecondBytes[0], grownSecondBytes.size())); //leaves one free sector behind
+	}
+
+	RegionFile regionFile;
+	TEST_CHECK(regionFile.Open(REGION_TEST_FILE_PATH));
+	TEST_CHECK(DoesRegionChunkMatch(regionFile, 0, firstBytes));
+	TEST_CHECK(DoesRegionChunkMatch(regionFile, 1, grownSecondBytes));
+	TEST_CHECK(regionFile.GetNumSectors() == REGION_HEADER_SECTORS + 6);
+	TEST_CHECK(regionFile.GetNumFreeSectors() == 1);
+	regionFile.Close();
+
+	WriteTestHeaderEntry(2, REGION_HEADER_SECTORS + 1, REGION_SECTOR_BYTES); //overlaps chunk 0
+	WriteTestHeaderEntry(3, REGION_HEADER_SECTORS + 5, 2 * REGION_SECTOR_BYTES); //runs past the end
+	WriteTestHeaderEntry(4, 0, 100); //inside the header
+	WriteTestHeaderEntry(5, REGION_HEADER_SECTORS + 2, 10); //the free sector, which is fine
+	TEST_CHECK(regionFile.Open(REGION_TEST_FILE_PATH));
+	TEST_CHECK(!regionFile.HasChunk(2));
+	TEST_CHECK(!regionFile.HasChunk(3));
+	TEST_CHECK(!regionFile.HasChunk(4));
+	TEST_CHECK(regionFile.HasChunk(5));
+	TEST_CHECK(regionFile.GetNumFreeSectors() == 0);
+	TEST_CHECK(DoesRegionChunkMatch(regionFile, 0, firstBytes));
+	TEST_CHECK(DoesRegionChunkMatch(regionFile, 1, grownSecondBytes));
+
+	std::vector<unsigned char> buffer(REGION_SECTOR_BYTES);
+	size_t numBytes = 0;
+	TEST_CHECK(!regionFile.ReadChunk(2, &buffer[0], buffer.size(), numBytes));
+	TEST_CHECK(!regionFile.ReadChunk(1, &buffer[0], buffer.size(), numBytes)); //too big for the buffer
+	regionFile.Close();
+
+	//a header cut short can't be trusted at all
+	FILE* file = NULL;
+	TEST_CHECK(fopen_s(&file, REGION_TEST_FILE_PATH, "wb") == 0);
+	if (file != NULL){
+		const std::vector<unsigned char> partialHeader(REGION_SECTOR_BYTES, 0xFF);
+		fwrite(&partialHeader[0], 1, partialHeader.size(), file);
+		fclose(file);
+	}
+	TEST_CHECK(regionFile.Open(REGION_TEST_FILE_PATH));
+	bool hasAnyChunk = false;
+	for (int chunkIndex = 0; chunkIndex < CHUNKS_PER_REGION; ++chunkIndex){
+		hasAnyChunk = hasAnyChunk || regionFile.HasChunk(chunkIndex);
+	}
+	TEST_CHECK(!hasAnyChunk);
+	regionFile.Close();
+}
+
+///=====================================================
+/// 
+///=====================================================
+static void WriteTestChunkFile(const std::string& fileName, const std::vector<unsigned char>& bytes){
+	FILE* file = NULL;
+	if (fopen_s(&file, (std::string(REGION_TEST_DIRECTORY) + "/" + fileName).c_str(), "wb") != 0)
+		return;
+	if (!bytes.empty())
+		fwrite(&bytes[0], 1, bytes.size(), file);
+	fclose(file);
+}
+
+///=====================================================
+/// Old per-chunk files move into their regions, across region boundaries and at negative coords; files that aren't chunks stay
+///=====================================================
+static void TestChunkFilesAreConverted(){
+	ResetTestDirectory();
+	const ChunkCoords convertedCoords[3] = {ChunkCoords(3, -2), ChunkCoords(-33, 40), ChunkCoords(31, 31)};
+	std::vector<unsigned char> convertedBytes[3];
+	for (int chunk = 0; chunk < 3; ++chunk){
+		convertedBytes[chunk] = CreateTestChunkBytes(700 + chunk * 900, 30 + chunk);
+		std::stringstream ss;
+		ss << "Chunk" << convertedCoords[chunk].x << "," << convertedCoords[chunk].y << ".chunk";
+		WriteTestChunkFile(ss.str(), convertedBytes[chunk]);
+	}
+	WriteTestChunkFile("Chunk5,5.chunk", std::vector<unsigned char>());
+	WriteTestChunkFile("ChunkNotCoords.chunk", CreateTestChunkBytes(100, 40));
+
+	RegionFileCache regionFiles(REGION_TEST_DIRECTORY);
+	TEST_CHECK(regionFiles.ConvertChunkFiles(REGION_TEST_DIRECTORY) == 3);
+
+	std::vector<unsigned char> buffer(MAX_RLE_BYTES);
+	for (int chunk = 0; chunk < 3; ++chunk){
+		size_t numBytes = 0;
+		const bool didLoad = regionFiles.LoadChunk(convertedCoords[chunk], &buffer[0], buffer.size(), numBytes);
+		TEST_CHECK(didLoad && numBytes == convertedBytes[chunk].size() && memcmp(&buffer[0], &convertedBytes[chunk][0], numBytes) == 0);
+	}
+	size_t numBytes = 0;
+	TEST_CHECK(!regionFiles.LoadChunk(ChunkCoords(5, 5), &buffer[0], buffer.size(), numBytes));
+	TEST_CHECK(!regionFiles.LoadChunk(ChunkCoords(4, -2), &buffer[0], buffer.size(), numBytes));
+
+	TEST_CHECK(GetFileAttributesA((std::string(REGION_TEST_DIRECTORY) + "/Chunk3,-2.chunk").c_str()) == INVALID_FILE_ATTRIBUTES);
+	TEST_CHECK(GetFileAttributesA((std::string(REGION_TEST_DIRECTORY) + "/Chunk5,5.chunk").c_str()) != INVALID_FILE_ATTRIBUTES);
+	TEST_CHECK(GetFileAttributesA((std::string(REGION_TEST_DIRECTORY) + "/ChunkNotCoords.chunk").c_str()) != INVALID_FILE_ATTRIBUTES);
+
+	//converting again finds nothing new, and the index sees all three after a restart
+	TEST_CHECK(regionFiles.ConvertChunkFiles(REGION_TEST_DIRECTORY) == 0);
+	regionFiles.CloseAll();
+	SavedChunkIndex savedChunks;
+	regionFiles.IndexSavedChunks(savedChunks);
+	TEST_CHECK(savedChunks.GetNumSavedChunks() == 3);
+	TEST_CHECK(savedChunks.HasChunk(ChunkCoords(-33, 40)));
+	TEST_CHECK(!savedChunks.HasChunk(ChunkCoords(5, 5)));
+}
+
+///=====================================================
+/// Saves a full region of generated chunks, resaves them in place, then loads them back through a fresh cache.
+/// The files are new and small, so this measures the region code and the OS file cache rather than the disk.
+///=====================================================
+static void BenchmarkRegionFiles(){
+	ResetTestDirectory();
+	std::vector<std::vector<unsigned char> > sourceBuffers(NUM_REGION_BENCHMARK_SOURCE_CHUNKS);
+	for (int source = 0; source < NUM_REGION_BENCHMARK_SOURCE_CHUNKS; ++source){
+		Chunk* chunk = new Chunk();
+		chunk->m_worldCoordsMins = Chunk::GetWorldCoordsAtChunkCoords(ChunkCoords(source * 7, source * 3));
+		chunk->PopulateWithBlocks();
+		chunk->CreateRLEBuffer(sourceBuffers[source]);
+		delete chunk;
+	}
+
+	const int numChunks = REGION_BENCHMARK_CHUNKS_WIDE * REGION_BENCHMARK_CHUNKS_WIDE;
+	size_t numBytesSaved = 0;
+	RegionFileCache regionFiles(REGION_TEST_DIRECTORY);
+	double startSeconds = GetCurrentSeconds();
+	for (int chunk = 0; chunk < numChunks; ++chunk){
+		const std::vector<unsigned char>& buffer = sourceBuffers[chunk % NUM_REGION_BENCHMARK_SOURCE_CHUNKS];
+		regionFiles.SaveChunk(ChunkCoords(chunk % REGION_BENCHMARK_CHUNKS_WIDE, chunk / REGION_BENCHMARK_CHUNKS_WIDE), &buffer[0], buffer.size());
+		numBytesSaved += buffer.size();
+	}
+	regionFiles.CloseAll();
+	const double saveSeconds = GetCurrentSeconds() - startSeconds;
+
+	startSeconds = GetCurrentSeconds();
+	for (int chunk = 0; chunk < numChunks; ++chunk){
+		const std::vector<unsigned char>& buffer = sourceBuffers[chunk % NUM_REGION_BENCHMARK_SOURCE_CHUNKS];
+		regionFiles.SaveChunk(ChunkCoords(chunk % REGION_BENCHMARK_CHUNKS_WIDE, chunk / REGION_BENCHMARK_CHUNKS_WIDE), &buffer[0], buffer.size());
+	}
+	regionFiles.CloseAll();
+	const double resaveSeconds = GetCurrentSeconds() - startSeconds;
+
+	std::vector<unsigned char> loadBuffer(MAX_RLE_BYTES);
+	int numChunksMatched = 0;
+	startSeconds = GetCurrentSeconds();
+	for (int chunk = 0; chunk < numChunks; ++chunk){
+		size_t numBytes = 0;
+		if (regionFiles.LoadChunk(ChunkCoords(chunk % REGION_BENCHMARK_CHUNKS_WIDE, chunk / REGION_BENCHMARK_CHUNKS_WIDE), &loadBuffer[0], loadBuffer.size(), numBytes) && numBytes == sourceBuffers[chunk % NUM_REGION_BENCHMARK_SOURCE_CHUNKS].size())
+			++numChunksMatched;
+	}
+	regionFiles.CloseAll();
+	const double loadSeconds = GetCurrentSeconds() - startSeconds;
+	TEST_CHECK(numChunksMatched == numChunks);
+
+	const double numMegabytes = numBytesSaved / (1024.0 * 1024.0);
+	printf("  %d chunks, %d bytes each on average\n", numChunks, (int)(numBytesSaved / numChunks));
+	printf("  save %.0f chunks/sec (%.1f MB/sec), resave %.0f chunks/sec, load %.0f chunks/sec (%.1f MB/sec)\n", numChunks / saveSeconds, numMegabytes / saveSeconds, numChunks / resaveSeconds, numChunks / loadSeconds, numMegabytes / loadSeconds);
+}
+
+///=====================================================
+/// Startup cost of indexing a world with 100k saved chunks, in about 100 region files this writes first.
+/// Each chunk is a single sector, since indexing only reads the headers. The files were just written, so they're in the OS file cache.
+///=====================================================
+static void BenchmarkIndexingSavedChunks(){
+	ResetTestDirectory();
+	const std::vector<unsigned char> chunkBytes = CreateTestChunkBytes(REGION_SECTOR_BYTES / 2, 40);
+	{
+		RegionFileCache regionFiles(REGION_TEST_DIRECTORY);
+		for (int chunk = 0; chunk < NUM_INDEX_BENCHMARK_SAVED_CHUNKS; ++chunk){
+			regionFiles.SaveChunk(ChunkCoords(chunk % INDEX_BENCHMARK_CHUNKS_WIDE, chunk / INDEX_BENCHMARK_CHUNKS_WIDE), &chunkBytes[0], chunkBytes.size());
+		}
+	}
+
+	const double startSeconds = GetCurrentSeconds();
+	RegionFileCache regionFiles(REGION_TEST_DIRECTORY);
+	SavedChunkIndex savedChunkIndex;
+	regionFiles.IndexSavedChunks(savedChunkIndex);
+	const double indexSeconds = GetCurrentSeconds() - startSeconds;
+	regionFiles.CloseAll();
+
+	const ChunkCoords lastSavedChunkCoords((NUM_INDEX_BENCHMARK_SAVED_CHUNKS - 1) % INDEX_BENCHMARK_CHUNKS_WIDE, (NUM_INDEX_BENCHMARK_SAVED_CHUNKS - 1) / INDEX_BENCHMARK_CHUNKS_WIDE);
+	TEST_CHECK(savedChunkIndex.GetNumSavedChunks() == NUM_INDEX_BENCHMARK_SAVED_CHUNKS);
+	TEST_CHECK(savedChunkIndex.HasChunk(ChunkCoords(0, 0)) && savedChunkIndex.HasChunk(lastSavedChunkCoords));
+	TEST_CHECK(!savedChunkIndex.HasChunk(ChunkCoords(lastSavedChunkCoords.x + 1, lastSavedChunkCoords.y)) && !savedChunkIndex.HasChunk(ChunkCoords(-1, 0)));
+
+	const int numRegionFiles = ((INDEX_BENCHMARK_CHUNKS_WIDE + CHUNKS_PER_REGION_SIDE - 1) / CHUNKS_PER_REGION_SIDE) * (lastSavedChunkCoords.y / CHUNKS_PER_REGION_SIDE + 1);
+	printf("  indexed %d saved chunks in %d region files in %.1f ms\n", savedChunkIndex.GetNumSavedChunks(), numRegionFiles, indexSeconds * 1000.0);
+	ResetTestDirectory();
+}
+
+///=====================================================
+/// Flies east across a 33 chunk wide view, deactivating a column of chunks each step and placing a block every 16 columns.
+/// Each chunk is generated as it leaves the view, with the edit it received, then saved as the mode says; returns the bytes written.
+/// SAVE_EVERY_CHUNK still goes through ChunkSaveJob, so unedited chunks only write an empty delta.
+///=====================================================
+static size_t SaveTestSessionChunks(SessionSaveMode saveMode, int& out_numSaves){
+	ResetTestDirectory();
+	RegionFileCache regionFiles(REGION_TEST_DIRECTORY);
+	Chunk* chunk = new Chunk();
+	BlockLocations dirtyBlocks;
+	std::vector<unsigned char> rleBuffer;
+	size_t numBytesSaved = 0;
+	out_numSaves = 0;
+
+	for (int column = 0; column < NUM_SESSION_COLUMNS_CROSSED; ++column){
+		for (int chunkY = -SESSION_VIEW_CHUNKS_WIDE / 2; chunkY <= SESSION_VIEW_CHUNKS_WIDE / 2; ++chunkY){
+			const ChunkCoords chunkCoords(column, chunkY);
+			chunk->Reset();
+			chunk->m_worldCoordsMins = Chunk::GetWorldCoordsAtChunkCoords(chunkCoords);
+			chunk->PopulateWithBlocks();
+			if (column % SESSION_EDIT_INTERVAL_COLUMNS == 0 && chunkY == 0){
+				chunk->PlaceBlockBeneathCoords(BT_GLOWSTONE, chunk->m_worldCoordsMins + Vec3(7.5f, 7.5f, (float)BLOCKS_PER_CHUNK_Z - 0.5f), dirtyBlocks);
+				dirtyBlocks.clear();
+			}
+
+			if (saveMode == SAVE_EDITED_CHUNKS && !chunk->m_hasUnsavedEdits)
+				continue;
+
+			if (saveMode == SAVE_EVERY_CHUNK_IN_FULL){
+				chunk->CreateRLEBuffer(rleBuffer);
+				if (regionFiles.SaveChunk(chunkCoords, &rleBuffer[0], rleBuffer.size()))
+					numBytesSaved += rleBuffer.size();
+			}
+			else{
+				ChunkSaveJob saveJob(chunkCoords, *chunk, regionFiles);
+				saveJob.Execute();
+				numBytesSaved += saveJob.m_numBytesSaved;
+			}
+			++out_numSaves;
+		}
+	}
+
+	regionFiles.CloseAll();
+	delete chunk;
+	return numBytesSaved;
+}
+
+///=====================================================
+/// Bytes written over a session of flying across the map, before and after unedited chunks stopped being saved
+///=====================================================
+static void BenchmarkSessionBytesSaved(){
+	int numFullSaves, numSaves, numEditedSaves;
+	const size_t numFullBytesSaved = SaveTestSessionChunks(SAVE_EVERY_CHUNK_IN_FULL, numFullSaves);
+	const size_t numBytesSaved = SaveTestSessionChunks(SAVE_EVERY_CHUNK, numSaves);
+	const size_t numEditedBytesSaved = SaveTestSessionChunks(SAVE_EDITED_CHUNKS, numEditedSaves);
+	TEST_CHECK(numFullSaves == NUM_SESSION_COLUMNS_CROSSED * SESSION_VIEW_CHUNKS_WIDE && numSaves == numFullSaves);
+	TEST_CHECK(numEditedSaves == NUM_SESSION_COLUMNS_CROSSED / SESSION_EDIT_INTERVAL_COLUMNS);
+	TEST_CHECK(numEditedBytesSaved > 0 && numEditedBytesSaved < numBytesSaved && numBytesSaved < numFullBytesSaved);
+
+	printf("  crossing %d columns of a %d chunk view, placing a block every %d:\n", NUM_SESSION_COLUMNS_CROSSED, SESSION_VIEW_CHUNKS_WIDE, SESSION_EDIT_INTERVAL_COLUMNS);
+	printf("  every chunk in full %d saves, %d bytes; every chunk %d saves, %d bytes; edited chunks %d saves, %d bytes\n",
+		numFullSaves, (int)numFullBytesSaved, numSaves, (int)numBytesSaved, numEditedSaves, (int)numEditedBytesSaved);
+}
+
+///=====================================================
+/// 
+///=====================================================
+void RunRegionFileTests(){
+	printf("Region files\n");
+	TestFreedSectorsAreReused();
+	TestShrinkingChunkIsOverwrittenInPlace();
+	TestHeaderIsValidatedOnReopen();
+	TestChunkFilesAreConverted();
+	BenchmarkRegionFiles();
+	BenchmarkIndexingSavedChunks();
+	BenchmarkSessionBytesSaved();
+	DeleteTestDirectory();
+}
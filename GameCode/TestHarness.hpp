@@ -0,0 +1,33 @@
+//=====================================================
+// TestHarness.hpp
+// by Andrew Socha
+//=====================================================
+
+#pragma once
+
+#ifndef __included_TestHarness__
+#define __included_TestHarness__
+
+///=====================================================
+/// Minimal check counting for the headless SimpleMinerTests console target.
+/// Failed checks are printed with their file and line; the process exits nonzero if any failed.
+///=====================================================
+bool RecordTestCheck(bool didPass, const char* expression, const char* file, int line);
+#define TEST_CHECK(condition) RecordTestCheck((condition), #condition, __FILE__, __LINE__)
+
+void SetUpTestBlockDefinitions();
+
+void RunNoiseTests();
+void RunChunkMeshTests();
+void RunBlockCollisionTests();
+void RunRaycastTests();
+void RunLightingTests();
+void RunChunkSaveTests();
+void RunPalettedBlockStorageTests();
+void RunChunkRegistryTests();
+void RunRegionFileTests();
+void RunJobSystemTests();
+void RunRadixSortTests();
+void RunWorldBlockAccessorTests();
+
+#endif
@@ -0,0 +1,83 @@
+//=====================================================
+// TestWorld.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "TestWorld.hpp"
+#include <string.h>
+
+///=====================================================
+/// 
+///=====================================================
+TestWorld::~TestWorld(){
+	for (std::vector<Chunk*>::iterator chunkIter = m_ownedChunks.begin(); chunkIter != m_ownedChunks.end(); ++chunkIter){
+		delete *chunkIter;
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+Chunk* TestWorld::FindChunk(const ChunkCoords& chunkCoords) const{
+	Chunks::const_iterator chunkIter = m_chunks.find(chunkCoords);
+	return (chunkIter == m_chunks.end()) ? NULL : chunkIter->second;
+}
+
+///=====================================================
+/// chunk coord ranges are inclusive
+///=====================================================
+void TestWorld::AddAirChunks(const ChunkCoords& chunkCoordsMins, const ChunkCoords& chunkCoordsMaxs){
+	for (int chunkY = chunkCoordsMins.y; chunkY <= chunkCoordsMaxs.y; ++chunkY){
+		for (int chunkX = chunkCoordsMins.x; chunkX <= chunkCoordsMaxs.x; ++chunkX){
+			const ChunkCoords chunkCoords(chunkX, chunkY);
+			Chunk* chunk = new Chunk();
+			chunk->m_worldCoordsMins = Chunk::GetWorldCoordsAtChunkCoords(chunkCoords);
+			for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+				chunk->m_sections[section].m_blockTypes.Fill(BT_AIR);
+			}
+			memset(chunk->m_lightValues, FULL_SKY_LIGHT_VALUE, sizeof(chunk->m_lightValues));
+			memset(chunk->m_lightDirtyBits, 0, sizeof(chunk->m_lightDirtyBits));
+			memset(chunk->m_skyHeights, 0, sizeof(chunk->m_skyHeights));
+			m_ownedChunks.push_back(chunk);
+			m_chunks[chunkCoords] = chunk;
+		}
+	}
+
+	for (Chunks::iterator chunkIter = m_chunks.begin(); chunkIter != m_chunks.end(); ++chunkIter){
+		const ChunkCoords& chunkCoords = chunkIter->first;
+		Chunk* chunk = chunkIter->second;
+		chunk->m_chunkToNorth = FindChunk(ChunkCoords(chunkCoords.x, chunkCoords.y + 1));
+		chunk->m_chunkToSouth = FindChunk(ChunkCoords(chunkCoords.x, chunkCoords.y - 1));
+		chunk->m_chunkToEast = FindChunk(ChunkCoords(chunkCoords.x + 1, chunkCoords.y));
+		chunk->m_chunkToWest = FindChunk(ChunkCoords(chunkCoords.x - 1, chunkCoords.y));
+	}
+}
+
+///=====================================================
+/// the block's chunk must already be added
+///=====================================================
+void TestWorld::SetBlockType(int blockX, int blockY, int blockZ, BlockType blockType){
+	Chunk* chunk = m_chunks.at(ChunkCoords(blockX >> CHUNKS_WIDE_EXPONENT, blockY >> CHUNKS_LONG_EXPONENT));
+	chunk->SetBlockType(Chunk::GetIndexAtLocalCoords(LocalCoords(blockX & CHUNK_X_MASK, blockY & CHUNK_Y_MASK, blockZ)), (unsigned char)blockType);
+}
+
+///=====================================================
+/// block coord ranges are inclusive
+///=====================================================
+void TestWorld::FillBlocks(int blockMinX, int blockMinY, int blockMinZ, int blockMaxX, int blockMaxY, int blockMaxZ, BlockType blockType){
+	for (int blockZ = blockMinZ; blockZ <= blockMaxZ; ++blockZ){
+		for (int blockY = blockMinY; blockY <= blockMaxY; ++blockY){
+			for (int blockX = blockMinX; blockX <= blockMaxX; ++blockX){
+				SetBlockType(blockX, blockY, blockZ, blockType);
+			}
+		}
+	}
+}
+
+///=====================================================
+/// 
+///=====================================================
+unsigned char TestWorld::GetBlockType(int blockX, int blockY, int blockZ) const{
+	const Chunk* chunk = m_chunks.at(ChunkCoords(blockX >> CHUNKS_WIDE_EXPONENT, blockY >> CHUNKS_LONG_EXPONENT));
+	return chunk->GetBlockType(Chunk::GetIndexAtLocalCoords(LocalCoords(blockX & CHUNK_X_MASK, blockY & CHUNK_Y_MASK, blockZ)));
+}
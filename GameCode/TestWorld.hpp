@@ -0,0 +1,38 @@
+//=====================================================
+// TestWorld.hpp
+// by Andrew Socha
+//=====================================================
+
+#pragma once
+
+#ifndef __included_TestWorld__
+#define __included_TestWorld__
+
+#include "ChunkRegistry.hpp"
+
+///=====================================================
+/// A hand-built set of active chunks for the headless tests, linked to their neighbors the way World links them.
+/// Chunks start as all air under full sky light; blocks are then placed by world block coordinates.
+///=====================================================
+class TestWorld{
+private:
+	std::vector<Chunk*> m_ownedChunks;
+
+	Chunk* FindChunk(const ChunkCoords& chunkCoords) const;
+
+	TestWorld(const TestWorld&);
+	TestWorld& operator=(const TestWorld&);
+
+public:
+	Chunks m_chunks;
+
+	TestWorld(){}
+	~TestWorld();
+
+	void AddAirChunks(const ChunkCoords& chunkCoordsMins, const ChunkCoords& chunkCoordsMaxs);
+	void SetBlockType(int blockX, int blockY, int blockZ, BlockType blockType);
+	void FillBlocks(int blockMinX, int blockMinY, int blockMinZ, int blockMaxX, int blockMaxY, int blockMaxZ, BlockType blockType);
+	unsigned char GetBlockType(int blockX, int blockY, int blockZ) const;
+};
+
+#endif
@@ -10,11 +10,19 @@
 #include "Engine/Renderer/AnimatedTexture.hpp"
 #include "Engine/Renderer/Camera.hpp"
 #include "Engine/Input/InputSystem.hpp"
+#include "ChunkJobs.hpp"
+#include "BlockCollision.hpp"
+#include "BlockRaycast.hpp"
+#include "WorldBlockAccessor.hpp"
+#include "RadixSort.hpp"
+#include <algorithm>
 
 const int INNER_VISIBILITY_DISTANCE = 15;
 const int INNER_DISTANCE_THERMOSTAT_QUALIFICATION = (INNER_VISIBILITY_DISTANCE) * (INNER_VISIBILITY_DISTANCE) + 1;
 const int OUTER_VISIBILITY_DISTANCE = INNER_VISIBILITY_DISTANCE + 1;
 const int OUTER_DISTANCE_THERMOSTAT_QUALIFICATION = (OUTER_VISIBILITY_DISTANCE) * (OUTER_VISIBILITY_DISTANCE);
+const int CHUNK_POOL_CAPACITY = (2 * OUTER_VISIBILITY_DISTANCE + 1) * (2 * OUTER_VISIBILITY_DISTANCE + 1); //every chunk coord that can ever be active at once
+const int MAX_PENDING_MESHES_PER_WORKER = 4; //each pooled mesh job holds a snapshot about the size of one chunk
 
 const Vec2 MOUSE_RESET_POSITION(400.0f, 300.0f);
 
@@ -27,6 +35,17 @@ const float CAMERA_HEIGHT = 1.62f;
 ///=====================================================
 World::World()
 :m_isRunning(true),
+m_chunkPool(CHUNK_POOL_CAPACITY),
+m_regionFiles("Data/Regions"),
+m_nextMeshRevision(1),
+m_numPendingMeshes(0),
+m_numPendingChunkLoads(0),
+m_numCoalescedChunkLoads(0),
+m_numChunkSavesSkipped(0),
+m_numChunkLoadsSkipped(0),
+m_numChunkBytesSaved(0),
+m_nextChunkIOLatencySample(0),
+m_numMeshesCompletedThisFrame(0),
 m_textureAtlas(0),
 m_skybox(0),
 m_camera(0),
@@ -37,6 +56,7 @@ m_playerIsNoClip(false),
 m_playerIsOnGround(false),
 m_playerIsOnIce(false),
 m_playerIsInWater(false),
+m_isRainingAtCamera(false),
 m_countUntilNextWalkSound(0.0),
 m_rainSound(0),
 m_currentMusic(NULL),
@@ -47,6 +67,10 @@ m_rainTexture(NULL),
 m_splashSound(-1),
 m_timeUntilThunder(GetRandomDoubleInRange(2.0, 5.0)),
 m_lightLevel(DAYLIGHT),
+m_maxLightUpdatesPerFrame(DEFAULT_MAX_LIGHT_UPDATES_PER_FRAME),
+m_numLightUpdatesThisFrame(0),
+m_numSortedDirtyBlocks(0),
+m_dirtyBlocksSortCameraCoords(0, 0, 0),
 m_selectedBlockType((BlockType)1),
 m_playerBox(Vec3(0.0f, 0.0f, Chunk::SEA_LEVEL), Vec3(PLAYER_WIDTH, PLAYER_WIDTH, Chunk::SEA_LEVEL + PLAYER_HEIGHT)),
 m_playerLocalVelocity(0.0f, 0.0f, 0.0f){
@@ -75,6 +99,15 @@ void World::Startup(){
 	s_theInputSystem->SetMousePosition(MOUSE_RESET_POSITION);
 
 	m_dirtyBlocks.reserve(10000);
+	PackedBlockVertex::SetSkyLightLevel(m_lightLevel);
+
+	m_regionFiles.ConvertChunkFiles("Data/Chunks"); //saves from before region files existed
+	m_regionFiles.IndexSavedChunks(m_savedChunks);
+
+	m_jobSystem.Startup(JobSystem::GetDefaultNumWorkerThreads());
+	m_ioJobSystem.Startup(NUM_CHUNK_IO_THREADS);
+	m_freeMeshJobs.reserve(MAX_PENDING_MESHES_PER_WORKER * max(m_jobSystem.GetNumWorkerThreads(), 1));
+	m_chunkIOLatencies.reserve(NUM_CHUNK_IO_LATENCY_SAMPLES);
 }
 
 ///=====================================================
@@ -85,11 +118,25 @@ void World::Shutdown(const OpenGLRenderer* renderer){
 
 	m_isRunning = false;
 
+	m_jobSystem.Shutdown();
+	ProcessCompletedJobs(renderer);
+
+	//every save is queued before waiting on any, so the I/O thread writes while the rest are still being encoded
 	Chunks::iterator mapIter;
 	while (!m_activeChunks.empty()){
 		mapIter = m_activeChunks.begin();
 		DeactivateChunk(mapIter->first, renderer);
 	}
+
+	m_ioJobSystem.Shutdown();
+	ProcessCompletedJobs(renderer);
+
+	m_chunkPool.Clear(renderer);
+	for (std::vector<ChunkMeshJob*>::iterator meshJobIter = m_freeMeshJobs.begin(); meshJobIter != m_freeMeshJobs.end(); ++meshJobIter){
+		delete *meshJobIter;
+	}
+	m_freeMeshJobs.clear();
+	m_regionFiles.CloseAll();
 }
 
 ///=====================================================
@@ -100,7 +147,7 @@ void World::Update(double deltaSeconds, const OpenGLRenderer* renderer){
 		g_debugPointsEnabled = !g_debugPointsEnabled;
 		g_debugPositions.clear();
 		if (!g_debugPointsEnabled){
-			m_dirtyBlocks = m_nextDirtyBlocksDebug;
+			m_dirtyBlocks.insert(m_dirtyBlocks.end(), m_nextDirtyBlocksDebug.begin(), m_nextDirtyBlocksDebug.end()); //appended, since the chunks count every queued block
 			m_nextDirtyBlocksDebug.clear();
 		}
 		else{
@@ -109,9 +156,19 @@ void World::Update(double deltaSeconds, const OpenGLRenderer* renderer){
 		}
 	}
 	
+	if (s_theInputSystem->IsKeyDown('L') && s_theInputSystem->DidStateJustChange('L')){
+		if (m_lightLevel == DAYLIGHT)
+			SetLightLevel(MEDIUMLIGHT);
+		else if (m_lightLevel == MEDIUMLIGHT)
+			SetLightLevel(MOONLIGHT);
+		else
+			SetLightLevel(DAYLIGHT);
+	}
+	
 	UpdateBlockSelectionTab();
 
-	ActivateNearestNeededChunk();
+	ProcessCompletedJobs(renderer);
+	ActivateNearestNeededChunks();
 	DeactivateFurthestChunk(renderer);
 
 	if (m_camera){
@@ -121,7 +178,7 @@ void World::Update(double deltaSeconds, const OpenGLRenderer* renderer){
 	PlaceOrRemoveBlockWithRaycast();
 
 	if (g_debugPointsEnabled && s_theInputSystem->IsKeyDown('C') && s_theInputSystem->DidStateJustChange('C')){
-		m_dirtyBlocks = m_nextDirtyBlocksDebug;
+		m_dirtyBlocks.insert(m_dirtyBlocks.end(), m_nextDirtyBlocksDebug.begin(), m_nextDirtyBlocksDebug.end());
 		m_nextDirtyBlocksDebug.clear();
 		m_nextDirtyBlocksDebug.reserve(10000);
 		g_debugPositions.clear();
@@ -129,12 +186,16 @@ void World::Update(double deltaSeconds, const OpenGLRenderer* renderer){
 	}
 
 	UpdateLighting();
+	m_isRainingAtCamera = IsRainingAtCamera();
 	UpdateSoundAndMusic(deltaSeconds);
 
 	for (Chunks::iterator chunkIter = m_activeChunks.begin(); chunkIter != m_activeChunks.end(); ++chunkIter){
 		Chunk* chunk = chunkIter->second;
 		chunk->Update(deltaSeconds);
 	}
+
+	RequestDirtyChunkMeshes();
+	RefreshChunkVboLighting(renderer);
 }
 
 ///=====================================================
@@ -164,7 +225,7 @@ void World::Draw(const OpenGLRenderer* renderer) const{
 		renderer->DrawOverlay(RGBA((float)m_timeUntilThunder * (4.0f / 3.0f), (float)m_timeUntilThunder * (4.0f / 3.0f), (float)m_timeUntilThunder * (4.0f / 3.0f), 0.4f + 0.6f * (float)m_timeUntilThunder));
 		//lightning that transitions into the normal rain overlay
 
-	else if (Chunk::IsRainingAtWorldCoords(m_camera->m_position))
+	else if (m_isRainingAtCamera)
 		renderer->DrawOverlay(RGBA(0.0f, 0.0f, 0.0f, 0.4f));
 
 	renderer->DrawCrosshair(2.0f, 15.0f);
@@ -254,23 +315,29 @@ void World::RenderChunks(const OpenGLRenderer* renderer) const{
 ///=====================================================
 /// 
 ///=====================================================
-void World::ActivateNearestNeededChunk(){
-	int shortestCandidateDistSquared = INNER_DISTANCE_THERMOSTAT_QUALIFICATION;
-	ChunkCoords chunkCoordsToActivate;
+void World::ActivateNearestNeededChunks(){
+	int maxGeneratingChunks = 2 * max(m_jobSystem.GetNumWorkerThreads(), 1); //keep every worker busy with one queued behind it
+	int numChunksToRequest = maxGeneratingChunks - (int)m_generatingChunks.size();
+	if (numChunksToRequest <= 0)
+		return;
+
+	m_neededChunkCandidates.clear();
 	const ChunkCoords playerCoords = Chunk::GetChunkCoordsAtWorldCoords(m_camera->m_position);
 	for (int x = playerCoords.x - OUTER_VISIBILITY_DISTANCE; x <= playerCoords.x + OUTER_VISIBILITY_DISTANCE; ++x){
 		for (int y = playerCoords.y - OUTER_VISIBILITY_DISTANCE; y <= playerCoords.y + OUTER_VISIBILITY_DISTANCE; ++y){
 			const ChunkCoords chunkCoords(x, y);
 			int distanceSquared = CalcDistanceSquared(chunkCoords, playerCoords);
-			if (distanceSquared < shortestCandidateDistSquared && !IsChunkActive(chunkCoords)){
-				shortestCandidateDistSquared = distanceSquared;
-				chunkCoordsToActivate = chunkCoords;
+			if (distanceSquared < INNER_DISTANCE_THERMOSTAT_QUALIFICATION && !IsChunkActive(chunkCoords) && m_generatingChunks.find(chunkCoords) == m_generatingChunks.end()){
+				m_neededChunkCandidates.push_back(std::make_pair(distanceSquared, chunkCoords));
 			}
 		}
 	}
 
-	if (shortestCandidateDistSquared < INNER_DISTANCE_THERMOSTAT_QUALIFICATION){
-		ActivateChunk(chunkCoordsToActivate);
+	//activate the nearest needed chunks first
+	numChunksToRequest = min(numChunksToRequest, (int)m_neededChunkCandidates.size());
+	std::partial_sort(m_neededChunkCandidates.begin(), m_neededChunkCandidates.begin() + numChunksToRequest, m_neededChunkCandidates.end());
+	for (int i = 0; i < numChunksToRequest; ++i){
+		ActivateChunk(m_neededChunkCandidates[i].second);
 	}
 }
 
@@ -278,25 +345,37 @@ void World::ActivateNearestNeededChunk(){
 /// 
 ///=====================================================
 bool World::IsChunkActive(const ChunkCoords& chunkCoords) const{
-	for (Chunks::const_iterator chunkIter = m_activeChunks.begin(); chunkIter != m_activeChunks.end(); ++chunkIter){
-		if (chunkCoords == chunkIter->first){
-			return true;
-		}
-	}
-
-	return false;
+	return m_activeChunks.find(chunkCoords) != m_activeChunks.end();
 }
 
 ///=====================================================
 /// 
 ///=====================================================
 void World::ActivateChunk(const ChunkCoords& chunkCoords){
-	Chunk* newChunk = CreateChunkFromFile(chunkCoords);
+	const ChunkSaveJob* pendingSave = FindPendingChunkSave(chunkCoords);
+	if (pendingSave != NULL){ //reloaded before its save landed, so take the blocks straight from the save rather than the disk
+		Chunk* newChunk = m_chunkPool.AcquireChunk(chunkCoords);
+		newChunk->PopulateFromRLEBuffer(&pendingSave->m_rleBuffer[0]);
+		newChunk->m_editedBlockIndexes = pendingSave->m_editedBlockIndexes;
+		newChunk->m_hasUntrackedEdits = pendingSave->m_hasUntrackedEdits;
+		++m_numCoalescedChunkLoads;
+		AddActiveChunk(chunkCoords, newChunk);
+		return;
+	}
 
-	if (newChunk == NULL){
-		newChunk = CreateChunkFromPerlinNoise(chunkCoords);
+	if (!m_savedChunks.HasChunk(chunkCoords)){ //never saved, so there's nothing for the I/O thread to find
+		++m_numChunkLoadsSkipped;
+		RequestChunkGeneration(chunkCoords);
+		return;
 	}
 
+	RequestChunkLoad(chunkCoords);
+}
+
+///=====================================================
+/// links a fully populated chunk to its neighbors and activates it
+///=====================================================
+void World::AddActiveChunk(const ChunkCoords& chunkCoords, Chunk* newChunk){
 	const ChunkCoords chunkCoordsNorth(chunkCoords.x, chunkCoords.y + 1);
 	Chunks::iterator northChunk = m_activeChunks.find(chunkCoordsNorth);
 	if (northChunk != m_activeChunks.end()){
@@ -344,67 +423,228 @@ void World::ActivateChunk(const ChunkCoords& chunkCoords){
 ///=====================================================
 /// 
 ///=====================================================
-Chunk* World::CreateChunkFromPerlinNoise(const ChunkCoords& chunkCoords) const{
-	Chunk* chunk = new Chunk();
-	chunk->m_worldCoordsMins = Chunk::GetWorldCoordsAtChunkCoords(chunkCoords);
-	chunk->PopulateWithBlocks();
-	return chunk;
+void World::RequestChunkGeneration(const ChunkCoords& chunkCoords){
+	Chunk* chunk = m_chunkPool.AcquireChunk(chunkCoords);
+	m_generatingChunks[chunkCoords] = chunk;
+	m_jobSystem.SubmitJob(new ChunkGenerationJob(chunkCoords, chunk));
+}
+
+///=====================================================
+/// the chunk counts as generating until a generation job has populated it from the save the load reads, or generated it if there's none
+///=====================================================
+void World::RequestChunkLoad(const ChunkCoords& chunkCoords){
+	Chunk* chunk = m_chunkPool.AcquireChunk(chunkCoords);
+	m_generatingChunks[chunkCoords] = chunk;
+	++m_numPendingChunkLoads;
+	m_ioJobSystem.SubmitJob(new ChunkLoadJob(chunkCoords, chunk, m_regionFiles));
+}
+
+///=====================================================
+/// returns the most recent save still queued or being written for chunkCoords, if any
+///=====================================================
+const ChunkSaveJob* World::FindPendingChunkSave(const ChunkCoords& chunkCoords) const{
+	for (std::vector<ChunkSaveJob*>::const_reverse_iterator saveIter = m_pendingChunkSaves.rbegin(); saveIter != m_pendingChunkSaves.rend(); ++saveIter){
+		if ((*saveIter)->m_chunkCoords == chunkCoords)
+			return *saveIter;
+	}
+	return NULL;
+}
+
+///=====================================================
+/// 
+///=====================================================
+void World::RecordChunkIOLatency(float latencyMilliseconds){
+	if (m_chunkIOLatencies.size() < (size_t)NUM_CHUNK_IO_LATENCY_SAMPLES)
+		m_chunkIOLatencies.push_back(latencyMilliseconds);
+	else
+		m_chunkIOLatencies[m_nextChunkIOLatencySample] = latencyMilliseconds;
+	m_nextChunkIOLatencySample = (m_nextChunkIOLatencySample + 1) % NUM_CHUNK_IO_LATENCY_SAMPLES;
+}
+
+///=====================================================
+/// percentile is 0-100, over the most recent chunk loads and saves
+///=====================================================
+float World::GetChunkIOLatencyPercentile(float percentile) const{
+	if (m_chunkIOLatencies.empty())
+		return 0.0f;
+
+	std::vector<float> sortedLatencies(m_chunkIOLatencies);
+	size_t sampleIndex = (size_t)(percentile * 0.01f * (float)(sortedLatencies.size() - 1) + 0.5f);
+	sampleIndex = min(sampleIndex, sortedLatencies.size() - 1);
+	std::nth_element(sortedLatencies.begin(), sortedLatencies.begin() + sampleIndex, sortedLatencies.end());
+	return sortedLatencies[sampleIndex];
 }
 
 ///=====================================================
 /// 
 ///=====================================================
-Chunk* World::CreateChunkFromFile(const ChunkCoords& chunkCoords) const{
-	Chunk* chunk = new Chunk();
-	chunk->m_worldCoordsMins = Chunk::GetWorldCoordsAtChunkCoords(chunkCoords);
-	bool didLoad = chunk->LoadFromDisk();
-	if (!didLoad){
-		delete chunk;
-		chunk = NULL;
+void World::ProcessCompletedJobs(const OpenGLRenderer* renderer){
+	m_completedJobs.clear();
+	m_jobSystem.PopCompletedJobs(m_completedJobs);
+	m_ioJobSystem.PopCompletedJobs(m_completedJobs);
+	m_numMeshesCompletedThisFrame = 0;
+
+	for (Jobs::const_iterator jobIter = m_completedJobs.begin(); jobIter != m_completedJobs.end(); ++jobIter){
+		Job* job = *jobIter;
+		switch (job->GetType()){
+		case JOB_TYPE_GENERATE_CHUNK:{
+			ChunkGenerationJob* generationJob = (ChunkGenerationJob*)job;
+			m_generatingChunks.erase(generationJob->m_chunkCoords);
+			if (m_isRunning)
+				AddActiveChunk(generationJob->m_chunkCoords, generationJob->m_chunk);
+			else
+				m_chunkPool.ReleaseChunk(generationJob->m_chunk, renderer);
+			break;
+		}
+		case JOB_TYPE_MESH_CHUNK:{
+			ChunkMeshJob* meshJob = (ChunkMeshJob*)job;
+			--m_numPendingMeshes;
+			++m_numMeshesCompletedThisFrame;
+
+			//the chunk may have been deactivated or recycled while the job ran
+			Chunks::iterator chunkIter = m_activeChunks.find(meshJob->m_chunkCoords);
+			if (m_isRunning && chunkIter != m_activeChunks.end() && chunkIter->second->m_pendingMeshRevision == meshJob->m_meshRevision){
+				chunkIter->second->UploadSectionMeshes(renderer, meshJob->m_sectionsMask, meshJob->m_opaqueVertexFaces, meshJob->m_translucentVertexFaces);
+				chunkIter->second->m_pendingMeshRevision = 0;
+			}
+			m_freeMeshJobs.push_back(meshJob);
+			break;
+		}
+		case JOB_TYPE_LOAD_CHUNK:{
+			ChunkLoadJob* loadJob = (ChunkLoadJob*)job;
+			--m_numPendingChunkLoads;
+			RecordChunkIOLatency(loadJob->GetLatencyMilliseconds());
+
+			if (!m_isRunning){
+				m_generatingChunks.erase(loadJob->m_chunkCoords);
+				m_chunkPool.ReleaseChunk(loadJob->m_chunk, renderer);
+			}
+			else{ //populate it on a worker, in the chunk the load already took from the pool
+				ChunkGenerationJob* generationJob = new ChunkGenerationJob(loadJob->m_chunkCoords, loadJob->m_chunk);
+				if (loadJob->m_didLoad)
+					generationJob->m_saveBuffer.swap(loadJob->m_rleBuffer);
+				m_jobSystem.SubmitJob(generationJob);
+			}
+			break;
+		}
+		case JOB_TYPE_SAVE_CHUNK:{
+			ChunkSaveJob* saveJob = (ChunkSaveJob*)job;
+			RecordChunkIOLatency(saveJob->GetLatencyMilliseconds());
+			m_numChunkBytesSaved += saveJob->m_numBytesSaved;
+			m_pendingChunkSaves.erase(std::find(m_pendingChunkSaves.begin(), m_pendingChunkSaves.end(), saveJob));
+			break;
+		}
+		}
+
+		if (job->GetType() != JOB_TYPE_MESH_CHUNK) //mesh jobs went back to m_freeMeshJobs
+			delete job;
 	}
+}
+
+///=====================================================
+/// A chunk edited while its mesh job runs stays dirty, so it is remeshed again once that job lands
+///=====================================================
+void World::RequestDirtyChunkMeshes(){
+	const int maxPendingMeshes = MAX_PENDING_MESHES_PER_WORKER * max(m_jobSystem.GetNumWorkerThreads(), 1);
+	for (Chunks::iterator chunkIter = m_activeChunks.begin(); chunkIter != m_activeChunks.end() && m_numPendingMeshes < maxPendingMeshes; ++chunkIter){
+		Chunk* chunk = chunkIter->second;
+		if (chunk->m_dirtySectionsMask == 0 || chunk->m_pendingMeshRevision != 0 || !chunk->IsLightingSettled())
+			continue;
+
+		chunk->m_pendingMeshRevision = m_nextMeshRevision++;
+		if (m_nextMeshRevision == 0) //0 means no job is pending
+			m_nextMeshRevision = 1;
+
+		ChunkMeshJob* meshJob;
+		if (m_freeMeshJobs.empty()){
+			meshJob = new ChunkMeshJob();
+		}
+		else{
+			meshJob = m_freeMeshJobs.back();
+			m_freeMeshJobs.pop_back();
+		}
+		meshJob->Prepare(chunkIter->first, *chunk, chunk->m_dirtySectionsMask, chunk->m_pendingMeshRevision);
 
-	return chunk;
+		++m_numPendingMeshes;
+		m_jobSystem.SubmitJob(meshJob);
+		chunk->m_dirtySectionsMask = 0;
+	}
 }
 
 ///=====================================================
 /// 
 ///=====================================================
 void World::OnChunkActivated(Chunk* chunk){
-	for (int column = 1; column <= BLOCKS_PER_CHUNK_LAYER; ++column){
-		bool endedSky = false;
-		for (BlockIndex index = (BlockIndex)(BLOCKS_PER_CHUNK - column); index < BLOCKS_PER_CHUNK; index -= BLOCKS_PER_CHUNK_LAYER){
-			Block& block = chunk->m_blocks[index];
-			
-			if (!endedSky && block.m_type == BT_AIR){ //set up lighting for sky and dirty its neighbors
-				block.MarkAsSky();
-				block.SetLightValue(m_lightLevel);
+	bool isSectionUniformOpaqueAndUnlit[SECTIONS_PER_CHUNK];
+	for (int section = 0; section < SECTIONS_PER_CHUNK; ++section){
+		isSectionUniformOpaqueAndUnlit[section] = chunk->IsSectionUniformOpaqueAndUnlit(section);
+	}
 
+	for (int column = 0; column < BLOCKS_PER_CHUNK_LAYER; ++column){
+		//set up lighting for sky, only dirtying neighbors where a neighboring column is still covered
+		int skyHeight = chunk->GetSkyHeight(column);
+		int highestCoveredNeighborHeight = GetHighestNeighborSkyHeight(chunk, column);
+		for (int height = BLOCKS_PER_CHUNK_Z - 1; height >= skyHeight; --height){
+			BlockIndex index = (BlockIndex)(column + height * BLOCKS_PER_CHUNK_LAYER);
+			chunk->m_lightValues[index] = FULL_SKY_LIGHT_VALUE;
+
+			if (height < highestCoveredNeighborHeight){
 				BlockLocation blockLocation(chunk, index);
 				DirtyNonopaqueNeighbors(blockLocation, false);
 			}
-			else if (block.GetLightValue() != 0){ //dirty lighting around glowstones and any other light-omitting blocks
-				endedSky = true;
-				BlockLocation blockLocation(chunk, index);
-				DirtyNonopaqueNeighbors(blockLocation, true);
-			}
-			else if (!g_blockDefinitions[block.m_type].m_isOpaque && !block.IsLightingDirty()){ //mark non-opaque blocks (water) as dirty
-				endedSky = true;
-				block.DirtyLighting();
-				BlockLocation blockLocation(chunk, index);
-				if (g_debugPointsEnabled){
-					g_debugPositions.push_back(blockLocation.m_chunk->GetWorldCoordsAtIndex(blockLocation.m_index));
-					m_nextDirtyBlocksDebug.push_back(blockLocation);
+		}
+
+		//below the sky, dirty lighting around light-emitting blocks and non-opaque blocks
+		for (int section = (skyHeight - 1) / BLOCKS_PER_SECTION_Z; section >= 0; --section){
+			if (isSectionUniformOpaqueAndUnlit[section]) //nothing in here emits light or needs relighting
+				continue;
+
+			int sectionTopHeight = min((section + 1) * BLOCKS_PER_SECTION_Z, skyHeight) - 1;
+			for (int height = sectionTopHeight; height >= section * BLOCKS_PER_SECTION_Z; --height){
+				BlockIndex index = (BlockIndex)(column + height * BLOCKS_PER_CHUNK_LAYER);
+				Block block = chunk->GetBlock(index);
+
+				if (block.GetLightValue() != 0){ //dirty lighting around glowstones and any other light-omitting blocks
+					BlockLocation blockLocation(chunk, index);
+					DirtyNonopaqueNeighbors(blockLocation, true);
+				}
+				else if (!chunk->GetBlockDefinition(index).m_isOpaque && !block.IsLightingDirty()){ //mark non-opaque blocks (water) as dirty
+					if (g_debugPointsEnabled)
+						g_debugPositions.push_back(chunk->GetWorldCoordsAtIndex(index));
+					chunk->DirtyLightingAtIndex(index, g_debugPointsEnabled ? m_nextDirtyBlocksDebug : m_dirtyBlocks);
 				}
-				else
-					m_dirtyBlocks.push_back(blockLocation);
-			}
-			else{
-				endedSky = true;
 			}
 		}
 	}
 }
 
+///=====================================================
+/// neighbors in inactive chunks count as open sky, since DirtyNonopaqueNeighbors can't reach them anyway
+///=====================================================
+int World::GetHighestNeighborSkyHeight(const Chunk* chunk, int column) const{
+	int x = column & CHUNK_X_MASK;
+	int y = column >> CHUNKS_WIDE_EXPONENT;
+	int highestSkyHeight = 0;
+
+	const Chunk* eastChunk = (x == CHUNK_X_MASK) ? chunk->m_chunkToEast : chunk;
+	if (eastChunk)
+		highestSkyHeight = max(highestSkyHeight, eastChunk->GetSkyHeight(((column + STEP_EAST) & CHUNK_X_MASK) | (column & BLOCKINDEX_Y_MASK)));
+
+	const Chunk* westChunk = (x == 0) ? chunk->m_chunkToWest : chunk;
+	if (westChunk)
+		highestSkyHeight = max(highestSkyHeight, westChunk->GetSkyHeight(((column + STEP_WEST) & CHUNK_X_MASK) | (column & BLOCKINDEX_Y_MASK)));
+
+	const Chunk* northChunk = (y == CHUNK_Y_MASK) ? chunk->m_chunkToNorth : chunk;
+	if (northChunk)
+		highestSkyHeight = max(highestSkyHeight, northChunk->GetSkyHeight((column + STEP_NORTH) & CHUNK_LAYER_MASK));
+
+	const Chunk* southChunk = (y == 0) ? chunk->m_chunkToSouth : chunk;
+	if (southChunk)
+		highestSkyHeight = max(highestSkyHeight, southChunk->GetSkyHeight((column + STEP_SOUTH) & CHUNK_LAYER_MASK));
+
+	return highestSkyHeight;
+}
+
 ///=====================================================
 /// 
 ///=====================================================
@@ -426,16 +666,29 @@ void World::DeactivateFurthestChunk(const OpenGLRenderer* renderer){
 	}
 }
 
+///=====================================================
+/// 
+///=====================================================
+static void RemoveBlocksInChunk(BlockLocations& blockLocations, const Chunk* chunk){
+	size_t numKept = 0;
+	for (size_t blockIndex = 0; blockIndex < blockLocations.size(); ++blockIndex){
+		if (blockLocations[blockIndex].m_chunk != chunk)
+			blockLocations[numKept++] = blockLocations[blockIndex];
+	}
+	blockLocations.resize(numKept);
+}
+
 ///=====================================================
 /// 
 ///=====================================================
 void World::DeactivateChunk(const ChunkCoords& chunkCoords, const OpenGLRenderer* renderer){
-	SaveChunkToFile(chunkCoords);
+	if (m_activeChunks.at(chunkCoords)->m_hasUnsavedEdits)
+		SaveChunkToFile(chunkCoords);
+	else
+		++m_numChunkSavesSkipped;
 
 	OnChunkDeactivated(chunkCoords);
 
-	renderer->DeleteBuffer(&(m_activeChunks[chunkCoords]->m_vboID));
-
 	if (m_isRunning){ //don't update lighting if the user is quitting the game
 		const ChunkCoords chunkCoordsNorth(chunkCoords.x, chunkCoords.y + 1);
 		Chunks::iterator northChunk = m_activeChunks.find(chunkCoordsNorth);
@@ -466,16 +719,24 @@ void World::DeactivateChunk(const ChunkCoords& chunkCoords, const OpenGLRenderer
 		}
 	}
 
-	m_activeChunks[chunkCoords] = NULL;
-	delete m_activeChunks[chunkCoords];
+	//deferred relighting must not outlive the chunk, since the pool may hand it out again at other coords
+	Chunk* chunk = m_activeChunks.at(chunkCoords);
+	RemoveBlocksInChunk(m_dirtyBlocks, chunk);
+	RemoveBlocksInChunk(m_nextDirtyBlocksDebug, chunk);
+	m_numSortedDirtyBlocks = 0; //the neighbors' border blocks were appended unsorted
+	m_lightPropagator.DiscardBlocksInChunk(chunk);
 	m_activeChunks.erase(chunkCoords);
+	m_chunkPool.ReleaseChunk(chunk, renderer);
 }
 
 ///=====================================================
-/// 
+/// the chunk is encoded now, so it can go back to the pool before the I/O thread writes it
 ///=====================================================
-void World::SaveChunkToFile(const ChunkCoords& chunkCoords) const{
-	m_activeChunks.at(chunkCoords)->SaveToDisk();
+void World::SaveChunkToFile(const ChunkCoords& chunkCoords){
+	ChunkSaveJob* saveJob = new ChunkSaveJob(chunkCoords, *m_activeChunks.at(chunkCoords), m_regionFiles);
+	m_pendingChunkSaves.push_back(saveJob);
+	m_savedChunks.AddChunk(chunkCoords);
+	m_ioJobSystem.SubmitJob(saveJob);
 }
 
 ///=====================================================
@@ -716,12 +977,10 @@ void World::UpdatePlayerVelocityFromGravity(float deltaSeconds){
 		m_playerIsOnGround = false;
 
 	//check if player is in water
-	const ChunkCoords chunkCoords = Chunk::GetChunkCoordsAtWorldCoords(m_camera->m_position);
-	Chunks::const_iterator chunkIter = m_activeChunks.find(chunkCoords);
-	if (chunkIter != m_activeChunks.end()){
-		Chunk* chunk = chunkIter->second;
-		BlockIndex index = chunk->GetIndexAtWorldCoords(m_camera->m_position);
-		if (chunk->m_blocks[index].m_type == BT_WATER){ //player is in water - reduced gravity
+	WorldBlockAccessor blockAccessor(m_activeChunks);
+	const BlockLocation cameraLocation = blockAccessor.GetBlockLocationAtWorldCoords(m_camera->m_position);
+	if (cameraLocation.m_chunk){
+		if (GetBlockType(cameraLocation) == BT_WATER){ //player is in water - reduced gravity
 			if (!m_playerIsInWater){ //played just entered water from nonwater
 				s_theSoundSystem->PlaySound(m_splashSound, 0, 0.4f);
 				m_playerIsInWater = true;
@@ -809,7 +1068,7 @@ void World::UpdatePlayer(double deltaSeconds){
 	if (!m_playerIsNoClip){
 		if (totalPlayerTranslation.x != 0.0f || totalPlayerTranslation.y != 0.0f || (totalPlayerTranslation.z != 0.0f && m_playerIsInWater))
 			m_countUntilNextWalkSound -= deltaSeconds * currentSpeed;
-		MovePlayerWithRaycast(totalPlayerTranslation);
+		MovePlayerWithCollision(totalPlayerTranslation);
 	}
 	else{
 		m_playerBox.Translate(totalPlayerTranslation);
@@ -834,89 +1093,42 @@ void World::UpdatePlayer(double deltaSeconds){
 ///=====================================================
 /// 
 ///=====================================================
-const Raycast3DResult World::MovePlayerWithRaycast(const Vec3& totalPlayerTranslation){
-	const static float RAYCAST_INCREMENT = 0.01f;
-	Raycast3DResult result;
-	result.m_didImpact = false;
-
+void World::MovePlayerWithCollision(const Vec3& totalPlayerTranslation){
 	if ((totalPlayerTranslation.x == 0.0f) && (totalPlayerTranslation.y == 0.0f) && (totalPlayerTranslation.z == 0.0f))
-		return result;
-
-	Vec3 raycastIncrement = totalPlayerTranslation * RAYCAST_INCREMENT;
+		return;
 
-	Chunk* chunk;
-	BlockIndex index;
+	BlockCollisionSolver collisionSolver(m_activeChunks);
+	float liftDistance;
+	if (!collisionSolver.PushBoxUpOutOfBlocks(m_playerBox, liftDistance)) //player is not inside the active world
+		return;
+	m_camera->m_position.z += liftDistance;
 
-	bool playerIsWithinWorld = MovePlayerWhenStuckInsideBlocks();
-	if (!playerIsWithinWorld)
-		return result;
-	
-	for (float t = 0.0f; t < 1.0f; t += RAYCAST_INCREMENT){
-		m_playerBox.Translate(raycastIncrement);
-		m_camera->m_position += raycastIncrement;
-		const Vec3s playerBoxContactPoints = GetPlayerBoxContactPoints();
-
-		for (Vec3s::const_iterator cornerIter = playerBoxContactPoints.begin(); cornerIter != playerBoxContactPoints.end(); ++cornerIter){
-			const ChunkCoords chunkCoords = Chunk::GetChunkCoordsAtWorldCoords(*cornerIter);
-			Chunks::const_iterator chunkIter = m_activeChunks.find(chunkCoords);
-			if (chunkIter == m_activeChunks.end())
-				return result;
-			chunk = chunkIter->second;
-			index = chunk->GetIndexAtWorldCoords(*cornerIter);
-			const Block& block = chunk->m_blocks[index];
-
-			if (g_blockDefinitions[block.m_type].m_isSolid){
-				result.m_didImpact = true;
-
-				if (RoundDownToInt(cornerIter->z) != RoundDownToInt(cornerIter->z - raycastIncrement.z)){
-					m_playerBox.Translate(-raycastIncrement);
-					m_camera->m_position -= raycastIncrement;
-					m_playerLocalVelocity.z = 0.0f;
-					m_playerIsOnGround = true;
-					if (block.m_type == BT_ICE)
-						m_playerIsOnIce = true;
-					else
-						m_playerIsOnIce = false;
+	const BoxMovementResult movement = collisionSolver.MoveBox(m_playerBox, totalPlayerTranslation);
+	m_camera->m_position += movement.m_appliedTranslation;
 
-					if (raycastIncrement.x == 0.0f && raycastIncrement.y == 0.0f)
-						return result;
-					raycastIncrement.z = 0.0f;
-					break;
-				}
-				else if (RoundDownToInt(cornerIter->x) != RoundDownToInt(cornerIter->x - raycastIncrement.x)){
-					m_playerBox.Translate(-raycastIncrement);
-					m_camera->m_position -= raycastIncrement;
-
-					float cosCameraYaw = cos(ConvertDegreesToRadians(m_camera->m_orientation.yawDegreesAboutZ));
-					float sinCameraYaw = sin(ConvertDegreesToRadians(m_camera->m_orientation.yawDegreesAboutZ));
-					float playerWorldVelocityY = (m_playerLocalVelocity.x * sinCameraYaw) + (m_playerLocalVelocity.y * cosCameraYaw);
-					m_playerLocalVelocity.x = playerWorldVelocityY * sinCameraYaw;
-					m_playerLocalVelocity.y = playerWorldVelocityY * cosCameraYaw;
-
-					if (raycastIncrement.z == 0.0f && raycastIncrement.y == 0.0f)
-						return result;
-					raycastIncrement.x = 0.0f;
-					break;
-				}
-				else if (RoundDownToInt(cornerIter->y) != RoundDownToInt(cornerIter->y - raycastIncrement.y)){
-					m_playerBox.Translate(-raycastIncrement);
-					m_camera->m_position -= raycastIncrement;
-					
-					float cosCameraYaw = cos(ConvertDegreesToRadians(m_camera->m_orientation.yawDegreesAboutZ));
-					float sinCameraYaw = sin(ConvertDegreesToRadians(m_camera->m_orientation.yawDegreesAboutZ));
-					float playerWorldVelocityX = (m_playerLocalVelocity.x * cosCameraYaw) + (m_playerLocalVelocity.y * -sinCameraYaw);
-					m_playerLocalVelocity.x = playerWorldVelocityX * cosCameraYaw;
-					m_playerLocalVelocity.y = playerWorldVelocityX * -sinCameraYaw;
-
-					if (raycastIncrement.x == 0.0f && raycastIncrement.z == 0.0f)
-						return result;
-					raycastIncrement.y = 0.0f;
-					break;
-				}
-			}
+	if (movement.m_didCollideOnAxis[2]){
+		m_playerLocalVelocity.z = 0.0f;
+		if (totalPlayerTranslation.z < 0.0f){
+			m_playerIsOnGround = true;
+			m_playerIsOnIce = (movement.m_blockTypeBelow == BT_ICE);
 		}
 	}
-	return result;
+
+	if (movement.m_didCollideOnAxis[0]){ //keep only the world y part of the velocity
+		float cosCameraYaw = cos(ConvertDegreesToRadians(m_camera->m_orientation.yawDegreesAboutZ));
+		float sinCameraYaw = sin(ConvertDegreesToRadians(m_camera->m_orientation.yawDegreesAboutZ));
+		float playerWorldVelocityY = (m_playerLocalVelocity.x * sinCameraYaw) + (m_playerLocalVelocity.y * cosCameraYaw);
+		m_playerLocalVelocity.x = playerWorldVelocityY * sinCameraYaw;
+		m_playerLocalVelocity.y = playerWorldVelocityY * cosCameraYaw;
+	}
+
+	if (movement.m_didCollideOnAxis[1]){ //keep only the world x part of the velocity
+		float cosCameraYaw = cos(ConvertDegreesToRadians(m_camera->m_orientation.yawDegreesAboutZ));
+		float sinCameraYaw = sin(ConvertDegreesToRadians(m_camera->m_orientation.yawDegreesAboutZ));
+		float playerWorldVelocityX = (m_playerLocalVelocity.x * cosCameraYaw) + (m_playerLocalVelocity.y * -sinCameraYaw);
+		m_playerLocalVelocity.x = playerWorldVelocityX * cosCameraYaw;
+		m_playerLocalVelocity.y = playerWorldVelocityX * -sinCameraYaw;
+	}
 }
 
 ///=====================================================
@@ -1023,201 +1235,122 @@ void World::UpdatePlayerVelocityFromInput(float deltaSeconds){
 void World::PlaceOrRemoveBlockBeneathCamera(){
 	if (s_theInputSystem->DidStateJustChange('K') && s_theInputSystem->IsKeyDown('K')){
 		//destroy block
-		const ChunkCoords chunkCoords = Chunk::GetChunkCoordsAtWorldCoords(m_camera->m_position);
-		Chunks::iterator chunkIter = m_activeChunks.find(chunkCoords);
-		if (chunkIter != m_activeChunks.end())
-			chunkIter->second->DestroyBlockBeneathCoords(m_camera->m_position, g_debugPointsEnabled ? m_nextDirtyBlocksDebug : m_dirtyBlocks);
+		Chunk* chunk = WorldBlockAccessor(m_activeChunks).GetChunkAtWorldCoords(m_camera->m_position);
+		if (chunk)
+			chunk->DestroyBlockBeneathCoords(m_camera->m_position, g_debugPointsEnabled ? m_nextDirtyBlocksDebug : m_dirtyBlocks);
 	}
 	else if (s_theInputSystem->DidStateJustChange('P') && s_theInputSystem->IsKeyDown('P')){
 		//place block
-		const ChunkCoords chunkCoords = Chunk::GetChunkCoordsAtWorldCoords(m_camera->m_position);
-		Chunks::iterator chunkIter = m_activeChunks.find(chunkCoords);
-		if (chunkIter != m_activeChunks.end())
-			chunkIter->second->PlaceBlockBeneathCoords(m_selectedBlockType, m_camera->m_position, g_debugPointsEnabled ? m_nextDirtyBlocksDebug : m_dirtyBlocks);
+		Chunk* chunk = WorldBlockAccessor(m_activeChunks).GetChunkAtWorldCoords(m_camera->m_position);
+		if (chunk)
+			chunk->PlaceBlockBeneathCoords(m_selectedBlockType, m_camera->m_position, g_debugPointsEnabled ? m_nextDirtyBlocksDebug : m_dirtyBlocks);
 	}
 }
 
 ///=====================================================
-/// 
+/// Relights at most m_maxLightUpdatesPerFrame blocks, admitting the dirty blocks nearest the camera first and leaving the rest for later frames.
+/// Each chunk counts its own queued blocks as they're pushed and popped, so it isn't remeshed until its light stops changing.
 ///=====================================================
 void World::UpdateLighting(){
-	while (!m_dirtyBlocks.empty()){
+	//while earlier propagation is unfinished, save half the budget so it keeps draining
+	const int maxBlocksToAdmit = m_lightPropagator.IsSettled() ? m_maxLightUpdatesPerFrame : m_maxLightUpdatesPerFrame / 2;
+	if ((int)m_dirtyBlocks.size() > maxBlocksToAdmit && m_camera){
+		//popping from the back keeps the rest sorted, so only a camera move or new dirty blocks need another sort
+		const LocalCoords cameraBlockCoords(RoundDownToInt(m_camera->m_position.x), RoundDownToInt(m_camera->m_position.y), RoundDownToInt(m_camera->m_position.z));
+		if (m_dirtyBlocks.size() != m_numSortedDirtyBlocks || !(cameraBlockCoords == m_dirtyBlocksSortCameraCoords)){
+			m_dirtyBlocksSortCameraCoords = cameraBlockCoords;
+			SortDirtyBlocksNearestLast();
+		}
+	}
+
+	int numBlocksAdmitted = 0;
+	while (!m_dirtyBlocks.empty() && numBlocksAdmitted < maxBlocksToAdmit){
 		const BlockLocation blockLocation = m_dirtyBlocks.back();
 		m_dirtyBlocks.pop_back();
 		if (blockLocation.m_chunk){
-			UpdateLightingForBlock(blockLocation);
-			blockLocation.m_chunk->m_isVboDirty = true;
+			blockLocation.m_chunk->UndirtyLightingAtIndex(blockLocation.m_index);
+			m_lightPropagator.RelightBlock(blockLocation);
+			++numBlocksAdmitted;
 		}
 	}
-}
+	if (m_numSortedDirtyBlocks != 0)
+		m_numSortedDirtyBlocks = m_dirtyBlocks.size();
 
-///=====================================================
-/// 
-///=====================================================
-void World::UpdateLightingForBlock(const BlockLocation& blockLocation){
-	unsigned char idealLight = CalculateIdealLightingForBlock(blockLocation);
-	Block& block = GetBlock(blockLocation);
-	if (block.GetLightValue() != idealLight){
-		block.SetLightValue(idealLight);
-		DirtyNonopaqueNeighbors(blockLocation, true);
-	}
-	block.UndirtyLighting();
+	m_numLightUpdatesThisFrame = numBlocksAdmitted + m_lightPropagator.PropagateLight(m_maxLightUpdatesPerFrame - numBlocksAdmitted);
 }
 
 ///=====================================================
-/// 
+/// sorts by squared distance from m_dirtyBlocksSortCameraCoords
 ///=====================================================
-unsigned char World::CalculateIdealLightingForBlock(const BlockLocation& blockLocation) const{
-	Block& block = GetBlock(blockLocation);
-	unsigned char maxAdjacentLighting = g_blockDefinitions[block.m_type].m_inherentLightValue + 1; //+1 to cancel out the -1 at the end
-
-	const BlockLocation locationAbove = GetBlockLocation(blockLocation, STEP_UP);
-	if (locationAbove.m_chunk){
-		const Block& blockAbove = GetBlock(locationAbove);
-		unsigned char blockAboveLighting = blockAbove.GetLightValue();
-		if (blockAboveLighting > maxAdjacentLighting)
-			maxAdjacentLighting = blockAboveLighting;
-	}
+void World::SortDirtyBlocksNearestLast(){
+	const int cameraX = m_dirtyBlocksSortCameraCoords.x;
+	const int cameraY = m_dirtyBlocksSortCameraCoords.y;
+	const int cameraZ = m_dirtyBlocksSortCameraCoords.z;
 
-	const BlockLocation locationBelow = GetBlockLocation(blockLocation, STEP_DOWN);
-	if (locationBelow.m_chunk){
-		const Block& blockBelow = GetBlock(locationBelow);
-		unsigned char blockBelowLighting = blockBelow.GetLightValue();
-		if (blockBelowLighting > maxAdjacentLighting)
-			maxAdjacentLighting = blockBelowLighting;
-	}
+	std::vector<unsigned int>& distanceKeys = m_dirtyBlockDistanceKeys;
+	distanceKeys.resize(m_dirtyBlocks.size());
+	for (size_t blockIndex = 0; blockIndex < m_dirtyBlocks.size(); ++blockIndex){
+		const BlockLocation& blockLocation = m_dirtyBlocks[blockIndex];
+		if (!blockLocation.m_chunk){
+			distanceKeys[blockIndex] = 0;
+			continue;
+		}
 
-	const BlockLocation locationToNorth = GetBlockLocation(blockLocation, STEP_NORTH);
-	if (locationToNorth.m_chunk){
-		const Block& blockToNorth = GetBlock(locationToNorth);
-		unsigned char blockToNorthLighting = blockToNorth.GetLightValue();
-		if (blockToNorthLighting > maxAdjacentLighting)
-			maxAdjacentLighting = blockToNorthLighting;
+		const WorldCoords& chunkMins = blockLocation.m_chunk->m_worldCoordsMins;
+		const int deltaX = (int)chunkMins.x + (blockLocation.m_index & CHUNK_X_MASK) - cameraX;
+		const int deltaY = (int)chunkMins.y + ((blockLocation.m_index >> CHUNKS_WIDE_EXPONENT) & CHUNK_Y_MASK) - cameraY;
+		const int deltaZ = (blockLocation.m_index >> (CHUNKS_WIDE_EXPONENT + CHUNKS_LONG_EXPONENT)) - cameraZ;
+		distanceKeys[blockIndex] = (unsigned int)(deltaX * deltaX + deltaY * deltaY + deltaZ * deltaZ);
 	}
 
-	const BlockLocation locationToSouth = GetBlockLocation(blockLocation, STEP_SOUTH);
-	if (locationToSouth.m_chunk){
-		const Block& blockToSouth = GetBlock(locationToSouth);
-		unsigned char blockToSouthLighting = blockToSouth.GetLightValue();
-		if (blockToSouthLighting > maxAdjacentLighting)
-			maxAdjacentLighting = blockToSouthLighting;
-	}
+	RadixSortIndexesByKey(&distanceKeys[0], (int)distanceKeys.size(), m_dirtyBlockSortOrder);
 
-	const BlockLocation locationToEast = GetBlockLocation(blockLocation, STEP_EAST);
-	if (locationToEast.m_chunk){
-		const Block& blockToEast = GetBlock(locationToEast);
-		unsigned char blockToEastLighting = blockToEast.GetLightValue();
-		if (blockToEastLighting > maxAdjacentLighting)
-			maxAdjacentLighting = blockToEastLighting;
+	m_sortedDirtyBlocks.resize(m_dirtyBlocks.size());
+	for (size_t sortedIndex = 0; sortedIndex < m_dirtyBlockSortOrder.size(); ++sortedIndex){
+		m_sortedDirtyBlocks[m_dirtyBlockSortOrder.size() - 1 - sortedIndex] = m_dirtyBlocks[m_dirtyBlockSortOrder[sortedIndex]];
 	}
+	m_dirtyBlocks.swap(m_sortedDirtyBlocks);
+	m_numSortedDirtyBlocks = m_dirtyBlocks.size();
+}
 
-	const BlockLocation locationToWest = GetBlockLocation(blockLocation, STEP_WEST);
-	if (locationToWest.m_chunk){
-		const Block& blockToWest = GetBlock(locationToWest);
-		unsigned char blockToWestLighting = blockToWest.GetLightValue();
-		if (blockToWestLighting > maxAdjacentLighting)
-			maxAdjacentLighting = blockToWestLighting;
-	}
+///=====================================================
+/// Sky light is stored at full daylight, so changing the level only recolors vertexes; nothing is relit or remeshed
+///=====================================================
+void World::SetLightLevel(unsigned char lightLevel){
+	m_lightLevel = lightLevel;
+	PackedBlockVertex::SetSkyLightLevel(lightLevel);
+}
 
-	if (block.IsSky() && maxAdjacentLighting == m_lightLevel)
-		return maxAdjacentLighting;
+///=====================================================
+/// re-uploads a few chunks' VBOs per frame from their kept faces once the sky light level has changed
+///=====================================================
+void World::RefreshChunkVboLighting(const OpenGLRenderer* renderer){
+	int numChunksRefreshed = 0;
+	for (Chunks::iterator chunkIter = m_activeChunks.begin(); chunkIter != m_activeChunks.end() && numChunksRefreshed < MAX_VBO_LIGHTING_REFRESHES_PER_FRAME; ++chunkIter){
+		Chunk* chunk = chunkIter->second;
+		if (chunk->m_vboSkyLightLevel == m_lightLevel)
+			continue;
 
-	return maxAdjacentLighting - 1;
+		chunk->RefreshVboLighting(renderer);
+		++numChunksRefreshed;
+	}
 }
 
 ///=====================================================
 /// 
 ///=====================================================
 void World::DirtyNonopaqueNeighbors(const BlockLocation& blockLocation, bool includingAboveBelow){
-	if (includingAboveBelow){
-		const BlockLocation locationAbove = GetBlockLocation(blockLocation, STEP_UP);
-		if (locationAbove.m_chunk){
-			locationAbove.m_chunk->m_isVboDirty = true;
-			Block& blockAbove = GetBlock(locationAbove);
-			if (!g_blockDefinitions[blockAbove.m_type].m_isOpaque && !blockAbove.IsLightingDirty()){
-				blockAbove.DirtyLighting();
-				if (g_debugPointsEnabled){
-					g_debugPositions.push_back(locationAbove.m_chunk->GetWorldCoordsAtIndex(locationAbove.m_index));
-					m_nextDirtyBlocksDebug.push_back(locationAbove);
-				}
-				else
-					m_dirtyBlocks.push_back(locationAbove);
-			}
-		}
-
-		const BlockLocation locationBelow = GetBlockLocation(blockLocation, STEP_DOWN);
-		if (locationBelow.m_chunk){
-			locationBelow.m_chunk->m_isVboDirty = true;
-			Block& blockBelow = GetBlock(locationBelow);
-			if (!g_blockDefinitions[blockBelow.m_type].m_isOpaque && !blockBelow.IsLightingDirty()){
-				blockBelow.DirtyLighting();
-				if (g_debugPointsEnabled){
-					g_debugPositions.push_back(locationBelow.m_chunk->GetWorldCoordsAtIndex(locationBelow.m_index));
-					m_nextDirtyBlocksDebug.push_back(locationBelow);
-				}
-				else
-					m_dirtyBlocks.push_back(locationBelow);
-			}
-		}
-	}
-
-	const BlockLocation locationToNorth = GetBlockLocation(blockLocation, STEP_NORTH);
-	if (locationToNorth.m_chunk){
-		locationToNorth.m_chunk->m_isVboDirty = true;
-		Block& blockToNorth = GetBlock(locationToNorth);
-		if (!g_blockDefinitions[blockToNorth.m_type].m_isOpaque && !blockToNorth.IsLightingDirty()){
-			blockToNorth.DirtyLighting();
-			if (g_debugPointsEnabled){
-				g_debugPositions.push_back(locationToNorth.m_chunk->GetWorldCoordsAtIndex(locationToNorth.m_index));
-				m_nextDirtyBlocksDebug.push_back(locationToNorth);
-			}
-			else
-				m_dirtyBlocks.push_back(locationToNorth);
-		}
-	}
-
-	const BlockLocation locationToSouth = GetBlockLocation(blockLocation, STEP_SOUTH);
-	if (locationToSouth.m_chunk){
-		locationToSouth.m_chunk->m_isVboDirty = true;
-		Block& blockToSouth = GetBlock(locationToSouth);
-		if (!g_blockDefinitions[blockToSouth.m_type].m_isOpaque && !blockToSouth.IsLightingDirty()){
-			blockToSouth.DirtyLighting();
-			if (g_debugPointsEnabled){
-				g_debugPositions.push_back(locationToSouth.m_chunk->GetWorldCoordsAtIndex(locationToSouth.m_index));
-				m_nextDirtyBlocksDebug.push_back(locationToSouth);
-			}
-			else
-				m_dirtyBlocks.push_back(locationToSouth);
-		}
-	}
-
-	const BlockLocation locationToEast = GetBlockLocation(blockLocation, STEP_EAST);
-	if (locationToEast.m_chunk){
-		locationToEast.m_chunk->m_isVboDirty = true;
-		Block& blockToEast = GetBlock(locationToEast);
-		if (!g_blockDefinitions[blockToEast.m_type].m_isOpaque && !blockToEast.IsLightingDirty()){
-			blockToEast.DirtyLighting();
-			if (g_debugPointsEnabled){
-				g_debugPositions.push_back(locationToEast.m_chunk->GetWorldCoordsAtIndex(locationToEast.m_index));
-				m_nextDirtyBlocksDebug.push_back(locationToEast);
-			}
-			else
-				m_dirtyBlocks.push_back(locationToEast);
-		}
-	}
-
-	const BlockLocation locationToWest = GetBlockLocation(blockLocation, STEP_WEST);
-	if (locationToWest.m_chunk){
-		locationToWest.m_chunk->m_isVboDirty = true;
-		Block& blockToWest = GetBlock(locationToWest);
-		if (!g_blockDefinitions[blockToWest.m_type].m_isOpaque && !blockToWest.IsLightingDirty()){
-			blockToWest.DirtyLighting();
-			if (g_debugPointsEnabled){
-				g_debugPositions.push_back(locationToWest.m_chunk->GetWorldCoordsAtIndex(locationToWest.m_index));
-				m_nextDirtyBlocksDebug.push_back(locationToWest);
-			}
-			else
-				m_dirtyBlocks.push_back(locationToWest);
+	for (int face = includingAboveBelow ? FACE_TOP : FACE_NORTH; face < NUM_BLOCK_FACES; ++face){
+		const BlockLocation neighborLocation = WorldBlockAccessor::GetNeighborBlockLocation(blockLocation, (BlockFace)face);
+		if (!neighborLocation.m_chunk)
+			continue;
+
+		neighborLocation.m_chunk->DirtyMeshAtIndex(neighborLocation.m_index);
+		Block neighborBlock = GetBlock(neighborLocation);
+		if (!GetBlockDefinition(neighborLocation).m_isOpaque && !neighborBlock.IsLightingDirty()){
+			if (g_debugPointsEnabled)
+				g_debugPositions.push_back(neighborLocation.m_chunk->GetWorldCoordsAtIndex(neighborLocation.m_index));
+			neighborLocation.m_chunk->DirtyLightingAtIndex(neighborLocation.m_index, g_debugPointsEnabled ? m_nextDirtyBlocksDebug : m_dirtyBlocks);
 		}
 	}
 }
@@ -1338,131 +1471,7 @@ void World::RenderRaycastTargetBlockOutline(const OpenGLRenderer* renderer) cons
 /// 
 ///=====================================================
 const Raycast3DResult World::Raycast3D(const WorldCoords& start, const WorldCoords& end) const{
-	const static float RAYCAST_INCREMENT = 0.001f;
-	Raycast3DResult result;
-	result.m_didImpact = false;
-
-	Vec3 rayDisplacement = end - start;
-
-	result.m_impactWorldCoords = start;
-
-	const ChunkCoords chunkCoords = Chunk::GetChunkCoordsAtWorldCoords(start);
-	Chunks::const_iterator chunkIter = m_activeChunks.find(chunkCoords);
-	if (chunkIter == m_activeChunks.end())
-		return result;
-	Chunk* chunk = chunkIter->second;
-	BlockIndex index = chunk->GetIndexAtWorldCoords(start);
-
-	if (g_blockDefinitions[chunk->m_blocks[index].m_type].m_isVisible) //camera is inside a visible block
-		return result;
-
-	float raycastIncrementX = RAYCAST_INCREMENT * rayDisplacement.x;
-	float raycastIncrementY = RAYCAST_INCREMENT * rayDisplacement.y;
-	float raycastIncrementZ = RAYCAST_INCREMENT * rayDisplacement.z;
-
-	BlockIndex previousIndex = index;
-
-	for (float t = 0.0f; t < 1.0f;){
-		while (index == previousIndex){
-			t += RAYCAST_INCREMENT;
-			if (t >= 1.0f)
-				return result;
-			result.m_impactWorldCoords += WorldCoords(raycastIncrementX, raycastIncrementY, raycastIncrementZ);
-
-			const ChunkCoords chunkCoords = Chunk::GetChunkCoordsAtWorldCoords(result.m_impactWorldCoords);
-			Chunks::const_iterator chunkIter = m_activeChunks.find(chunkCoords);
-			if (chunkIter == m_activeChunks.end())
-				return result;
-			chunk = chunkIter->second;
-			index = chunk->GetIndexAtWorldCoords(result.m_impactWorldCoords);
-			if (index >= BLOCKS_PER_CHUNK)
-				return result;
-		}
-
-		if (g_blockDefinitions[chunk->m_blocks[index].m_type].m_isVisible){
-			result.m_didImpact = true;
-
-			unsigned short indexMinusPrevIndex = index - previousIndex;
-			unsigned short prevIndexMinusIndex = previousIndex - index;
-
-			if ((indexMinusPrevIndex & BLOCKINDEX_Z_MASK) == (1 << (CHUNKS_WIDE_EXPONENT + CHUNKS_LONG_EXPONENT))){ //indexMinusPrevIndex z == 1
-				result.m_impactSurfaceNormal = Vec3(0.0f, 0.0f, -1.0f);
-				result.m_impactWorldCoordsMins = Vec3(floor(result.m_impactWorldCoords.x), floor(result.m_impactWorldCoords.y), floor(result.m_impactWorldCoords.z));
-				result.m_impactWorldCoords.x = result.m_impactWorldCoordsMins.x + 1;
-				result.m_impactWorldCoords.y = result.m_impactWorldCoordsMins.y + 1;
-				result.m_impactWorldCoords.z = result.m_impactWorldCoordsMins.z;
-
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords);
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(0.0f, -1.0f, 0.0f));
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(-1.0f, -1.0f, 0.0f));
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(-1.0f, 0.0f, 0.0f));
-			}
-			else if ((prevIndexMinusIndex & BLOCKINDEX_Z_MASK) == (1 << (CHUNKS_WIDE_EXPONENT + CHUNKS_LONG_EXPONENT))){ //prevIndexMinusIndex z == 1
-				result.m_impactSurfaceNormal = Vec3(0.0f, 0.0f, 1.0f);
-				result.m_impactWorldCoordsMins = Vec3(floor(result.m_impactWorldCoords.x), floor(result.m_impactWorldCoords.y), floor(result.m_impactWorldCoords.z));
-				result.m_impactWorldCoords.x = result.m_impactWorldCoordsMins.x;
-				result.m_impactWorldCoords.y = result.m_impactWorldCoordsMins.y + 1;
-				result.m_impactWorldCoords.z = result.m_impactWorldCoordsMins.z + 1;
-
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords);
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(0.0f, -1.0f, 0.0f));
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(1.0f, -1.0f, 0.0f));
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(1.0f, 0.0f, 0.0f));
-			}
-			else if ((indexMinusPrevIndex & BLOCKINDEX_X_MASK) == 1){ //indexMinusPrevIndex x == 1
-				result.m_impactSurfaceNormal = Vec3(-1.0f, 0.0f, 0.0f);
-				result.m_impactWorldCoordsMins = Vec3(floor(result.m_impactWorldCoords.x), floor(result.m_impactWorldCoords.y), floor(result.m_impactWorldCoords.z));
-				result.m_impactWorldCoords.x = result.m_impactWorldCoordsMins.x;
-				result.m_impactWorldCoords.y = result.m_impactWorldCoordsMins.y + 1;
-				result.m_impactWorldCoords.z = result.m_impactWorldCoordsMins.z;
-				
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords);
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(0.0f, -1.0f, 0.0f));
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(0.0f, -1.0f, 1.0f));
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(0.0f, 0.0f, 1.0f));
-			}
-			else if ((prevIndexMinusIndex & BLOCKINDEX_X_MASK) == 1){ //prevIndexMinusIndex x == 1
-				result.m_impactSurfaceNormal = Vec3(1.0f, 0.0f, 0.0f);
-				result.m_impactWorldCoordsMins = Vec3(floor(result.m_impactWorldCoords.x), floor(result.m_impactWorldCoords.y), floor(result.m_impactWorldCoords.z));
-				result.m_impactWorldCoords.x = result.m_impactWorldCoordsMins.x + 1;
-				result.m_impactWorldCoords.y = result.m_impactWorldCoordsMins.y;
-				result.m_impactWorldCoords.z = result.m_impactWorldCoordsMins.z;
-
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords);
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(0.0f, 1.0f, 0.0f));
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(0.0f, 1.0f, 1.0f));
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(0.0f, 0.0f, 1.0f));
-			}
-			else if ((indexMinusPrevIndex & BLOCKINDEX_Y_MASK) == (1 << CHUNKS_WIDE_EXPONENT)){ //indexMinusPrevIndex y == 1
-				result.m_impactSurfaceNormal = Vec3(0.0f, -1.0f, 0.0f);
-				result.m_impactWorldCoordsMins = Vec3(floor(result.m_impactWorldCoords.x), floor(result.m_impactWorldCoords.y), floor(result.m_impactWorldCoords.z));
-				result.m_impactWorldCoords.x = result.m_impactWorldCoordsMins.x;
-				result.m_impactWorldCoords.y = result.m_impactWorldCoordsMins.y;
-				result.m_impactWorldCoords.z = result.m_impactWorldCoordsMins.z;
-
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords);
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(1.0f, 0.0f, 0.0f));
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(1.0f, 0.0f, 1.0f));
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(0.0f, 0.0f, 1.0f));
-			}
-			else/* if ((prevIndexMinusIndex & BLOCKINDEX_Y_MASK) == (1 << CHUNKS_WIDE_EXPONENT))*/{ //prevIndexMinusIndex y == 1
-				result.m_impactSurfaceNormal = Vec3(0.0f, 1.0f, 0.0f);
-				result.m_impactWorldCoordsMins = Vec3(floor(result.m_impactWorldCoords.x), floor(result.m_impactWorldCoords.y), floor(result.m_impactWorldCoords.z));
-				result.m_impactWorldCoords.x = result.m_impactWorldCoordsMins.x + 1;
-				result.m_impactWorldCoords.y = result.m_impactWorldCoordsMins.y + 1;
-				result.m_impactWorldCoords.z = result.m_impactWorldCoordsMins.z;
-
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords);
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(-1.0f, 0.0f, 0.0f));
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(-1.0f, 0.0f, 1.0f));
-				result.m_impactFaceCoords.push_back(result.m_impactWorldCoords + Vec3(0.0f, 0.0f, 1.0f));
-			}
-
-			return result;
-		}
-		previousIndex = index;
-	}
-	return result;
+	return RaycastBlocks(m_activeChunks, start, end);
 }
 
 ///=====================================================
@@ -1526,69 +1535,55 @@ void World::RenderSkybox(const OpenGLRenderer* renderer) const{
 ///=====================================================
 void World::PlaceBlockWithRaycast(BlockType blocktype, const Raycast3DResult& raycastResult, BlockLocations& dirtyBlocksList){
 	const WorldCoords newBlockCoords(raycastResult.m_impactWorldCoordsMins + raycastResult.m_impactSurfaceNormal);
-	BlockIndex index = Chunk::GetIndexAtWorldCoords(newBlockCoords);
-	ChunkCoords chunkCoords = Chunk::GetChunkCoordsAtWorldCoords(newBlockCoords);
-	Chunks::iterator chunkIter = m_activeChunks.find(chunkCoords);
-	if (chunkIter == m_activeChunks.end())
+	const BlockLocation newBlockLocation = WorldBlockAccessor(m_activeChunks).GetBlockLocationAtWorldCoords(newBlockCoords);
+	if (!newBlockLocation.m_chunk)
 		return;
 
-	Chunk* chunk = chunkIter->second;
-	Block& blockToChange = chunk->m_blocks[index];
-	if (blockToChange.m_type != BT_AIR){
+	Chunk* chunk = newBlockLocation.m_chunk;
+	BlockIndex index = newBlockLocation.m_index;
+	Block blockToChange = chunk->GetBlock(index);
+	if (chunk->GetBlockType(index) != BT_AIR){
 		return;
 	}
 
-	const Vec3s playerBoxContactPoints = GetPlayerBoxContactPoints();
-	for (Vec3s::const_iterator cornerIter = playerBoxContactPoints.begin(); cornerIter != playerBoxContactPoints.end(); ++cornerIter){
-		if (newBlockCoords == Vec3(floor(cornerIter->x), floor(cornerIter->y), floor(cornerIter->z))) //tried to place a block inside the player's box
-			return;
-	}
+	if (DoesBoxOverlapBlock(m_playerBox, RoundDownToInt(newBlockCoords.x), RoundDownToInt(newBlockCoords.y), RoundDownToInt(newBlockCoords.z))) //tried to place a block inside the player's box
+		return;
 
 	//Passing this confirms that a new block is being placed
 
-	bool wasSky = blockToChange.IsSky();
+	int column = index & CHUNK_LAYER_MASK;
+	int oldSkyHeight = chunk->GetSkyHeight(column);
+	bool wasSky = chunk->IsSky(index);
 
-	blockToChange.m_type = (unsigned char)blocktype;
-	chunk->m_isVboDirty = true;
-	if (wasSky)
-		blockToChange.UnmarkAsSky();
+	chunk->SetBlockType(index, (unsigned char)blocktype);
+	chunk->RecordBlockEdit(index);
+	chunk->DirtyMeshesAroundIndex(index);
 
-	const SoundIDs& placeSounds = blockToChange.GetPlaceSounds();
+	const SoundIDs& placeSounds = g_blockDefinitions[blocktype].m_placeSounds;
 	s_theSoundSystem->PlayRandomSound(placeSounds, 0, 0.25f);
 
 	//update block's and nearby blocks' lighting
-	blockToChange.SetLightValue(g_blockDefinitions[blockToChange.m_type].m_inherentLightValue);
 	BlockLocation blockLocation(chunk, index);
 	if (!blockToChange.IsLightingDirty()){
 		if (g_debugPointsEnabled)
 			g_debugPositions.push_back(chunk->GetWorldCoordsAtIndex(index));
 
-		dirtyBlocksList.push_back(blockLocation);
-		blockToChange.DirtyLighting();
+		chunk->DirtyLightingAtIndex(index, dirtyBlocksList);
 	}
 	DirtyNonopaqueNeighbors(blockLocation, true);
 
-	//update sky below placed block
+	//relight blocks below the placed block that are no longer sky
 	if (wasSky){
-		index -= BLOCKS_PER_CHUNK_LAYER;
-
-		while (index < BLOCKS_PER_CHUNK) {
-			Block& block = chunk->m_blocks[index];
-			if (block.m_type != BT_AIR){
-				return;
-			}
-
-			block.UnmarkAsSky();
+		for (int height = index / BLOCKS_PER_CHUNK_LAYER - 1; height >= oldSkyHeight; --height){
+			BlockIndex belowIndex = (BlockIndex)(column + height * BLOCKS_PER_CHUNK_LAYER);
+			Block block = chunk->GetBlock(belowIndex);
 
 			if (!block.IsLightingDirty()){
 				if (g_debugPointsEnabled)
-					g_debugPositions.push_back(chunk->GetWorldCoordsAtIndex(index));
+					g_debugPositions.push_back(chunk->GetWorldCoordsAtIndex(belowIndex));
 
-				BlockLocation blockLocation(chunk, index);
-				dirtyBlocksList.push_back(blockLocation);
-				block.DirtyLighting();
+				chunk->DirtyLightingAtIndex(belowIndex, dirtyBlocksList);
 			}
-			index -= BLOCKS_PER_CHUNK_LAYER;
 		}
 	}
 }
@@ -1597,194 +1592,58 @@ void World::PlaceBlockWithRaycast(BlockType blocktype, const Raycast3DResult& ra
 /// 
 ///=====================================================
 void World::DestroyBlockWithRaycast(const Raycast3DResult& raycastResult, BlockLocations& dirtyBlocksList){
-	BlockIndex index = Chunk::GetIndexAtWorldCoords(raycastResult.m_impactWorldCoordsMins);
-	ChunkCoords chunkCoords = Chunk::GetChunkCoordsAtWorldCoords(raycastResult.m_impactWorldCoordsMins);
-	Chunks::iterator chunkIter = m_activeChunks.find(chunkCoords);
-	if (chunkIter == m_activeChunks.end())
+	const BlockLocation impactLocation = WorldBlockAccessor(m_activeChunks).GetBlockLocationAtWorldCoords(raycastResult.m_impactWorldCoordsMins);
+	if (!impactLocation.m_chunk)
 		return;
 
-	Chunk* chunk = chunkIter->second;
-	Block& block = chunk->m_blocks[index];
+	Chunk* chunk = impactLocation.m_chunk;
+	BlockIndex index = impactLocation.m_index;
+	Block block = chunk->GetBlock(index);
 
-	const SoundIDs& breakSounds = block.GetBreakSounds();
+	const SoundIDs& breakSounds = chunk->GetBlockDefinition(index).m_breakSounds;
 	s_theSoundSystem->PlayRandomSound(breakSounds, 0, 0.25f);
 
-	block.m_type = BT_AIR;
+	chunk->SetBlockType(index, BT_AIR);
+	chunk->RecordBlockEdit(index);
 
-	chunk->m_isVboDirty = true;
+	chunk->DirtyMeshesAroundIndex(index);
 	if (!block.IsLightingDirty()){
 		if (g_debugPointsEnabled)
 			g_debugPositions.push_back(chunk->GetWorldCoordsAtIndex(index));
 
-		BlockLocation blockLocation(chunk, index);
-		dirtyBlocksList.push_back(blockLocation);
-		block.DirtyLighting();
-
-		//if we are on the edge of a chunk, dirty the adjacent chunk's VBO
-		BlockLocation locationToEast = GetBlockLocation(blockLocation, STEP_EAST);
-		if (locationToEast.m_chunk != chunk){
-			locationToEast.m_chunk->m_isVboDirty = true;
-		}
-		else{
-			BlockLocation locationToWest = GetBlockLocation(blockLocation, STEP_WEST);
-			if (locationToWest.m_chunk != chunk){
-				locationToWest.m_chunk->m_isVboDirty = true;
-			}
-		}
-		BlockLocation locationToNorth = GetBlockLocation(blockLocation, STEP_NORTH);
-		if (locationToNorth.m_chunk != chunk){
-			locationToNorth.m_chunk->m_isVboDirty = true;
-		}
-		else{
-			BlockLocation locationToSouth = GetBlockLocation(blockLocation, STEP_SOUTH);
-			if (locationToSouth.m_chunk != chunk){
-				locationToSouth.m_chunk->m_isVboDirty = true;
-			}
-		}
+		chunk->DirtyLightingAtIndex(index, dirtyBlocksList);
 	}
 
-	index += BLOCKS_PER_CHUNK_LAYER;
-	if (index < BLOCKS_PER_CHUNK){
-		Block& blockAbove = chunk->m_blocks[index];
-		if (blockAbove.IsSky()){
-			block.MarkAsSky();
-
-			index -= BLOCKS_PER_CHUNK_LAYER * 2;
-
-			while (index < BLOCKS_PER_CHUNK) {
-				Block& blockBelow = chunk->m_blocks[index];
-				if (blockBelow.m_type != BT_AIR){
-					return;
-				}
-
-				blockBelow.MarkAsSky();
-
-				if (!blockBelow.IsLightingDirty()){
-					if (g_debugPointsEnabled)
-						g_debugPositions.push_back(chunk->GetWorldCoordsAtIndex(index));
+	//relight blocks below the destroyed block that just became sky
+	if (chunk->IsSky(index)){
+		int column = index & CHUNK_LAYER_MASK;
+		for (int height = index / BLOCKS_PER_CHUNK_LAYER - 1; height >= chunk->GetSkyHeight(column); --height){
+			BlockIndex belowIndex = (BlockIndex)(column + height * BLOCKS_PER_CHUNK_LAYER);
+			Block blockBelow = chunk->GetBlock(belowIndex);
 
-					BlockLocation blockLocation(chunk, index);
-					dirtyBlocksList.push_back(blockLocation);
-					blockBelow.DirtyLighting();
-				}
+			if (!blockBelow.IsLightingDirty()){
+				if (g_debugPointsEnabled)
+					g_debugPositions.push_back(chunk->GetWorldCoordsAtIndex(belowIndex));
 
-				index -= BLOCKS_PER_CHUNK_LAYER;
+				chunk->DirtyLightingAtIndex(belowIndex, dirtyBlocksList);
 			}
 		}
 	}
 }
 
 ///=====================================================
-/// 
+/// uses the biome cached by the camera's chunk when it is active, so only the weather term is sampled
 ///=====================================================
-const BlockLocation World::GetBlockLocation(const BlockLocation& blockLocation, short indexOffset) const{
-	BlockLocation newBlockLocation(blockLocation);
-	if (indexOffset == STEP_EAST){ //block to east
-		if ((newBlockLocation.m_index & BLOCKINDEX_X_MASK) == BLOCKINDEX_X_MASK){
-			Chunk* chunkToEast = newBlockLocation.m_chunk->m_chunkToEast;
-			if (chunkToEast){
-				newBlockLocation.m_index -= BLOCKINDEX_X_MASK;
-				newBlockLocation.m_chunk = chunkToEast;
-			}
-			else
-				newBlockLocation.m_chunk = NULL;
-		}
-		else{
-			newBlockLocation.m_index += indexOffset;
-		}
-	}
-	else if (indexOffset == STEP_WEST){ //block to west
-		if ((newBlockLocation.m_index & BLOCKINDEX_X_MASK) == 0){
-			Chunk* chunkToWest = newBlockLocation.m_chunk->m_chunkToWest;
-			if (chunkToWest){
-				newBlockLocation.m_index += BLOCKINDEX_X_MASK;
-				newBlockLocation.m_chunk = chunkToWest;
-			}
-			else
-				newBlockLocation.m_chunk = NULL;
-		}
-		else{
-			newBlockLocation.m_index += indexOffset;
-		}
-	}
-	else if (indexOffset == STEP_NORTH){ //block to north
-		if ((newBlockLocation.m_index & BLOCKINDEX_Y_MASK) == BLOCKINDEX_Y_MASK){
-			Chunk* chunkToNorth = newBlockLocation.m_chunk->m_chunkToNorth;
-			if (chunkToNorth){
-				newBlockLocation.m_index -= BLOCKINDEX_Y_MASK;
-				newBlockLocation.m_chunk = chunkToNorth;
-			}
-			else
-				newBlockLocation.m_chunk = NULL;
-		}
-		else{
-			newBlockLocation.m_index += indexOffset;
-		}
-	}
-	else if (indexOffset == STEP_SOUTH){ //block to south
-		if ((newBlockLocation.m_index & BLOCKINDEX_Y_MASK) == 0){
-			Chunk* chunkToSouth = newBlockLocation.m_chunk->m_chunkToSouth;
-			if (chunkToSouth != NULL){
-				newBlockLocation.m_index += BLOCKINDEX_Y_MASK;
-				newBlockLocation.m_chunk = chunkToSouth;
-			}
-			else
-				newBlockLocation.m_chunk = NULL;
-		}
-		else{
-			newBlockLocation.m_index += indexOffset;
-		}
-	}
-	else if (indexOffset == STEP_UP || indexOffset == STEP_DOWN){ //block above or below
-		BlockIndex newIndex = (BlockIndex)(newBlockLocation.m_index + indexOffset);
-		if (newIndex < BLOCKS_PER_CHUNK)
-			newBlockLocation.m_index = newIndex;
-		else
-			newBlockLocation.m_chunk = NULL;
-	}
+bool World::IsRainingAtCamera() const{
+	if (!m_camera)
+		return false;
 
-	return newBlockLocation;
-}
-
-///=====================================================
-/// 
-///=====================================================
-const Vec3s World::GetPlayerBoxContactPoints() const{
-	Vec3s playerBoxContactPoints = m_playerBox.GetCorners();
-	float playerWaistHeight = (m_playerBox.maxs.z + m_playerBox.mins.z) * 0.5f;
-	playerBoxContactPoints.push_back(Vec3(m_playerBox.maxs.x, m_playerBox.maxs.y, playerWaistHeight));
-	playerBoxContactPoints.push_back(Vec3(m_playerBox.mins.x, m_playerBox.maxs.y, playerWaistHeight));
-	playerBoxContactPoints.push_back(Vec3(m_playerBox.maxs.x, m_playerBox.mins.y, playerWaistHeight));
-	playerBoxContactPoints.push_back(Vec3(m_playerBox.mins.x, m_playerBox.mins.y, playerWaistHeight));
-	return playerBoxContactPoints;
-}
+	Chunk* chunk = WorldBlockAccessor(m_activeChunks).GetChunkAtWorldCoords(m_camera->m_position);
+	if (!chunk)
+		return Chunk::IsRainingAtWorldCoords(m_camera->m_position);
 
-///=====================================================
-/// Returns False if player is not inside the world
-///=====================================================
-#pragma warning(disable:4127)
-bool World::MovePlayerWhenStuckInsideBlocks(){
-	while (true){ //while the player is stuck inside blocks, move him up
-		const Vec3s playerBoxContactPoints = GetPlayerBoxContactPoints();
-
-		for (Vec3s::const_iterator cornerIter = playerBoxContactPoints.begin(); cornerIter != playerBoxContactPoints.end(); ++cornerIter){
-			const ChunkCoords chunkCoords = Chunk::GetChunkCoordsAtWorldCoords(*cornerIter);
-			Chunks::const_iterator chunkIter = m_activeChunks.find(chunkCoords);
-			if (chunkIter == m_activeChunks.end())
-				return false;
-			Chunk* chunk = chunkIter->second;
-			BlockIndex index = chunk->GetIndexAtWorldCoords(*cornerIter);
-
-			if (g_blockDefinitions[chunk->m_blocks[index].m_type].m_isSolid){ //a corner began inside a solid block
-				const static Vec3 MOVE_UP(0.0f, 0.0f, 0.1f);
-				m_playerBox.Translate(MOVE_UP);
-				m_camera->m_position += MOVE_UP;
-			}
-			else{
-				return true;
-			}
-		}
-	}
+	const LocalCoords localCoords = Chunk::GetLocalCoordsAtWorldCoords(m_camera->m_position);
+	return chunk->IsRainingAtColumn(localCoords.x | (localCoords.y << CHUNKS_WIDE_EXPONENT));
 }
 
 ///=====================================================
@@ -1794,7 +1653,7 @@ void World::UpdateSoundAndMusic(double deltaSeconds){
 	if (!m_currentMusic || !m_currentMusic->IsPlaying())
 		m_currentMusic = s_theSoundSystem->PlayRandomSound(m_music);
 
-	bool isRainingAtPlayer = Chunk::IsRainingAtWorldCoords(m_camera->m_position);
+	bool isRainingAtPlayer = m_isRainingAtCamera;
 	if (isRainingAtPlayer && (!m_currentRainSound || !m_currentRainSound->IsPlaying())){
 		m_currentRainSound = s_theSoundSystem->PlaySound(m_rainSound, -1);
 	}
@@ -1822,18 +1681,16 @@ void World::UpdateSoundAndMusic(double deltaSeconds){
 		playerBoxBase.push_back(Vec3(m_playerBox.maxs.x, m_playerBox.maxs.y, m_playerBox.mins.z - 0.01f));
 
 		SoundIDs currentWalkSounds;
+		WorldBlockAccessor blockAccessor(m_activeChunks);
 
 		for (Vec3s::const_iterator pointIter = playerBoxBase.begin(); pointIter != playerBoxBase.end(); ++pointIter){
-			const ChunkCoords chunkCoords = Chunk::GetChunkCoordsAtWorldCoords(*pointIter);
-			Chunks::const_iterator chunkIter = m_activeChunks.find(chunkCoords);
-			if (chunkIter == m_activeChunks.end())
+			const BlockLocation pointLocation = blockAccessor.GetBlockLocationAtWorldCoords(*pointIter);
+			if (!pointLocation.m_chunk)
 				break;
-			Chunk* chunk = chunkIter->second;
-			BlockIndex index = chunk->GetIndexAtWorldCoords(*pointIter);
-			const Block& block = chunk->m_blocks[index];
+			const BlockDefinition& blockDef = GetBlockDefinition(pointLocation);
 
-			if (g_blockDefinitions[block.m_type].m_isSolid){
-				const SoundIDs& walkSounds = block.GetWalkSounds();
+			if (blockDef.m_isSolid){
+				const SoundIDs& walkSounds = blockDef.m_walkSounds;
 				assert(!walkSounds.empty());
 				currentWalkSounds.push_back(walkSounds.at(GetRandomIntInRange(0, walkSounds.size() - 1)));
 			}
@@ -9,24 +9,63 @@
 #define __included_World__
 
 #include "Engine/Math/AABB3D.hpp"
-#include "Chunk.hpp"
+#include "ChunkRegistry.hpp"
+#include "ChunkPool.hpp"
+#include "JobSystem.hpp"
+#include "LightPropagator.hpp"
+#include "RegionFile.hpp"
 class Camera;
 class AnimatedTexture;
 class InputSystem;
+class ChunkSaveJob;
+class ChunkMeshJob;
 
 const unsigned char DAYLIGHT = 15;
 const unsigned char MEDIUMLIGHT = 10;
 const unsigned char MOONLIGHT = 6;
 
+const int DEFAULT_MAX_LIGHT_UPDATES_PER_FRAME = 32768; //dirty blocks admitted plus blocks propagated, roughly a millisecond of relighting
+const int MAX_VBO_LIGHTING_REFRESHES_PER_FRAME = 16; //chunks recolored after the sky light level changes
+const int NUM_CHUNK_IO_THREADS = 1; //region files aren't thread-safe, so one thread does every chunk read and write
+const int NUM_CHUNK_IO_LATENCY_SAMPLES = 256;
+
 extern Vec3s g_debugPositions;
 extern bool g_debugPointsEnabled;
 
 class World{
 private:
 	Chunks m_activeChunks;
+	ChunkPool m_chunkPool;
+	Chunks m_generatingChunks; //being loaded or generated
+	RegionFileCache m_regionFiles;
+	SavedChunkIndex m_savedChunks; //main thread only; includes chunks whose saves are still queued
+	JobSystem m_jobSystem;
+	JobSystem m_ioJobSystem;
+	std::vector<ChunkSaveJob*> m_pendingChunkSaves; //oldest first; a coordinate can have several while it's reloaded and unloaded again
+	int m_numPendingChunkLoads;
+	int m_numCoalescedChunkLoads;
+	int m_numChunkSavesSkipped;
+	int m_numChunkLoadsSkipped;
+	size_t m_numChunkBytesSaved;
+	std::vector<float> m_chunkIOLatencies; //milliseconds from submission to completion, for the most recent loads and saves
+	size_t m_nextChunkIOLatencySample;
+	Jobs m_completedJobs;
+	std::vector<ChunkMeshJob*> m_freeMeshJobs; //landed mesh jobs, reused so meshing doesn't allocate
+	std::vector<std::pair<int, ChunkCoords> > m_neededChunkCandidates;
+	unsigned int m_nextMeshRevision;
+	int m_numPendingMeshes;
+	int m_numMeshesCompletedThisFrame;
 	BlockLocations m_dirtyBlocks;
 	BlockLocations m_nextDirtyBlocksDebug;
+	size_t m_numSortedDirtyBlocks; //how many of m_dirtyBlocks are still in sorted order; 0 if they were never sorted
+	LocalCoords m_dirtyBlocksSortCameraCoords; //the camera's block when m_dirtyBlocks was last sorted
+	std::vector<unsigned int> m_dirtyBlockDistanceKeys;
+	std::vector<unsigned int> m_dirtyBlockSortOrder;
+	BlockLocations m_sortedDirtyBlocks;
 	unsigned char m_lightLevel;
+	LightPropagator m_lightPropagator;
+	int m_maxLightUpdatesPerFrame;
+	int m_numLightUpdatesThisFrame;
 	bool m_isRunning;
 	AnimatedTexture* m_textureAtlas;
 	AnimatedTexture* m_skybox;
@@ -42,6 +81,7 @@ private:
 	bool m_playerIsNoClip;
 	bool m_playerIsOnGround;
 	bool m_playerIsInWater;
+	bool m_isRainingAtCamera;
 	bool m_playerIsOnIce;
 	BlockType m_selectedBlockType;
 	double m_countUntilNextWalkSound;
@@ -60,18 +100,24 @@ private:
 	void PlaceBlockWithRaycast(BlockType blocktype, const Raycast3DResult& raycastResult, BlockLocations& dirtyBlocksList);
 	void DestroyBlockWithRaycast(const Raycast3DResult& raycastResult, BlockLocations& dirtyBlocksList);
 
-	void ActivateNearestNeededChunk();
+	void ActivateNearestNeededChunks();
 	void DeactivateFurthestChunk(const OpenGLRenderer* renderer);
 	void ActivateChunk(const ChunkCoords& chunkCoords);
+	void AddActiveChunk(const ChunkCoords& chunkCoords, Chunk* newChunk);
+	void RequestChunkGeneration(const ChunkCoords& chunkCoords);
+	void RequestChunkLoad(const ChunkCoords& chunkCoords);
+	const ChunkSaveJob* FindPendingChunkSave(const ChunkCoords& chunkCoords) const;
+	void RecordChunkIOLatency(float latencyMilliseconds);
+	void ProcessCompletedJobs(const OpenGLRenderer* renderer);
+	void RequestDirtyChunkMeshes();
 	void DeactivateChunk(const ChunkCoords& chunkCoords, const OpenGLRenderer* renderer);
 	void OnChunkActivated(Chunk* chunk);
+	int GetHighestNeighborSkyHeight(const Chunk* chunk, int column) const;
 	void OnChunkDeactivated(const ChunkCoords& chunkCoords);
 
 	bool IsChunkActive(const ChunkCoords& chunkCoords) const;
 
-	Chunk* CreateChunkFromPerlinNoise(const ChunkCoords& chunkCoords) const;
-	Chunk* CreateChunkFromFile(const ChunkCoords& chunkCoords) const;
-	void SaveChunkToFile(const ChunkCoords& chunkCoords) const;
+	void SaveChunkToFile(const ChunkCoords& chunkCoords);
 
 	void RenderSkybox(const OpenGLRenderer* renderer) const;
 	void RenderDebugPoints(const OpenGLRenderer* renderer) const;
@@ -88,18 +134,19 @@ private:
 	void UpdatePlayerVelocityFromInput(float deltaSeconds);
 	void UpdatePlayerMovementModeFromInput();
 	void UpdatePlayerVelocityFromGravity(float deltaSeconds);
-	const Raycast3DResult MovePlayerWithRaycast(const Vec3& totalPlayerTranslation);
-	const Vec3s GetPlayerBoxContactPoints() const;
-	bool MovePlayerWhenStuckInsideBlocks();
+	void MovePlayerWithCollision(const Vec3& totalPlayerTranslation);
 
 	void UpdateLighting();
-	void UpdateLightingForBlock(const BlockLocation& blockLocation);
+	void SortDirtyBlocksNearestLast();
+	void RefreshChunkVboLighting(const OpenGLRenderer* renderer);
 
 	void UpdateSoundAndMusic(double deltaSeconds);
+	bool IsRainingAtCamera() const;
 
-	const BlockLocation GetBlockLocation(const BlockLocation& blockLocation, short indexOffset) const;
-	unsigned char CalculateIdealLightingForBlock(const BlockLocation& blockLocation) const;
-	Block& GetBlock(const BlockLocation& blockLocation) const;
+	Block GetBlock(const BlockLocation& blockLocation) const;
+	unsigned char GetLightValue(const BlockLocation& blockLocation) const;
+	unsigned char GetBlockType(const BlockLocation& blockLocation) const;
+	const BlockDefinition& GetBlockDefinition(const BlockLocation& blockLocation) const;
 
 	void UpdateBlockSelectionTab();
 
@@ -112,13 +159,49 @@ public:
 	void Startup();
 	void Shutdown(const OpenGLRenderer* renderer);
 	inline bool IsRunning() const{return m_isRunning;}
+	inline const ChunkPool& GetChunkPool() const{return m_chunkPool;}
+	inline int GetNumPendingMeshes() const{return m_numPendingMeshes;}
+	inline int GetNumMeshesCompletedThisFrame() const{return m_numMeshesCompletedThisFrame;}
+	inline int GetNumPendingChunkIO() const{return m_numPendingChunkLoads + (int)m_pendingChunkSaves.size();}
+	inline int GetNumCoalescedChunkLoads() const{return m_numCoalescedChunkLoads;}
+	inline int GetNumChunkSavesSkipped() const{return m_numChunkSavesSkipped;}
+	inline int GetNumChunkLoadsSkipped() const{return m_numChunkLoadsSkipped;}
+	inline int GetNumSavedChunks() const{return m_savedChunks.GetNumSavedChunks();}
+	inline size_t GetNumChunkBytesSaved() const{return m_numChunkBytesSaved;}
+	float GetChunkIOLatencyPercentile(float percentile) const;
+	inline int GetNumQueuedLightUpdates() const{return (int)(m_dirtyBlocks.size() + m_lightPropagator.GetNumQueuedBlocks());}
+	inline int GetNumLightUpdatesThisFrame() const{return m_numLightUpdatesThisFrame;}
+	inline void SetMaxLightUpdatesPerFrame(int maxLightUpdatesPerFrame){m_maxLightUpdatesPerFrame = maxLightUpdatesPerFrame;}
+	inline unsigned char GetLightLevel() const{return m_lightLevel;}
+	void SetLightLevel(unsigned char lightLevel);
 };
 
 ///=====================================================
 /// 
 ///=====================================================
-inline Block& World::GetBlock(const BlockLocation& blockLocation) const{
-	return blockLocation.m_chunk->m_blocks[blockLocation.m_index];
+inline Block World::GetBlock(const BlockLocation& blockLocation) const{
+	return blockLocation.m_chunk->GetBlock(blockLocation.m_index);
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline unsigned char World::GetLightValue(const BlockLocation& blockLocation) const{
+	return blockLocation.m_chunk->m_lightValues[blockLocation.m_index];
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline unsigned char World::GetBlockType(const BlockLocation& blockLocation) const{
+	return blockLocation.m_chunk->GetBlockType(blockLocation.m_index);
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline const BlockDefinition& World::GetBlockDefinition(const BlockLocation& blockLocation) const{
+	return blockLocation.m_chunk->GetBlockDefinition(blockLocation.m_index);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,81 @@
+//=====================================================
+// WorldBlockAccessor.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "WorldBlockAccessor.hpp"
+
+struct NeighborStep{
+	BlockIndex m_edgeMask; //the block is on the chunk's edge in this direction when (index & m_edgeMask) == m_edgeValue
+	BlockIndex m_edgeValue;
+	short m_indexStepWithinChunk;
+	short m_indexStepAcrossChunks;
+	Chunk* Chunk::* m_neighborChunk; //NULL where there is no chunk past the edge
+};
+
+//indexed by BlockFace
+const NeighborStep NEIGHBOR_STEPS[NUM_BLOCK_FACES] = {
+	{ BLOCKINDEX_Z_MASK, BLOCKINDEX_Z_MASK, STEP_UP, 0, NULL },
+	{ BLOCKINDEX_Z_MASK, 0, STEP_DOWN, 0, NULL },
+	{ BLOCKINDEX_Y_MASK, BLOCKINDEX_Y_MASK, STEP_NORTH, -(short)BLOCKINDEX_Y_MASK, &Chunk::m_chunkToNorth },
+	{ BLOCKINDEX_Y_MASK, 0, STEP_SOUTH, (short)BLOCKINDEX_Y_MASK, &Chunk::m_chunkToSouth },
+	{ BLOCKINDEX_X_MASK, BLOCKINDEX_X_MASK, STEP_EAST, -(short)BLOCKINDEX_X_MASK, &Chunk::m_chunkToEast },
+	{ BLOCKINDEX_X_MASK, 0, STEP_WEST, (short)BLOCKINDEX_X_MASK, &Chunk::m_chunkToWest }
+};
+
+///=====================================================
+/// 
+///=====================================================
+WorldBlockAccessor::WorldBlockAccessor(const Chunks& chunks)
+:m_chunks(chunks),
+m_cachedChunk(NULL),
+m_cachedChunkCoords(0, 0){
+}
+
+///=====================================================
+/// returns NULL if the chunk isn't active
+///=====================================================
+Chunk* WorldBlockAccessor::GetChunkAtChunkCoords(const ChunkCoords& chunkCoords){
+	if (m_cachedChunk != NULL){
+		const int deltaX = chunkCoords.x - m_cachedChunkCoords.x;
+		const int deltaY = chunkCoords.y - m_cachedChunkCoords.y;
+		if (deltaX == 0 && deltaY == 0)
+			return m_cachedChunk;
+
+		Chunk* neighborChunk = NULL;
+		if (deltaY == 0){
+			if (deltaX == 1) neighborChunk = m_cachedChunk->m_chunkToEast;
+			else if (deltaX == -1) neighborChunk = m_cachedChunk->m_chunkToWest;
+		}
+		else if (deltaX == 0){
+			if (deltaY == 1) neighborChunk = m_cachedChunk->m_chunkToNorth;
+			else if (deltaY == -1) neighborChunk = m_cachedChunk->m_chunkToSouth;
+		}
+
+		if (neighborChunk != NULL){
+			m_cachedChunk = neighborChunk;
+			m_cachedChunkCoords = chunkCoords;
+			return neighborChunk;
+		}
+	}
+
+	Chunks::const_iterator chunkIter = m_chunks.find(chunkCoords);
+	if (chunkIter == m_chunks.end())
+		return NULL;
+
+	m_cachedChunk = chunkIter->second;
+	m_cachedChunkCoords = chunkCoords;
+	return m_cachedChunk;
+}
+
+///=====================================================
+/// m_chunk is NULL if the neighbor is outside the world or in a chunk that isn't active
+///=====================================================
+const BlockLocation WorldBlockAccessor::GetNeighborBlockLocation(const BlockLocation& blockLocation, BlockFace face){
+	const NeighborStep& step = NEIGHBOR_STEPS[face];
+	if ((blockLocation.m_index & step.m_edgeMask) != step.m_edgeValue)
+		return BlockLocation(blockLocation.m_chunk, (BlockIndex)(blockLocation.m_index + step.m_indexStepWithinChunk));
+
+	Chunk* neighborChunk = (step.m_neighborChunk != NULL) ? blockLocation.m_chunk->*step.m_neighborChunk : NULL;
+	return BlockLocation(neighborChunk, (BlockIndex)(blockLocation.m_index + step.m_indexStepAcrossChunks));
+}
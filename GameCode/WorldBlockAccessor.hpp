@@ -0,0 +1,68 @@
+//=====================================================
+// WorldBlockAccessor.hpp
+// by Andrew Socha
+//=====================================================
+
+#pragma once
+
+#ifndef __included_WorldBlockAccessor__
+#define __included_WorldBlockAccessor__
+
+#include "ChunkRegistry.hpp"
+
+///=====================================================
+/// Resolves world block coordinates to locations in the active chunks.
+/// Remembers the last chunk it found, so lookups in that chunk or one of its four neighbors skip the registry.
+/// Only keep one for a single pass over the world, since the remembered chunk can be deactivated between frames.
+///=====================================================
+class WorldBlockAccessor{
+private:
+	const Chunks& m_chunks;
+	Chunk* m_cachedChunk;
+	ChunkCoords m_cachedChunkCoords;
+
+	WorldBlockAccessor& operator=(const WorldBlockAccessor&);
+
+public:
+	explicit WorldBlockAccessor(const Chunks& chunks);
+
+	Chunk* GetChunkAtChunkCoords(const ChunkCoords& chunkCoords);
+	Chunk* GetChunkAtBlockCoords(int blockX, int blockY);
+	Chunk* GetChunkAtWorldCoords(const WorldCoords& worldCoords);
+	const BlockLocation GetBlockLocationAtBlockCoords(int blockX, int blockY, int blockZ);
+	const BlockLocation GetBlockLocationAtWorldCoords(const WorldCoords& worldCoords);
+
+	static const BlockLocation GetNeighborBlockLocation(const BlockLocation& blockLocation, BlockFace face);
+};
+
+///=====================================================
+/// 
+///=====================================================
+inline Chunk* WorldBlockAccessor::GetChunkAtBlockCoords(int blockX, int blockY){
+	return GetChunkAtChunkCoords(ChunkCoords(blockX >> CHUNKS_WIDE_EXPONENT, blockY >> CHUNKS_LONG_EXPONENT));
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline Chunk* WorldBlockAccessor::GetChunkAtWorldCoords(const WorldCoords& worldCoords){
+	return GetChunkAtChunkCoords(Chunk::GetChunkCoordsAtWorldCoords(worldCoords));
+}
+
+///=====================================================
+/// m_chunk is NULL if the block is outside the active chunks
+///=====================================================
+inline const BlockLocation WorldBlockAccessor::GetBlockLocationAtBlockCoords(int blockX, int blockY, int blockZ){
+	if ((unsigned int)blockZ >= (unsigned int)BLOCKS_PER_CHUNK_Z)
+		return BlockLocation(NULL, 0);
+	return BlockLocation(GetChunkAtBlockCoords(blockX, blockY), Chunk::GetIndexAtLocalCoords(LocalCoords(blockX & CHUNK_X_MASK, blockY & CHUNK_Y_MASK, blockZ)));
+}
+
+///=====================================================
+/// 
+///=====================================================
+inline const BlockLocation WorldBlockAccessor::GetBlockLocationAtWorldCoords(const WorldCoords& worldCoords){
+	return GetBlockLocationAtBlockCoords(RoundDownToInt(worldCoords.x), RoundDownToInt(worldCoords.y), RoundDownToInt(worldCoords.z));
+}
+
+#endif
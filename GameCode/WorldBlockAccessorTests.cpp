@@ -0,0 +1,205 @@
+//=====================================================
+// WorldBlockAccessorTests.cpp
+// by Andrew Socha
+//=====================================================
+
+#include "TestHarness.hpp"
+#include "TestWorld.hpp"
+#include "WorldBlockAccessor.hpp"
+#include "Engine/Time/Time.hpp"
+#include <stdio.h>
+#include <vector>
+
+const int ACCESSOR_TEST_CHUNKS_RADIUS = 6; //a 12x12 set of linked chunks
+const int NUM_ACCESSOR_TEST_LOOKUPS = 200000;
+const int NUM_ACCESSOR_BENCHMARK_LOOKUPS = 4000000;
+
+///=====================================================
+/// 
+///=====================================================
+static unsigned int GetNextTestRandom(unsigned int& state){
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+///=====================================================
+/// the chunks span block coords [-96, 96) on x and y
+///=====================================================
+static void AddAccessorTestChunks(TestWorld& testWorld){
+	testWorld.AddAirChunks(ChunkCoords(-ACCESSOR_TEST_CHUNKS_RADIUS, -ACCESSOR_TEST_CHUNKS_RADIUS), ChunkCoords(ACCESSOR_TEST_CHUNKS_RADIUS - 1, ACCESSOR_TEST_CHUNKS_RADIUS - 1));
+}
+
+///=====================================================
+/// the lookup every call site made before the accessor: find the chunk in the registry, then the index within it
+///=====================================================
+static const BlockLocation GetBlockLocationFromRegistry(const Chunks& chunks, int blockX, int blockY, int blockZ){
+	if ((unsigned int)blockZ >= (unsigned int)BLOCKS_PER_CHUNK_Z)
+		return BlockLocation(NULL, 0);
+
+	Chunks::const_iterator chunkIter = chunks.find(ChunkCoords(blockX >> CHUNKS_WIDE_EXPONENT, blockY >> CHUNKS_LONG_EXPONENT));
+	Chunk* chunk = (chunkIter == chunks.end()) ? NULL : chunkIter->second;
+	return BlockLocation(chunk, Chunk::GetIndexAtLocalCoords(LocalCoords(blockX & CHUNK_X_MASK, blockY & CHUNK_Y_MASK, blockZ)));
+}
+
+///=====================================================
+/// 
+///=====================================================
+static bool AreSameBlockLocation(const BlockLocation& blockLocation, const BlockLocation& otherBlockLocation){
+	if (blockLocation.m_chunk == NULL || otherBlockLocation.m_chunk == NULL)
+		return blockLocation.m_chunk == otherBlockLocation.m_chunk;
+	return blockLocation.m_chunk == otherBlockLocation.m_chunk && blockLocation.m_index == otherBlockLocation.m_index;
+}
+
+///=====================================================
+/// one step of a walk that moves to a face neighbor each lookup, wrapping at the edges of the chunks so it stays in the world
+///=====================================================
+static void StepRandomWalk(unsigned int& state, int& blockX, int& blockY, int& blockZ){
+	const int worldBlocksRadius = ACCESSOR_TEST_CHUNKS_RADIUS * BLOCKS_PER_CHUNK_X;
+	const unsigned int roll = GetNextTestRandom(state) % 6;
+	const int step = (roll & 1) ? 1 : -1;
+	if (roll < 2)
+		blockX = ((blockX + step + worldBlocksRadius * 3) % (worldBlocksRadius * 2)) - worldBlocksRadius;
+	else if (roll < 4)
+		blockY = ((blockY + step + worldBlocksRadius * 3) % (worldBlocksRadius * 2)) - worldBlocksRadius;
+	else
+		blockZ = (blockZ + step + BLOCKS_PER_CHUNK_Z) % BLOCKS_PER_CHUNK_Z;
+}
+
+///=====================================================
+/// Random lookups, including ones outside the active chunks and above or below the world, then a walk that crosses chunk edges
+///=====================================================
+static void TestAccessorMatchesRegistry(){
+	TestWorld testWorld;
+	AddAccessorTestChunks(testWorld);
+	WorldBlockAccessor blockAccessor(testWorld.m_chunks);
+	unsigned int state = 17u;
+
+	const int lookupBlocksWidth = (ACCESSOR_TEST_CHUNKS_RADIUS + 2) * BLOCKS_PER_CHUNK_X * 2;
+	bool doRandomLookupsMatch = true;
+	for (int lookup = 0; lookup < NUM_ACCESSOR_TEST_LOOKUPS; ++lookup){
+		const int blockX = (int)(GetNextTestRandom(state) % lookupBlocksWidth) - lookupBlocksWidth / 2;
+		const int blockY = (int)(GetNextTestRandom(state) % lookupBlocksWidth) - lookupBlocksWidth / 2;
+		const int blockZ = (int)(GetNextTestRandom(state) % (BLOCKS_PER_CHUNK_Z + 4)) - 2;
+		const BlockLocation blockLocation = blockAccessor.GetBlockLocationAtBlockCoords(blockX, blockY, blockZ);
+		doRandomLookupsMatch = doRandomLookupsMatch && AreSameBlockLocation(blockLocation, GetBlockLocationFromRegistry(testWorld.m_chunks, blockX, blockY, blockZ));
+	}
+	TEST_CHECK(doRandomLookupsMatch);
+
+	int blockX = 0;
+	int blockY = 0;
+	int blockZ = BLOCKS_PER_CHUNK_Z / 2;
+	bool doWalkLookupsMatch = true;
+	for (int lookup = 0; lookup < NUM_ACCESSOR_TEST_LOOKUPS; ++lookup){
+		StepRandomWalk(state, blockX, blockY, blockZ);
+		const BlockLocation blockLocation = blockAccessor.GetBlockLocationAtWorldCoords(WorldCoords(blockX + 0.5f, blockY + 0.5f, blockZ + 0.5f));
+		const BlockLocation registryBlockLocation = GetBlockLocationFromRegistry(testWorld.m_chunks, blockX, blockY, blockZ);
+		doWalkLookupsMatch = doWalkLookupsMatch && registryBlockLocation.m_chunk != NULL && AreSameBlockLocation(blockLocation, registryBlockLocation);
+	}
+	TEST_CHECK(doWalkLookupsMatch);
+}
+
+///=====================================================
+/// Each face neighbor found from the index alone should be the block found from its coords, across chunk edges too
+///=====================================================
+static void TestNeighborLocationsMatchBlockCoords(){
+	TestWorld testWorld;
+	AddAccessorTestChunks(testWorld);
+	WorldBlockAccessor blockAccessor(testWorld.m_chunks);
+	unsigned int state = 99u;
+
+	const int faceOffsets[NUM_BLOCK_FACES][3] = {{0, 0, 1}, {0, 0, -1}, {0, 1, 0}, {0, -1, 0}, {1, 0, 0}, {-1, 0, 0}};
+	const int worldBlocksWidth = ACCESSOR_TEST_CHUNKS_RADIUS * BLOCKS_PER_CHUNK_X * 2;
+	bool doNeighborsMatch = true;
+	for (int lookup = 0; lookup < NUM_ACCESSOR_TEST_LOOKUPS; ++lookup){
+		//bias toward chunk edges, where the neighbor is in another chunk or outside the world
+		int blockX = (int)(GetNextTestRandom(state) % worldBlocksWidth) - worldBlocksWidth / 2;
+		int blockY = (int)(GetNextTestRandom(state) % worldBlocksWidth) - worldBlocksWidth / 2;
+		int blockZ = (int)(GetNextTestRandom(state) % BLOCKS_PER_CHUNK_Z);
+		if ((lookup & 1) == 0)
+			blockX = (blockX & ~CHUNK_X_MASK) | ((GetNextTestRandom(state) & 1) ? CHUNK_X_MASK : 0);
+		if ((lookup & 2) == 0)
+			blockY = (blockY & ~CHUNK_Y_MASK) | ((GetNextTestRandom(state) & 1) ? CHUNK_Y_MASK : 0);
+		if ((lookup & 12) == 0)
+			blockZ = (GetNextTestRandom(state) & 1) ? BLOCKS_PER_CHUNK_Z - 1 : 0;
+
+		const BlockLocation blockLocation = blockAccessor.GetBlockLocationAtBlockCoords(blockX, blockY, blockZ);
+		for (int face = 0; face < NUM_BLOCK_FACES; ++face){
+			const BlockLocation neighborLocation = WorldBlockAccessor::GetNeighborBlockLocation(blockLocation, (BlockFace)face);
+			const BlockLocation registryNeighborLocation = GetBlockLocationFromRegistry(testWorld.m_chunks, blockX + faceOffsets[face][0], blockY + faceOffsets[face][1], blockZ + faceOffsets[face][2]);
+			doNeighborsMatch = doNeighborsMatch && AreSameBlockLocation(neighborLocation, registryNeighborLocation);
+		}
+	}
+	TEST_CHECK(doNeighborsMatch);
+}
+
+///=====================================================
+/// nanoseconds per lookup through the registry and through the accessor, over the same block coords
+///=====================================================
+static void TimeLookups(const Chunks& chunks, const std::vector<int>& blockCoords, double& out_registryNanoseconds, double& out_accessorNanoseconds){
+	const int numLookups = (int)blockCoords.size() / 3;
+	size_t registryChecksum = 0;
+	double startSeconds = GetCurrentSeconds();
+	for (int lookup = 0; lookup < numLookups; ++lookup){
+		const BlockLocation blockLocation = GetBlockLocationFromRegistry(chunks, blockCoords[lookup * 3], blockCoords[lookup * 3 + 1], blockCoords[lookup * 3 + 2]);
+		registryChecksum += (size_t)blockLocation.m_chunk + blockLocation.m_index;
+	}
+	out_registryNanoseconds = (GetCurrentSeconds() - startSeconds) * 1e9 / numLookups;
+
+	WorldBlockAccessor blockAccessor(chunks);
+	size_t accessorChecksum = 0;
+	startSeconds = GetCurrentSeconds();
+	for (int lookup = 0; lookup < numLookups; ++lookup){
+		const BlockLocation blockLocation = blockAccessor.GetBlockLocationAtBlockCoords(blockCoords[lookup * 3], blockCoords[lookup * 3 + 1], blockCoords[lookup * 3 + 2]);
+		accessorChecksum += (size_t)blockLocation.m_chunk + blockLocation.m_index;
+	}
+	out_accessorNanoseconds = (GetCurrentSeconds() - startSeconds) * 1e9 / numLookups;
+	TEST_CHECK(registryChecksum == accessorChecksum);
+}
+
+///=====================================================
+/// Lookups scattered over the whole 12x12 set of chunks, then a walk to a face neighbor each lookup, like a raycast or collision sweep
+///=====================================================
+static void BenchmarkAccessorLookups(){
+	TestWorld testWorld;
+	AddAccessorTestChunks(testWorld);
+	unsigned int state = 5u;
+
+	const int worldBlocksWidth = ACCESSOR_TEST_CHUNKS_RADIUS * BLOCKS_PER_CHUNK_X * 2;
+	std::vector<int> randomBlockCoords;
+	randomBlockCoords.reserve(NUM_ACCESSOR_BENCHMARK_LOOKUPS * 3);
+	for (int lookup = 0; lookup < NUM_ACCESSOR_BENCHMARK_LOOKUPS; ++lookup){
+		randomBlockCoords.push_back((int)(GetNextTestRandom(state) % worldBlocksWidth) - worldBlocksWidth / 2);
+		randomBlockCoords.push_back((int)(GetNextTestRandom(state) % worldBlocksWidth) - worldBlocksWidth / 2);
+		randomBlockCoords.push_back((int)(GetNextTestRandom(state) % BLOCKS_PER_CHUNK_Z));
+	}
+
+	std::vector<int> walkBlockCoords;
+	walkBlockCoords.reserve(NUM_ACCESSOR_BENCHMARK_LOOKUPS * 3);
+	int blockX = 0;
+	int blockY = 0;
+	int blockZ = BLOCKS_PER_CHUNK_Z / 2;
+	for (int lookup = 0; lookup < NUM_ACCESSOR_BENCHMARK_LOOKUPS; ++lookup){
+		StepRandomWalk(state, blockX, blockY, blockZ);
+		walkBlockCoords.push_back(blockX);
+		walkBlockCoords.push_back(blockY);
+		walkBlockCoords.push_back(blockZ);
+	}
+
+	double randomRegistryNanoseconds, randomAccessorNanoseconds;
+	TimeLookups(testWorld.m_chunks, randomBlockCoords, randomRegistryNanoseconds, randomAccessorNanoseconds);
+	double walkRegistryNanoseconds, walkAccessorNanoseconds;
+	TimeLookups(testWorld.m_chunks, walkBlockCoords, walkRegistryNanoseconds, walkAccessorNanoseconds);
+
+	printf("  random access: registry find %.1f ns, accessor %.1f ns\n", randomRegistryNanoseconds, randomAccessorNanoseconds);
+	printf("  coherent random walk: registry find %.1f ns, accessor %.1f ns\n", walkRegistryNanoseconds, walkAccessorNanoseconds);
+}
+
+///=====================================================
+/// 
+///=====================================================
+void RunWorldBlockAccessorTests(){
+	printf("World block accessor\n");
+	TestAccessorMatchesRegistry();
+	TestNeighborLocationsMatchBlockCoords();
+	BenchmarkAccessorLookups();
+}